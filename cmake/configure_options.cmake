@@ -5,6 +5,7 @@
 
 set ( SHELL ${ENABLE_SHELL} )
 set ( UNIT_TEST ${ENABLE_UNIT_TESTS} )
+set ( BENCHMARK_TEST ${ENABLE_BENCHMARK_TESTS} )
 set ( PIGLET ${ENABLE_PIGLET} )
 
 if ( NOT ENABLE_COREFILES )
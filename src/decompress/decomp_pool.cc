@@ -0,0 +1,459 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// decomp_pool.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "decomp_pool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "main/thread.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+static const PegInfo decomp_pegs[] =
+{
+    { CountType::SUM, "inflate_contexts", "inflate contexts handed to decompressors" },
+    { CountType::SUM, "inflate_reuses", "inflate contexts recycled from the pool" },
+    { CountType::SUM, "lzma_contexts", "lzma contexts handed to decompressors" },
+    { CountType::SUM, "lzma_reuses", "lzma contexts recycled from the pool" },
+    { CountType::SUM, "context_failures", "decompression contexts that could not be set up" },
+    { CountType::NOW, "contexts_in_use", "decompression contexts currently checked out" },
+    { CountType::MAX, "max_contexts_in_use", "maximum decompression contexts checked out" },
+    { CountType::NOW, "memory", "bytes held by decompression contexts, including idle ones" },
+    { CountType::MAX, "max_memory", "maximum bytes held by decompression contexts" },
+    { CountType::SUM, "compressed_bytes", "compressed bytes consumed by the decompressors" },
+    { CountType::SUM, "decompressed_bytes", "bytes produced by the decompressors" },
+    { CountType::END, nullptr, nullptr }
+};
+
+static THREAD_LOCAL DecompPoolStats stats;
+static THREAD_LOCAL unsigned max_idle = 0;
+static THREAD_LOCAL std::vector<z_stream*>* idle_inflate = nullptr;
+#ifdef HAVE_LZMA
+static THREAD_LOCAL std::vector<lzma_stream*>* idle_lzma = nullptr;
+#endif
+
+//--------------------------------------------------------------------------
+// accounting allocator
+//--------------------------------------------------------------------------
+
+// each block carries its size so the free can be charged back
+struct alignas(16) BlockHeader
+{
+    size_t size;
+};
+
+static void* pool_alloc(size_t n)
+{
+    BlockHeader* h = (BlockHeader*)malloc(sizeof(BlockHeader) + n);
+
+    if ( !h )
+        return nullptr;
+
+    h->size = n;
+    stats.memory += n;
+
+    if ( stats.memory > stats.max_memory )
+        stats.max_memory = stats.memory;
+
+    return h + 1;
+}
+
+static void pool_free(void* p)
+{
+    if ( !p )
+        return;
+
+    BlockHeader* h = (BlockHeader*)p - 1;
+    stats.memory -= h->size;
+    free(h);
+}
+
+static voidpf z_alloc(voidpf, uInt items, uInt size)
+{
+    void* p = pool_alloc((size_t)items * size);
+    return p ? p : Z_NULL;
+}
+
+static void z_free(voidpf, voidpf p)
+{ pool_free(p); }
+
+#ifdef HAVE_LZMA
+static void* lz_alloc(void*, size_t nmemb, size_t size)
+{ return pool_alloc(nmemb * size); }
+
+static void lz_free(void*, void* p)
+{ pool_free(p); }
+
+static const lzma_allocator lz_allocator = { lz_alloc, lz_free, nullptr };
+#endif
+
+static void checked_out()
+{
+    if ( ++stats.contexts_in_use > stats.max_contexts_in_use )
+        stats.max_contexts_in_use = stats.contexts_in_use;
+}
+
+static void checked_in()
+{
+    if ( stats.contexts_in_use )
+        --stats.contexts_in_use;
+}
+
+//--------------------------------------------------------------------------
+// pool
+//--------------------------------------------------------------------------
+
+namespace snort
+{
+namespace DecompPool
+{
+void thread_init(unsigned n)
+{
+    max_idle = n;
+}
+
+void thread_term()
+{
+    if ( idle_inflate )
+    {
+        for ( auto z_s : *idle_inflate )
+        {
+            inflateEnd(z_s);
+            delete z_s;
+        }
+        delete idle_inflate;
+        idle_inflate = nullptr;
+    }
+#ifdef HAVE_LZMA
+    if ( idle_lzma )
+    {
+        for ( auto l_s : *idle_lzma )
+        {
+            lzma_end(l_s);
+            delete l_s;
+        }
+        delete idle_lzma;
+        idle_lzma = nullptr;
+    }
+#endif
+    max_idle = 0;
+}
+
+z_stream* acquire_inflate(int window_bits)
+{
+    z_stream* z_s;
+
+    if ( idle_inflate and !idle_inflate->empty() )
+    {
+        z_s = idle_inflate->back();
+        idle_inflate->pop_back();
+
+        // a reset keeps the state and, for the same window size, the window
+        if ( inflateReset2(z_s, window_bits) != Z_OK )
+        {
+            inflateEnd(z_s);
+            delete z_s;
+            stats.context_failures++;
+            return nullptr;
+        }
+        stats.inflate_reuses++;
+    }
+    else
+    {
+        z_s = new z_stream;
+        memset(z_s, 0, sizeof(*z_s));
+        z_s->zalloc = z_alloc;
+        z_s->zfree = z_free;
+
+        if ( inflateInit2(z_s, window_bits) != Z_OK )
+        {
+            delete z_s;
+            stats.context_failures++;
+            return nullptr;
+        }
+    }
+    z_s->next_in = Z_NULL;
+    z_s->avail_in = 0;
+    z_s->next_out = Z_NULL;
+    z_s->avail_out = 0;
+
+    stats.inflate_contexts++;
+    checked_out();
+    return z_s;
+}
+
+void release_inflate(z_stream* z_s)
+{
+    if ( !z_s )
+        return;
+
+    checked_in();
+
+    if ( max_idle )
+    {
+        if ( !idle_inflate )
+            idle_inflate = new std::vector<z_stream*>;
+
+        if ( idle_inflate->size() < max_idle )
+        {
+            idle_inflate->emplace_back(z_s);
+            return;
+        }
+    }
+    inflateEnd(z_s);
+    delete z_s;
+}
+
+#ifdef HAVE_LZMA
+lzma_stream* acquire_lzma_alone(uint64_t memlimit)
+{
+    lzma_stream* l_s;
+    bool reused = false;
+
+    if ( idle_lzma and !idle_lzma->empty() )
+    {
+        l_s = idle_lzma->back();
+        idle_lzma->pop_back();
+        reused = true;
+    }
+    else
+    {
+        l_s = new lzma_stream();
+        l_s->allocator = &lz_allocator;
+    }
+
+    // liblzma keeps the coder and dictionary of a stream that is
+    // initialized again with the same decoder
+    if ( lzma_alone_decoder(l_s, memlimit) != LZMA_OK )
+    {
+        lzma_end(l_s);
+        delete l_s;
+        stats.context_failures++;
+        return nullptr;
+    }
+    l_s->next_in = nullptr;
+    l_s->avail_in = 0;
+    l_s->next_out = nullptr;
+    l_s->avail_out = 0;
+
+    if ( reused )
+        stats.lzma_reuses++;
+
+    stats.lzma_contexts++;
+    checked_out();
+    return l_s;
+}
+
+void release_lzma(lzma_stream* l_s)
+{
+    if ( !l_s )
+        return;
+
+    checked_in();
+
+    // an lzma decoder holds its whole dictionary (8 MiB for typical SWF
+    // presets) so only one is kept
+    if ( max_idle )
+    {
+        if ( !idle_lzma )
+            idle_lzma = new std::vector<lzma_stream*>;
+
+        if ( idle_lzma->empty() )
+        {
+            idle_lzma->emplace_back(l_s);
+            return;
+        }
+    }
+    lzma_end(l_s);
+    delete l_s;
+}
+#endif
+
+void count(uint64_t in, uint64_t out)
+{
+    stats.compressed_bytes += in;
+    stats.decompressed_bytes += out;
+}
+
+const PegInfo* get_pegs()
+{ return decomp_pegs; }
+
+PegCount* get_counts()
+{ return (PegCount*)&stats; }
+
+const DecompPoolStats& get_stats()
+{ return stats; }
+}
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static void deflate_text(const char* text, std::vector<uint8_t>& out)
+{
+    uLongf len = compressBound(strlen(text));
+    out.resize(len);
+    REQUIRE(compress(out.data(), &len, (const Bytef*)text, strlen(text)) == Z_OK);
+    out.resize(len);
+}
+
+static bool inflate_text(z_stream* z_s, const std::vector<uint8_t>& in, const char* expected)
+{
+    uint8_t buf[256];
+    z_s->next_in = const_cast<Bytef*>(in.data());
+    z_s->avail_in = in.size();
+    z_s->next_out = buf;
+    z_s->avail_out = sizeof(buf);
+
+    if ( inflate(z_s, Z_SYNC_FLUSH) != Z_STREAM_END )
+        return false;
+
+    return (sizeof(buf) - z_s->avail_out == strlen(expected)) and
+        !memcmp(buf, expected, strlen(expected));
+}
+
+TEST_CASE("DecompPool-uncached", "[decomp_pool]")
+{
+    DecompPool::thread_init(0);
+    const DecompPoolStats& s = DecompPool::get_stats();
+    PegCount base = s.memory;
+
+    z_stream* z_s = DecompPool::acquire_inflate(MAX_WBITS);
+    REQUIRE(z_s != nullptr);
+    CHECK(s.contexts_in_use == 1);
+    CHECK(s.memory > base);
+
+    DecompPool::release_inflate(z_s);
+    CHECK(s.contexts_in_use == 0);
+    CHECK(s.memory == base);
+    DecompPool::thread_term();
+}
+
+TEST_CASE("DecompPool-reuse", "[decomp_pool]")
+{
+    const char* text = "a context that comes back from the pool inflates like a new one";
+    std::vector<uint8_t> zipped;
+    deflate_text(text, zipped);
+
+    DecompPool::thread_init(2);
+    const DecompPoolStats& s = DecompPool::get_stats();
+    PegCount base = s.memory;
+    PegCount reuses = s.inflate_reuses;
+
+    z_stream* z_s = DecompPool::acquire_inflate(MAX_WBITS);
+    REQUIRE(z_s != nullptr);
+    CHECK(inflate_text(z_s, zipped, text));
+    DecompPool::release_inflate(z_s);
+
+    // the window stays with the idle context
+    PegCount held = s.memory;
+    CHECK(held > base);
+
+    z_stream* again = DecompPool::acquire_inflate(MAX_WBITS);
+    REQUIRE(again == z_s);
+    CHECK(s.inflate_reuses == reuses + 1);
+    CHECK(s.memory == held);
+    CHECK(inflate_text(again, zipped, text));
+
+    // a reused context can switch header formats
+    DecompPool::release_inflate(again);
+    again = DecompPool::acquire_inflate(-MAX_WBITS);
+    REQUIRE(again != nullptr);
+    CHECK(again->total_in == 0);
+    std::vector<uint8_t> raw(zipped.begin() + 2, zipped.end() - 4);
+    CHECK(inflate_text(again, raw, text));
+    DecompPool::release_inflate(again);
+
+    DecompPool::thread_term();
+    CHECK(s.memory == base);
+}
+
+TEST_CASE("DecompPool-max_idle", "[decomp_pool]")
+{
+    DecompPool::thread_init(1);
+    const DecompPoolStats& s = DecompPool::get_stats();
+    PegCount base = s.memory;
+
+    z_stream* a = DecompPool::acquire_inflate(MAX_WBITS);
+    z_stream* b = DecompPool::acquire_inflate(MAX_WBITS);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    CHECK(s.contexts_in_use == 2);
+    CHECK(s.max_contexts_in_use >= 2);
+
+    DecompPool::release_inflate(a);
+    PegCount one = s.memory;
+    DecompPool::release_inflate(b);
+    CHECK(s.memory < one);
+
+    DecompPool::thread_term();
+    CHECK(s.memory == base);
+}
+
+TEST_CASE("DecompPool-bad_window", "[decomp_pool]")
+{
+    DecompPool::thread_init(1);
+    const DecompPoolStats& s = DecompPool::get_stats();
+    PegCount failures = s.context_failures;
+
+    CHECK(DecompPool::acquire_inflate(99) == nullptr);
+    CHECK(s.context_failures == failures + 1);
+    CHECK(s.contexts_in_use == 0);
+    DecompPool::thread_term();
+}
+
+#ifdef HAVE_LZMA
+TEST_CASE("DecompPool-lzma", "[decomp_pool]")
+{
+    DecompPool::thread_init(1);
+    const DecompPoolStats& s = DecompPool::get_stats();
+    PegCount base = s.memory;
+
+    lzma_stream* l_s = DecompPool::acquire_lzma_alone(UINT64_MAX);
+    REQUIRE(l_s != nullptr);
+    CHECK(s.memory > base);
+    DecompPool::release_lzma(l_s);
+
+    PegCount reuses = s.lzma_reuses;
+    lzma_stream* again = DecompPool::acquire_lzma_alone(UINT64_MAX);
+    CHECK(again == l_s);
+    CHECK(s.lzma_reuses == reuses + 1);
+    DecompPool::release_lzma(again);
+
+    DecompPool::thread_term();
+    CHECK(s.memory == base);
+}
+#endif
+
+#endif
+
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// decomp_pool.h
+
+#ifndef DECOMP_POOL_H
+#define DECOMP_POOL_H
+
+// Per packet thread pool of zlib inflate and liblzma decoder contexts.
+// A decompressor checks a context out when a compressed stream starts and
+// returns it when the stream ends.  Returned contexts are reset instead of
+// torn down so the next stream skips the state and window allocations.
+// All context memory goes through the pool allocator so it can be counted.
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#include <zlib.h>
+
+#include "framework/counts.h"
+#include "main/snort_types.h"
+
+struct DecompPoolStats
+{
+    PegCount inflate_contexts;
+    PegCount inflate_reuses;
+    PegCount lzma_contexts;
+    PegCount lzma_reuses;
+    PegCount context_failures;
+    PegCount contexts_in_use;
+    PegCount max_contexts_in_use;
+    PegCount memory;
+    PegCount max_memory;
+    PegCount compressed_bytes;
+    PegCount decompressed_bytes;
+};
+
+namespace snort
+{
+namespace DecompPool
+{
+// max_idle is the number of released inflate contexts kept for reuse (at
+// most one lzma context is kept); 0, the state before thread_init, disables
+// caching but not accounting
+SO_PUBLIC void thread_init(unsigned max_idle);
+SO_PUBLIC void thread_term();
+
+// window_bits as for inflateInit2(); returns nullptr on failure
+SO_PUBLIC z_stream* acquire_inflate(int window_bits);
+SO_PUBLIC void release_inflate(z_stream*);
+
+#ifdef HAVE_LZMA
+// an lzma_alone_decoder() context; returns nullptr on failure
+SO_PUBLIC lzma_stream* acquire_lzma_alone(uint64_t memlimit);
+SO_PUBLIC void release_lzma(lzma_stream*);
+#endif
+
+// record compressed input consumed and decompressed output produced
+SO_PUBLIC void count(uint64_t in, uint64_t out);
+
+SO_PUBLIC const PegInfo* get_pegs();
+SO_PUBLIC PegCount* get_counts();
+SO_PUBLIC const DecompPoolStats& get_stats();
+}
+}
+
+#endif
+
@@ -29,6 +29,7 @@
 #include "detection/detection_util.h"
 #include "utils/util.h"
 
+#include "decomp_pool.h"
 #include "file_decomp_pdf.h"
 #include "file_decomp_swf.h"
 #include "file_decomp_zip.h"
@@ -339,6 +340,30 @@ fd_status_t File_Decomp(fd_session_t* SessionPtr)
         return( File_Decomp_Error );
 }
 
+fd_status_t File_Decomp_Run(fd_session_t* SessionPtr, const uint8_t* In, uint32_t In_Len,
+    uint8_t* Out, uint32_t Out_Size, uint32_t* Out_Len)
+{
+    *Out_Len = 0;
+
+    if ( SessionPtr == nullptr )
+        return( File_Decomp_Error );
+
+    SessionPtr->Next_In = In;
+    SessionPtr->Avail_In = In_Len;
+    SessionPtr->Next_Out = Out;
+    SessionPtr->Avail_Out = Out_Size;
+
+    fd_status_t Ret_Code = File_Decomp(SessionPtr);
+
+    if ( (Ret_Code == File_Decomp_Error) || (Ret_Code == File_Decomp_NoSig) )
+        return( Ret_Code );
+
+    *Out_Len = SessionPtr->Next_Out - Out;
+    DecompPool::count(In_Len - SessionPtr->Avail_In, *Out_Len);
+
+    return( Ret_Code );
+}
+
 fd_status_t File_Decomp_End(fd_session_t* SessionPtr)
 {
     if ( SessionPtr == nullptr )
@@ -288,6 +288,12 @@ SO_PUBLIC fd_status_t File_Decomp_Init(fd_session_t*);
 /* Run the incremental decompression engine */
 SO_PUBLIC fd_status_t File_Decomp(fd_session_t*);
 
+/* Run the engine over the next piece of input, writing directly into the caller's
+   buffer (e.g. the detection or file_api buffer).  Out_Len is set to the number of
+   bytes produced.  Consumed and produced bytes are added to the DecompPool counts. */
+SO_PUBLIC fd_status_t File_Decomp_Run(fd_session_t*, const uint8_t* In, uint32_t In_Len,
+    uint8_t* Out, uint32_t Out_Size, uint32_t* Out_Len);
+
 /* Close the decomp session processing */
 SO_PUBLIC fd_status_t File_Decomp_End(fd_session_t*);
 
@@ -65,7 +65,7 @@ struct fd_PDF_Parse_t
 
 struct fd_PDF_Deflate_t
 {
-    z_stream StreamDeflate;
+    z_stream* StreamDeflate;  // from DecompPool while a stream is open
 };
 
 struct fd_PDF_t
@@ -26,6 +26,8 @@
 
 #include "utils/util.h"
 
+#include "decomp_pool.h"
+
 #ifdef UNIT_TEST
 #include "catch/snort_catch.h"
 #endif
@@ -48,7 +50,7 @@ static fd_status_t File_Decomp_Process_LZMA_Header(fd_session_t* SessionPtr)
     int idx;
 
     lzma_ret l_ret;
-    lzma_stream* l_s = &(SessionPtr->SWF->StreamLZMA);
+    lzma_stream* l_s = SessionPtr->SWF->StreamLZMA;
 
     SWF_Uncomp_Len = 0;
     /* Read little-endian into value */
@@ -100,7 +102,7 @@ static fd_status_t Decomp(fd_session_t* SessionPtr)
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
         int z_ret;
-        z_stream* z_s = &(SessionPtr->SWF->StreamZLIB);
+        z_stream* z_s = SessionPtr->SWF->StreamZLIB;
 
         SYNC_IN(z_s)
 
@@ -125,7 +127,7 @@ static fd_status_t Decomp(fd_session_t* SessionPtr)
     case FILE_COMPRESSION_TYPE_LZMA:
     {
         lzma_ret l_ret;
-        lzma_stream* l_s = &(SessionPtr->SWF->StreamLZMA);
+        lzma_stream* l_s = SessionPtr->SWF->StreamLZMA;
 
         SYNC_IN(l_s)
 
@@ -163,26 +165,15 @@ fd_status_t File_Decomp_End_SWF(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
-        z_stream* z_s = &(SessionPtr->SWF->StreamZLIB);
-
-        z_ret = inflateEnd(z_s);
-
-        if ( z_ret != Z_OK )
-        {
-            SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
-            return( File_Decomp_DecompError );
-        }
-
+        DecompPool::release_inflate(SessionPtr->SWF->StreamZLIB);
+        SessionPtr->SWF->StreamZLIB = nullptr;
         break;
     }
 #ifdef HAVE_LZMA
     case FILE_COMPRESSION_TYPE_LZMA:
     {
-        lzma_stream* l_s = &(SessionPtr->SWF->StreamLZMA);
-
-        lzma_end(l_s);
-
+        DecompPool::release_lzma(SessionPtr->SWF->StreamLZMA);
+        SessionPtr->SWF->StreamLZMA = nullptr;
         break;
     }
 #endif
@@ -209,53 +200,35 @@ fd_status_t File_Decomp_Init_SWF(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
-        z_stream* z_s;
-
         SessionPtr->SWF->Header_Len =
             SWF_VER_LEN + SWF_UCL_LEN;
 
-        z_s = &(SessionPtr->SWF->StreamZLIB);
-
-        memset( (char*)z_s, 0, sizeof(z_stream));
-
-        z_s->zalloc = (alloc_func)nullptr;
-        z_s->zfree = (free_func)nullptr;
-        SYNC_IN(z_s)
+        z_stream* z_s = DecompPool::acquire_inflate(MAX_WBITS);
 
-        z_ret = inflateInit(z_s);
-
-        if ( z_ret != Z_OK )
+        if ( z_s == nullptr )
         {
             SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
             return( File_Decomp_DecompError );
         }
 
+        SessionPtr->SWF->StreamZLIB = z_s;
         break;
     }
 #ifdef HAVE_LZMA
     case FILE_COMPRESSION_TYPE_LZMA:
     {
-        lzma_ret l_ret;
-        lzma_stream* l_s;
-
         SessionPtr->SWF->Header_Len =
             SWF_VER_LEN + SWF_UCL_LEN + SWF_LZMA_CML_LEN + SWF_LZMA_PRP_LEN;
 
-        l_s = &(SessionPtr->SWF->StreamLZMA);
-
-        memset( (char*)l_s, 0, sizeof(lzma_stream));
-
-        SYNC_IN(l_s)
-
-        l_ret = lzma_alone_decoder(l_s, UINT64_MAX);
+        lzma_stream* l_s = DecompPool::acquire_lzma_alone(UINT64_MAX);
 
-        if ( l_ret != LZMA_OK )
+        if ( l_s == nullptr )
         {
             SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_LZMA_FAILURE;
             return( File_Decomp_DecompError );
         }
 
+        SessionPtr->SWF->StreamLZMA = l_s;
         break;
     }
 #endif
@@ -25,23 +25,16 @@
 #include "file_decomp_zip.h"
 #include "utils/util.h"
 
+#include "decomp_pool.h"
+
 using namespace snort;
 
 // initialize zlib decompression
 static fd_status_t Inflate_Init(fd_session_t* SessionPtr)
 {
-    z_stream* z_s = &(SessionPtr->ZIP->Stream);
-
-    memset((char*)z_s, 0, sizeof(z_stream));
-
-    z_s->zalloc = (alloc_func)nullptr;
-    z_s->zfree = (free_func)nullptr;
-
-    SYNC_IN(z_s)
-
-    int z_ret = inflateInit2(z_s, -MAX_WBITS);
+    SessionPtr->ZIP->Stream = DecompPool::acquire_inflate(-MAX_WBITS);
 
-    if ( z_ret != Z_OK )
+    if ( SessionPtr->ZIP->Stream == nullptr )
         return File_Decomp_Error;
 
     return File_Decomp_OK;
@@ -50,9 +43,9 @@ static fd_status_t Inflate_Init(fd_session_t* SessionPtr)
 // end zlib decompression
 static fd_status_t Inflate_End(fd_session_t* SessionPtr)
 {
-    z_stream* z_s = &(SessionPtr->ZIP->Stream);
-
-    inflateEnd(z_s);
+    // each entry of an archive reuses the same pooled context
+    DecompPool::release_inflate(SessionPtr->ZIP->Stream);
+    SessionPtr->ZIP->Stream = nullptr;
 
     return File_Decomp_OK;
 }
@@ -62,7 +55,7 @@ static fd_status_t Inflate(fd_session_t* SessionPtr)
 {
     const uint8_t *zlib_start, *zlib_end;
 
-    z_stream* z_s = &(SessionPtr->ZIP->Stream);
+    z_stream* z_s = SessionPtr->ZIP->Stream;
 
     zlib_start = SessionPtr->Next_In;
 
@@ -62,38 +62,38 @@ using namespace snort;
 // basic de
 //--------------------------------------------------------------------------
 
-void DetectionEngine::thread_init()
+bool DetectionEngine::offload_is_async(SnortConfig* sc)
 {
-    SnortConfig* sc = SnortConfig::get_conf();
     FastPatternConfig* fp = sc->fast_pattern_config;
     const MpseApi* offload_search_api = fp->get_offload_search_api();
 
-    // Note: offload_threads is really the maximum number of offload_requests
     if (offload_search_api and MpseManager::is_async_capable(offload_search_api))
     {
         // Check that poll functionality has been provided
         assert(MpseManager::is_poll_capable(offload_search_api));
-
-        // If the search method is async capable then the searches will be performed directly
-        // by the search engine, without requiring a processing thread.
-        offloader = RegexOffload::get_offloader(sc->offload_threads, false);
+        return true;
     }
-    else
-    {
-        const MpseApi* search_api = fp->get_search_api();
 
-        if (MpseManager::is_async_capable(search_api))
-        {
-            assert(MpseManager::is_poll_capable(search_api));
-            offloader = RegexOffload::get_offloader(sc->offload_threads, false);
-        }
-        else
-        {
-            // If the search method is not async capable then offloaded searches will be performed
-            // in a separate processing thread that the RegexOffload instance needs to create.
-            offloader = RegexOffload::get_offloader(sc->offload_threads, true);
-        }
+    const MpseApi* search_api = fp->get_search_api();
+
+    if (MpseManager::is_async_capable(search_api))
+    {
+        assert(MpseManager::is_poll_capable(search_api));
+        return true;
     }
+    return false;
+}
+
+void DetectionEngine::thread_init()
+{
+    SnortConfig* sc = SnortConfig::get_conf();
+
+    // Note: offload_threads is really the maximum number of offload_requests
+    // per packet thread and the number of threads in the shared pool.
+    // If the search method is async capable then the searches will be performed directly
+    // by the search engine, without requiring a processing thread.  Otherwise offloaded
+    // searches will be performed by the offload threads.
+    offloader = RegexOffload::get_offloader(sc->offload_threads, !offload_is_async(sc));
 }
 
 void DetectionEngine::thread_term()
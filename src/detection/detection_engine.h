@@ -51,6 +51,10 @@ public:
     static void thread_init();
     static void thread_term();
 
+    // true if offloaded searches are done by the search engine instead of
+    // offload threads
+    static bool offload_is_async(SnortConfig*);
+
     static void reset();
 
     static IpsContext* get_context();
@@ -49,6 +49,7 @@
 #include "main/thread_config.h"
 #include "managers/ips_manager.h"
 #include "parser/parser.h"
+#include "profiler/rule_cost.h"
 #include "profiler/rule_profiler_defs.h"
 #include "protocols/packet_manager.h"
 #include "utils/util.h"
@@ -393,6 +394,8 @@ int detection_option_node_evaluate(
         }
     }
 
+    RuleCostContext cost(state, p->dsize);
+
     state.last_check.ts = eval_data->p->pkth->ts;
     state.last_check.run_num = get_run_num();
     state.last_check.context_num = cur_eval_context_num;
@@ -470,6 +473,7 @@ int detection_option_node_evaluate(
                 if ( f_result )
                 {
                     otn->state[get_instance_id()].matches++;
+                    RuleCostContext::match(otn);
 
                     if ( !eval_data->flowbit_noalert )
                     {
@@ -581,6 +585,7 @@ int detection_option_node_evaluate(
 
         {
             RulePause pause(profile);
+            RuleCostPause cost_pause(cost);
             // Passed, check the children.
             if ( node->num_children )
             {
@@ -73,6 +73,12 @@ struct dot_node_state_t
     unsigned latency_timeouts;
     unsigned latency_suspends;
 
+    // rolling cost of this node alone, harvested and cleared by
+    // RuleCostContext::get_top()
+    uint64_t cost_evals;
+    uint64_t cost_ticks;
+    uint64_t cost_bytes;
+
     // FIXIT-L perf profiler stuff should be factored of the node state struct
     void update(hr_duration delta, bool match)
     {
@@ -25,11 +25,17 @@
 #ifndef FP_CONFIG_H
 #define FP_CONFIG_H
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace snort
 {
     struct MpseApi;
 }
 
+struct RuleDb;
+
 // this is a basically a factory for creating MPSE
 
 #define PL_BLEEDOVER_WARNINGS_ENABLED        0x01
@@ -150,6 +156,29 @@ public:
 
     unsigned set_max(unsigned bytes);
 
+    void set_rule_db_dir(const char* s)
+    { rule_db_dir = s; }
+
+    const std::string& get_rule_db_dir()
+    { return rule_db_dir; }
+
+    void set_reuse_rule_dbs(bool b)
+    { reuse_rule_dbs = b; }
+
+    bool get_reuse_rule_dbs()
+    { return reuse_rule_dbs; }
+
+    void set_compile_threads(unsigned n)
+    { compile_threads = n; }
+
+    unsigned get_compile_threads()
+    { return compile_threads; }
+
+    // dbs are released when this config is deleted, after the search
+    // engines that use them
+    void add_rule_db(const std::shared_ptr<RuleDb>& db)
+    { rule_dbs.emplace_back(db); }
+
 private:
     const snort::MpseApi* search_api = nullptr;
     const snort::MpseApi* offload_search_api = nullptr;
@@ -160,14 +189,19 @@ private:
     bool debug_print_fast_pattern = false;
     bool debug = false;
     bool search_opt = false;
+    bool reuse_rule_dbs = true;
 
     unsigned max_queue_events = 5;
     unsigned bleedover_port_limit = 1024;
     unsigned max_pattern_len = 0;
+    unsigned compile_threads = 0;   // 0 means one per cpu
 
     int portlists_flags = 0;
     int num_patterns_truncated = 0;  // due to max_pattern_len
     int num_patterns_trimmed = 0;    // due to zero byte prefix
+
+    std::string rule_db_dir;
+    std::vector<std::shared_ptr<RuleDb>> rule_dbs;
 };
 
 #endif
@@ -34,6 +34,19 @@
 
 #include "fp_create.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "framework/mpse.h"
 #include "framework/mpse_batch.h"
 #include "hash/ghash.h"
@@ -44,6 +57,8 @@
 #include "parser/parser.h"
 #include "ports/port_table.h"
 #include "ports/rule_port_tables.h"
+#include "time/clock_defs.h"
+#include "time/stopwatch.h"
 #include "utils/stats.h"
 #include "utils/util.h"
 
@@ -61,6 +76,15 @@ using namespace std;
 
 static unsigned mpse_count = 0;
 static unsigned offload_mpse_count = 0;
+static unsigned rule_db_compiled = 0;
+static unsigned rule_db_reused = 0;
+static unsigned rule_db_loaded = 0;
+static unsigned rule_db_saved = 0;
+static unsigned rule_db_errors = 0;
+static unsigned num_compile_threads = 0;
+static Stopwatch<SnortClock> reuse_time;
+static Stopwatch<SnortClock> compile_time;
+static Stopwatch<SnortClock> finish_time;
 static const char* s_group = "";
 
 static void fpDeletePMX(void* data);
@@ -411,6 +435,331 @@ static int fpFinishPortGroupRule(
     return 0;
 }
 
+//-------------------------------------------------------------------------
+// compiled mpse databases
+//
+// the compiled state of each mpse is kept in a db named for its method and
+// pattern set hash.  with search_engine.reuse_rule_dbs, the dbs of the
+// current config are found in memory by the next one so that a reload only
+// compiles groups whose patterns changed and unchanged groups share their
+// state with the outgoing config instead of doubling it.  with
+// search_engine.rule_db_dir set, dbs are also saved to files and mapped
+// read only so they are reused across restarts and the pages are shared by
+// all processes on the box that load the same file.
+//
+// the mpse and detection option trees are still built per config since
+// they reference that config's rules; only the compiled state is shared.
+//-------------------------------------------------------------------------
+
+struct RuleDb
+{
+    RuleDb(uint8_t* p, size_t n, bool m) : data(p), len(n), mapped(m) { }
+
+    ~RuleDb()
+    {
+        if ( mapped )
+            munmap(data, len);
+        else
+            snort_free(data);
+    }
+
+    uint8_t* data;
+    size_t len;
+    bool mapped;
+};
+
+// dbs in use by any config; only changed while building a config in the
+// main thread.  entries expire when the last config using them is deleted.
+static unordered_map<string, weak_ptr<RuleDb>> s_rule_dbs;
+
+static shared_ptr<RuleDb> fp_map_rule_db(const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+        return nullptr;
+
+    struct stat st;
+
+    if ( fstat(fd, &st) or st.st_size <= 0 )
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t len = st.st_size;
+    void* map = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if ( map == MAP_FAILED )
+        return nullptr;
+
+    return make_shared<RuleDb>((uint8_t*)map, len, true);
+}
+
+// the file is written under a temporary name and renamed into place so
+// that other processes never map a partial database
+static bool fp_save_rule_db(const RuleDb& db, const string& path)
+{
+    string tmp = path + ".tmp." + to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    bool ok = f and fwrite(db.data, 1, db.len, f) == db.len;
+
+    if ( f and fclose(f) )
+        ok = false;
+
+    if ( ok and !rename(tmp.c_str(), path.c_str()) )
+    {
+        ++rule_db_saved;
+        return true;
+    }
+
+    unlink(tmp.c_str());
+    ++rule_db_errors;
+    return false;
+}
+
+static bool fp_use_rule_db(
+    SnortConfig* sc, Mpse* mpse, const string& key, const shared_ptr<RuleDb>& db)
+{
+    FastPatternConfig* fp = sc->fast_pattern_config;
+
+    if ( !db or !mpse->deserialize(sc, db->data, db->len) )
+        return false;
+
+    fp->add_rule_db(db);
+
+    if ( fp->get_reuse_rule_dbs() )
+        s_rule_dbs[key] = db;
+
+    return true;
+}
+
+static void fp_prune_rule_dbs()
+{
+    for ( auto it = s_rule_dbs.begin(); it != s_rule_dbs.end(); )
+    {
+        if ( it->second.expired() )
+            it = s_rule_dbs.erase(it);
+        else
+            ++it;
+    }
+}
+
+//-------------------------------------------------------------------------
+// mpse preparation
+//
+// port and service groups queue their mpses which are all prepared once
+// the groups are built.  the compile step of engines flagged MPSE_MTBLD is
+// run by search_engine.compile_threads threads.  everything else touches
+// shared state (rule dbs, detection option trees, engine stats) and runs in
+// the main thread in queue order so the result does not depend on the
+// number of threads or their timing.
+//-------------------------------------------------------------------------
+
+struct MpseJob
+{
+    MpseJob(Mpse* m, const char* t) : mpse(m), type(t) { }
+
+    Mpse* mpse;
+    const char* type;
+    string key;
+    string path;
+    int rval = 0;
+    bool parallel = false;
+};
+
+static vector<MpseJob> s_mpse_jobs;
+
+static void fp_queue_mpse(Mpse* mpse, const char* type)
+{
+    s_mpse_jobs.emplace_back(mpse, type);
+}
+
+// returns true if a compiled db was found for this mpse
+static bool fp_find_rule_db(SnortConfig* sc, MpseJob& job, FastPatternConfig* fp)
+{
+    const string& dir = fp->get_rule_db_dir();
+    bool reuse = fp->get_reuse_rule_dbs();
+    string hash;
+
+    if ( (!reuse and dir.empty()) or !job.mpse->get_hash(hash) )
+        return false;
+
+    job.key = string(job.mpse->get_method()) + "-" + hash;
+    job.path = dir.empty() ? dir : dir + "/" + job.key + ".db";
+
+    if ( reuse )
+    {
+        auto it = s_rule_dbs.find(job.key);
+
+        if ( it != s_rule_dbs.end() and fp_use_rule_db(sc, job.mpse, job.key, it->second.lock()) )
+        {
+            ++rule_db_reused;
+            return true;
+        }
+    }
+
+    if ( !job.path.empty() )
+    {
+        auto db = fp_map_rule_db(job.path);
+
+        if ( fp_use_rule_db(sc, job.mpse, job.key, db) )
+        {
+            ++rule_db_loaded;
+            return true;
+        }
+        if ( db )
+            WarningMessage("ignoring unusable search engine database %s\n", job.path.c_str());
+    }
+    return false;
+}
+
+static void fp_keep_rule_db(SnortConfig* sc, MpseJob& job, FastPatternConfig* fp)
+{
+    if ( job.key.empty() )
+        return;
+
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+
+    if ( !job.mpse->serialize(buf, len) )
+        return;
+
+    // switch the new mpse to the saved copy so it can be shared
+    auto db = make_shared<RuleDb>(buf, len, false);
+
+    if ( !job.path.empty() and fp_save_rule_db(*db, job.path) )
+    {
+        if ( auto map = fp_map_rule_db(job.path) )
+            db = map;
+    }
+
+    if ( db->mapped or fp->get_reuse_rule_dbs() )
+        fp_use_rule_db(sc, job.mpse, job.key, db);
+}
+
+static void fp_compile_mpses(vector<MpseJob*>& jobs, unsigned num_threads)
+{
+    const int64_t progress_usecs = 5000000;
+
+    atomic<unsigned> next(0);
+    atomic<unsigned> done(0);
+
+    auto compile = [&jobs, &next, &done]()
+    {
+        unsigned i;
+
+        while ( (i = next++) < jobs.size() )
+        {
+            jobs[i]->rval = jobs[i]->mpse->compile_patterns();
+            ++done;
+        }
+    };
+
+    vector<thread> threads;
+
+    for ( unsigned i = 1; i < num_threads and i < jobs.size(); ++i )
+        threads.emplace_back(compile);
+
+    // the main thread compiles too and reports progress between jobs
+    Stopwatch<SnortClock> progress;
+    progress.start();
+
+    unsigned i;
+
+    while ( (i = next++) < jobs.size() )
+    {
+        jobs[i]->rval = jobs[i]->mpse->compile_patterns();
+        ++done;
+
+        if ( clock_usecs(TO_USECS(progress.get())) >= progress_usecs )
+        {
+            LogMessage("compiled %u of %zu rule groups\n", done.load(), jobs.size());
+            progress.reset();
+            progress.start();
+        }
+    }
+
+    for ( auto& t : threads )
+        t.join();
+}
+
+static unsigned fp_get_compile_threads(FastPatternConfig* fp)
+{
+    unsigned n = fp->get_compile_threads();
+
+    if ( !n )
+        n = thread::hardware_concurrency();
+
+    return n ? n : 1;
+}
+
+static void fp_prep_mpses(SnortConfig* sc, FastPatternConfig* fp)
+{
+    vector<MpseJob*> compile;
+    vector<MpseJob*> parallel;
+
+    reuse_time.start();
+
+    for ( auto& job : s_mpse_jobs )
+    {
+        if ( fp_find_rule_db(sc, job, fp) )
+            continue;
+
+        job.parallel = MpseManager::is_mt_build_capable(job.mpse->get_api());
+        compile.emplace_back(&job);
+
+        if ( job.parallel )
+            parallel.emplace_back(&job);
+    }
+    reuse_time.stop();
+
+    rule_db_compiled = compile.size();
+
+    if ( !parallel.empty() )
+    {
+        num_compile_threads = min(fp_get_compile_threads(fp), (unsigned)parallel.size());
+
+        compile_time.start();
+        fp_compile_mpses(parallel, num_compile_threads);
+        compile_time.stop();
+    }
+
+    for ( auto job : compile )
+    {
+        if ( job->parallel )
+        {
+            finish_time.start();
+            if ( !job->rval )
+                job->rval = job->mpse->finish_patterns(sc);
+            finish_time.stop();
+        }
+        else
+        {
+            compile_time.start();
+            job->rval = job->mpse->prep_patterns(sc);
+            compile_time.stop();
+        }
+
+        if ( job->rval )
+            FatalError("Failed to compile port group patterns for %s search engine.\n",
+                job->type);
+
+        finish_time.start();
+        fp_keep_rule_db(sc, *job, fp);
+        finish_time.stop();
+    }
+
+    if ( fp->get_debug_mode() )
+    {
+        for ( auto& job : s_mpse_jobs )
+            job.mpse->print_info();
+    }
+
+    s_mpse_jobs.clear();
+}
+
 static int fpFinishPortGroup(
     SnortConfig* sc, PortGroup* pg, FastPatternConfig* fp)
 {
@@ -429,14 +778,8 @@ static int fpFinishPortGroup(
                 if (pg->mpsegrp[i]->normal_mpse->get_pattern_count() != 0)
                 {
                     if ( !sc->test_mode() or sc->mem_check() )
-                    {
-                        if ( pg->mpsegrp[i]->normal_mpse->prep_patterns(sc) != 0 )
-                            FatalError("Failed to compile port group patterns for normal "
-                                    "search engine.\n");
-                    }
+                        fp_queue_mpse(pg->mpsegrp[i]->normal_mpse, "normal");
 
-                    if (fp->get_debug_mode())
-                        pg->mpsegrp[i]->normal_mpse->print_info();
                     rules = 1;
                 }
                 else
@@ -450,14 +793,8 @@ static int fpFinishPortGroup(
                 if (pg->mpsegrp[i]->offload_mpse->get_pattern_count() != 0)
                 {
                     if ( !sc->test_mode() or sc->mem_check() )
-                    {
-                        if ( pg->mpsegrp[i]->offload_mpse->prep_patterns(sc) != 0 )
-                            FatalError("Failed to compile port group patterns for offload "
-                                    "search engine.\n");
-                    }
+                        fp_queue_mpse(pg->mpsegrp[i]->offload_mpse, "offload");
 
-                    if (fp->get_debug_mode())
-                        pg->mpsegrp[i]->offload_mpse->print_info();
                     rules = 1;
                 }
                 else
@@ -1692,6 +2029,20 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
 
     mpse_count = 0;
     offload_mpse_count = 0;
+    rule_db_compiled = 0;
+    rule_db_reused = 0;
+    rule_db_loaded = 0;
+    rule_db_saved = 0;
+    rule_db_errors = 0;
+    num_compile_threads = 0;
+
+    Stopwatch<SnortClock> build_time;
+    build_time.start();
+    reuse_time.reset();
+    compile_time.reset();
+    finish_time.reset();
+
+    fp_prune_rule_dbs();
 
     MpseManager::start_search_engine(fp->get_search_api());
 
@@ -1729,6 +2080,11 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Service Based Rule Maps Done....\n");
 
+    Stopwatch<SnortClock> group_time = build_time;
+    group_time.stop();
+
+    fp_prep_mpses(sc, fp);
+
     fp_print_port_groups(port_tables);
     fp_print_service_groups(sc->spgmmTable);
 
@@ -1749,6 +2105,24 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if ( fp->get_num_patterns_trimmed() )
         LogMessage("%25.25s: %-12u\n", "prefix trims", fp->get_num_patterns_trimmed());
 
+    build_time.stop();
+
+    LogLabel("rule group build");
+    LogCount("mpse compiled", rule_db_compiled);
+    LogCount("mpse reused", rule_db_reused);
+    LogCount("mpse loaded", rule_db_loaded);
+    LogCount("mpse saved", rule_db_saved);
+    LogCount("compile threads", num_compile_threads);
+    LogStat("group seconds", clock_usecs(TO_USECS(group_time.get())) / 1e6);
+    LogStat("reuse seconds", clock_usecs(TO_USECS(reuse_time.get())) / 1e6);
+    LogStat("compile seconds", clock_usecs(TO_USECS(compile_time.get())) / 1e6);
+    LogStat("finish seconds", clock_usecs(TO_USECS(finish_time.get())) / 1e6);
+    LogStat("total seconds", clock_usecs(TO_USECS(build_time.get())) / 1e6);
+
+    if ( rule_db_errors )
+        WarningMessage("could not save %u search engine databases to %s\n",
+            rule_db_errors, fp->get_rule_db_dir().c_str());
+
     MpseManager::setup_search_engine(fp->get_search_api(), sc);
 
     return 0;
@@ -338,6 +338,7 @@ static int detection_option_tree_evaluate(detection_option_tree_root_t* root,
         return 0;
 
     RuleLatency::Context rule_latency_ctx(root, eval_data->p);
+    SampleFrame rule_sample(root->otn);
 
     if ( RuleLatency::suspended() )
         return 0;
@@ -24,15 +24,18 @@
 
 #include "regex_offload.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <vector>
 #include <thread>
 
+#include "framework/mpse_batch.h"
 #include "fp_detect.h"
 #include "ips_context.h"
 #include "latency/packet_latency.h"
@@ -41,6 +44,7 @@
 #include "main/thread.h"
 #include "main/thread_config.h"
 #include "managers/module_manager.h"
+#include "time/clock_defs.h"
 #include "utils/stats.h"
 
 using namespace snort;
@@ -49,10 +53,8 @@ using namespace snort;
 struct RegexRequest
 {
     snort::Packet* packet = nullptr;
-
-    std::thread* thread;
-    std::mutex mutex;
-    std::condition_variable cond;
+    ThreadRegexOffload* owner = nullptr;
+    SnortClock::time_point start;
 
 #ifdef REG_TEST
     // used to make main thread wait for results to get predictable behavior
@@ -61,8 +63,6 @@ struct RegexRequest
 #endif
 
     std::atomic<bool> offload { false };
-
-    bool go = true;
 };
 
 RegexOffload* RegexOffload::get_offloader(unsigned max, bool async)
@@ -176,149 +176,279 @@ bool MpseRegexOffload::get(snort::Packet*& p)
 }
 
 //--------------------------------------------------------------------------
-// async (threads) offload implementation
+// offload thread pool
+//
+// each worker has a queue of requests.  packet threads spread their
+// requests over the queues and idle workers steal from the other queues.
+// a worker takes up to max_batch requests from its queue at once and runs
+// the searches of all those packets grouped by config and search engine so
+// each engine searches all of its buffers back to back while its state is
+// in cache.  the searches of one packet remain in their original order.
+//
+// engines with their own batch search are async capable and are driven by
+// MpseRegexOffload instead, so the workers search each buffer directly.
 //--------------------------------------------------------------------------
 
-ThreadRegexOffload::ThreadRegexOffload(unsigned max) : RegexOffload(max)
+class RegexOffloadPool
 {
-    unsigned i = ThreadConfig::get_instance_max();
+public:
+    static RegexOffloadPool* acquire(unsigned num_threads);
+    static void release();
 
-    for ( auto* req : idle )
-        req->thread = new std::thread(worker, req, snort::SnortConfig::get_conf(), i++);
-}
+    unsigned size() const
+    { return queues.size(); }
 
-ThreadRegexOffload::~ThreadRegexOffload()
-{
-    for ( auto* req : idle )
+    void put(unsigned queue, RegexRequest*);
+
+private:
+    RegexOffloadPool(unsigned num_threads);
+    ~RegexOffloadPool();
+
+    void worker(unsigned id, SnortConfig*);
+
+    bool take(unsigned id, std::vector<RegexRequest*>&);
+    bool steal(unsigned id, std::vector<RegexRequest*>&);
+    void search(std::vector<RegexRequest*>&);
+
+private:
+    struct Queue
     {
-        req->thread->join();
-        delete req->thread;
-    }
+        std::mutex mutex;
+        std::deque<RegexRequest*> reqs;
+    };
+
+    struct Search
+    {
+        SnortConfig* conf;
+        Mpse* mpse;
+        const MpseBatchKey<>* key;
+        MpseBatchItem* item;
+        MpseBatch* batch;
+    };
+
+    static const unsigned max_batch = 8;
+
+    std::vector<Queue*> queues;
+    std::vector<std::thread*> threads;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<unsigned> pending { 0 };
+    bool go = true;
+
+    static std::mutex pool_mutex;
+    static RegexOffloadPool* pool;
+    static unsigned pool_refs;
+};
+
+std::mutex RegexOffloadPool::pool_mutex;
+RegexOffloadPool* RegexOffloadPool::pool = nullptr;
+unsigned RegexOffloadPool::pool_refs = 0;
+
+// the pool is started by the first packet thread and stopped by the last
+RegexOffloadPool* RegexOffloadPool::acquire(unsigned num_threads)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    if ( !pool )
+        pool = new RegexOffloadPool(num_threads);
+
+    ++pool_refs;
+    return pool;
 }
 
-void ThreadRegexOffload::stop()
+void RegexOffloadPool::release()
 {
-    RegexOffload::stop();
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    assert(pool_refs);
 
-    for ( auto* req : idle )
-    {
-        std::unique_lock<std::mutex> lock(req->mutex);
-        req->go = false;
-        req->cond.notify_one();
-    }
+    if ( --pool_refs )
+        return;
+
+    delete pool;
+    pool = nullptr;
 }
 
-void ThreadRegexOffload::put(snort::Packet* p)
+RegexOffloadPool::RegexOffloadPool(unsigned num_threads)
 {
-    Profile profile(mpsePerfStats);
+    assert(num_threads);
 
-    assert(p);
-    assert(!idle.empty());
-    assert(p->context->searches.items.size() > 0);
+    for ( unsigned i = 0; i < num_threads; ++i )
+        queues.emplace_back(new Queue);
 
-    RegexRequest* req = idle.front();
-    idle.pop_front();  // FIXIT-H use splice to move instead
+    SnortConfig* sc = SnortConfig::get_conf();
 
-    busy.emplace_back(req);
-    p->context->regex_req_it = std::prev(busy.end());
+    for ( unsigned i = 0; i < num_threads; ++i )
+        threads.emplace_back(new std::thread(&RegexOffloadPool::worker, this, i, sc));
+}
 
+RegexOffloadPool::~RegexOffloadPool()
+{
     {
-        std::unique_lock<std::mutex> lock(req->mutex);
-        req->packet = p;
+        std::lock_guard<std::mutex> lock(mutex);
+        go = false;
+    }
+    cond.notify_all();
 
-        req->offload = true;
-        req->cond.notify_one();
+    for ( auto* t : threads )
+    {
+        t->join();
+        delete t;
     }
 
-#ifdef REG_TEST
+    for ( auto* q : queues )
     {
-        std::unique_lock<std::mutex> sync_lock(req->sync_mutex);
-        while ( req->offload and req->sync_cond.wait_for(sync_lock, std::chrono::seconds(1))
-            == std::cv_status::timeout );
+        assert(q->reqs.empty());
+        delete q;
     }
-#endif
 }
 
-bool ThreadRegexOffload::get(snort::Packet*& p)
+void RegexOffloadPool::put(unsigned queue, RegexRequest* req)
 {
-    Profile profile(mpsePerfStats);
-    assert(!busy.empty());
+    Queue* q = queues[queue % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(q->mutex);
+        q->reqs.emplace_back(req);
+    }
+    ++pending;
 
-    for ( auto i = busy.begin(); i != busy.end(); i++ )
+    // lock so the wakeup can't be lost between a worker's check and wait
     {
-        RegexRequest* req = *i;
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    cond.notify_one();
+}
 
-        if ( req->offload )
-            continue;
+bool RegexOffloadPool::take(unsigned id, std::vector<RegexRequest*>& reqs)
+{
+    Queue* q = queues[id];
+    std::lock_guard<std::mutex> lock(q->mutex);
 
-        p = req->packet;
-        assert(p->context->regex_req_it == i);
-        req->packet = nullptr;
+    while ( !q->reqs.empty() and reqs.size() < max_batch )
+    {
+        reqs.emplace_back(q->reqs.front());
+        q->reqs.pop_front();
+    }
+    return !reqs.empty();
+}
 
-        busy.erase(i);
-        idle.emplace_back(req);
+// thieves take from the back to stay out of the owner's way
+bool RegexOffloadPool::steal(unsigned id, std::vector<RegexRequest*>& reqs)
+{
+    for ( unsigned i = 1; i < queues.size(); ++i )
+    {
+        Queue* q = queues[(id + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(q->mutex);
 
+        if ( q->reqs.empty() )
+            continue;
+
+        reqs.emplace_back(q->reqs.back());
+        q->reqs.pop_back();
+        pc.offload_steals++;
         return true;
     }
-
-    p = nullptr;
     return false;
 }
 
-void ThreadRegexOffload::worker(
-    RegexRequest* req, snort::SnortConfig* initial_config, unsigned id)
+void RegexOffloadPool::search(std::vector<RegexRequest*>& reqs)
 {
-    set_instance_id(id);
-    snort::SnortConfig::set_conf(initial_config);
+    std::vector<Search> searches;
 
-    while ( true )
+    for ( auto* req : reqs )
     {
-        {
-            std::unique_lock<std::mutex> lock(req->mutex);
-            req->cond.wait_for(lock, std::chrono::seconds(1));
+        assert(req->packet);
+        assert(req->packet->is_offloaded());
 
-            if ( !req->go )
-                break;
+        IpsContext* c = req->packet->context;
+        assert(c->searches.items.size() > 0);
 
-            if ( !req->offload )
+        for ( auto& it : c->searches.items )
+        {
+            if ( it.second.done )
                 continue;
-        }
 
-        assert(req->packet);
-        assert(req->packet->is_offloaded());
-        assert(req->packet->context->searches.items.size() > 0);
+            it.second.error = false;
+            it.second.matches = 0;
+
+            for ( auto* so : it.second.so )
+                searches.push_back({ c->conf, so->get_offload_mpse(), &it.first, &it.second, &c->searches });
+        }
+    }
 
-        snort::SnortConfig::set_conf(req->packet->context->conf);
-        snort::IpsContext* c = req->packet->context;
-        snort::Mpse::MpseRespType resp_ret;
+    std::stable_sort(searches.begin(), searches.end(),
+        [](const Search& a, const Search& b)
+        {
+            if ( a.conf != b.conf )
+                return a.conf < b.conf;
+            return a.mpse < b.mpse;
+        });
 
-        c->searches.offload_search();
+    SnortConfig* conf = nullptr;
 
-        do
+    for ( auto& s : searches )
+    {
+        if ( s.conf != conf )
         {
-            resp_ret = c->searches.receive_offload_responses();
+            conf = s.conf;
+            SnortConfig::set_conf(conf);
         }
-        while (resp_ret == snort::Mpse::MPSE_RESP_NOT_COMPLETE);
+        int start_state = 0;
 
-        if (resp_ret == snort::Mpse::MPSE_RESP_COMPLETE_FAIL)
+        s.item->matches += s.mpse->search(
+            s.key->buf, s.key->len, s.batch->mf, s.batch->context, &start_state);
+
+        pc.offload_bytes += s.key->len;
+    }
+
+    for ( auto* req : reqs )
+        req->packet->context->searches.items.clear();
+
+    pc.offload_batches++;
+
+    if ( reqs.size() > 1 )
+        pc.offload_batched += reqs.size();
+}
+
+void RegexOffloadPool::worker(unsigned id, SnortConfig* initial_config)
+{
+    set_instance_id(ThreadConfig::get_instance_max() + id);
+    SnortConfig::set_conf(initial_config);
+
+    std::vector<RegexRequest*> reqs;
+
+    while ( true )
+    {
+        reqs.clear();
+
+        if ( !take(id, reqs) and !steal(id, reqs) )
         {
-            if (c->searches.can_fallback())
-            {
-                c->searches.search_sync();
-                pc.offload_fallback++;
-            }
-            pc.offload_failures++;
-        }
+            std::unique_lock<std::mutex> lock(mutex);
 
-        c->searches.items.clear();
-        req->offload = false;
+            if ( !go )
+                break;
 
-#ifdef REG_TEST
+            if ( !pending )
+                cond.wait_for(lock, std::chrono::seconds(1));
+
+            continue;
+        }
+        pending -= reqs.size();
+        search(reqs);
+
+        for ( auto* req : reqs )
         {
+#ifdef REG_TEST
+            // the waiter must not see offload cleared before the result is queued
             std::unique_lock<std::mutex> lock(req->sync_mutex);
+#endif
+            req->offload = false;
+            req->owner->complete(id, req);
+
+#ifdef REG_TEST
             req->sync_cond.notify_one();
-        }
 #endif
+        }
     }
     snort::ModuleManager::accumulate_offload("search_engine");
     snort::ModuleManager::accumulate_offload("detection");
@@ -328,3 +458,114 @@ void ThreadRegexOffload::worker(
     RuleLatency::tterm();
 }
 
+//--------------------------------------------------------------------------
+// async (threads) offload implementation
+//--------------------------------------------------------------------------
+
+static void count_offload_latency(const SnortClock::time_point& start)
+{
+    auto usecs = clock_usecs(TO_USECS(SnortClock::now() - start));
+
+    if ( usecs < 10 )
+        pc.offload_lt_10us++;
+    else if ( usecs < 100 )
+        pc.offload_lt_100us++;
+    else if ( usecs < 1000 )
+        pc.offload_lt_1ms++;
+    else if ( usecs < 10000 )
+        pc.offload_lt_10ms++;
+    else
+        pc.offload_ge_10ms++;
+}
+
+ThreadRegexOffload::ThreadRegexOffload(unsigned max) : RegexOffload(max)
+{
+    if ( !max )
+    {
+        pool = nullptr;
+        return;
+    }
+
+    pool = RegexOffloadPool::acquire(max);
+
+    // each ring can hold all of this thread's requests
+    for ( unsigned i = 0; i < pool->size(); ++i )
+        done.emplace_back(new SpscRing<RegexRequest*>(max));
+
+    for ( auto* req : idle )
+        req->owner = this;
+}
+
+ThreadRegexOffload::~ThreadRegexOffload()
+{
+    if ( pool )
+        RegexOffloadPool::release();
+
+    for ( auto* ring : done )
+        delete ring;
+}
+
+void ThreadRegexOffload::put(snort::Packet* p)
+{
+    Profile profile(mpsePerfStats);
+
+    assert(p);
+    assert(!idle.empty());
+    assert(p->context->searches.items.size() > 0);
+
+    RegexRequest* req = idle.front();
+    idle.pop_front();  // FIXIT-H use splice to move instead
+
+    busy.emplace_back(req);
+    p->context->regex_req_it = std::prev(busy.end());
+
+    req->packet = p;
+    req->start = SnortClock::now();
+    req->offload = true;
+
+    pool->put(get_instance_id() + next_queue++, req);
+
+#ifdef REG_TEST
+    {
+        std::unique_lock<std::mutex> sync_lock(req->sync_mutex);
+        while ( req->offload and req->sync_cond.wait_for(sync_lock, std::chrono::seconds(1))
+            == std::cv_status::timeout );
+    }
+#endif
+}
+
+bool ThreadRegexOffload::get(snort::Packet*& p)
+{
+    Profile profile(mpsePerfStats);
+    assert(!busy.empty());
+
+    for ( unsigned i = 0; i < done.size(); ++i )
+    {
+        unsigned n = (next_done + i) % done.size();
+        RegexRequest* req;
+
+        if ( !done[n]->pop(req) )
+            continue;
+
+        next_done = n + 1;
+        count_offload_latency(req->start);
+
+        p = req->packet;
+        req->packet = nullptr;
+
+        busy.erase(p->context->regex_req_it);
+        idle.emplace_back(req);
+
+        return true;
+    }
+
+    p = nullptr;
+    return false;
+}
+
+void ThreadRegexOffload::complete(unsigned n, RegexRequest* req)
+{
+    bool ok = done[n]->push(req);
+    assert(ok);
+    UNUSED(ok);
+}
@@ -25,13 +25,14 @@
 // There are two flavors: MPSE and thread.  The MpseRegexOffload interfaces to
 // an MPSE that is capable of regex offload such as the RXP whereas
 // ThreadRegexOffload implements the regex search in auxiliary threads w/o
-// requiring extra MPSE instances.  presently all offload is per packet thread;
-// packet threads do not share offload resources.
+// requiring extra MPSE instances.  each packet thread has its own requests
+// but the threads are a single pool shared by all packet threads.  results
+// come back to each packet thread through one lock free ring per worker.
 
-#include <condition_variable>
 #include <list>
-#include <mutex>
-#include <thread>
+#include <vector>
+
+#include "helpers/spsc_ring.h"
 
 namespace snort
 {
@@ -40,6 +41,7 @@ struct Packet;
 struct SnortConfig;
 }
 struct RegexRequest;
+class RegexOffloadPool;
 
 class RegexOffload
 {
@@ -83,13 +85,17 @@ public:
     ThreadRegexOffload(unsigned max);
     ~ThreadRegexOffload() override;
 
-    void stop() override;
-
     void put(snort::Packet*) override;
     bool get(snort::Packet*&) override;
 
+    // called by worker n when a request is done
+    void complete(unsigned n, RegexRequest*);
+
 private:
-    static void worker(RegexRequest*, snort::SnortConfig*, unsigned id);
+    RegexOffloadPool* pool;
+    std::vector<SpscRing<RegexRequest*>*> done;
+    unsigned next_queue = 0;
+    unsigned next_done = 0;
 };
 
 #endif
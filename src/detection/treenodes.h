@@ -68,6 +68,13 @@ struct OtnState
     uint64_t latency_timeouts = 0;
     uint64_t latency_suspends = 0;
 
+    // rolling cost of this rule, matches counted at its leaf and the rest
+    // summed from the nodes on its path by RuleCostContext::get_top()
+    uint64_t cost_evals = 0;
+    uint64_t cost_matches = 0;
+    uint64_t cost_ticks = 0;
+    uint64_t cost_bytes = 0;
+
     operator bool() const
     { return elapsed > 0_ticks || checks > 0; }
 };
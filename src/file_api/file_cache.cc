@@ -23,6 +23,10 @@
 
 #include "file_cache.h"
 
+#include <chrono>
+#include <cstring>
+#include <vector>
+
 #include "hash/xhash.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
@@ -37,6 +41,41 @@
 
 using namespace snort;
 
+// freeing a context drains its offloaded signature work, which can wait on
+// other threads, so contexts unlinked with a stripe locked are collected
+// here and deleted after the lock is released
+namespace
+{
+class RetiredFiles
+{
+public:
+    RetiredFiles()
+    { current = this; }
+
+    ~RetiredFiles()
+    {
+        current = nullptr;
+
+        for ( auto file : files )
+            delete file;
+    }
+
+    static void retire(FileContext* file)
+    {
+        if ( current )
+            current->files.emplace_back(file);
+        else
+            delete file;
+    }
+
+private:
+    std::vector<FileContext*> files;
+    static THREAD_LOCAL RetiredFiles* current;
+};
+
+THREAD_LOCAL RetiredFiles* RetiredFiles::current = nullptr;
+}
+
 static int file_cache_anr_free_func(void*, void* data)
 {
     FileCache::FileNode* node = (FileCache::FileNode*)data;
@@ -50,7 +89,7 @@ static int file_cache_anr_free_func(void*, void* data)
     // only recycle expired nodes
     if (timercmp(&node->cache_expire_time, &now, <))
     {
-        delete node->file;
+        RetiredFiles::retire(node->file);
         return 0;
     }
     else
@@ -62,7 +101,7 @@ static int file_cache_free_func(void*, void* data)
     FileCache::FileNode* node = (FileCache::FileNode*)data;
     if (node)
     {
-        delete node->file;
+        RetiredFiles::retire(node->file);
     }
     return 0;
 }
@@ -76,39 +115,133 @@ static int64_t time_elapsed_ms(struct timeval* now, struct timeval* expire_time,
     return lookup_timeout * 1000 + timersub_ms(now, expire_time);
 }
 
+//-------------------------------------------------------------------------
+// stripe locking and the per thread front cache
+//-------------------------------------------------------------------------
+
+// expiry refreshes smaller than this are skipped on a front cache hit
+#define FRONT_CACHE_REFRESH_SLACK 1
+
+namespace
+{
+// the key is kept as raw bytes so the entries need no construction
+struct FrontEntry
+{
+    uint64_t key[sizeof(FileCache::FileHashKey) / sizeof(uint64_t)];
+    uint32_t hash;
+    FileContext* file;
+    struct timeval expire_time;
+    unsigned generation;
+    unsigned owner;
+};
+
+class StripeLock
+{
+public:
+    StripeLock(std::mutex& m) : mutex(m)
+    {
+        if ( mutex.try_lock() )
+            return;
+
+        auto start = std::chrono::steady_clock::now();
+        mutex.lock();
+        auto wait = std::chrono::steady_clock::now() - start;
+
+        file_counts.cache_lock_waits++;
+        file_counts.cache_lock_wait_usecs +=
+            std::chrono::duration_cast<std::chrono::microseconds>(wait).count();
+    }
+
+    ~StripeLock()
+    { mutex.unlock(); }
+
+private:
+    std::mutex& mutex;
+};
+}
+
+static THREAD_LOCAL FrontEntry front_cache[FileCache::FRONT_CACHE_SIZE];
+
+// 0 is never assigned so zeroed front cache entries never match
+static std::atomic<unsigned> cache_instances { 0 };
+
+static uint32_t key_hash(const FileCache::FileHashKey& key)
+{
+    static_assert(sizeof(key) % sizeof(uint64_t) == 0, "key is not a multiple of 8 bytes");
+    const uint64_t* w = (const uint64_t*)&key;
+    uint64_t h = 0;
+
+    // fold the key and mix once; this only picks a stripe and front slot
+    for ( unsigned i = 0; i < sizeof(key) / sizeof(uint64_t); ++i )
+        h = ((h << 5) | (h >> 59)) ^ w[i];
+
+    h *= 0x9E3779B97F4A7C15;
+    return (uint32_t)(h >> 32);
+}
+
+static inline unsigned stripe_of(uint32_t hash)
+{ return hash & (FileCache::NUM_STRIPES - 1); }
+
+static inline unsigned front_slot_of(uint32_t hash)
+{ return (hash >> 16) & (FileCache::FRONT_CACHE_SIZE - 1); }
+
+//-------------------------------------------------------------------------
+// file cache
+//-------------------------------------------------------------------------
+
 FileCache::FileCache(int64_t max_files_cached)
 {
+    static_assert((NUM_STRIPES & (NUM_STRIPES - 1)) == 0, "stripes must be a power of 2");
+    static_assert((FRONT_CACHE_SIZE & (FRONT_CACHE_SIZE - 1)) == 0,
+        "front cache size must be a power of 2");
+
+    instance_id = ++cache_instances;
     max_files = max_files_cached;
-    fileHash = xhash_new(max_files, sizeof(FileHashKey), sizeof(FileNode),
-        0, 1, file_cache_anr_free_func, file_cache_free_func, 1);
-    if (!fileHash)
-        FatalError("Failed to create the expected channel hash table.\n");
-    xhash_set_max_nodes(fileHash, max_files);
+    int64_t stripe_max = (max_files + NUM_STRIPES - 1) / NUM_STRIPES;
+
+    for ( auto& stripe : stripes )
+    {
+        stripe.fileHash = xhash_new(stripe_max, sizeof(FileHashKey), sizeof(FileNode),
+            0, 1, file_cache_anr_free_func, file_cache_free_func, 1);
+        if (!stripe.fileHash)
+            FatalError("Failed to create the expected channel hash table.\n");
+        xhash_set_max_nodes(stripe.fileHash, stripe_max);
+    }
 }
 
 FileCache::~FileCache()
 {
-    if (fileHash)
+    for ( auto& stripe : stripes )
     {
-        xhash_delete(fileHash);
+        if (stripe.fileHash)
+            xhash_delete(stripe.fileHash);
     }
 }
 
 void FileCache::set_block_timeout(int64_t timeout)
 {
-    std::lock_guard<std::mutex> lock(cache_mutex);
     block_timeout = timeout;
 }
 
 void FileCache::set_lookup_timeout(int64_t timeout)
 {
-    std::lock_guard<std::mutex> lock(cache_mutex);
     lookup_timeout = timeout;
 }
 
+void FileCache::set_stripe_max(int64_t max)
+{
+    int64_t stripe_max = (max + NUM_STRIPES - 1) / NUM_STRIPES;
+
+    for ( auto& stripe : stripes )
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        xhash_set_max_nodes(stripe.fileHash, stripe_max);
+    }
+}
+
 void FileCache::set_max_files(int64_t max)
 {
-    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::lock_guard<std::mutex> lock(config_mutex);
 
     int64_t minimal_files = ThreadConfig::get_instance_max() + 1;
     if (max < minimal_files)
@@ -119,10 +252,57 @@ void FileCache::set_max_files(int64_t max)
     }
     else
         max_files = max;
-    xhash_set_max_nodes(fileHash, max_files);
+    set_stripe_max(max_files);
+}
+
+// A front cache entry is only used while its stripe has not freed any node
+// since the entry was taken, so the context is known to still be cached.
+// Since expiry times only move forward, the recorded expiry is a lower
+// bound on the cached one; the stripe is only skipped when the refresh
+// find() would do is a no-op or less than the slack.  Verdicts stored with
+// the block timeout always go through the stripe.
+FileContext* FileCache::front_find(const FileHashKey& key, uint32_t hash, int64_t timeout)
+{
+    FrontEntry& entry = front_cache[front_slot_of(hash)];
+
+    if ( entry.owner != instance_id or entry.hash != hash or
+        memcmp(entry.key, &key, sizeof(key)) )
+        return nullptr;
+
+    if ( entry.generation != stripes[stripe_of(hash)].generation.load(std::memory_order_acquire) )
+        return nullptr;
+
+    struct timeval now;
+    packet_gettimeofday(&now);
+
+    if ( !timercmp(&now, &entry.expire_time, <) )
+        return nullptr;
+
+    struct timeval next_expire_time;
+    struct timeval time_to_add = { timeout - FRONT_CACHE_REFRESH_SLACK, 0 };
+    timeradd(&now, &time_to_add, &next_expire_time);
+
+    if ( timercmp(&entry.expire_time, &next_expire_time, <) )
+        return nullptr;
+
+    file_counts.cache_front_hits++;
+    return entry.file;
+}
+
+// called with the stripe locked
+void FileCache::front_update(const FileHashKey& key, uint32_t hash, const FileNode& node)
+{
+    FrontEntry& entry = front_cache[front_slot_of(hash)];
+
+    memcpy(entry.key, &key, sizeof(key));
+    entry.hash = hash;
+    entry.file = node.file;
+    entry.expire_time = node.cache_expire_time;
+    entry.generation = stripes[stripe_of(hash)].generation.load(std::memory_order_relaxed);
+    entry.owner = instance_id;
 }
 
-FileContext* FileCache::add(const FileHashKey& hashKey, int64_t timeout)
+FileContext* FileCache::add(const FileHashKey& hashKey, uint32_t hash, int64_t timeout)
 {
     FileNode new_node;
     /*
@@ -139,9 +319,18 @@ FileContext* FileCache::add(const FileHashKey& hashKey, int64_t timeout)
 
     new_node.file = new FileContext;
 
-    std::lock_guard<std::mutex> lock(cache_mutex);
+    // declared first so a recycled context is deleted after the unlock
+    RetiredFiles retired;
+    Stripe& stripe = stripes[stripe_of(hash)];
+    StripeLock lock(stripe.mutex);
 
-    if (xhash_add(fileHash, (void*)&hashKey, &new_node) != XHASH_OK)
+    unsigned recycled = xhash_anr_count(stripe.fileHash);
+    int ret = xhash_add(stripe.fileHash, (void*)&hashKey, &new_node);
+
+    if (xhash_anr_count(stripe.fileHash) != recycled)
+        stripe.generation.fetch_add(1, std::memory_order_release);
+
+    if (ret != XHASH_OK)
     {
         /* Uh, shouldn't get here...
          * There is already a node or couldn't alloc space
@@ -149,23 +338,31 @@ FileContext* FileCache::add(const FileHashKey& hashKey, int64_t timeout)
          * gracefully.
          */
         file_counts.cache_add_fails++;
-        delete new_node.file;
+        RetiredFiles::retire(new_node.file);
         return nullptr;
     }
 
+    front_update(hashKey, hash, new_node);
     return new_node.file;
 }
 
-FileContext* FileCache::find(const FileHashKey& hashKey, int64_t timeout)
+FileContext* FileCache::find(const FileHashKey& hashKey, uint32_t hash, int64_t timeout)
 {
-    std::lock_guard<std::mutex> lock(cache_mutex);
+    FileContext* file = front_find(hashKey, hash, timeout);
+
+    if (file)
+        return file;
+
+    RetiredFiles retired;
+    Stripe& stripe = stripes[stripe_of(hash)];
+    StripeLock lock(stripe.mutex);
 
-    if (!xhash_count(fileHash))
+    if (!xhash_count(stripe.fileHash))
     {
         return nullptr;
     }
 
-    XHashNode* hash_node = xhash_find_node(fileHash, &hashKey);
+    XHashNode* hash_node = xhash_find_node(stripe.fileHash, &hashKey);
 
     if (!hash_node)
         return nullptr;
@@ -173,7 +370,8 @@ FileContext* FileCache::find(const FileHashKey& hashKey, int64_t timeout)
     FileNode* node = (FileNode*)hash_node->data;
     if (!node)
     {
-        xhash_free_node(fileHash, hash_node);
+        xhash_free_node(stripe.fileHash, hash_node);
+        stripe.generation.fetch_add(1, std::memory_order_release);
         return nullptr;
     }
 
@@ -182,7 +380,8 @@ FileContext* FileCache::find(const FileHashKey& hashKey, int64_t timeout)
 
     if (timercmp(&node->cache_expire_time, &now, <))
     {
-        xhash_free_node(fileHash, hash_node);
+        xhash_free_node(stripe.fileHash, hash_node);
+        stripe.generation.fetch_add(1, std::memory_order_release);
         return nullptr;
     }
 
@@ -194,6 +393,7 @@ FileContext* FileCache::find(const FileHashKey& hashKey, int64_t timeout)
     if (timercmp(&node->cache_expire_time, &next_expire_time, <))
         node->cache_expire_time = next_expire_time;
 
+    front_update(hashKey, hash, *node);
     return node->file;
 }
 
@@ -205,9 +405,10 @@ FileContext* FileCache::get_file(Flow* flow, uint64_t file_id, bool to_create,
     hashKey.sip.set(flow->server_ip);
     hashKey.padding = 0;
     hashKey.file_id = file_id;
-    FileContext* file = find(hashKey, timeout);
+    uint32_t hash = key_hash(hashKey);
+    FileContext* file = find(hashKey, hash, timeout);
     if (to_create and !file)
-       file = add(hashKey, timeout);
+       file = add(hashKey, hash, timeout);
 
     return file;
 }
@@ -21,6 +21,7 @@
 #ifndef FILE_CACHE_H
 #define FILE_CACHE_H
 
+#include <atomic>
 #include <mutex>
 
 #include "sfip/sf_ip.h"
@@ -54,6 +55,12 @@ PADDING_GUARD_END
         snort::FileContext* file;
     };
 
+    // the cache is split into stripes, each with its own hash and lock,
+    // selected by a hash of the key; packet threads also keep a small
+    // front cache of recently used contexts in front of the stripes
+    static const unsigned NUM_STRIPES = 16;
+    static const unsigned FRONT_CACHE_SIZE = 8;
+
     FileCache(int64_t max_files_cached);
     ~FileCache();
 
@@ -68,18 +75,36 @@ PADDING_GUARD_END
         snort::FilePolicyBase*);
 
 private:
-    snort::FileContext* add(const FileHashKey&, int64_t timeout);
-    snort::FileContext* find(const FileHashKey&, int64_t);
+    struct Stripe
+    {
+        snort::XHash* fileHash = nullptr;
+        std::mutex mutex;
+
+        // bumped whenever a node is freed so front cache entries taken
+        // from this stripe can be validated without the lock
+        std::atomic<unsigned> generation { 0 };
+    };
+
+    void set_stripe_max(int64_t);
+
+    snort::FileContext* front_find(const FileHashKey&, uint32_t hash, int64_t timeout);
+    void front_update(const FileHashKey&, uint32_t hash, const FileNode&);
+
+    snort::FileContext* add(const FileHashKey&, uint32_t hash, int64_t timeout);
+    snort::FileContext* find(const FileHashKey&, uint32_t hash, int64_t timeout);
     snort::FileContext* get_file(snort::Flow*, uint64_t file_id, bool to_create, int64_t timeout);
     FileVerdict check_verdict(snort::Packet*, snort::FileInfo*, snort::FilePolicyBase*);
     int store_verdict(snort::Flow*, snort::FileInfo*, int64_t timeout);
 
-    /* The hash table of expected files */
-    snort::XHash* fileHash = nullptr;
-    int64_t block_timeout = DEFAULT_FILE_BLOCK_TIMEOUT;
-    int64_t lookup_timeout = DEFAULT_FILE_LOOKUP_TIMEOUT;
+    /* The hash tables of expected files */
+    Stripe stripes[NUM_STRIPES];
+    std::mutex config_mutex;
+    std::atomic<int64_t> block_timeout { DEFAULT_FILE_BLOCK_TIMEOUT };
+    std::atomic<int64_t> lookup_timeout { DEFAULT_FILE_LOOKUP_TIMEOUT };
     int64_t max_files = DEFAULT_MAX_FILES_CACHED;
-    std::mutex cache_mutex;
+
+    // distinguishes this cache from a previous one in the front caches
+    unsigned instance_id;
 };
 
 #endif
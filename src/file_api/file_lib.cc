@@ -29,12 +29,11 @@
 
 #include "file_lib.h"
 
-#include <openssl/sha.h>
-
 #include <iostream>
 #include <iomanip>
 
 #include "hash/hashes.h"
+#include "hash/sha256_mb.h"
 #include "framework/data_bus.h"
 #include "main/snort_config.h"
 #include "managers/inspector_manager.h"
@@ -47,12 +46,15 @@
 #include "file_config.h"
 #include "file_cache.h"
 #include "file_flows.h"
+#include "file_offload.h"
 #include "file_service.h"
 #include "file_segment.h"
 #include "file_stats.h"
 
 using namespace snort;
 
+static const DataEventId file_event = DataBus::get_id("file_event");
+
 // Convert UTF16-LE file name to UTF-8.
 // Returns allocated name. Caller responsible for freeing the buffer.
 char* FileContext::get_UTF8_fname(size_t* converted_len)
@@ -269,6 +271,11 @@ FileContext::FileContext ()
 
 FileContext::~FileContext ()
 {
+    if (offload)
+    {
+        FileOffload::drain(*offload);
+        delete offload;
+    }
     if (file_signature_context)
         snort_free(file_signature_context);
     if (file_capture)
@@ -297,16 +304,16 @@ void FileContext::log_file_event(Flow* flow, FilePolicyBase* policy)
         {
         case FILE_VERDICT_LOG:
             // Log file event through data bus
-            DataBus::publish("file_event", (const uint8_t*)"LOG", 3, flow);
+            DataBus::publish(file_event, (const uint8_t*)"LOG", 3, flow);
             break;
 
         case FILE_VERDICT_BLOCK:
             // can't block session inside a session
-            DataBus::publish("file_event", (const uint8_t*)"BLOCK", 5, flow);
+            DataBus::publish(file_event, (const uint8_t*)"BLOCK", 5, flow);
             break;
 
         case FILE_VERDICT_REJECT:
-            DataBus::publish("file_event", (const uint8_t*)"RESET", 5, flow);
+            DataBus::publish(file_event, (const uint8_t*)"RESET", 5, flow);
             break;
         default:
             log_needed = false;
@@ -446,7 +453,7 @@ bool FileContext::process(Packet* p, const uint8_t* file_data, int data_size,
     /* file signature calculation */
     if (is_file_signature_enabled())
     {
-        if (!sha256)
+        if (!sha256 and !offload_signature(file_data, data_size, position))
             process_file_signature_sha256(file_data, data_size, position);
 
         file_stats->data_processed[get_file_type()][get_file_direction()]
@@ -514,6 +521,34 @@ void FileContext::process_file_type(const uint8_t* file_data, int data_size, Fil
         finalize_file_type();
 }
 
+// Hand the segment to an offload thread if possible.  Only the start and
+// middle of a file within the signature depth are offloaded; everything
+// else is hashed inline after the file's queued segments are done.
+bool FileContext::offload_signature(const uint8_t* file_data, int data_size,
+    FilePosition position)
+{
+    if ( !FileOffload::enabled() or file_state.sig_state != FILE_SIG_PROCESSING or
+        (position != SNORT_FILE_START and position != SNORT_FILE_MIDDLE) or
+        ((int64_t)processed_bytes + data_size > config->file_signature_depth) )
+    {
+        if (offload)
+            FileOffload::drain(*offload);
+        return false;
+    }
+
+    if (position == SNORT_FILE_MIDDLE and !file_signature_context)
+        return false;
+
+    if (!file_signature_context)
+        file_signature_context = snort_calloc(sizeof(Sha256Ctx));
+
+    if (!offload)
+        offload = new FileOffloadState;
+
+    return FileOffload::hash(*offload, (Sha256Ctx*)file_signature_context,
+        position == SNORT_FILE_START, file_data, data_size);
+}
+
 void FileContext::process_file_signature_sha256(const uint8_t* file_data, int data_size,
     FilePosition position)
 {
@@ -523,57 +558,51 @@ void FileContext::process_file_signature_sha256(const uint8_t* file_data, int da
         return;
     }
 
+    Sha256Ctx* ctx = (Sha256Ctx*)file_signature_context;
+
     switch (position)
     {
     case SNORT_FILE_START:
-        if (!file_signature_context)
-            file_signature_context = snort_calloc(sizeof(SHA256_CTX));
-        SHA256_Init((SHA256_CTX*)file_signature_context);
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
+        if (!ctx)
+            file_signature_context = ctx = (Sha256Ctx*)snort_calloc(sizeof(Sha256Ctx));
+        sha256_init(*ctx);
+        sha256_update(*ctx, file_data, data_size);
         if (file_state.sig_state == FILE_SIG_FLUSH)
         {
-            static uint8_t file_signature_context_backup[sizeof(SHA256_CTX)];
             sha256 = (uint8_t*)snort_alloc(SHA256_HASH_SIZE);
-            memcpy(file_signature_context_backup, file_signature_context, sizeof(SHA256_CTX));
-
-            SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
-            memcpy(file_signature_context, file_signature_context_backup, sizeof(SHA256_CTX));
+            sha256_final(*ctx, sha256);
         }
         break;
 
     case SNORT_FILE_MIDDLE:
-        if (!file_signature_context)
+        if (!ctx)
             return;
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
+        sha256_update(*ctx, file_data, data_size);
         if (file_state.sig_state == FILE_SIG_FLUSH)
         {
-            static uint8_t file_signature_context_backup[sizeof(SHA256_CTX)];
             if ( !sha256 )
                 sha256 = (uint8_t*)snort_alloc(SHA256_HASH_SIZE);
-            memcpy(file_signature_context_backup, file_signature_context, sizeof(SHA256_CTX));
-
-            SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
-            memcpy(file_signature_context, file_signature_context_backup, sizeof(SHA256_CTX));
+            sha256_final(*ctx, sha256);
         }
 
         break;
 
     case SNORT_FILE_END:
-        if (!file_signature_context)
+        if (!ctx)
             return;
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
+        sha256_update(*ctx, file_data, data_size);
         sha256 = new uint8_t[SHA256_HASH_SIZE];
-        SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
+        sha256_final(*ctx, sha256);
         file_state.sig_state = FILE_SIG_DONE;
         break;
 
     case SNORT_FILE_FULL:
-        if (!file_signature_context)
-            file_signature_context = snort_calloc(sizeof (SHA256_CTX));
-        SHA256_Init((SHA256_CTX*)file_signature_context);
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
+        if (!ctx)
+            file_signature_context = ctx = (Sha256Ctx*)snort_calloc(sizeof (Sha256Ctx));
+        sha256_init(*ctx);
+        sha256_update(*ctx, file_data, data_size);
         sha256 = new uint8_t[SHA256_HASH_SIZE];
-        SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
+        sha256_final(*ctx, sha256);
         file_state.sig_state = FILE_SIG_DONE;
         break;
 
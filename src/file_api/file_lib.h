@@ -36,6 +36,7 @@
 class FileCapture;
 class FileConfig;
 class FileSegments;
+struct FileOffloadState;
 
 namespace snort
 {
@@ -141,8 +142,10 @@ private:
     FileSegments* file_segments;
     FileInspect* inspector;
     FileConfig*  config;
+    FileOffloadState* offload = nullptr;
 
     inline void finalize_file_type();
+    bool offload_signature(const uint8_t* file_data, int data_size, FilePosition);
     inline void finish_signature_lookup(Packet*, bool, FilePolicyBase*);
 };
 }
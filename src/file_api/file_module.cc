@@ -152,6 +152,15 @@ static const Parameter file_id_params[] =
     { "max_files_cached", Parameter::PT_INT, "8:max53", "65536",
       "maximal number of files cached in memory" },
 
+    { "offload_threads", Parameter::PT_INT, "0:64", "0",
+      "number of threads computing file signatures for the packet threads (0 to disable)" },
+
+    { "offload_ring", Parameter::PT_INT, "1:65536", "256",
+      "number of file segments each packet thread may queue for each offload thread" },
+
+    { "signature_batch", Parameter::PT_INT, "0:max32", "0",
+      "without offload threads, bytes of file data each packet thread collects to hash several files at once (0 to disable)" },
+
     { "enable_type", Parameter::PT_BOOL, nullptr, "true",
       "enable type ID" },
 
@@ -190,6 +199,18 @@ static const PegInfo file_pegs[] =
     { CountType::SUM, "total_files", "number of files processed" },
     { CountType::SUM, "total_file_data", "number of file data bytes processed" },
     { CountType::SUM, "cache_failures", "number of file cache add failures" },
+    { CountType::SUM, "cache_front_hits", "number of file cache lookups served by the thread front cache" },
+    { CountType::SUM, "cache_lock_waits", "number of file cache lookups that waited for a stripe lock" },
+    { CountType::SUM, "cache_lock_wait_usecs", "total time waiting for file cache stripe locks in usecs" },
+    { CountType::SUM, "offload_segments", "number of file segments hashed by offload threads" },
+    { CountType::SUM, "offload_bytes", "number of file bytes hashed by offload threads" },
+    { CountType::SUM, "offload_full", "number of file segments hashed inline because the ring was full" },
+    { CountType::SUM, "offload_waits", "number of times a packet thread waited for a file's queued segments" },
+    { CountType::NOW, "offload_depth", "file segments waiting to be hashed" },
+    { CountType::MAX, "offload_max_depth", "maximum file segments waiting to be hashed" },
+    { CountType::SUM, "batch_runs", "number of file segment batches hashed by packet threads" },
+    { CountType::SUM, "batch_files", "number of files in file segment batches" },
+    { CountType::SUM, "batch_bytes", "number of file bytes hashed in batches" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -250,6 +271,15 @@ bool FileIdModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("max_files_cached") )
         fc->max_files_cached = v.get_int64();
 
+    else if ( v.is("offload_threads") )
+        fc->offload_threads = v.get_uint8();
+
+    else if ( v.is("offload_ring") )
+        fc->offload_ring = v.get_uint32();
+
+    else if ( v.is("signature_batch") )
+        fc->signature_batch = v.get_uint32();
+
     else if ( v.is("enable_type") )
     {
         if ( v.get_bool() )
@@ -0,0 +1,510 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// file_offload.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_offload.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hash/sha256_mb.h"
+#include "helpers/spsc_ring.h"
+#include "main/thread.h"
+#include "utils/util.h"
+
+#include "file_stats.h"
+
+using namespace snort;
+
+// -----------------------------------------------------------------------------
+// queues
+// -----------------------------------------------------------------------------
+
+struct Job
+{
+    FileOffloadState* state;
+    Sha256Ctx* ctx;
+    uint8_t* buf;
+    unsigned len;
+    bool init;
+};
+
+struct Queue
+{
+    Queue(unsigned size) : ring(size) { }
+
+    SpscRing<Job> ring;
+    std::atomic<uint64_t> done { 0 };  // written by the offload thread
+    uint64_t pushed = 0;               // producer only
+};
+
+// -----------------------------------------------------------------------------
+// batches
+//
+// segments of different files are hashed together with sha256_update_mb().
+// the segments of a file stay in order and form one stream of the batch.
+// -----------------------------------------------------------------------------
+
+#define MAX_BATCH_JOBS 256
+
+class Batch
+{
+public:
+    void add(const Job&, Queue*);
+    void run();
+
+    size_t get_bytes() const
+    { return bytes; }
+
+private:
+    struct Item
+    {
+        Job job;
+        Queue* queue;
+        unsigned stream;
+    };
+
+    std::vector<Item> jobs;
+    std::vector<Sha256Stream> streams;
+    std::vector<Sha256Seg> segs;
+    size_t bytes = 0;
+};
+
+void Batch::add(const Job& j, Queue* q)
+{
+    unsigned s = 0;
+
+    while ( s < streams.size() and streams[s].ctx != j.ctx )
+        ++s;
+
+    // a restarted file can't be initialized under its earlier segments
+    if ( j.init and s < streams.size() )
+    {
+        run();
+        s = 0;
+    }
+
+    if ( j.init )
+        sha256_init(*j.ctx);
+
+    if ( s == streams.size() )
+        streams.push_back({ j.ctx, nullptr, 0 });
+
+    ++streams[s].count;
+    jobs.push_back({ j, q, s });
+    bytes += j.len;
+
+    if ( jobs.size() >= MAX_BATCH_JOBS )
+        run();
+}
+
+void Batch::run()
+{
+    if ( jobs.empty() )
+        return;
+
+    // lay out each stream's segments together, in order
+    segs.resize(jobs.size());
+    unsigned off = 0;
+
+    for ( auto& s : streams )
+    {
+        s.segs = segs.data() + off;
+        off += s.count;
+        s.count = 0;
+    }
+
+    for ( auto& i : jobs )
+    {
+        Sha256Stream& s = streams[i.stream];
+        segs[(s.segs - segs.data()) + s.count++] = { i.job.buf, i.job.len };
+    }
+
+    // offload threads count into their own file_counts, which aren't
+    // reported, so these are only the packet thread batches
+    ++file_counts.batch_runs;
+    file_counts.batch_files += streams.size();
+    file_counts.batch_bytes += bytes;
+
+    sha256_update_mb(streams.data(), streams.size());
+
+    for ( auto& i : jobs )
+    {
+        snort_free(i.job.buf);
+
+        // the state may be freed as soon as its count is complete
+        if ( i.queue )
+            i.queue->done.fetch_add(1, std::memory_order_release);
+
+        i.job.state->done.fetch_add(1, std::memory_order_release);
+    }
+    jobs.clear();
+    streams.clear();
+    bytes = 0;
+}
+
+// -----------------------------------------------------------------------------
+// threads
+// -----------------------------------------------------------------------------
+
+// one queue per offload thread for each packet thread or, without offload
+// threads, a batch hashed by the packet thread itself.  a file context can
+// be freed by any packet thread (the file cache recycles expired nodes on
+// whichever thread adds or finds one) so the batch is locked and another
+// thread can run it to drain a file.
+struct Local
+{
+    std::vector<Queue*> queues;
+    unsigned next = 0;
+
+    Batch* batch = nullptr;
+    size_t batch_limit = 0;
+    std::mutex batch_mutex;
+};
+
+static THREAD_LOCAL Local* s_local = nullptr;
+
+// s_mutex guards everything below it
+static std::mutex s_mutex;
+static std::condition_variable s_cond;
+static std::vector<std::thread*> s_workers;
+static std::vector<Local*> s_locals;
+static std::vector<Local*> s_batchers;
+static unsigned s_gen = 0;
+static unsigned s_users = 0;
+static bool s_stop = false;
+
+// set by idle offload threads so producers know to kick them
+static std::atomic<unsigned> s_sleepers { 0 };
+
+// -----------------------------------------------------------------------------
+// offload threads
+// -----------------------------------------------------------------------------
+
+static bool service(Queue* q, Batch& batch)
+{
+    Job j;
+    bool any = false;
+
+    while ( q->ring.pop(j) )
+    {
+        batch.add(j, q);
+        any = true;
+    }
+    return any;
+}
+
+// offload thread id services queue id of each packet thread.  queues are
+// only freed after the offload threads are joined so the snapshot can be
+// used unlocked.
+static void worker(unsigned id)
+{
+    std::vector<Queue*> mine;
+    unsigned gen = ~0u;
+    Batch batch;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    while ( true )
+    {
+        if ( gen != s_gen )
+        {
+            mine.clear();
+
+            for ( auto l : s_locals )
+                mine.emplace_back(l->queues[id]);
+
+            gen = s_gen;
+        }
+        bool stop = s_stop;
+        lock.unlock();
+
+        bool idle = true;
+
+        for ( auto q : mine )
+            idle = !service(q, batch) and idle;
+
+        batch.run();
+
+        lock.lock();
+
+        if ( stop and idle )
+            break;
+
+        if ( idle )
+        {
+            ++s_sleepers;
+            s_cond.wait_for(lock, std::chrono::milliseconds(1));
+            --s_sleepers;
+        }
+    }
+}
+
+static void kick()
+{
+    if ( s_sleepers.load(std::memory_order_relaxed) )
+        s_cond.notify_all();
+}
+
+static void start(unsigned threads, unsigned size, unsigned batch)
+{
+    if ( s_local )
+        return;
+
+    if ( (!threads or !size) and batch )
+    {
+        s_local = new Local;
+        s_local->batch = new Batch;
+        s_local->batch_limit = batch;
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_batchers.emplace_back(s_local);
+        return;
+    }
+
+    if ( !threads or !size )
+        return;
+
+    s_local = new Local;
+
+    for ( unsigned i = 0; i < threads; ++i )
+        s_local->queues.emplace_back(new Queue(size));
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_locals.emplace_back(s_local);
+    ++s_gen;
+
+    if ( s_users++ )
+        return;
+
+    assert(s_workers.empty());
+    s_stop = false;
+
+    for ( unsigned i = 0; i < threads; ++i )
+        s_workers.emplace_back(new std::thread(worker, i));
+}
+
+static void wait()
+{
+    s_cond.notify_all();
+    std::this_thread::yield();
+}
+
+static void stop()
+{
+    if ( !s_local )
+        return;
+
+    if ( s_local->batch )
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_batchers.erase(std::find(s_batchers.begin(), s_batchers.end(), s_local));
+        }
+        {
+            // a drain that found this batch before it was unlisted holds
+            // the batch lock until it is done with it
+            std::lock_guard<std::mutex> lock(s_local->batch_mutex);
+            s_local->batch->run();
+        }
+        delete s_local->batch;
+        delete s_local;
+        s_local = nullptr;
+        return;
+    }
+
+    for ( auto q : s_local->queues )
+    {
+        while ( q->done.load(std::memory_order_acquire) != q->pushed )
+            wait();
+    }
+    s_local = nullptr;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    if ( --s_users )
+        return;
+
+    s_stop = true;
+    s_cond.notify_all();
+    lock.unlock();
+
+    for ( auto t : s_workers )
+    {
+        t->join();
+        delete t;
+    }
+    s_workers.clear();
+
+    for ( auto l : s_locals )
+    {
+        for ( auto q : l->queues )
+            delete q;
+
+        delete l;
+    }
+    s_locals.clear();
+}
+
+static void update_depth()
+{
+    PegCount depth = 0;
+
+    for ( auto q : s_local->queues )
+        depth += q->pushed - q->done.load(std::memory_order_relaxed);
+
+    file_counts.offload_depth = depth;
+
+    if ( depth > file_counts.offload_max_depth )
+        file_counts.offload_max_depth = depth;
+}
+
+// -----------------------------------------------------------------------------
+// api
+// -----------------------------------------------------------------------------
+
+void FileOffload::thread_init(unsigned threads, unsigned ring_size, unsigned batch)
+{ start(threads, ring_size, batch); }
+
+void FileOffload::thread_term()
+{ stop(); }
+
+bool FileOffload::enabled()
+{ return s_local != nullptr; }
+
+// run the batch holding the file's segments, whichever thread owns it
+static void batch_drain(FileOffloadState& state)
+{
+    std::unique_lock<std::mutex> list_lock(s_mutex);
+    auto it = std::find(s_batchers.begin(), s_batchers.end(), (Local*)state.owner);
+
+    // the owner is gone; its batch was run when it stopped
+    if ( it == s_batchers.end() )
+        return;
+
+    Local* owner = *it;
+    std::lock_guard<std::mutex> lock(owner->batch_mutex);
+    list_lock.unlock();
+
+    owner->batch->run();
+}
+
+static void batch_hash(FileOffloadState& state, Sha256Ctx* ctx, bool init,
+    const uint8_t* data, unsigned len)
+{
+    // segments must stay in one batch to be hashed in order
+    if ( state.owner != s_local )
+        FileOffload::drain(state);
+
+    Batch* b = s_local->batch;
+    Job j { &state, ctx, (uint8_t*)snort_alloc(len), len, init };
+    memcpy(j.buf, data, len);
+
+    std::lock_guard<std::mutex> lock(s_local->batch_mutex);
+    state.owner = s_local;
+    state.batched = true;
+    state.queued.fetch_add(1, std::memory_order_release);
+    b->add(j, nullptr);
+
+    if ( b->get_bytes() >= s_local->batch_limit )
+        b->run();
+}
+
+bool FileOffload::hash(FileOffloadState& state, Sha256Ctx* ctx, bool init,
+    const uint8_t* data, unsigned len)
+{
+    if ( !s_local )
+    {
+        drain(state);
+        return false;
+    }
+
+    if ( s_local->batch )
+    {
+        batch_hash(state, ctx, init, data, len);
+        return true;
+    }
+
+    // segments must stay on one ring to be hashed in order
+    if ( state.owner != s_local )
+    {
+        drain(state);
+        state.owner = s_local;
+        state.batched = false;
+        state.ring = s_local->next++ % s_local->queues.size();
+    }
+
+    Queue* q = s_local->queues[state.ring];
+    Job j { &state, ctx, (uint8_t*)snort_alloc(len), len, init };
+    memcpy(j.buf, data, len);
+
+    if ( !q->ring.push(j) )
+    {
+        snort_free(j.buf);
+        ++file_counts.offload_full;
+        drain(state);
+        return false;
+    }
+
+    ++q->pushed;
+    state.queued.fetch_add(1, std::memory_order_release);
+    kick();
+
+    ++file_counts.offload_segments;
+    file_counts.offload_bytes += len;
+    update_depth();
+    return true;
+}
+
+void FileOffload::drain(FileOffloadState& state)
+{
+    uint64_t queued = state.queued.load(std::memory_order_acquire);
+
+    if ( state.done.load(std::memory_order_acquire) == queued )
+        return;
+
+    // a batched file is hashed by running the batch that holds it, which
+    // may belong to another packet thread
+    if ( state.batched )
+    {
+        batch_drain(state);
+        assert(state.done.load(std::memory_order_acquire) == queued);
+        return;
+    }
+
+    ++file_counts.offload_waits;
+
+    while ( state.done.load(std::memory_order_acquire) != queued )
+        wait();
+
+    if ( s_local )
+        update_depth();
+}
+
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// file_offload.h
+
+#ifndef FILE_OFFLOAD_H
+#define FILE_OFFLOAD_H
+
+// moves file signature (sha256) computation off the packet threads.  each
+// packet thread has one spsc ring per offload thread and every segment of
+// a file goes to the same ring, so a file is hashed in order by one
+// offload thread while different files are hashed in parallel.  the packet
+// thread copies the segment onto the ring and carries on.  before it uses
+// the hash context itself (to finish or flush the signature, or to free
+// it) it calls drain() for that file, which only waits for that file's
+// outstanding segments.  file capture stays on the packet thread; it is a
+// copy into the mempool, no more work than the copy needed to queue it.
+//
+// offload threads hash whatever they pop from their rings as one batch
+// with sha256_update_mb(), so segments of different files are compressed
+// together.  without offload threads a packet thread can batch its own
+// segments the same way: they are copied until batch bytes are held or a
+// file is drained and then hashed together on the packet thread.  a file
+// context may be freed on any packet thread, so draining a batched file
+// runs the batch of the thread that queued it under that batch's lock.
+
+#include <atomic>
+#include <cstdint>
+
+namespace snort
+{
+struct Sha256Ctx;
+}
+
+struct FileOffloadState
+{
+    // written by the packet thread that owns the file; read by drain()
+    std::atomic<uint64_t> queued { 0 };
+
+    // written by the offload thread
+    std::atomic<uint64_t> done { 0 };
+
+    // written by the owner before queued is bumped
+    const void* owner = nullptr;
+    unsigned ring = 0;
+    bool batched = false;
+};
+
+class FileOffload
+{
+public:
+    // packet thread calls.  the first thread in starts the offload threads
+    // and the last one out stops them.  batch is only used without offload
+    // threads.
+    static void thread_init(unsigned threads, unsigned ring_size, unsigned batch = 0);
+    static void thread_term();
+
+    // true if this packet thread offloads or batches
+    static bool enabled();
+
+    // queue a copy of data to be hashed into ctx, initializing ctx first
+    // if init is set.  false if the caller must hash inline; in that case
+    // nothing is outstanding for the file.
+    static bool hash(FileOffloadState&, snort::Sha256Ctx*, bool init, const uint8_t* data, unsigned len);
+
+    // wait until everything queued for the file has been hashed
+    static void drain(FileOffloadState&);
+};
+
+#endif
+
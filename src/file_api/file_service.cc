@@ -36,6 +36,7 @@
 #include "file_cache.h"
 #include "file_capture.h"
 #include "file_flows.h"
+#include "file_offload.h"
 #include "file_stats.h"
 
 using namespace snort;
@@ -51,6 +52,9 @@ FileCache* FileService::file_cache = nullptr;
 static int64_t max_files_cached = 0;
 static int64_t capture_memcap = 0;
 static int64_t capture_block_size = 0;
+static unsigned offload_threads = 0;
+static unsigned offload_ring = 0;
+static unsigned signature_batch = 0;
 
 void FileService::init()
 {
@@ -69,6 +73,9 @@ void FileService::post_init()
     {
         file_cache = new FileCache(conf->max_files_cached);
         max_files_cached = conf->max_files_cached;
+        offload_threads = conf->offload_threads;
+        offload_ring = conf->offload_ring;
+        signature_batch = conf->signature_batch;
     }
 
     if (file_capture_enabled)
@@ -89,6 +96,12 @@ void FileService::verify_reload(SnortConfig* sc)
     if (max_files_cached != conf->max_files_cached)
         ReloadError("Changing file_id:max_files_cached requires a restart\n");
 
+    if (offload_threads != conf->offload_threads or offload_ring != conf->offload_ring)
+        ReloadError("Changing file_id:offload_threads or offload_ring requires a restart\n");
+
+    if (signature_batch != conf->signature_batch)
+        ReloadError("Changing file_id:signature_batch requires a restart\n");
+
     if (file_capture_enabled)
     {
         if (capture_memcap != conf->capture_memcap)
@@ -108,10 +121,21 @@ void FileService::close()
 }
 
 void FileService::thread_init()
-{ file_stats_init(); }
+{
+    file_stats_init();
+
+    const FileConfig* const conf = get_file_config();
+
+    if (conf)
+        FileOffload::thread_init(conf->offload_threads, conf->offload_ring,
+            conf->signature_batch);
+}
 
 void FileService::thread_term()
-{ file_stats_term(); }
+{
+    FileOffload::thread_term();
+    file_stats_term();
+}
 
 void FileService::enable_file_type()
 {
@@ -35,6 +35,18 @@ struct FileCounts
     PegCount files_total;
     PegCount file_data_total;
     PegCount cache_add_fails;
+    PegCount cache_front_hits;
+    PegCount cache_lock_waits;
+    PegCount cache_lock_wait_usecs;
+    PegCount offload_segments;
+    PegCount offload_bytes;
+    PegCount offload_full;
+    PegCount offload_waits;
+    PegCount offload_depth;
+    PegCount offload_max_depth;
+    PegCount batch_runs;
+    PegCount batch_files;
+    PegCount batch_bytes;
     PegCount files_buffered_total;
     PegCount files_released_total;
     PegCount files_freed_total;
@@ -0,0 +1,432 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// file_cache_test.cc
+
+// unit tests and contention benchmark for the striped file cache
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "file_api/file_cache.h"
+#include "file_api/file_flows.h"
+#include "file_api/file_lib.h"
+#include "file_api/file_stats.h"
+#include "flow/flow.h"
+#include "hash/xhash.h"
+#include "main/snort_config.h"
+#include "main/thread_config.h"
+#include "packet_io/active.h"
+#include "packet_tracer/packet_tracer.h"
+#include "time/packet_time.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+//--------------------------------------------------------------------------
+// stubs
+//--------------------------------------------------------------------------
+
+static SnortConfig my_config;
+THREAD_LOCAL SnortConfig* snort_conf = &my_config;
+THREAD_LOCAL FileCounts file_counts;
+
+static std::atomic<time_t> test_time { 1000 };
+
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ snort_conf->run_flags = 0; }
+
+SnortConfig::~SnortConfig() = default;
+
+SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+Flow::Flow() = default;
+Flow::~Flow() { }
+
+FileInfo::~FileInfo() { }
+FileInfo& FileInfo::operator=(const FileInfo&) { return *this; }
+uint8_t* FileInfo::get_file_sig_sha256() const { return nullptr; }
+uint64_t FileInfo::get_file_id() const { return file_id; }
+FileContext::FileContext() { }
+
+// when set, deleting a context looks up a file from another thread, which
+// blocks if the context is deleted with its stripe locked
+static struct
+{
+    FileCache* cache;
+    Flow* flow;
+    uint64_t file_id;
+} probe;
+
+static std::atomic<unsigned> probes { 0 };
+static std::atomic<unsigned> probes_done { 0 };
+static std::atomic<unsigned> probes_blocked { 0 };
+static THREAD_LOCAL bool probing = false;
+
+FileContext::~FileContext()
+{
+    // the probe's own lookup may free the expired file
+    if ( !probe.cache or probing )
+        return;
+
+    ++probes;
+    std::thread t([]()
+    {
+        probing = true;
+        probe.cache->get_file(probe.flow, probe.file_id, false);
+        ++probes_done;
+    });
+
+    for ( unsigned i = 0; i < 1000 and probes_done != probes; ++i )
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    if ( probes_done == probes )
+        t.join();
+    else
+    {
+        ++probes_blocked;
+        t.detach();
+    }
+}
+void FileContext::log_file_event(Flow*, FilePolicyBase*) { }
+
+FileFlows* FileFlows::get_file_flows(Flow*) { return nullptr; }
+void FileFlows::add_pending_file(uint64_t) { }
+FileConfig* get_file_config(SnortConfig*) { return nullptr; }
+
+unsigned ThreadConfig::get_instance_max() { return 4; }
+
+void Active::set_delayed_action(ActiveAction, bool) { }
+
+void packet_gettimeofday(struct timeval* tv)
+{ *tv = { test_time.load(), 0 }; }
+
+namespace snort
+{
+THREAD_LOCAL PacketTracer* s_pkt_trace = nullptr;
+void PacketTracer::log(const char*, ...) { }
+
+int64_t timersub_ms(const struct timeval*, const struct timeval*) { return 0; }
+
+char* snort_strdup(const char* s) { return strdup(s); }
+void ErrorMessage(const char*, ...) { }
+[[noreturn]] void FatalError(const char*, ...) { throw "fatal"; }
+}
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+static void set_ips(Flow& flow, uint32_t client, uint32_t server)
+{
+    flow.client_ip.set(&client, AF_INET);
+    flow.server_ip.set(&server, AF_INET);
+}
+
+TEST_GROUP(file_cache)
+{
+    Flow flow;
+
+    void setup() override
+    {
+        memset(&file_counts, 0, sizeof(file_counts));
+        test_time = 1000;
+        set_ips(flow, 0x0100000a, 0x0200000a);
+    }
+};
+
+TEST(file_cache, add_find)
+{
+    FileCache cache(64);
+
+    CHECK(!cache.get_file(&flow, 1, false));
+
+    FileContext* f1 = cache.get_file(&flow, 1, true);
+    FileContext* f2 = cache.get_file(&flow, 2, true);
+    CHECK(f1);
+    CHECK(f2);
+    CHECK(f1 != f2);
+
+    CHECK(cache.get_file(&flow, 1, false) == f1);
+    CHECK(cache.get_file(&flow, 2, true) == f2);
+
+    Flow other;
+    set_ips(other, 0x0300000a, 0x0200000a);
+    CHECK(!cache.get_file(&other, 1, false));
+}
+
+TEST(file_cache, front_hit)
+{
+    FileCache cache(64);
+    FileContext* f = cache.get_file(&flow, 7, true);
+
+    CHECK(cache.get_file(&flow, 7, false) == f);
+    CHECK(cache.get_file(&flow, 7, false) == f);
+    CHECK(file_counts.cache_front_hits == 2);
+
+    // once the refresh would extend the expiry by more than the slack the
+    // stripe is consulted again
+    test_time += 2;
+    CHECK(cache.get_file(&flow, 7, false) == f);
+    CHECK(file_counts.cache_front_hits == 2);
+
+    CHECK(cache.get_file(&flow, 7, false) == f);
+    CHECK(file_counts.cache_front_hits == 3);
+}
+
+TEST(file_cache, expiry)
+{
+    FileCache cache(64);
+    cache.set_lookup_timeout(10);
+
+    FileContext* f = cache.get_file(&flow, 3, true);
+
+    test_time += 9;
+    CHECK(cache.get_file(&flow, 3, false) == f);
+
+    // refreshed at 1009 so still cached at 1018
+    test_time += 9;
+    CHECK(cache.get_file(&flow, 3, false) == f);
+
+    test_time += 11;
+    CHECK(!cache.get_file(&flow, 3, false));
+    CHECK(cache.get_file(&flow, 3, true));
+}
+
+TEST(file_cache, stale_front_entry)
+{
+    FileCache cache(64);
+    cache.set_lookup_timeout(10);
+
+    FileContext* f = cache.get_file(&flow, 5, true);
+    CHECK(cache.get_file(&flow, 5, false) == f);
+
+    // another packet thread, further ahead in time, expires the file and
+    // creates a new context for the same key
+    FileContext* g = nullptr;
+    std::thread other([&]()
+    {
+        test_time = 1020;
+        CHECK(!cache.get_file(&flow, 5, false));
+        g = cache.get_file(&flow, 5, true);
+    });
+    other.join();
+
+    // this thread still thinks the old entry is live; the stripe
+    // generation must send it back to the stripe
+    test_time = 1001;
+    unsigned hits = file_counts.cache_front_hits;
+    CHECK(cache.get_file(&flow, 5, false) == g);
+    CHECK(file_counts.cache_front_hits == hits);
+}
+
+TEST(file_cache, free_outside_lock)
+{
+    FileCache cache(FileCache::NUM_STRIPES);
+    cache.set_lookup_timeout(10);
+    probes = probes_done = probes_blocked = 0;
+
+    // expired by find
+    cache.get_file(&flow, 1, true);
+    test_time += 20;
+    probe = { &cache, &flow, 1 };
+    CHECK(!cache.get_file(&flow, 1, false));
+    CHECK(probes == 1);
+
+    // recycled by add, and failed adds; with one node per stripe some of
+    // these land on the stripe holding expired file 2
+    probe = { };
+    cache.get_file(&flow, 2, true);
+    test_time += 20;
+    probe = { &cache, &flow, 2 };
+
+    for ( uint64_t id = 3; id < 4 * FileCache::NUM_STRIPES; ++id )
+        cache.get_file(&flow, id, true);
+
+    probe = { };
+
+    CHECK(probes > 2);
+    CHECK(probes_blocked == 0);
+}
+
+TEST(file_cache, new_cache_instance)
+{
+    FileCache* cache = new FileCache(64);
+    cache->get_file(&flow, 9, true);
+    delete cache;
+
+    cache = new FileCache(64);
+    CHECK(!cache->get_file(&flow, 9, false));
+    delete cache;
+}
+
+TEST(file_cache, max_files)
+{
+    FileCache cache(FileCache::NUM_STRIPES);
+    unsigned added = 0;
+
+    // one file per stripe, all unexpired, so some adds must fail
+    for ( uint64_t id = 1; id <= 4 * FileCache::NUM_STRIPES; ++id )
+        if ( cache.get_file(&flow, id, true) )
+            ++added;
+
+    CHECK(added >= FileCache::NUM_STRIPES / 2);
+    CHECK(added <= FileCache::NUM_STRIPES);
+    CHECK(file_counts.cache_add_fails == 4 * FileCache::NUM_STRIPES - added);
+
+    // expired nodes are recycled
+    test_time += 100;
+    CHECK(cache.get_file(&flow, 1000, true));
+}
+
+//--------------------------------------------------------------------------
+// benchmark
+//--------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+// the previous single lock cache, reduced to its find / add path
+class SingleLockCache
+{
+public:
+    SingleLockCache(int max)
+    {
+        hash = xhash_new(max, sizeof(FileCache::FileHashKey), sizeof(FileCache::FileNode),
+            0, 1, nullptr, nullptr, 1);
+        xhash_set_max_nodes(hash, max);
+    }
+
+    ~SingleLockCache()
+    { xhash_delete(hash); }
+
+    void* get_file(Flow* flow, uint64_t file_id, bool)
+    {
+        FileCache::FileHashKey key;
+        key.dip.set(flow->client_ip);
+        key.sip.set(flow->server_ip);
+        key.padding = 0;
+        key.file_id = file_id;
+
+        struct timeval now;
+        packet_gettimeofday(&now);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        XHashNode* hash_node = xhash_find_node(hash, &key);
+
+        if ( hash_node )
+        {
+            FileCache::FileNode* node = (FileCache::FileNode*)hash_node->data;
+            struct timeval next_expire_time;
+            struct timeval time_to_add = { timeout, 0 };
+            timeradd(&now, &time_to_add, &next_expire_time);
+
+            if (timercmp(&node->cache_expire_time, &next_expire_time, <))
+                node->cache_expire_time = next_expire_time;
+
+            return node->file;
+        }
+
+        FileCache::FileNode new_node;
+        struct timeval time_to_add = { timeout, 0 };
+        timeradd(&now, &time_to_add, &new_node.cache_expire_time);
+        new_node.file = nullptr;
+        xhash_add(hash, &key, &new_node);
+        return nullptr;
+    }
+
+private:
+    XHash* hash;
+    std::mutex mutex;
+    int64_t timeout = 3600;
+};
+
+static const unsigned bench_files = 64;
+static const unsigned bench_lookups = 1000000;
+
+// run is the number of consecutive lookups of the same file, eg segments
+// of one download; a run of 1 interleaves all files and defeats the front
+// cache
+template <typename Cache>
+static double contend(Cache& cache, unsigned threads, unsigned run, PegCount& waits)
+{
+    std::vector<std::thread> workers;
+    std::atomic<PegCount> total_waits { 0 };
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned t = 0; t < threads; ++t )
+    {
+        workers.emplace_back([&cache, &total_waits, t, run]()
+        {
+            // each thread works on its own set of in progress files
+            Flow flow;
+            set_ips(flow, 0x0100000a + (t << 24), 0x0200000a);
+            memset(&file_counts, 0, sizeof(file_counts));
+
+            for ( unsigned i = 0; i < bench_lookups; ++i )
+                cache.get_file(&flow, (i / run) % bench_files + 1, true);
+
+            total_waits += file_counts.cache_lock_waits;
+        });
+    }
+    for ( auto& w : workers )
+        w.join();
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    waits = total_waits;
+    return threads * bench_lookups / secs.count() / 1000000.0;
+}
+
+TEST(file_cache, contention_benchmark)
+{
+    printf("\nrun  threads  single lock M/s  striped M/s  lock waits\n");
+
+    for ( unsigned run : { 1, 16 } )
+    {
+        for ( unsigned threads = 1; threads <= 8; threads *= 2 )
+        {
+            SingleLockCache old_cache(65536);
+            FileCache new_cache(65536);
+            new_cache.set_lookup_timeout(3600);
+            PegCount unused, waits;
+
+            double old_rate = contend(old_cache, threads, run, unused);
+            double new_rate = contend(new_cache, threads, run, waits);
+
+            printf("%3u  %7u  %15.1f  %11.1f  %10" PRIu64 "\n",
+                run, threads, old_rate, new_rate, waits);
+        }
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
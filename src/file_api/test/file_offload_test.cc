@@ -0,0 +1,459 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// file_offload_test.cc
+
+// unit tests and packet thread cost benchmark for file signature offload
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <openssl/sha.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "file_api/file_offload.h"
+#include "file_api/file_stats.h"
+#include "hash/sha256_mb.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+THREAD_LOCAL FileCounts file_counts;
+
+//--------------------------------------------------------------------------
+// helpers
+//--------------------------------------------------------------------------
+
+struct TestFile
+{
+    TestFile(unsigned size, unsigned seed) : data(size)
+    {
+        std::mt19937 gen(seed);
+
+        for ( auto& b : data )
+            b = (uint8_t)gen();
+
+        SHA256(data.data(), data.size(), expected);
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t expected[SHA256_DIGEST_LENGTH];
+
+    Sha256Ctx ctx;
+    FileOffloadState state;
+    unsigned offset = 0;
+
+    // hash the next segment the way FileContext does
+    void next(unsigned len)
+    {
+        if ( offset + len > data.size() )
+            len = data.size() - offset;
+
+        bool init = !offset;
+
+        if ( !FileOffload::hash(state, &ctx, init, data.data() + offset, len) )
+        {
+            if ( init )
+                sha256_init(ctx);
+            sha256_update(ctx, data.data() + offset, len);
+        }
+        offset += len;
+    }
+
+    bool done() const
+    { return offset == data.size(); }
+
+    bool check()
+    {
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        FileOffload::drain(state);
+        sha256_final(ctx, digest);
+        return !memcmp(digest, expected, sizeof(digest));
+    }
+};
+
+// interleave segments of several files of various sizes
+static bool run_files(unsigned num_files)
+{
+    std::vector<TestFile*> files;
+    std::mt19937 gen(7);
+
+    for ( unsigned i = 0; i < num_files; ++i )
+        files.emplace_back(new TestFile(1000 + 7919 * i, i));
+
+    bool more = true;
+
+    while ( more )
+    {
+        more = false;
+
+        for ( auto f : files )
+        {
+            if ( f->done() )
+                continue;
+
+            f->next(1 + gen() % 2000);
+            more = true;
+        }
+    }
+
+    bool ok = true;
+
+    for ( auto f : files )
+    {
+        ok = f->check() and ok;
+        delete f;
+    }
+    return ok;
+}
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+TEST_GROUP(file_offload)
+{
+    void setup() override
+    {
+        memset(&file_counts, 0, sizeof(file_counts));
+    }
+};
+
+TEST(file_offload, disabled)
+{
+    CHECK(!FileOffload::enabled());
+    CHECK(run_files(3));
+    CHECK(file_counts.offload_segments == 0);
+}
+
+TEST(file_offload, one_thread)
+{
+    FileOffload::thread_init(1, 64);
+    CHECK(FileOffload::enabled());
+    CHECK(run_files(5));
+    CHECK(file_counts.offload_segments > 0);
+    CHECK(file_counts.offload_bytes > 0);
+    CHECK(file_counts.offload_depth == 0);
+    FileOffload::thread_term();
+    CHECK(!FileOffload::enabled());
+}
+
+TEST(file_offload, full_rings)
+{
+    // rings this small overflow constantly; full segments are hashed
+    // inline after the file's queued segments are done
+    FileOffload::thread_init(3, 1);
+    CHECK(run_files(8));
+    CHECK(file_counts.offload_segments > 0);
+    CHECK(file_counts.offload_max_depth <= 3);
+    FileOffload::thread_term();
+}
+
+TEST(file_offload, packet_threads)
+{
+    bool ok[4] = { };
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < 4; ++i )
+    {
+        threads.emplace_back([&ok, i]()
+        {
+            FileOffload::thread_init(2, 16);
+            ok[i] = run_files(4 + i);
+            FileOffload::thread_term();
+        });
+    }
+    for ( auto& t : threads )
+        t.join();
+
+    for ( auto b : ok )
+        CHECK(b);
+}
+
+TEST(file_offload, change_owner)
+{
+    // another packet thread picks up a file this thread started
+    TestFile f(100000, 3);
+
+    FileOffload::thread_init(2, 256);
+
+    while ( f.offset < 50000 )
+        f.next(1460);
+
+    std::thread other([&f]()
+    {
+        FileOffload::thread_init(2, 256);
+
+        while ( !f.done() )
+            f.next(1460);
+
+        FileOffload::drain(f.state);
+        FileOffload::thread_term();
+    });
+    other.join();
+
+    CHECK(f.check());
+    FileOffload::thread_term();
+}
+
+TEST(file_offload, batch)
+{
+    FileOffload::thread_init(0, 0, 16384);
+    CHECK(FileOffload::enabled());
+    CHECK(run_files(9));
+    CHECK(file_counts.offload_segments == 0);
+    CHECK(file_counts.batch_runs > 0);
+    CHECK(file_counts.batch_files > file_counts.batch_runs);
+    FileOffload::thread_term();
+    CHECK(!FileOffload::enabled());
+}
+
+TEST(file_offload, batch_restart)
+{
+    // a file that starts over while its earlier segments are batched
+    FileOffload::thread_init(0, 0, 1 << 20);
+
+    TestFile f(5000, 4);
+    f.next(3000);
+    f.offset = 0;
+
+    while ( !f.done() )
+        f.next(700);
+
+    CHECK(f.check());
+    FileOffload::thread_term();
+}
+
+// the file cache can free a context on any packet thread, or on the main
+// thread, while the file's segments sit in its owner's batch
+static void batch_free_elsewhere(bool other_batches)
+{
+    TestFile* f = new TestFile(100000, 5);
+    std::atomic<int> step { 0 };
+
+    std::thread owner([&f, &step]()
+    {
+        FileOffload::thread_init(0, 0, 1 << 20);
+
+        // another file keeps the owner's batch busy after f is freed
+        TestFile g(1000, 6);
+
+        while ( f->offset < 50000 )
+            f->next(1460);
+
+        g.next(1000);
+        step = 1;
+
+        while ( step != 2 )
+            std::this_thread::yield();
+
+        // runs what is left of the batch; f must not be in it
+        FileOffload::thread_term();
+        CHECK(g.check());
+    });
+
+    while ( step != 1 )
+        std::this_thread::yield();
+
+    std::thread other([&f, other_batches]()
+    {
+        if ( other_batches )
+            FileOffload::thread_init(0, 0, 1 << 20);
+
+        while ( !f->done() )
+            f->next(1460);
+
+        CHECK(f->check());
+        delete f;
+
+        if ( other_batches )
+            FileOffload::thread_term();
+    });
+    other.join();
+
+    step = 2;
+    owner.join();
+}
+
+TEST(file_offload, batch_free_other_thread)
+{
+    batch_free_elsewhere(true);
+}
+
+TEST(file_offload, batch_free_main_thread)
+{
+    batch_free_elsewhere(false);
+}
+
+TEST(file_offload, threads_ignore_batch)
+{
+    FileOffload::thread_init(1, 64, 16384);
+    CHECK(run_files(5));
+    CHECK(file_counts.offload_segments > 0);
+    CHECK(file_counts.batch_runs == 0);
+    FileOffload::thread_term();
+}
+
+//--------------------------------------------------------------------------
+// benchmark
+//--------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+// time spent on the packet thread for 1 MB files in 1460 byte segments,
+// hashing inline versus queuing for the offload threads.  segment time is
+// what each packet pays; finish time is the wait for the file's queued
+// segments when its last packet arrives.
+static void packet_thread_usecs(unsigned threads, double& segment, double& finish)
+{
+    const unsigned file_size = 1 << 20;
+    const unsigned files = 64;
+    TestFile f(file_size, 1);
+
+    if ( threads )
+        FileOffload::thread_init(threads, 1024);
+
+    std::chrono::duration<double> seg_time(0), fin_time(0);
+
+    for ( unsigned i = 0; i < files; ++i )
+    {
+        f.offset = 0;
+
+        while ( !f.done() )
+        {
+            auto start = std::chrono::steady_clock::now();
+            f.next(1460);
+            seg_time += std::chrono::steady_clock::now() - start;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        CHECK(f.check());
+        fin_time += std::chrono::steady_clock::now() - start;
+    }
+
+    if ( threads )
+        FileOffload::thread_term();
+
+    segment = seg_time.count() * 1e6 / files;
+    finish = fin_time.count() * 1e6 / files;
+}
+
+// GB/s hashing concurrent 1 MB files whose 1460 byte segments are
+// interleaved, one segment at a time inline versus batched on the packet
+// thread
+static double batch_rate(unsigned files, unsigned batch)
+{
+    std::vector<TestFile*> tf;
+
+    for ( unsigned i = 0; i < files; ++i )
+        tf.emplace_back(new TestFile(1 << 20, i));
+
+    if ( batch )
+        FileOffload::thread_init(0, 0, batch);
+
+    auto start = std::chrono::steady_clock::now();
+    bool more = true;
+
+    while ( more )
+    {
+        more = false;
+
+        for ( auto f : tf )
+        {
+            if ( f->done() )
+                continue;
+
+            f->next(1460);
+            more = true;
+        }
+    }
+
+    for ( auto f : tf )
+        FileOffload::drain(f->state);
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+    for ( auto f : tf )
+    {
+        CHECK(f->check());
+        delete f;
+    }
+
+    if ( batch )
+        FileOffload::thread_term();
+
+    return files * (1 << 20) / secs.count() / 1e9;
+}
+
+TEST(file_offload, batch_benchmark)
+{
+    Sha256Isa save = sha256_isa;
+    batch_rate(4, 0);
+
+    printf("\nfiles  inline GB/s  batch GB/s by sha256 kernel\n%19s", "");
+
+    for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+        if ( sha256_isa_supported((Sha256Isa)i) )
+            printf(" %7s", sha256_isa_name((Sha256Isa)i));
+
+    printf("\n");
+
+    for ( unsigned files : { 1, 4, 8, 16 } )
+    {
+        printf("%5u  %11.2f ", files, batch_rate(files, 0));
+
+        for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+        {
+            if ( !sha256_isa_supported((Sha256Isa)i) )
+                continue;
+
+            sha256_isa = (Sha256Isa)i;
+            printf(" %7.2f", batch_rate(files, 65536));
+        }
+        printf("\n");
+    }
+    sha256_isa = save;
+}
+
+TEST(file_offload, packet_thread_benchmark)
+{
+    printf("\noffload threads  segment usecs/MB  finish usecs/MB\n");
+
+    for ( unsigned threads : { 0, 1, 2 } )
+    {
+        double segment, finish;
+        packet_thread_usecs(threads, segment, finish);
+        printf("%15u  %16.0f  %15.0f\n", threads, segment, finish);
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -43,6 +43,8 @@ using namespace snort;
 #define MAX_PRUNE   5
 
 static THREAD_LOCAL std::vector<ExpectFlow*>* packet_expect_flows = nullptr;
+static const DataEventId early_session_create_event =
+    DataBus::get_id(EXPECT_EVENT_TYPE_EARLY_SESSION_CREATE_KEY);
 
 ExpectFlow::~ExpectFlow()
 {
@@ -437,7 +439,7 @@ int ExpectCache::add_flow(const Packet *ctrlPkt,
         packet_expect_flows->emplace_back(last);
 
         ExpectEvent event(ctrlPkt, last, fd);
-        DataBus::publish(EXPECT_EVENT_TYPE_EARLY_SESSION_CREATE_KEY, event, ctrlPkt->flow);
+        DataBus::publish(early_session_create_event, event, ctrlPkt->flow);
     }
     return 0;
 }
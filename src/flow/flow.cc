@@ -529,5 +529,5 @@ bool Flow::is_pdu_inorder(uint8_t dir)
 void Flow::set_service(Packet* pkt, const char* new_service)
 {   
     service = new_service;
-    DataBus::publish(FLOW_SERVICE_CHANGE_EVENT, pkt);
+    DataBus::publish(FLOW_SERVICE_CHANGE_EVENT_ID, pkt);
 }   
@@ -24,6 +24,7 @@
 
 #include "flow/flow_cache.h"
 
+#include "hash/bucket_hash.h"
 #include "hash/zhash.h"
 #include "helpers/flag_context.h"
 #include "ips_options/ips_flowbits.h"
@@ -48,7 +49,11 @@ using namespace snort;
 
 FlowCache::FlowCache(const FlowCacheConfig& cfg) : config(cfg)
 {
-    hash_table = new ZHash(config.max_flows, sizeof(FlowKey));
+    if ( config.engine == FlowTableEngine::BUCKET )
+        hash_table = new BucketHash(config.max_flows, sizeof(FlowKey));
+    else
+        hash_table = new ZHash(config.max_flows, sizeof(FlowKey));
+
     hash_table->set_keyops(FlowKey::hash, FlowKey::compare);
 
     uni_flows = new FlowUniList;
@@ -92,6 +97,9 @@ Flow* FlowCache::find(const FlowKey* key)
     return flow;
 }
 
+void FlowCache::prefetch(const FlowKey* key)
+{ hash_table->prefetch(key); }
+
 // always prepend
 void FlowCache::link_uni(Flow* flow)
 {
@@ -306,7 +314,7 @@ bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
     if ( hash_table->get_count() <= 1 )
         return false;
 
-    // ZHash returns in LRU order, which is updated per packet via find --> move_to_front call
+    // the hash table returns in LRU order, which is updated per packet via find --> move_to_front call
     auto flow = static_cast<Flow*>(hash_table->first());
     assert(flow);
 
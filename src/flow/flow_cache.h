@@ -23,7 +23,8 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored by FlowKey in a ZHash or BucketHash instance depending
+// on the configured flow table engine.
 
 #include <ctime>
 #include <type_traits>
@@ -52,6 +53,7 @@ public:
 
     snort::Flow* find(const snort::FlowKey*);
     snort::Flow* get(const snort::FlowKey*);
+    void prefetch(const snort::FlowKey*);
 
     int release(snort::Flow*, PruneReason = PruneReason::NONE, bool do_cleanup = true);
 
@@ -87,7 +89,7 @@ private:
     const FlowCacheConfig config;
     uint32_t flags;
 
-    class ZHash* hash_table;
+    class LruHashTable* hash_table;
     FlowUniList* uni_flows;
     FlowUniList* uni_ip_flows;
 
@@ -30,10 +30,18 @@ struct FlowTypeConfig
     unsigned cap_weight = 0;
 };
 
+// hash table used to store the flows by key
+enum class FlowTableEngine : uint8_t
+{
+    ZHASH,      // chained rows
+    BUCKET      // open addressing, cache line buckets
+};
+
 struct FlowCacheConfig
 {
     unsigned max_flows = 0;
     unsigned pruning_timeout = 0;
+    FlowTableEngine engine = FlowTableEngine::ZHASH;
     FlowTypeConfig proto[to_utype(PktType::MAX)];
 };
 
@@ -39,6 +39,7 @@
 
 #include "expect_cache.h"
 #include "flow_cache.h"
+#include "flow_prefetch.h"
 #include "ha.h"
 #include "session.h"
 
@@ -102,6 +103,16 @@ Flow* FlowControl::find_flow(const FlowKey* key)
     return nullptr;
 }
 
+void FlowControl::prefetch_flow(
+    int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id)
+{
+    auto cache = get_cache();
+    FlowKey key;
+
+    if ( cache and get_prefetch_key(key, dlt, data, len, address_space_id) )
+        cache->prefetch(&key);
+}
+
 Flow* FlowControl::new_flow(const FlowKey* key)
 {
     if ( auto cache = get_cache() )
@@ -440,7 +451,7 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
             PacketTracer::log("Session: new snort session\n");
 
         init_roles(p, flow);
-        DataBus::publish(FLOW_STATE_SETUP_EVENT, p);
+        DataBus::publish(FLOW_STATE_SETUP_EVENT_ID, p);
 
         if ( flow->flow_state == Flow::FlowState::SETUP ||
             (flow->flow_state == Flow::FlowState::INSPECT &&
@@ -56,6 +56,7 @@ public:
 
     snort::Flow* find_flow(const snort::FlowKey*);
     snort::Flow* new_flow(const snort::FlowKey*);
+    void prefetch_flow(int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id);
 
     void init_proto(PktType, snort::InspectSsnFunc);
     void init_exp(uint32_t max);
@@ -0,0 +1,215 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_prefetch.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flow_prefetch.h"
+
+#include <daq_dlt.h>
+
+#include "flow/flow_key.h"
+#include "protocols/eth.h"
+#include "protocols/ipv4.h"
+#include "protocols/ipv6.h"
+#include "protocols/vlan.h"
+#include "sfip/sf_ip.h"
+
+using namespace snort;
+
+// the decoder keeps the innermost tag
+static const unsigned max_vlan_tags = 2;
+
+static bool is_vlan(ProtocolId type)
+{
+    switch ( type )
+    {
+    case ProtocolId::ETHERTYPE_8021Q:
+    case ProtocolId::ETHERTYPE_8021AD:
+    case ProtocolId::ETHERTYPE_QINQ_NS1:
+    case ProtocolId::ETHERTYPE_QINQ_NS2:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+// sets off to the start of the ip header if there is one
+static bool skip_eth(const uint8_t* data, uint32_t len, uint32_t& off, uint16_t& vlan_id)
+{
+    if ( len < eth::ETH_HEADER_LEN )
+        return false;
+
+    const eth::EtherHdr* eh = reinterpret_cast<const eth::EtherHdr*>(data);
+    ProtocolId type = eh->ethertype();
+    off = eth::ETH_HEADER_LEN;
+
+    for ( unsigned i = 0; i < max_vlan_tags and is_vlan(type); ++i )
+    {
+        if ( len < off + sizeof(vlan::VlanTagHdr) )
+            return false;
+
+        const vlan::VlanTagHdr* vh = reinterpret_cast<const vlan::VlanTagHdr*>(data + off);
+        vlan_id = vh->vid();
+        type = (ProtocolId)vh->proto();
+        off += sizeof(vlan::VlanTagHdr);
+    }
+
+    return type == ProtocolId::ETHERTYPE_IPV4 or type == ProtocolId::ETHERTYPE_IPV6;
+}
+
+static bool get_ports(
+    IpProtocol proto, const uint8_t* data, uint32_t len, uint16_t& sp, uint16_t& dp)
+{
+    switch ( proto )
+    {
+    case IpProtocol::TCP:
+    case IpProtocol::UDP:
+        // both start with the ports
+        if ( len < 4 )
+            return false;
+
+        sp = (data[0] << 8) | data[1];
+        dp = (data[2] << 8) | data[3];
+        return true;
+
+    case IpProtocol::ICMPV4:
+    case IpProtocol::ICMPV6:
+        // the icmp type goes in the source port
+        if ( len < 1 )
+            return false;
+
+        sp = data[0];
+        dp = 0;
+        return true;
+
+    default:
+        break;
+    }
+    return false;
+}
+
+static PktType get_pkt_type(IpProtocol proto)
+{
+    switch ( proto )
+    {
+    case IpProtocol::TCP:
+        return PktType::TCP;
+    case IpProtocol::UDP:
+        return PktType::UDP;
+    default:
+        break;
+    }
+    return PktType::ICMP;
+}
+
+static bool get_key4(
+    FlowKey& key, const uint8_t* data, uint32_t len,
+    uint16_t vlan_id, uint16_t address_space_id)
+{
+    if ( len < ip::IP4_HEADER_LEN )
+        return false;
+
+    const ip::IP4Hdr* iph = reinterpret_cast<const ip::IP4Hdr*>(data);
+    uint32_t hlen = iph->hlen();
+
+    if ( iph->ver() != 4 or hlen < ip::IP4_HEADER_LEN or len < hlen )
+        return false;
+
+    // fragments are keyed by ip id; leave them to the decoder
+    if ( iph->mf() or iph->off() )
+        return false;
+
+    IpProtocol proto = iph->proto();
+    uint16_t sp, dp;
+
+    if ( proto == IpProtocol::ICMPV6 or !get_ports(proto, data + hlen, len - hlen, sp, dp) )
+        return false;
+
+    SfIp src(&iph->ip_src, AF_INET);
+    SfIp dst(&iph->ip_dst, AF_INET);
+
+    key.init(get_pkt_type(proto), proto, &src, sp, &dst, dp, vlan_id, 0, address_space_id);
+    return true;
+}
+
+static bool get_key6(
+    FlowKey& key, const uint8_t* data, uint32_t len,
+    uint16_t vlan_id, uint16_t address_space_id)
+{
+    if ( len < ip::IP6_HEADER_LEN )
+        return false;
+
+    const ip::IP6Hdr* iph = reinterpret_cast<const ip::IP6Hdr*>(data);
+
+    if ( iph->ver() != 6 )
+        return false;
+
+    // extension headers are not walked
+    IpProtocol proto = iph->next();
+    uint16_t sp, dp;
+
+    if ( proto == IpProtocol::ICMPV4 or
+        !get_ports(proto, data + ip::IP6_HEADER_LEN, len - ip::IP6_HEADER_LEN, sp, dp) )
+        return false;
+
+    SfIp src(iph->get_src(), AF_INET6);
+    SfIp dst(iph->get_dst(), AF_INET6);
+
+    key.init(get_pkt_type(proto), proto, &src, sp, &dst, dp, vlan_id, 0, address_space_id);
+    return true;
+}
+
+bool get_prefetch_key(
+    FlowKey& key, int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id)
+{
+    uint16_t vlan_id = 0;
+    uint32_t off = 0;
+
+    switch ( dlt )
+    {
+    case DLT_EN10MB:
+        if ( !skip_eth(data, len, off, vlan_id) )
+            return false;
+        break;
+
+    case DLT_RAW:
+    case DLT_IPV4:
+    case DLT_IPV6:
+        break;
+
+    default:
+        return false;
+    }
+
+    data += off;
+    len -= off;
+
+    if ( len < 1 )
+        return false;
+
+    if ( (data[0] >> 4) == 4 )
+        return get_key4(key, data, len, vlan_id, address_space_id);
+
+    return get_key6(key, data, len, vlan_id, address_space_id);
+}
+
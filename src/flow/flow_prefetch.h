@@ -0,0 +1,44 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_prefetch.h
+
+#ifndef FLOW_PREFETCH_H
+#define FLOW_PREFETCH_H
+
+// wire level flow key extraction so that the flow table entries for a batch
+// of packets can be prefetched before the packets are decoded.  only the
+// common cases are handled: ethernet with optional vlan tags or raw ip
+// carrying unfragmented tcp, udp, or icmp.  anything else is not prefetched.
+//
+// the key is built with FlowKey::init() so it matches the one the decoded
+// packet will get.  where it doesn't (eg tunnels, ipv6 extension headers) the
+// cost is a wasted prefetch, never a wrong lookup.
+
+#include <cstdint>
+
+namespace snort
+{
+struct FlowKey;
+}
+
+bool get_prefetch_key(
+    snort::FlowKey&, int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id);
+
+#endif
+
@@ -41,6 +41,7 @@
 #include "utils/util.h"
 #include "flow/expect_cache.h"
 #include "flow/flow_cache.h"
+#include "flow/flow_prefetch.h"
 #include "flow/ha.h"
 #include "flow/session.h"
 
@@ -71,6 +72,7 @@ DetectionEngine::~DetectionEngine() { }
 unsigned FlowCache::purge() { return 1; }
 Flow* FlowCache::find(const FlowKey* key) { return nullptr; }
 Flow* FlowCache::get(const FlowKey* key) { return nullptr; }
+void FlowCache::prefetch(const FlowKey*) { }
 void FlowCache::push(Flow* flow) { }
 bool FlowCache::prune_one(PruneReason reason, bool do_cleanup) { return true; }
 unsigned FlowCache::timeout(unsigned num_flows, time_t thetime) { return 1; }
@@ -78,6 +80,7 @@ void Flow::init(PktType type) { }
 void set_network_policy(SnortConfig* sc, unsigned i) { } 
 void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f) { }
 void DataBus::publish(const char* key, Packet* p, Flow* f) { }
+void DataBus::publish(DataEventId, Packet*, Flow*) { }
 SnortConfig* SnortConfig::get_conf() { return nullptr; }
 void FlowCache::unlink_uni(Flow* flow) { }
 void Flow::set_direction(Packet* p) { }
@@ -91,6 +94,7 @@ ExpectCache::ExpectCache(uint32_t max) { }
 bool ExpectCache::check(Packet* p, Flow* lws) { return true; }
 bool ExpectCache::is_expected(Packet* p) { return true; }
 Flow* HighAvailabilityManager::import(Packet& p, FlowKey& key) { }
+bool get_prefetch_key(FlowKey&, int, const uint8_t*, uint32_t, uint16_t) { return false; }
 
 namespace memory 
 {
@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_prefetch_test.cc
+// unit tests for wire level prefetch key extraction
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flow/flow_prefetch.h"
+
+#include <daq_dlt.h>
+
+#include <cstring>
+
+#include "flow/flow_key.h"
+#include "main/snort_config.h"
+#include "sfip/sf_ip.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+static SnortConfig my_config;
+THREAD_LOCAL SnortConfig* snort_conf = &my_config;
+
+SnortConfig::SnortConfig(const SnortConfig* const) { }
+SnortConfig::~SnortConfig() = default;
+
+SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+namespace snort
+{
+char* snort_strdup(const char* str)
+{ return strdup(str); }
+}
+
+static const uint8_t eth_vlan_ip4_tcp[] =
+{
+    // ethernet with one 802.1q tag, vid 100
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x81, 0x00,
+    0x20, 0x64, 0x08, 0x00,
+    // ipv4 10.1.1.2 -> 10.1.1.1 tcp
+    0x45, 0x00, 0x00, 0x28, 0x12, 0x34, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+    10, 1, 1, 2, 10, 1, 1, 1,
+    // tcp 50000 -> 80
+    0xc3, 0x50, 0x00, 0x50, 0, 0, 0, 0, 0, 0, 0, 0, 0x50, 0x02, 0xff, 0xff,
+    0, 0, 0, 0
+};
+
+static const uint8_t raw_ip6_udp[] =
+{
+    // ipv6 2001:db8::1 -> 2001:db8::2 udp
+    0x60, 0, 0, 0, 0x00, 0x08, 0x11, 0x40,
+    0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+    // udp 53 -> 5353
+    0x00, 0x35, 0x14, 0xe9, 0x00, 0x08, 0, 0
+};
+
+static const uint8_t raw_ip4_icmp[] =
+{
+    // ipv4 192.168.0.1 -> 192.168.0.2 icmp echo
+    0x45, 0x00, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x40, 0x01, 0x00, 0x00,
+    192, 168, 0, 1, 192, 168, 0, 2,
+    0x08, 0x00, 0, 0, 0, 1, 0, 1
+};
+
+TEST_GROUP(flow_prefetch)
+{
+    void setup() override
+    {
+        my_config.vlan_agnostic = false;
+    }
+};
+
+TEST(flow_prefetch, eth_vlan_tcp)
+{
+    FlowKey key, expect;
+    memset(&key, 0, sizeof(key));
+    memset(&expect, 0, sizeof(expect));
+
+    CHECK(get_prefetch_key(key, DLT_EN10MB, eth_vlan_ip4_tcp, sizeof(eth_vlan_ip4_tcp), 7));
+
+    uint8_t a[4] = { 10, 1, 1, 2 }, b[4] = { 10, 1, 1, 1 };
+    SfIp src(a, AF_INET), dst(b, AF_INET);
+    expect.init(PktType::TCP, IpProtocol::TCP, &src, 50000, &dst, 80, 100, 0, 7);
+
+    CHECK(!memcmp(&key, &expect, sizeof(key)));
+    CHECK(key.vlan_tag == 100);
+}
+
+TEST(flow_prefetch, vlan_agnostic)
+{
+    FlowKey key;
+    my_config.vlan_agnostic = true;
+
+    CHECK(get_prefetch_key(key, DLT_EN10MB, eth_vlan_ip4_tcp, sizeof(eth_vlan_ip4_tcp), 0));
+    CHECK(key.vlan_tag == 0);
+}
+
+TEST(flow_prefetch, raw_ip6_udp)
+{
+    FlowKey key, expect;
+    memset(&key, 0, sizeof(key));
+    memset(&expect, 0, sizeof(expect));
+
+    CHECK(get_prefetch_key(key, DLT_RAW, raw_ip6_udp, sizeof(raw_ip6_udp), 0));
+
+    SfIp src(raw_ip6_udp + 8, AF_INET6), dst(raw_ip6_udp + 24, AF_INET6);
+    expect.init(PktType::UDP, IpProtocol::UDP, &src, 53, &dst, 5353, 0, 0, 0);
+
+    CHECK(!memcmp(&key, &expect, sizeof(key)));
+}
+
+TEST(flow_prefetch, raw_ip4_icmp)
+{
+    FlowKey key, expect;
+    memset(&key, 0, sizeof(key));
+    memset(&expect, 0, sizeof(expect));
+
+    CHECK(get_prefetch_key(key, DLT_IPV4, raw_ip4_icmp, sizeof(raw_ip4_icmp), 0));
+
+    SfIp src(raw_ip4_icmp + 12, AF_INET), dst(raw_ip4_icmp + 16, AF_INET);
+    expect.init(PktType::ICMP, IpProtocol::ICMPV4, &src, 8, &dst, 0, 0, 0, 0);
+
+    CHECK(!memcmp(&key, &expect, sizeof(key)));
+}
+
+TEST(flow_prefetch, not_prefetched)
+{
+    FlowKey key;
+    uint8_t buf[sizeof(eth_vlan_ip4_tcp)];
+
+    // truncated
+    CHECK(!get_prefetch_key(key, DLT_EN10MB, eth_vlan_ip4_tcp, 40, 0));
+    CHECK(!get_prefetch_key(key, DLT_RAW, raw_ip6_udp, 41, 0));
+
+    // unsupported link type
+    CHECK(!get_prefetch_key(key, DLT_PPP_ETHER, eth_vlan_ip4_tcp, sizeof(buf), 0));
+
+    // fragment
+    memcpy(buf, eth_vlan_ip4_tcp, sizeof(buf));
+    buf[24] = 0x20;
+    CHECK(!get_prefetch_key(key, DLT_EN10MB, buf, sizeof(buf), 0));
+
+    // arp
+    memcpy(buf, eth_vlan_ip4_tcp, sizeof(buf));
+    buf[16] = 0x08;
+    buf[17] = 0x06;
+    CHECK(!get_prefetch_key(key, DLT_EN10MB, buf, sizeof(buf), 0));
+
+    // gre
+    memcpy(buf, eth_vlan_ip4_tcp, sizeof(buf));
+    buf[27] = 47;
+    CHECK(!get_prefetch_key(key, DLT_EN10MB, buf, sizeof(buf), 0));
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -18,6 +18,7 @@
 
 // flow_stash_test.cc author Shravan Rangaraju <shrarang@cisco.com>
 
+#include <map>
 #include <string>
 
 #include "flow/flow_stash.h"
@@ -77,26 +78,35 @@ const char* DBConsumer<Type>::STASH_EVENT = "foo.stash.event";
 
 
 
-// DataBus mock: most functions are stubs, but _subscribe() and  _publish()
-// are (close to) real.
+// DataBus mock: most functions are stubs, but get_id(), _subscribe() and
+// _publish() are (close to) real.
+static std::map<std::string, DataEventId> event_ids;
+
 DataBus::DataBus() = default;
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : map )
+        for ( auto* h : v )
             delete h;
 }
 
 void DataBus::add_mapped_module(const char*) {}
 void DataBus::clone(DataBus& ) {}
+
+DataEventId DataBus::get_id(const char* key)
+{
+    auto it = event_ids.emplace(key, event_ids.size());
+    return it.first->second;
+}
+
 void DataBus::subscribe(const char* key, DataHandler* h)
 {
-    DB->_subscribe(key, h);
+    DB->_subscribe(get_id(key), h);
 }
 void DataBus::subscribe_default(const char* key, DataHandler* h, SnortConfig*)
 {
-    DB->_subscribe(key, h);
+    DB->_subscribe(get_id(key), h);
 }
 
 void DataBus::unsubscribe(const char*, DataHandler*) {}
@@ -104,30 +114,30 @@ void DataBus::unsubscribe_default(const char*, DataHandler*, SnortConfig*) {}
 
 void DataBus::publish(const char* key, DataEvent& e, Flow* f)
 {
-    DB->_publish(key, e, f);
+    DB->_publish(get_id(key), e, f);
 }
 
 void DataBus::publish(const char*, const uint8_t*, unsigned, Flow*) {}
 void DataBus::publish(const char*, Packet*, Flow*) {}
 void DataBus::publish(const char*, void*, int, const uint8_t*) {}
 
-void DataBus::_subscribe(const char* key, DataHandler* h)
+void DataBus::_subscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
-    v.emplace_back(h);
+    if ( id >= map.size() )
+        map.resize(id + 1);
+
+    map[id].emplace_back(h);
 }
 
-void DataBus::_unsubscribe(const char*, DataHandler*) {}
+void DataBus::_unsubscribe(DataEventId, DataHandler*) {}
 
-void DataBus::_publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::_publish(DataEventId id, DataEvent& e, Flow* f)
 {
-    auto v = map.find(key);
+    if ( id >= map.size() )
+        return;
 
-    if ( v != map.end() )
-    {
-        for ( auto* h : v->second )
-            h->handle(e, f);
-    }
+    for ( auto* h : map[id] )
+        h->handle(e, f);
 }
 // end DataBus mock.
 
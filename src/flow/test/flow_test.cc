@@ -83,6 +83,7 @@ uint8_t ip::IpApi::ttl() const { return 0; }
 const Layer* snort::layer::get_mpls_layer(const Packet* const p) { return nullptr; }
 
 void snort::DataBus::publish(const char* key, Packet* p, Flow* f) {}
+void snort::DataBus::publish(snort::DataEventId, Packet*, Flow*) {}
 
 TEST_GROUP(nondefault_timeout)
 {
@@ -23,6 +23,12 @@
 
 #include "data_bus.h"
 
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#include "log/messages.h"
 #include "main/policy.h"
 #include "main/snort_config.h"
 #include "protocols/packet.h"
@@ -32,6 +38,130 @@ using namespace snort;
 static DataBus& get_data_bus()
 { return snort::get_inspection_policy()->dbus; }
 
+//--------------------------------------------------------------------------
+// event key registry
+//--------------------------------------------------------------------------
+
+// keys are held in an open addressed table that packet threads search
+// without locking.  new keys are added under the mutex and made visible by
+// the release store of the slot name, after the slot id is written.  keys
+// are never removed so ids stay valid across reloads.
+
+static const char* const core_keys[] =
+{
+    PACKET_EVENT,
+    DAQ_META_EVENT,
+    FLOW_STATE_EVENT,
+    THREAD_IDLE_EVENT,
+    THREAD_ROTATE_EVENT,
+    FLOW_SERVICE_CHANGE_EVENT,
+    FLOW_STATE_SETUP_EVENT,
+    STREAM_ICMP_NEW_FLOW_EVENT,
+    STREAM_IP_NEW_FLOW_EVENT,
+    STREAM_UDP_NEW_FLOW_EVENT,
+    STREAM_TCP_SYN_EVENT,
+    STREAM_TCP_SYN_ACK_EVENT,
+    STREAM_TCP_MIDSTREAM_EVENT,
+    STREAM_HA_NEW_FLOW_EVENT,
+    THREAD_BATCH_EVENT,
+};
+
+static_assert(sizeof(core_keys) / sizeof(core_keys[0]) == CORE_DATA_EVENT_IDS,
+    "core_keys must match CoreDataEventId");
+
+class EventRegistry
+{
+public:
+    EventRegistry()
+    {
+        for ( auto key : core_keys )
+            get_id(key);
+    }
+
+    bool find(const char* key, DataEventId& id) const
+    {
+        for ( unsigned i = hash(key); ; i = (i + 1) & (table_size - 1) )
+        {
+            const char* name = slots[i].name.load(std::memory_order_acquire);
+
+            if ( !name )
+                return false;
+
+            if ( !strcmp(name, key) )
+            {
+                id = slots[i].id;
+                return true;
+            }
+        }
+    }
+
+    DataEventId get_id(const char* key)
+    {
+        DataEventId id;
+
+        if ( find(key, id) )
+            return id;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if ( find(key, id) )
+            return id;
+
+        if ( count == max_ids )
+            FatalError("too many data bus event keys (%u)\n", max_ids);
+
+        unsigned i = hash(key);
+
+        while ( slots[i].name.load(std::memory_order_relaxed) )
+            i = (i + 1) & (table_size - 1);
+
+        keys.emplace_back(key);
+        id = count++;
+
+        names[id].store(keys.back().c_str(), std::memory_order_release);
+        slots[i].id = id;
+        slots[i].name.store(keys.back().c_str(), std::memory_order_release);
+
+        return id;
+    }
+
+    const char* get_name(DataEventId id) const
+    { return id < max_ids ? names[id].load(std::memory_order_acquire) : nullptr; }
+
+private:
+    // FNV-1a
+    static unsigned hash(const char* key)
+    {
+        uint32_t h = 2166136261u;
+
+        while ( *key )
+            h = (h ^ (uint8_t)*key++) * 16777619u;
+
+        return h & (table_size - 1);
+    }
+
+    static const unsigned max_ids = 2048;
+    static const unsigned table_size = 2 * max_ids;  // power of 2
+
+    struct Slot
+    {
+        std::atomic<const char*> name { nullptr };
+        DataEventId id = 0;
+    };
+
+    Slot slots[table_size];
+    std::atomic<const char*> names[max_ids] { };
+    std::deque<std::string> keys;  // elements are never moved
+    std::mutex mutex;
+    unsigned count = 0;
+};
+
+static EventRegistry& get_registry()
+{
+    static EventRegistry registry;
+    return registry;
+}
+
 class BufferEvent : public DataEvent
 {
 public:
@@ -67,8 +197,8 @@ DataBus::DataBus() = default;
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : map )
+        for ( auto* h : v )
         {
             // If the object is cloned, pass the ownership to the next config.
             // When the object is no further cloned (e.g., the last config), delete it.
@@ -89,56 +219,111 @@ void DataBus::add_mapped_module(const char* name)
 
 void DataBus::clone(DataBus& from)
 {
-    for ( auto& p : from.map )
-        for ( auto* h : p.second )
+    for ( unsigned id = 0; id < from.map.size(); ++id )
+        for ( auto* h : from.map[id] )
             if ( mapped_module.count(h->module_name) == 0 )
             {
                 h->cloned = true;
-                _subscribe(p.first.c_str(), h);
+                _subscribe(id, h);
             }
 }
 
+DataEventId DataBus::get_id(const char* key)
+{ return get_registry().get_id(key); }
+
+const char* DataBus::get_name(DataEventId id)
+{ return get_registry().get_name(id); }
+
 // add handler to list of handlers to be notified upon
 // publication of given event
 void DataBus::subscribe(const char* key, DataHandler* h)
 {
-    get_data_bus()._subscribe(key, h);
+    subscribe(get_id(key), h);
+}
+
+void DataBus::subscribe(DataEventId id, DataHandler* h)
+{
+    get_data_bus()._subscribe(id, h);
 }
 
 // for subscribers that need to receive events regardless of active inspection policy
 void DataBus::subscribe_default(const char* key, DataHandler* h, SnortConfig* sc)
+{
+    subscribe_default(get_id(key), h, sc);
+}
+
+void DataBus::subscribe_default(DataEventId id, DataHandler* h, SnortConfig* sc)
 {
     if (sc)
-        get_default_inspection_policy(sc)->dbus._subscribe(key, h);
+        get_default_inspection_policy(sc)->dbus._subscribe(id, h);
     else
-        get_default_inspection_policy(SnortConfig::get_conf())->dbus._subscribe(key, h);
+        get_default_inspection_policy(SnortConfig::get_conf())->dbus._subscribe(id, h);
 }
 
 void DataBus::unsubscribe(const char* key, DataHandler* h)
 {
-    get_data_bus()._unsubscribe(key, h);
+    unsubscribe(get_id(key), h);
+}
+
+void DataBus::unsubscribe(DataEventId id, DataHandler* h)
+{
+    get_data_bus()._unsubscribe(id, h);
 }
 
 void DataBus::unsubscribe_default(const char* key, DataHandler* h, SnortConfig* sc)
+{
+    unsubscribe_default(get_id(key), h, sc);
+}
+
+void DataBus::unsubscribe_default(DataEventId id, DataHandler* h, SnortConfig* sc)
 {
     if (sc)
-        get_default_inspection_policy(sc)->dbus._unsubscribe(key, h);
+        get_default_inspection_policy(sc)->dbus._unsubscribe(id, h);
     else
-        get_default_inspection_policy(SnortConfig::get_conf())->dbus._unsubscribe(key, h);
+        get_default_inspection_policy(SnortConfig::get_conf())->dbus._unsubscribe(id, h);
 }
 
 // notify subscribers of event
-void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::publish(DataEventId id, DataEvent& e, Flow* f)
 {
     InspectionPolicy* pi = snort::get_inspection_policy();
-    pi->dbus._publish(key, e, f);
+    pi->dbus._publish(id, e, f);
 
     // also publish to default policy to notify control subscribers such as appid
     InspectionPolicy* di = snort::get_default_inspection_policy(SnortConfig::get_conf());
 
     // of course, only when current is not default
     if ( di != pi )
-        di->dbus._publish(key, e, f);
+        di->dbus._publish(id, e, f);
+}
+
+// a key that was never interned has no subscribers
+void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+{
+    DataEventId id;
+
+    if ( get_registry().find(key, id) )
+        publish(id, e, f);
+}
+
+void DataBus::publish(DataEventId id, const uint8_t* buf, unsigned len, Flow* f)
+{
+    BufferEvent e(buf, len);
+    publish(id, e, f);
+}
+
+void DataBus::publish(DataEventId id, Packet* p, Flow* f)
+{
+    PacketEvent e(p);
+    if ( p && !f )
+        f = p->flow;
+    publish(id, e, f);
+}
+
+void DataBus::publish(DataEventId id, void* user, int type, const uint8_t* data)
+{
+    DaqMetaEvent e(user, type, data);
+    publish(id, e, nullptr);
 }
 
 void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
@@ -165,37 +350,36 @@ void DataBus::publish(const char* key, void* user, int type, const uint8_t* data
 // private methods
 //--------------------------------------------------------------------------
 
-void DataBus::_subscribe(const char* key, DataHandler* h)
+void DataBus::_subscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
-    v.emplace_back(h);
+    if ( id >= map.size() )
+        map.resize(id + 1);
+
+    map[id].emplace_back(h);
 
     // Track fresh subscriptions to distinguish during cloning
     if ( !h->cloned )
         add_mapped_module(h->module_name);
 }
 
-void DataBus::_unsubscribe(const char* key, DataHandler* h)
+void DataBus::_unsubscribe(DataEventId id, DataHandler* h)
 {
-    DataList& v = map[key];
+    if ( id >= map.size() )
+        return;
+
+    DataList& v = map[id];
 
     for ( unsigned i = 0; i < v.size(); i++ )
         if ( v[i] == h )
             v.erase(v.begin() + i--);
-
-    if ( v.empty() )
-        map.erase(key);
 }
 
 // notify subscribers of event
-void DataBus::_publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::_publish(DataEventId id, DataEvent& e, Flow* f)
 {
-    auto v = map.find(key);
+    if ( id >= map.size() )
+        return;
 
-    if ( v != map.end() )
-    {
-        for ( auto* h : v->second )
-            h->handle(e, f);
-    }
+    for ( auto* h : map[id] )
+        h->handle(e, f);
 }
-
@@ -82,9 +82,16 @@ protected:
     DataHandler(const char* mod_name) : module_name(mod_name), cloned(false) { }
 };
 
-// FIXIT-P evaluate perf; focus is on correctness
+// event keys are interned: each distinct key string gets a small integer
+// id that is fixed for the life of the process, so a bus can dispatch by
+// indexing a vector instead of searching a map of strings.  the core keys
+// defined below have constant ids; other publishers should get their ids
+// once with DataBus::get_id() and publish by id.  the key versions of the
+// methods remain and intern or look up the key on each call.
+typedef unsigned DataEventId;
+
 typedef std::vector<DataHandler*> DataList;
-typedef std::map<std::string, DataList> DataMap;
+typedef std::vector<DataList> DataMap;  // indexed by DataEventId
 typedef std::unordered_set<const char*> DataModule;
 
 class SO_PUBLIC DataBus
@@ -96,21 +103,35 @@ public:
     void clone(DataBus& from);
     void add_mapped_module(const char*);
 
+    // returns the id of key, interning it if this is the first use
+    static DataEventId get_id(const char* key);
+    static const char* get_name(DataEventId);
+
     static void subscribe(const char* key, DataHandler*);
     static void subscribe_default(const char* key, DataHandler*, SnortConfig* = nullptr);
     static void unsubscribe(const char* key, DataHandler*);
     static void unsubscribe_default(const char* key, DataHandler*, SnortConfig* = nullptr);
     static void publish(const char* key, DataEvent&, Flow* = nullptr);
 
+    static void subscribe(DataEventId, DataHandler*);
+    static void subscribe_default(DataEventId, DataHandler*, SnortConfig* = nullptr);
+    static void unsubscribe(DataEventId, DataHandler*);
+    static void unsubscribe_default(DataEventId, DataHandler*, SnortConfig* = nullptr);
+    static void publish(DataEventId, DataEvent&, Flow* = nullptr);
+
     // convenience methods
     static void publish(const char* key, const uint8_t*, unsigned, Flow* = nullptr);
     static void publish(const char* key, Packet*, Flow* = nullptr);
     static void publish(const char* key, void* user, int type, const uint8_t* data);
 
+    static void publish(DataEventId, const uint8_t*, unsigned, Flow* = nullptr);
+    static void publish(DataEventId, Packet*, Flow* = nullptr);
+    static void publish(DataEventId, void* user, int type, const uint8_t* data);
+
 private:
-    void _subscribe(const char* key, DataHandler*);
-    void _unsubscribe(const char* key, DataHandler*);
-    void _publish(const char* key, DataEvent&, Flow*);
+    void _subscribe(DataEventId, DataHandler*);
+    void _unsubscribe(DataEventId, DataHandler*);
+    void _publish(DataEventId, DataEvent&, Flow*);
 
 private:
     DataMap map;
@@ -169,5 +190,29 @@ private:
 // A new standby flow was generated by stream high availability
 #define STREAM_HA_NEW_FLOW_EVENT "stream.ha.new_flow"
 
+// A packet thread finished processing a batch of DAQ messages
+#define THREAD_BATCH_EVENT "thread.batch"
+
+// constant ids of the keys above, in the order they are interned at startup
+enum CoreDataEventId : snort::DataEventId
+{
+    PACKET_EVENT_ID,
+    DAQ_META_EVENT_ID,
+    FLOW_STATE_EVENT_ID,
+    THREAD_IDLE_EVENT_ID,
+    THREAD_ROTATE_EVENT_ID,
+    FLOW_SERVICE_CHANGE_EVENT_ID,
+    FLOW_STATE_SETUP_EVENT_ID,
+    STREAM_ICMP_NEW_FLOW_EVENT_ID,
+    STREAM_IP_NEW_FLOW_EVENT_ID,
+    STREAM_UDP_NEW_FLOW_EVENT_ID,
+    STREAM_TCP_SYN_EVENT_ID,
+    STREAM_TCP_SYN_ACK_EVENT_ID,
+    STREAM_TCP_MIDSTREAM_EVENT_ID,
+    STREAM_HA_NEW_FLOW_EVENT_ID,
+    THREAD_BATCH_EVENT_ID,
+    CORE_DATA_EVENT_IDS
+};
+
 #endif
 
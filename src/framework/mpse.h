@@ -38,7 +38,7 @@
 namespace snort
 {
 // this is the current version of the api
-#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 0)
+#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 2)
 
 struct SnortConfig;
 class Mpse;
@@ -82,6 +82,13 @@ public:
 
     virtual int prep_patterns(SnortConfig*) = 0;
 
+    // engines flagged MPSE_MTBLD also split prep_patterns() into these.
+    // compile_patterns() does not use the agent or any shared state so it
+    // may run concurrently for distinct instances.  finish_patterns() then
+    // builds the agent trees and accumulates stats in the main thread.
+    virtual int compile_patterns() { return -1; }
+    virtual int finish_patterns(SnortConfig*) { return 0; }
+
     int search(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
 
@@ -99,6 +106,18 @@ public:
     virtual int print_info() { return 0; }
     virtual int get_pattern_count() const { return 0; }
 
+    // compiled state may be saved and later restored in place of
+    // prep_patterns() for the same patterns added in the same order.
+    // get_hash() identifies the patterns and options.  serialize() returns
+    // a buffer allocated with snort_alloc().  deserialize() may reference
+    // the given buffer rather than copy it; the caller keeps it valid and
+    // unchanged for the life of this instance.  deserialize() after
+    // prep_patterns() switches to the identical state in the buffer so
+    // that it can be shared.
+    virtual bool get_hash(std::string&) { return false; }
+    virtual bool serialize(uint8_t*&, size_t&) { return false; }
+    virtual bool deserialize(SnortConfig*, const uint8_t*, size_t) { return false; }
+
     const char* get_method() { return method.c_str(); }
     void set_verbose(bool b = true) { verbose = b; }
 
@@ -133,6 +152,7 @@ typedef Mpse::MpseRespType (* MpsePollFunc)(MpseBatch*&, Mpse::MpseType);
 #define MPSE_TRIM   0x01
 #define MPSE_REGEX  0x02
 #define MPSE_ASYNC  0x04
+#define MPSE_MTBLD  0x08
 
 struct MpseApi
 {
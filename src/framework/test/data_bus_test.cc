@@ -0,0 +1,258 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// data_bus_test.cc
+
+// unit tests and publishes/sec benchmark for DataBus event ids
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "framework/data_bus.h"
+#include "main/policy.h"
+#include "main/snort_config.h"
+#include "pub_sub/appid_events.h"
+#include "pub_sub/http_events.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+//--------------------------------------------------------------------------
+// stubs
+//--------------------------------------------------------------------------
+
+InspectionPolicy::InspectionPolicy(PolicyId) { }
+InspectionPolicy::~InspectionPolicy() = default;
+
+static InspectionPolicy* current = nullptr;
+static InspectionPolicy* fallback = nullptr;
+
+namespace snort
+{
+InspectionPolicy* get_inspection_policy() { return current; }
+InspectionPolicy* get_default_inspection_policy(SnortConfig*) { return fallback; }
+SnortConfig* SnortConfig::get_conf() { return nullptr; }
+[[noreturn]] void FatalError(const char*, ...) { throw "fatal"; }
+}
+
+class Counter : public DataHandler
+{
+public:
+    Counter(unsigned& n) : DataHandler("test"), count(n) { }
+
+    void handle(DataEvent&, Flow*) override
+    { ++count; }
+
+private:
+    unsigned& count;
+};
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+TEST_GROUP(data_bus)
+{
+    void setup() override
+    {
+        current = fallback = new InspectionPolicy;
+    }
+
+    void teardown() override
+    {
+        delete current;
+        current = fallback = nullptr;
+    }
+};
+
+TEST(data_bus, core_ids)
+{
+    CHECK_EQUAL((unsigned)PACKET_EVENT_ID, DataBus::get_id(PACKET_EVENT));
+    CHECK_EQUAL((unsigned)STREAM_HA_NEW_FLOW_EVENT_ID, DataBus::get_id(STREAM_HA_NEW_FLOW_EVENT));
+    STRCMP_EQUAL(FLOW_STATE_EVENT, DataBus::get_name(FLOW_STATE_EVENT_ID));
+}
+
+TEST(data_bus, intern)
+{
+    DataEventId a = DataBus::get_id("test.intern.a");
+    DataEventId b = DataBus::get_id("test.intern.b");
+
+    CHECK(a >= CORE_DATA_EVENT_IDS);
+    CHECK(a != b);
+
+    std::string copy("test.intern.a");
+    CHECK_EQUAL(a, DataBus::get_id(copy.c_str()));
+    STRCMP_EQUAL("test.intern.b", DataBus::get_name(b));
+    CHECK(DataBus::get_name(100000) == nullptr);
+}
+
+TEST(data_bus, publish_key_and_id)
+{
+    unsigned count = 0;
+    DataBus::subscribe("test.pub", new Counter(count));
+    DataEventId id = DataBus::get_id("test.pub");
+
+    BareDataEvent e;
+    DataBus::publish("test.pub", e);
+    DataBus::publish(id, e);
+    CHECK_EQUAL(2u, count);
+
+    // keys no one subscribed to are dropped without being interned
+    DataBus::publish("test.pub.none", e);
+    DataBus::publish(DataBus::get_id("test.pub.other"), e);
+    CHECK_EQUAL(2u, count);
+}
+
+TEST(data_bus, default_policy)
+{
+    unsigned count = 0;
+    DataBus::subscribe_default(APPID_EVENT_ANY_CHANGE, new Counter(count));
+
+    InspectionPolicy other;
+    current = &other;
+
+    BareDataEvent e;
+    DataBus::publish(DataBus::get_id(APPID_EVENT_ANY_CHANGE), e);
+    CHECK_EQUAL(1u, count);
+
+    current = fallback;
+    DataBus::publish(APPID_EVENT_ANY_CHANGE, e);
+    CHECK_EQUAL(2u, count);
+}
+
+TEST(data_bus, unsubscribe)
+{
+    unsigned a = 0, b = 0;
+    Counter* ha = new Counter(a);
+    Counter* hb = new Counter(b);
+
+    DataBus::subscribe(HTTP_REQUEST_HEADER_EVENT_KEY, ha);
+    DataBus::subscribe(HTTP_REQUEST_HEADER_EVENT_KEY, hb);
+    DataBus::unsubscribe(HTTP_REQUEST_HEADER_EVENT_KEY, ha);
+    delete ha;
+
+    BareDataEvent e;
+    DataBus::publish(HTTP_REQUEST_HEADER_EVENT_KEY, e);
+    CHECK_EQUAL(0u, a);
+    CHECK_EQUAL(1u, b);
+}
+
+TEST(data_bus, clone)
+{
+    unsigned count = 0;
+    DataBus::subscribe(HTTP_RESPONSE_HEADER_EVENT_KEY, new Counter(count));
+
+    InspectionPolicy* old = current;
+    current = fallback = new InspectionPolicy;
+    current->dbus.clone(old->dbus);
+
+    BareDataEvent e;
+    DataBus::publish(HTTP_RESPONSE_HEADER_EVENT_KEY, e);
+    CHECK_EQUAL(1u, count);
+
+    // the clone owns the handler once the old bus is gone
+    delete old;
+    DataBus::publish(HTTP_RESPONSE_HEADER_EVENT_KEY, e);
+    CHECK_EQUAL(2u, count);
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// publishes/sec for the string map the bus used to search vs the
+// interned key lookup vs publishing by id
+//--------------------------------------------------------------------------
+
+static const char* const bench_keys[] =
+{
+    HTTP_REQUEST_HEADER_EVENT_KEY, HTTP_RESPONSE_HEADER_EVENT_KEY, APPID_EVENT_ANY_CHANGE,
+    "expect.early_session_create", "sip_event_dialog", "analyzer.finalize.packet",
+    "file_event", "foo.stash.event",
+
+    PACKET_EVENT, DAQ_META_EVENT, FLOW_STATE_EVENT, THREAD_IDLE_EVENT, THREAD_ROTATE_EVENT,
+    FLOW_SERVICE_CHANGE_EVENT, FLOW_STATE_SETUP_EVENT, STREAM_ICMP_NEW_FLOW_EVENT,
+    STREAM_IP_NEW_FLOW_EVENT, STREAM_UDP_NEW_FLOW_EVENT, STREAM_TCP_SYN_EVENT,
+    STREAM_TCP_SYN_ACK_EVENT, STREAM_TCP_MIDSTREAM_EVENT, STREAM_HA_NEW_FLOW_EVENT,
+};
+
+template<typename F>
+static double rate(unsigned num, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned i = 0; i < num; ++i )
+        f(i);
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return num / secs.count();
+}
+
+TEST(data_bus, benchmark)
+{
+    const unsigned num = 2000000;
+    unsigned count = 0;
+
+    std::map<std::string, std::vector<DataHandler*>> old_map;
+    Counter old_handler(count);
+
+    // a map as full as a typical config's
+    for ( auto key : bench_keys )
+    {
+        DataBus::subscribe(key, new Counter(count));
+        old_map[key].emplace_back(&old_handler);
+    }
+
+    BareDataEvent e;
+
+    printf("\n%-28s %14s %14s %14s %8s\n", "event", "map pub/s", "key pub/s", "id pub/s",
+        "speedup");
+
+    for ( auto key : { HTTP_REQUEST_HEADER_EVENT_KEY, APPID_EVENT_ANY_CHANGE } )
+    {
+        DataEventId id = DataBus::get_id(key);
+
+        double a = rate(num, [&](unsigned)
+        {
+            auto v = old_map.find(key);
+            if ( v != old_map.end() )
+                for ( auto* h : v->second )
+                    h->handle(e, nullptr);
+        });
+
+        double b = rate(num, [&](unsigned) { DataBus::publish(key, e); });
+        double c = rate(num, [&](unsigned) { DataBus::publish(id, e); });
+
+        printf("%-28s %14.0f %14.0f %14.0f %8.2f\n", key, a, b, c, c / a);
+    }
+    CHECK(count == 2 * 3 * num);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,474 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// bucket_hash.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bucket_hash.h"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hashfcn.h"
+
+//-------------------------------------------------------------------------
+// private stuff
+//-------------------------------------------------------------------------
+
+struct BucketHashNode
+{
+    BucketHashNode* gnext = nullptr; // global list
+    BucketHashNode* gprev = nullptr; // global list
+
+    void* key = nullptr;
+    void* data = nullptr;
+
+    uint32_t hash = 0;      // full key hash; home bucket is hash & mask
+    uint32_t bucket = 0;    // bucket the node is stored in
+    uint8_t slot = 0;       // slot within that bucket
+};
+
+// the tags are first so that all 7 plus the overflow count can be loaded
+// and compared at once.  a zero tag is an empty slot.  overflow counts the
+// nodes that had to probe past this bucket; lookups stop at a bucket with a
+// zero count.  the count sticks at its max (never decremented) which only
+// costs extra probes, never a missed node.
+struct BucketHashBucket
+{
+    uint8_t tag[BucketHash::slots_per_bucket];
+    uint8_t overflow;
+    BucketHashNode* node[BucketHash::slots_per_bucket];
+};
+
+static_assert(sizeof(BucketHashBucket) == 64 or sizeof(void*) != 8,
+    "BucketHashBucket should fill one cache line");
+
+static const unsigned bucket_align = 64;
+static const uint8_t overflow_max = 0xFF;
+
+static inline uint8_t get_tag(uint32_t hash)
+{
+    uint8_t tag = hash >> 24;
+    return tag ? tag : 1;
+}
+
+// return a bit mask of the slots whose tag matches
+static inline unsigned match_tags(const BucketHashBucket& b, uint8_t tag)
+{
+#ifdef __SSE2__
+    __m128i tags = _mm_loadl_epi64((const __m128i*)b.tag);
+    __m128i hits = _mm_cmpeq_epi8(tags, _mm_set1_epi8((char)tag));
+    return (unsigned)_mm_movemask_epi8(hits) & 0x7F;
+#else
+    // swar zero byte detection; may flag a byte above a real match (which
+    // just costs a key compare) but never misses one
+    const uint64_t lsb = 0x0101010101010101ULL;
+    const uint64_t msb = 0x8080808080808080ULL;
+
+    uint64_t w;
+    memcpy(&w, b.tag, sizeof(w));
+    w ^= lsb * tag;
+
+    uint64_t z = (w - lsb) & ~w & msb;
+
+    // gather the byte msbs into the low 8 bits
+    return (unsigned)(((z >> 7) * 0x0102040810204080ULL) >> 56) & 0x7F;
+#endif
+}
+
+static inline unsigned first_slot(unsigned m)
+{ return __builtin_ctz(m); }
+
+static inline BucketHashNode* s_node_alloc(int keysize)
+{
+    auto node = static_cast<BucketHashNode*>(
+        ::operator new(sizeof(BucketHashNode) + keysize));
+
+    *node = {};
+    return node;
+}
+
+static inline void s_node_free(BucketHashNode* node)
+{ ::operator delete(node); }
+
+static unsigned nearest_powerof2(unsigned n)
+{
+    unsigned p = 1;
+
+    while ( p < n )
+        p <<= 1;
+
+    return p;
+}
+
+void BucketHash::delete_free_list()
+{
+    while ( fhead )
+    {
+        BucketHashNode* cur = fhead;
+        fhead = cur->gnext;
+        s_node_free(cur);
+    }
+}
+
+void BucketHash::save_free_node(BucketHashNode* node)
+{
+    node->gprev = nullptr;
+    node->gnext = fhead;
+
+    if ( fhead )
+        fhead->gprev = node;
+
+    fhead = node;
+}
+
+BucketHashNode* BucketHash::get_free_node()
+{
+    BucketHashNode* node = fhead;
+
+    if ( fhead )
+    {
+        fhead = fhead->gnext;
+
+        if ( fhead )
+            fhead->gprev = nullptr;
+    }
+
+    return node;
+}
+
+void BucketHash::glink_node(BucketHashNode* node)
+{
+    node->gprev = nullptr;
+    node->gnext = ghead;
+
+    if ( ghead )
+        ghead->gprev = node;
+    else
+        gtail = node;
+
+    ghead = node;
+}
+
+void BucketHash::gunlink_node(BucketHashNode* node)
+{
+    if ( cursor == node )
+        cursor = node->gprev;
+
+    if ( ghead == node )
+    {
+        ghead = ghead->gnext;
+        if ( ghead )
+            ghead->gprev = nullptr;
+    }
+
+    if ( node->gprev )
+        node->gprev->gnext = node->gnext;
+
+    if ( node->gnext )
+        node->gnext->gprev = node->gprev;
+
+    if ( gtail == node )
+        gtail = node->gprev;
+}
+
+void BucketHash::move_to_front(BucketHashNode* node)
+{
+    if ( node != ghead )
+    {
+        gunlink_node(node);
+        glink_node(node);
+    }
+}
+
+BucketHashNode* BucketHash::find_node(const void* key, uint32_t hash)
+{
+    const uint8_t tag = get_tag(hash);
+    unsigned index = hash & mask;
+
+    for ( unsigned probes = 0; probes < nbuckets; ++probes )
+    {
+        const BucketHashBucket& b = table[index];
+        unsigned m = match_tags(b, tag);
+
+        while ( m )
+        {
+            BucketHashNode* node = b.node[first_slot(m)];
+            m &= m - 1;
+
+            if ( node and node->hash == hash and
+                !hashfcn->keycmp_fcn(node->key, key, keysize) )
+            {
+                move_to_front(node);
+                return node;
+            }
+        }
+
+        if ( !b.overflow )
+            break;
+
+        ++overflow_probes;
+        index = (index + 1) & mask;
+    }
+
+    return nullptr;
+}
+
+// caller ensures there is a free slot somewhere (count < max_count)
+void BucketHash::insert_node(BucketHashNode* node)
+{
+    unsigned index = node->hash & mask;
+
+    while ( true )
+    {
+        BucketHashBucket& b = table[index];
+        unsigned m = match_tags(b, 0);
+
+        if ( m )
+        {
+            unsigned slot = first_slot(m);
+            b.tag[slot] = get_tag(node->hash);
+            b.node[slot] = node;
+
+            node->bucket = index;
+            node->slot = slot;
+            return;
+        }
+
+        if ( b.overflow < overflow_max )
+            ++b.overflow;
+
+        index = (index + 1) & mask;
+    }
+}
+
+//-------------------------------------------------------------------------
+// public stuff
+//-------------------------------------------------------------------------
+
+BucketHash::BucketHash(int rows, int keysz)
+{
+    if ( rows < 1 )
+        rows = rows ? -rows : 1;
+
+    // keep the load at or under ~75% of the slots so that most keys are in
+    // their home bucket
+    unsigned slots = (unsigned)rows + (unsigned)rows / 3 + 1;
+    nbuckets = nearest_powerof2((slots + slots_per_bucket - 1) / slots_per_bucket);
+    mask = nbuckets - 1;
+    max_count = nbuckets * slots_per_bucket - 1;
+
+    hashfcn = hashfcn_new(rows);
+
+    raw_table = new uint8_t[nbuckets * sizeof(BucketHashBucket) + bucket_align]();
+    uintptr_t p = ((uintptr_t)raw_table + bucket_align - 1) & ~(uintptr_t)(bucket_align - 1);
+    table = (BucketHashBucket*)p;
+
+    keysize = keysz;
+    count = 0;
+    overflow_probes = 0;
+
+    fhead = cursor = nullptr;
+    ghead = gtail = nullptr;
+}
+
+BucketHash::~BucketHash()
+{
+    if ( hashfcn )
+        hashfcn_free(hashfcn);
+
+    for ( BucketHashNode* node = ghead; node; )
+    {
+        BucketHashNode* onode = node;
+        node = node->gnext;
+        s_node_free(onode);
+    }
+
+    delete[] raw_table;
+    delete_free_list();
+}
+
+void* BucketHash::push(void* p)
+{
+    auto node = s_node_alloc(keysize);
+
+    node->key = (char*)node + sizeof(BucketHashNode);
+    node->data = p;
+
+    save_free_node(node);
+    return node->key;
+}
+
+void* BucketHash::pop()
+{
+    BucketHashNode* node = get_free_node();
+
+    if ( !node )
+        return nullptr;
+
+    void* pv = node->data;
+    s_node_free(node);
+
+    return pv;
+}
+
+void* BucketHash::get(const void* key, bool* new_node)
+{
+    uint32_t hash = hashfcn->hash_fcn(hashfcn, (const unsigned char*)key, keysize);
+    BucketHashNode* node = find_node(key, hash);
+
+    if ( node )
+        return node->data;
+
+    if ( count >= max_count )
+        return nullptr;
+
+    node = get_free_node();
+
+    if ( !node )
+        return nullptr;
+
+    memcpy(node->key, key, keysize);
+    node->hash = hash;
+
+    insert_node(node);
+    glink_node(node);
+
+    count++;
+
+    if ( new_node )
+        *new_node = true;
+
+    return node->data;
+}
+
+void* BucketHash::find(const void* key)
+{
+    uint32_t hash = hashfcn->hash_fcn(hashfcn, (const unsigned char*)key, keysize);
+    BucketHashNode* node = find_node(key, hash);
+
+    if ( node )
+        return node->data;
+
+    return nullptr;
+}
+
+void BucketHash::prefetch(const void* key)
+{
+    uint32_t hash = hashfcn->hash_fcn(hashfcn, (const unsigned char*)key, keysize);
+    __builtin_prefetch(table + (hash & mask));
+}
+
+void* BucketHash::first()
+{
+    cursor = gtail;
+    return cursor ? cursor->data : nullptr;
+}
+
+void* BucketHash::next()
+{
+    if ( !cursor )
+        return nullptr;
+
+    cursor = cursor->gprev;
+    return cursor ? cursor->data : nullptr;
+}
+
+void* BucketHash::current()
+{
+    return cursor ? cursor->data : nullptr;
+}
+
+bool BucketHash::touch()
+{
+    BucketHashNode* node = cursor;
+
+    if ( !node )
+        return false;
+
+    cursor = cursor->gprev;
+
+    if ( node != ghead )
+    {
+        gunlink_node(node);
+        glink_node(node);
+        return true;
+    }
+    return false;
+}
+
+bool BucketHash::remove(BucketHashNode* node)
+{
+    if ( !node )
+        return false;
+
+    BucketHashBucket& b = table[node->bucket];
+    assert(b.node[node->slot] == node);
+
+    b.tag[node->slot] = 0;
+    b.node[node->slot] = nullptr;
+
+    // undo the overflow counts left by the probe from the home bucket
+    for ( unsigned index = node->hash & mask; index != node->bucket; index = (index + 1) & mask )
+    {
+        BucketHashBucket& ob = table[index];
+        assert(ob.overflow);
+
+        if ( ob.overflow < overflow_max )
+            --ob.overflow;
+    }
+
+    gunlink_node(node);
+
+    count--;
+    save_free_node(node);
+
+    return true;
+}
+
+bool BucketHash::remove()
+{
+    BucketHashNode* node = cursor;
+    cursor = nullptr;
+    return remove(node);
+}
+
+bool BucketHash::remove(const void* key)
+{
+    uint32_t hash = hashfcn->hash_fcn(hashfcn, (const unsigned char*)key, keysize);
+    BucketHashNode* node = find_node(key, hash);
+    return remove(node);
+}
+
+int BucketHash::set_keyops(
+    unsigned (* hash_fcn)(HashFnc* p, const unsigned char* d, int n),
+    int (* keycmp_fcn)(const void* s1, const void* s2, size_t n))
+{
+    if ( hash_fcn && keycmp_fcn )
+        return hashfcn_set_keyops(hashfcn, hash_fcn, keycmp_fcn);
+
+    return -1;
+}
+
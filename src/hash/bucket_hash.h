@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// bucket_hash.h
+
+#ifndef BUCKET_HASH_H
+#define BUCKET_HASH_H
+
+// BucketHash is a drop-in alternative to ZHash using open addressing over
+// cache line sized buckets.  Each bucket holds 7 one byte tags (derived from
+// the top bits of the key hash) and the matching node pointers, so a lookup
+// usually costs one bucket line plus the node that matches instead of
+// walking a row list.  The tags of a bucket are compared in parallel.
+//
+// like ZHash, nodes are preallocated with push() and keep the key inline
+// so that users may hold pointers to it; LRU order is kept in a separate
+// doubly linked list with the same cursor semantics.
+
+#include <cstdint>
+
+#include "hash/lru_hash_table.h"
+
+struct BucketHashNode;
+struct BucketHashBucket;
+
+class BucketHash : public LruHashTable
+{
+public:
+    BucketHash(int nrows, int keysize);
+    ~BucketHash() override;
+
+    BucketHash(const BucketHash&) = delete;
+    BucketHash& operator=(const BucketHash&) = delete;
+
+    void* push(void* p) override;
+    void* pop() override;
+
+    void* first() override;
+    void* next() override;
+    void* current() override;
+    bool touch() override;
+
+    void* find(const void* key) override;
+    void* get(const void* key, bool* new_node = nullptr) override;
+    void prefetch(const void* key) override;
+
+    bool remove(const void* key) override;
+    bool remove() override;
+
+    unsigned get_count() override { return count; }
+
+    int set_keyops(
+        unsigned (* hash_fcn)(HashFnc* p, const unsigned char* d, int n),
+        int (* keycmp_fcn)(const void* s1, const void* s2, size_t n)) override;
+
+    unsigned get_num_buckets() const
+    { return nbuckets; }
+
+    // number of buckets visited by lookups that had to go past the home
+    // bucket; a high ratio to lookups indicates clustering
+    uint64_t get_overflow_probes() const
+    { return overflow_probes; }
+
+    static const unsigned slots_per_bucket = 7;
+
+private:
+    BucketHashNode* find_node(const void* key, uint32_t hash);
+    void insert_node(BucketHashNode*);
+
+    void glink_node(BucketHashNode*);
+    void gunlink_node(BucketHashNode*);
+    void move_to_front(BucketHashNode*);
+
+    BucketHashNode* get_free_node();
+    void save_free_node(BucketHashNode*);
+    void delete_free_list();
+
+    bool remove(BucketHashNode*);
+
+private:
+    HashFnc* hashfcn;
+    int keysize;
+
+    unsigned nbuckets;
+    unsigned mask;
+    unsigned max_count;
+    unsigned count;
+
+    uint64_t overflow_probes;
+
+    uint8_t* raw_table;
+    BucketHashBucket* table;
+
+    BucketHashNode* ghead, * gtail;
+    BucketHashNode* fhead;
+    BucketHashNode* cursor;
+};
+
+#endif
+
@@ -0,0 +1,435 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lru_cache_sharded.h
+
+#ifndef LRU_CACHE_SHARDED_H
+#define LRU_CACHE_SHARDED_H
+
+// LruCacheSharded -- A drop-in replacement for LruCacheShared that splits
+// the map into independently locked shards so that packet threads looking
+// up different keys do not serialize on a single mutex.
+//
+// Each shard keeps its own LRU list. Every touch stamps the entry with a
+// global tick, so the least recently used entry overall is the tail with
+// the smallest stamp. Each shard publishes its tail stamp in an atomic so
+// pruning can pick the victim shard without taking any lock but the one it
+// evicts from. Eviction order is exact when single threaded and approximate
+// (off by at most the entries touched concurrently) otherwise.
+//
+// The size accounting is a single atomic so that derived classes such as
+// LruCacheSharedMemcap can keep a global memcap across all shards.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "hash/lru_cache_shared.h"
+
+template<typename Key, typename Value, typename Hash>
+class LruCacheSharded
+{
+public:
+    static constexpr unsigned default_shards = 16;
+
+    //  Do not allow default constructor, copy constructor or assignment
+    //  operator.  Cannot safely copy the LruCacheSharded due to the mutexes.
+    LruCacheSharded() = delete;
+    LruCacheSharded(const LruCacheSharded& arg) = delete;
+    LruCacheSharded& operator=(const LruCacheSharded& arg) = delete;
+
+    LruCacheSharded(const size_t initial_size, unsigned shards = default_shards) :
+        max_size(initial_size), current_size(0), tick(0),
+        num_shards(shards ? shards : 1), shard_array(new Shard[num_shards]) { }
+
+    virtual ~LruCacheSharded() = default;
+
+    using Data = std::shared_ptr<Value>;
+    using ValueType = Value;
+
+    // Return data entry associated with key. If doesn't exist, return nullptr.
+    Data find(const Key& key);
+
+    // Return data entry associated with key. If doesn't exist, create a new entry.
+    Data operator[](const Key& key);
+
+    // Same as operator[]; additionally, sets the boolean if a new entry is created.
+    Data find_else_create(const Key& key, bool* new_data);
+
+    // Return all data from the cache in order (most recently used to least)
+    std::vector<std::pair<Key, Data> > get_all_data();
+
+    //  Get current number of elements in the cache.
+    size_t size();
+
+    virtual size_t mem_size()
+    {
+        return size() * mem_chunk;
+    }
+
+    size_t get_max_size()
+    {
+        return max_size;
+    }
+
+    unsigned get_num_shards() const
+    {
+        return num_shards;
+    }
+
+    //  Modify the maximum number of entries allowed in the cache.
+    //  If the size is reduced, the oldest entries are removed.
+    bool set_max_size(size_t newsize);
+
+    //  Remove entry associated with Key.
+    //  Returns true if entry existed, false otherwise.
+    bool remove(const Key& key);
+
+    //  Remove entry associated with key and return removed data.
+    //  Returns true and copy of data if entry existed.  Returns false if
+    //  entry did not exist.
+    bool remove(const Key& key, Data& data);
+
+    const PegInfo* get_pegs() const
+    {
+        return lru_cache_shared_peg_names;
+    }
+
+    // Sum of the per shard counts. Take lock() first for a consistent view.
+    PegCount* get_counts();
+
+    // Lock / unlock all shards; always in the same order to avoid deadlock.
+    void lock()
+    {
+        for ( unsigned i = 0; i < num_shards; ++i )
+            shard_array[i].mutex.lock();
+    }
+
+    void unlock()
+    {
+        for ( unsigned i = num_shards; i > 0; --i )
+            shard_array[i - 1].mutex.unlock();
+    }
+
+protected:
+    struct Entry
+    {
+        Entry(const Key& k, const Data& d, uint64_t s) : key(k), data(d), stamp(s) { }
+
+        Key key;
+        Data data;
+        uint64_t stamp;   // tick of the last touch
+    };
+
+    using LruList = std::list<Entry>;
+    using LruListIter = typename LruList::iterator;
+    using LruMap  = std::unordered_map<Key, LruListIter, Hash>;
+    using LruMapIter = typename LruMap::iterator;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        LruList list;  //  Maintains LRU order with least recently used at the end.
+        LruMap map;    //  Maps key to list iterator for fast lookup.
+        LruCacheSharedStats stats;
+        std::atomic<uint64_t> tail_stamp { UINT64_MAX };  // UINT64_MAX if empty
+
+        // Call under the shard lock after anything that may change the tail.
+        void update_tail()
+        {
+            tail_stamp.store(list.empty() ? UINT64_MAX : list.back().stamp,
+                std::memory_order_relaxed);
+        }
+    };
+
+    static constexpr size_t mem_chunk = sizeof(Data) + sizeof(Value);
+
+    std::atomic<size_t> max_size;       // Once max_size is reached, start to
+                                        // remove the least-recently-used elements.
+
+    std::atomic<size_t> current_size;   // Number of entries (or bytes) in the cache.
+
+    std::atomic<uint64_t> tick;         // Source of the LRU stamps.
+
+    const unsigned num_shards;
+    std::unique_ptr<Shard[]> shard_array;
+
+    struct LruCacheSharedStats stats;   // Aggregated by get_counts().
+
+    Shard& get_shard(const Key& key)
+    {
+        // Fold the hash so that keys which only differ in the upper bits,
+        // such as IPv4 addresses mapped into an IPv6 SfIp, spread evenly.
+        uint64_t h = Hash()(key);
+        h ^= h >> 32;
+        h ^= h >> 16;
+        return shard_array[h % num_shards];
+    }
+
+    uint64_t next_tick()
+    {
+        return tick.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // These get called from within a shard lock (or no lock at all for
+    // update() in derived classes) and must only touch current_size.
+    virtual void increase_size()
+    {
+        current_size++;
+    }
+
+    virtual void decrease_size()
+    {
+        current_size--;
+    }
+
+    // Caller must NOT hold any shard lock; only the victim shard is locked
+    // here. The pruned data is returned in the list so that the caller
+    // can release it after this returns.
+    void prune(std::list<Data>& data);
+};
+
+template<typename Key, typename Value, typename Hash>
+void LruCacheSharded<Key, Value, Hash>::prune(std::list<Data>& data)
+{
+    while ( current_size > max_size )
+    {
+        Shard* victim = nullptr;
+        uint64_t oldest = UINT64_MAX;
+
+        for ( unsigned i = 0; i < num_shards; ++i )
+        {
+            uint64_t stamp = shard_array[i].tail_stamp.load(std::memory_order_relaxed);
+
+            if ( stamp < oldest )
+            {
+                oldest = stamp;
+                victim = &shard_array[i];
+            }
+        }
+
+        if ( !victim )
+            break;
+
+        std::lock_guard<std::mutex> shard_lock(victim->mutex);
+
+        // another thread may have pruned or touched it in the meantime;
+        // just take whatever is the oldest in this shard now
+        if ( victim->list.empty() )
+            continue;
+
+        LruListIter list_iter = --victim->list.end();
+        data.push_back(list_iter->data); // increase reference count
+        decrease_size();
+        victim->map.erase(list_iter->key);
+        victim->list.erase(list_iter);
+        victim->update_tail();
+        victim->stats.prunes++;
+    }
+}
+
+template<typename Key, typename Value, typename Hash>
+size_t LruCacheSharded<Key, Value, Hash>::size()
+{
+    size_t n = 0;
+
+    for ( unsigned i = 0; i < num_shards; ++i )
+    {
+        std::lock_guard<std::mutex> shard_lock(shard_array[i].mutex);
+        n += shard_array[i].list.size();
+    }
+    return n;
+}
+
+template<typename Key, typename Value, typename Hash>
+bool LruCacheSharded<Key, Value, Hash>::set_max_size(size_t newsize)
+{
+    if (newsize == 0)
+        return false;   //  Not allowed to set size to zero.
+
+    // The pruned data must self-destruct after all shard locks are released.
+    std::list<Data> data;
+
+    //  Remove the oldest entries if we have to reduce cache size.
+    max_size = newsize;
+
+    prune(data);
+
+    return true;
+}
+
+template<typename Key, typename Value, typename Hash>
+std::shared_ptr<Value> LruCacheSharded<Key, Value, Hash>::find(const Key& key)
+{
+    Shard& s = get_shard(key);
+    std::lock_guard<std::mutex> shard_lock(s.mutex);
+
+    LruMapIter map_iter = s.map.find(key);
+    if (map_iter == s.map.end())
+    {
+        s.stats.find_misses++;
+        return nullptr;
+    }
+
+    //  Move entry to front of LruList
+    s.list.splice(s.list.begin(), s.list, map_iter->second);
+    map_iter->second->stamp = next_tick();
+    s.update_tail();
+    s.stats.find_hits++;
+    return map_iter->second->data;
+}
+
+template<typename Key, typename Value, typename Hash>
+std::shared_ptr<Value> LruCacheSharded<Key, Value, Hash>::operator[](const Key& key)
+{
+    return find_else_create(key, nullptr);
+}
+
+template<typename Key, typename Value, typename Hash>
+std::shared_ptr<Value> LruCacheSharded<Key, Value, Hash>::
+find_else_create(const Key& key, bool* new_data)
+{
+    // As with remove, we need a temporary list of references to delay the
+    // destruction of the items being removed by prune() until no shard is
+    // locked. For the same reason, data is declared before any lock.
+    std::list<Data> tmp_data;
+    Data data;
+
+    Shard& s = get_shard(key);
+
+    {
+        std::lock_guard<std::mutex> shard_lock(s.mutex);
+        LruMapIter map_iter = s.map.find(key);
+
+        if (map_iter != s.map.end())
+        {
+            s.stats.find_hits++;
+            s.list.splice(s.list.begin(), s.list, map_iter->second); // update LRU
+            map_iter->second->stamp = next_tick();
+            s.update_tail();
+            return map_iter->second->data;
+        }
+
+        s.stats.find_misses++;
+        s.stats.adds++;
+        if ( new_data )
+            *new_data = true;
+        data = Data(new Value);
+
+        //  Add key/data pair to front of list.
+        s.list.emplace_front(key, data, next_tick());
+        increase_size();
+
+        //  Add list iterator for the new entry to map.
+        s.map[key] = s.list.begin();
+        s.update_tail();
+    }
+
+    prune(tmp_data);
+
+    return data;
+}
+
+template<typename Key, typename Value, typename Hash>
+std::vector< std::pair<Key, std::shared_ptr<Value>> >
+LruCacheSharded<Key, Value, Hash>::get_all_data()
+{
+    std::vector<std::pair<uint64_t, std::pair<Key, Data> > > stamped;
+
+    for ( unsigned i = 0; i < num_shards; ++i )
+    {
+        std::lock_guard<std::mutex> shard_lock(shard_array[i].mutex);
+
+        for ( auto& entry : shard_array[i].list )
+            stamped.emplace_back(entry.stamp, std::make_pair(entry.key, entry.data));
+    }
+
+    std::sort(stamped.begin(), stamped.end(),
+        [](const std::pair<uint64_t, std::pair<Key, Data> >& a,
+        const std::pair<uint64_t, std::pair<Key, Data> >& b)
+        { return a.first > b.first; });
+
+    std::vector<std::pair<Key, Data> > vec;
+    vec.reserve(stamped.size());
+
+    for ( auto& entry : stamped )
+        vec.emplace_back(entry.second);
+
+    return vec;
+}
+
+template<typename Key, typename Value, typename Hash>
+bool LruCacheSharded<Key, Value, Hash>::remove(const Key& key)
+{
+    // As in LruCacheShared::remove(), data must be defined before the lock
+    // so that the value is destroyed after the shard is unlocked. Do not
+    // change the order of data and shard_lock!
+    Data data;
+
+    return remove(key, data);
+}
+
+template<typename Key, typename Value, typename Hash>
+bool LruCacheSharded<Key, Value, Hash>::remove(const Key& key, std::shared_ptr<Value>& data)
+{
+    Shard& s = get_shard(key);
+    std::lock_guard<std::mutex> shard_lock(s.mutex);
+
+    LruMapIter map_iter = s.map.find(key);
+    if (map_iter == s.map.end())
+    {
+        return false;   //  Key is not in cache.
+    }
+
+    data = map_iter->second->data;
+
+    decrease_size();
+    s.list.erase(map_iter->second);
+    s.map.erase(map_iter);
+    s.update_tail();
+    s.stats.removes++;
+
+    assert( data.use_count() > 0 );
+
+    return true;
+}
+
+template<typename Key, typename Value, typename Hash>
+PegCount* LruCacheSharded<Key, Value, Hash>::get_counts()
+{
+    stats = LruCacheSharedStats();
+
+    for ( unsigned i = 0; i < num_shards; ++i )
+    {
+        const LruCacheSharedStats& ss = shard_array[i].stats;
+        stats.adds += ss.adds;
+        stats.prunes += ss.prunes;
+        stats.find_hits += ss.find_hits;
+        stats.find_misses += ss.find_misses;
+        stats.removes += ss.removes;
+    }
+    return (PegCount*)&stats;
+}
+
+#endif
+
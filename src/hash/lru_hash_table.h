@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lru_hash_table.h
+
+#ifndef LRU_HASH_TABLE_H
+#define LRU_HASH_TABLE_H
+
+// LruHashTable is the interface shared by the preallocated, LRU ordered hash
+// tables (ZHash and BucketHash) so that users like FlowCache can select the
+// table engine at configuration time.
+//
+// nodes are preallocated with push() and reclaimed with pop(); get() takes a
+// free node when the key is not found.  first() / next() walk from least to
+// most recently used and touch() moves the cursor node to the front.
+//
+// prefetch() only starts loading the table memory a later lookup of key will
+// touch first; it does not change the table.  callers processing a batch can
+// prefetch a few keys ahead to overlap the cache misses.
+
+#include <cstddef>
+
+struct HashFnc;
+
+class LruHashTable
+{
+public:
+    virtual ~LruHashTable() = default;
+
+    virtual void* push(void* p) = 0;
+    virtual void* pop() = 0;
+
+    virtual void* first() = 0;
+    virtual void* next() = 0;
+    virtual void* current() = 0;
+    virtual bool touch() = 0;
+
+    virtual void* find(const void* key) = 0;
+    virtual void* get(const void* key, bool* new_node = nullptr) = 0;
+    virtual void prefetch(const void* key) = 0;
+
+    virtual bool remove(const void* key) = 0;
+    virtual bool remove() = 0;
+
+    virtual unsigned get_count() = 0;
+
+    virtual int set_keyops(
+        unsigned (* hash_fcn)(HashFnc* p, const unsigned char* d, int n),
+        int (* keycmp_fcn)(const void* s1, const void* s2, size_t n)) = 0;
+};
+
+#endif
+
@@ -0,0 +1,710 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// sha256_mb.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sha256_mb.h"
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define USE_SHA256_SIMD
+#include <immintrin.h>
+#if defined(__clang__) or __GNUC__ >= 5
+#define USE_SHA256_SHANI
+#endif
+#endif
+
+#include "hashes.h"
+
+namespace snort
+{
+static const char* const isa_names[SHA256_ISA_MAX] = { "scalar", "sse2", "avx2", "shani" };
+
+alignas(16) static const uint32_t sha256_k[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_h0[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+//-------------------------------------------------------------------------
+// single message
+//-------------------------------------------------------------------------
+
+// openssl picks its own best block function (sha extensions, avx2, ...)
+static void compress(uint32_t* h, const uint8_t* data, size_t blocks)
+{
+    SHA256_CTX c;
+    memcpy(c.h, h, sizeof(c.h));
+
+    for ( size_t i = 0; i < blocks; ++i )
+        SHA256_Transform(&c, data + i * SHA256_BLOCK_SIZE);
+
+    memcpy(h, c.h, sizeof(c.h));
+}
+
+void sha256_init(Sha256Ctx& c)
+{
+    memcpy(c.h, sha256_h0, sizeof(c.h));
+    c.bytes = 0;
+}
+
+void sha256_update(Sha256Ctx& c, const uint8_t* data, size_t size)
+{
+    unsigned used = c.bytes % SHA256_BLOCK_SIZE;
+    c.bytes += size;
+
+    if ( used )
+    {
+        size_t take = std::min(size, (size_t)(SHA256_BLOCK_SIZE - used));
+        memcpy(c.buf + used, data, take);
+
+        if ( used + take < SHA256_BLOCK_SIZE )
+            return;
+
+        compress(c.h, c.buf, 1);
+        data += take;
+        size -= take;
+    }
+
+    if ( size >= SHA256_BLOCK_SIZE )
+    {
+        compress(c.h, data, size / SHA256_BLOCK_SIZE);
+        data += size & ~(size_t)(SHA256_BLOCK_SIZE - 1);
+        size %= SHA256_BLOCK_SIZE;
+    }
+
+    if ( size )
+        memcpy(c.buf, data, size);
+}
+
+static inline void put_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+void sha256_final(const Sha256Ctx& c, uint8_t* digest)
+{
+    uint8_t pad[2 * SHA256_BLOCK_SIZE] = { };
+    unsigned used = c.bytes % SHA256_BLOCK_SIZE;
+
+    memcpy(pad, c.buf, used);
+    pad[used] = 0x80;
+
+    unsigned n = (used < SHA256_BLOCK_SIZE - 8) ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+    uint64_t bits = c.bytes << 3;
+
+    put_be32(pad + n - 8, bits >> 32);
+    put_be32(pad + n - 4, (uint32_t)bits);
+
+    uint32_t h[8];
+    memcpy(h, c.h, sizeof(h));
+    compress(h, pad, n / SHA256_BLOCK_SIZE);
+
+    for ( unsigned i = 0; i < 8; ++i )
+        put_be32(digest + 4 * i, h[i]);
+}
+
+//-------------------------------------------------------------------------
+// kernels
+//
+// a kernel compresses the given number of consecutive blocks at p[i] into
+// h[i] for each of its lanes.
+//-------------------------------------------------------------------------
+
+typedef void (*Sha256Kernel)(uint32_t* const* h, const uint8_t* const* p, size_t blocks);
+
+// one lane; compress() is already the fastest way to do one message
+static void single_1(uint32_t* const* h, const uint8_t* const* p, size_t blocks)
+{ compress(h[0], p[0], blocks); }
+
+#ifdef USE_SHA256_SIMD
+//-------------------------------------------------------------------------
+// sse2 - 4 lanes
+//-------------------------------------------------------------------------
+
+#define ROR(x, n) OR(SRL(x, n), SLL(x, 32 - n))
+
+// one round of all lanes; w is the scheduled word for round t
+#define LANE_ROUND(t, w) \
+    { \
+        V t1 = ADD(ADD(ADD(k, XOR(XOR(ROR(e, 6), ROR(e, 11)), ROR(e, 25))), \
+            XOR(AND(e, f), ANDNOT(e, g))), ADD(SET1(sha256_k[t]), w)); \
+        V t2 = ADD(XOR(XOR(ROR(a, 2), ROR(a, 13)), ROR(a, 22)), OR(AND(a, b), AND(c, OR(a, b)))); \
+        k = g; g = f; f = e; e = ADD(d, t1); \
+        d = c; c = b; b = a; a = ADD(t1, t2); \
+    }
+
+#define LANE_SCHEDULE(t) \
+    { \
+        V w2 = w[(t - 2) & 15], w15 = w[(t - 15) & 15]; \
+        w[t & 15] = ADD(ADD(w[t & 15], XOR(XOR(ROR(w2, 17), ROR(w2, 19)), SRL(w2, 10))), \
+            ADD(w[(t - 7) & 15], XOR(XOR(ROR(w15, 7), ROR(w15, 18)), SRL(w15, 3)))); \
+    }
+
+#define LANE_BLOCK(N) \
+    { \
+        V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], k = s[7]; \
+        for ( unsigned t = 0; t < 16; ++t ) \
+            LANE_ROUND(t, w[t]); \
+        for ( unsigned t = 16; t < 64; ++t ) \
+        { \
+            LANE_SCHEDULE(t); \
+            LANE_ROUND(t, w[t & 15]); \
+        } \
+        s[0] = ADD(s[0], a); s[1] = ADD(s[1], b); s[2] = ADD(s[2], c); s[3] = ADD(s[3], d); \
+        s[4] = ADD(s[4], e); s[5] = ADD(s[5], f); s[6] = ADD(s[6], g); s[7] = ADD(s[7], k); \
+    }
+
+#define V __m128i
+#define ADD _mm_add_epi32
+#define XOR _mm_xor_si128
+#define AND _mm_and_si128
+#define ANDNOT _mm_andnot_si128
+#define OR _mm_or_si128
+#define SRL _mm_srli_epi32
+#define SLL _mm_slli_epi32
+#define SET1 _mm_set1_epi32
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_bswap(__m128i x)
+{
+    x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    x = _mm_shufflelo_epi16(x, 0xB1);
+    return _mm_shufflehi_epi16(x, 0xB1);
+}
+
+__attribute__((target("sse2")))
+static void sse2_4(uint32_t* const* h, const uint8_t* const* pv, size_t blocks)
+{
+    const uint8_t* p[4] = { pv[0], pv[1], pv[2], pv[3] };
+    V s[8];
+
+    for ( unsigned i = 0; i < 8; ++i )
+        s[i] = _mm_set_epi32(h[3][i], h[2][i], h[1][i], h[0][i]);
+
+    for ( size_t n = 0; n < blocks; ++n )
+    {
+        V w[16];
+
+        // transpose 4 words of each lane into 4 words of all lanes
+        for ( unsigned j = 0; j < 16; j += 4 )
+        {
+            V r0 = _mm_loadu_si128((const V*)(p[0] + 4 * j));
+            V r1 = _mm_loadu_si128((const V*)(p[1] + 4 * j));
+            V r2 = _mm_loadu_si128((const V*)(p[2] + 4 * j));
+            V r3 = _mm_loadu_si128((const V*)(p[3] + 4 * j));
+
+            V t0 = _mm_unpacklo_epi32(r0, r1);
+            V t1 = _mm_unpackhi_epi32(r0, r1);
+            V t2 = _mm_unpacklo_epi32(r2, r3);
+            V t3 = _mm_unpackhi_epi32(r2, r3);
+
+            w[j + 0] = sse2_bswap(_mm_unpacklo_epi64(t0, t2));
+            w[j + 1] = sse2_bswap(_mm_unpackhi_epi64(t0, t2));
+            w[j + 2] = sse2_bswap(_mm_unpacklo_epi64(t1, t3));
+            w[j + 3] = sse2_bswap(_mm_unpackhi_epi64(t1, t3));
+        }
+        LANE_BLOCK(4);
+
+        for ( unsigned i = 0; i < 4; ++i )
+            p[i] += SHA256_BLOCK_SIZE;
+    }
+
+    alignas(16) uint32_t out[4];
+
+    for ( unsigned i = 0; i < 8; ++i )
+    {
+        _mm_store_si128((V*)out, s[i]);
+
+        for ( unsigned j = 0; j < 4; ++j )
+            h[j][i] = out[j];
+    }
+}
+
+#undef V
+#undef ADD
+#undef XOR
+#undef AND
+#undef ANDNOT
+#undef OR
+#undef SRL
+#undef SLL
+#undef SET1
+
+//-------------------------------------------------------------------------
+// avx2 - 8 lanes
+//-------------------------------------------------------------------------
+
+#define V __m256i
+#define ADD _mm256_add_epi32
+#define XOR _mm256_xor_si256
+#define AND _mm256_and_si256
+#define ANDNOT _mm256_andnot_si256
+#define OR _mm256_or_si256
+#define SRL _mm256_srli_epi32
+#define SLL _mm256_slli_epi32
+#define SET1 _mm256_set1_epi32
+
+__attribute__((target("avx2")))
+static void avx2_8(uint32_t* const* h, const uint8_t* const* pv, size_t blocks)
+{
+    const uint8_t* p[8];
+    V s[8];
+
+    for ( unsigned i = 0; i < 8; ++i )
+    {
+        p[i] = pv[i];
+        s[i] = _mm256_set_epi32(h[7][i], h[6][i], h[5][i], h[4][i],
+            h[3][i], h[2][i], h[1][i], h[0][i]);
+    }
+
+    const V swap = _mm256_set_epi8(
+        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    for ( size_t n = 0; n < blocks; ++n )
+    {
+        V w[16];
+
+        // transpose 8 words of each lane into 8 words of all lanes
+        for ( unsigned j = 0; j < 16; j += 8 )
+        {
+            V r[8], t[8], u[8];
+
+            for ( unsigned i = 0; i < 8; ++i )
+                r[i] = _mm256_loadu_si256((const V*)(p[i] + 4 * j));
+
+            for ( unsigned i = 0; i < 8; i += 4 )
+            {
+                t[i + 0] = _mm256_unpacklo_epi32(r[i + 0], r[i + 1]);
+                t[i + 1] = _mm256_unpackhi_epi32(r[i + 0], r[i + 1]);
+                t[i + 2] = _mm256_unpacklo_epi32(r[i + 2], r[i + 3]);
+                t[i + 3] = _mm256_unpackhi_epi32(r[i + 2], r[i + 3]);
+
+                u[i + 0] = _mm256_unpacklo_epi64(t[i + 0], t[i + 2]);
+                u[i + 1] = _mm256_unpackhi_epi64(t[i + 0], t[i + 2]);
+                u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+                u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+            }
+            for ( unsigned i = 0; i < 4; ++i )
+            {
+                w[j + i] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i + 4], 0x20), swap);
+                w[j + i + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i + 4], 0x31), swap);
+            }
+        }
+        LANE_BLOCK(8);
+
+        for ( unsigned i = 0; i < 8; ++i )
+            p[i] += SHA256_BLOCK_SIZE;
+    }
+
+    alignas(32) uint32_t out[8];
+
+    for ( unsigned i = 0; i < 8; ++i )
+    {
+        _mm256_store_si256((V*)out, s[i]);
+
+        for ( unsigned j = 0; j < 8; ++j )
+            h[j][i] = out[j];
+    }
+}
+
+#undef V
+#undef ADD
+#undef XOR
+#undef AND
+#undef ANDNOT
+#undef OR
+#undef SRL
+#undef SLL
+#undef SET1
+
+#undef ROR
+#undef LANE_ROUND
+#undef LANE_SCHEDULE
+#undef LANE_BLOCK
+
+#ifdef USE_SHA256_SHANI
+//-------------------------------------------------------------------------
+// sha extensions - 2 interleaved lanes
+//
+// sha256rnds2 does 2 rounds but the next pair has to wait for it, so one
+// message leaves most of the unit idle.  a second independent message
+// fills the gaps.  state is kept as ABEF / CDGH as the instructions want.
+//-------------------------------------------------------------------------
+
+#define SHANI_TARGET __attribute__((target("sha,sse4.1")))
+
+SHANI_TARGET
+static inline void shani_load(const uint32_t* h, __m128i& abef, __m128i& cdgh)
+{
+    __m128i dcba = _mm_loadu_si128((const __m128i*)h);
+    __m128i hgfe = _mm_loadu_si128((const __m128i*)(h + 4));
+
+    dcba = _mm_shuffle_epi32(dcba, 0xB1);   // cdab
+    hgfe = _mm_shuffle_epi32(hgfe, 0x1B);   // efgh
+    abef = _mm_alignr_epi8(dcba, hgfe, 8);
+    cdgh = _mm_blend_epi16(hgfe, dcba, 0xF0);
+}
+
+SHANI_TARGET
+static inline void shani_store(uint32_t* h, __m128i abef, __m128i cdgh)
+{
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+
+    _mm_storeu_si128((__m128i*)h, _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i*)(h + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+// rounds 4g to 4g+3 of lane x.  m holds the message schedule as four words
+// per register; a is the current register, b the next and d the previous.
+#define SHANI_GROUP(x, g, a, b, d) \
+    { \
+        if ( g < 4 ) \
+            m##x[a] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p##x + 16 * g)), swap); \
+        __m128i k = _mm_add_epi32(m##x[a], _mm_load_si128((const __m128i*)(sha256_k + 4 * g))); \
+        cdgh##x = _mm_sha256rnds2_epu32(cdgh##x, abef##x, k); \
+        abef##x = _mm_sha256rnds2_epu32(abef##x, cdgh##x, _mm_shuffle_epi32(k, 0x0E)); \
+        if ( g >= 3 and g <= 14 ) \
+            m##x[b] = _mm_sha256msg2_epu32( \
+                _mm_add_epi32(m##x[b], _mm_alignr_epi8(m##x[a], m##x[d], 4)), m##x[a]); \
+        if ( g >= 1 and g <= 12 ) \
+            m##x[d] = _mm_sha256msg1_epu32(m##x[d], m##x[a]); \
+    }
+
+#define SHANI_GROUP2(g, a, b, d) \
+    SHANI_GROUP(0, g, a, b, d) \
+    SHANI_GROUP(1, g, a, b, d)
+
+SHANI_TARGET
+static void shani_2(uint32_t* const* h, const uint8_t* const* pv, size_t blocks)
+{
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const uint8_t* p0 = pv[0];
+    const uint8_t* p1 = pv[1];
+    __m128i abef0, cdgh0, abef1, cdgh1;
+
+    shani_load(h[0], abef0, cdgh0);
+    shani_load(h[1], abef1, cdgh1);
+
+    for ( size_t n = 0; n < blocks; ++n )
+    {
+        __m128i save_abef0 = abef0, save_cdgh0 = cdgh0;
+        __m128i save_abef1 = abef1, save_cdgh1 = cdgh1;
+        __m128i m0[4], m1[4];
+
+        SHANI_GROUP2(0, 0, 1, 3);
+        SHANI_GROUP2(1, 1, 2, 0);
+        SHANI_GROUP2(2, 2, 3, 1);
+        SHANI_GROUP2(3, 3, 0, 2);
+        SHANI_GROUP2(4, 0, 1, 3);
+        SHANI_GROUP2(5, 1, 2, 0);
+        SHANI_GROUP2(6, 2, 3, 1);
+        SHANI_GROUP2(7, 3, 0, 2);
+        SHANI_GROUP2(8, 0, 1, 3);
+        SHANI_GROUP2(9, 1, 2, 0);
+        SHANI_GROUP2(10, 2, 3, 1);
+        SHANI_GROUP2(11, 3, 0, 2);
+        SHANI_GROUP2(12, 0, 1, 3);
+        SHANI_GROUP2(13, 1, 2, 0);
+        SHANI_GROUP2(14, 2, 3, 1);
+        SHANI_GROUP2(15, 3, 0, 2);
+
+        abef0 = _mm_add_epi32(abef0, save_abef0);
+        cdgh0 = _mm_add_epi32(cdgh0, save_cdgh0);
+        abef1 = _mm_add_epi32(abef1, save_abef1);
+        cdgh1 = _mm_add_epi32(cdgh1, save_cdgh1);
+
+        p0 += SHA256_BLOCK_SIZE;
+        p1 += SHA256_BLOCK_SIZE;
+    }
+
+    shani_store(h[0], abef0, cdgh0);
+    shani_store(h[1], abef1, cdgh1);
+}
+
+#undef SHANI_GROUP
+#undef SHANI_GROUP2
+#endif
+#endif
+
+//-------------------------------------------------------------------------
+// dispatch
+//-------------------------------------------------------------------------
+
+#define MAX_LANES 8
+
+struct KernelInfo
+{
+    Sha256Kernel kernel;
+    unsigned lanes;
+
+    // with fewer messages left than this it is faster to finish them one
+    // at a time
+    unsigned min_active;
+};
+
+static KernelInfo get_kernel(Sha256Isa isa)
+{
+    switch ( isa )
+    {
+#ifdef USE_SHA256_SIMD
+#ifdef USE_SHA256_SHANI
+    case SHA256_SHANI: return { shani_2, 2, 2 };
+#endif
+    case SHA256_AVX2: return { avx2_8, 8, 4 };
+    case SHA256_SSE2: return { sse2_4, 4, 3 };
+#endif
+    default: break;
+    }
+    return { single_1, 1, 2 };
+}
+
+bool sha256_isa_supported(Sha256Isa isa)
+{
+    switch ( isa )
+    {
+    case SHA256_SCALAR:
+        return true;
+
+#ifdef USE_SHA256_SIMD
+#ifdef USE_SHA256_SHANI
+    case SHA256_SHANI:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sha") and __builtin_cpu_supports("sse4.1");
+#endif
+    case SHA256_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+
+    case SHA256_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+static Sha256Isa get_cpu_isa()
+{
+    for ( int i = SHA256_ISA_MAX - 1; i > SHA256_SCALAR; --i )
+    {
+        if ( sha256_isa_supported((Sha256Isa)i) )
+            return (Sha256Isa)i;
+    }
+    return SHA256_SCALAR;
+}
+
+Sha256Isa sha256_isa = get_cpu_isa();
+
+const char* sha256_isa_name(Sha256Isa isa)
+{ return (isa < SHA256_ISA_MAX) ? isa_names[isa] : "unknown"; }
+
+unsigned sha256_lanes()
+{ return get_kernel(sha256_isa).lanes; }
+
+//-------------------------------------------------------------------------
+// multiple messages
+//-------------------------------------------------------------------------
+
+namespace
+{
+struct Lane
+{
+    Sha256Ctx* ctx;
+    const Sha256Seg* seg;
+    const Sha256Seg* end;
+    size_t off;
+
+    // the next blocks to compress; either in the current segment or one
+    // block assembled in ctx->buf from the ends of segments
+    const uint8_t* run;
+    size_t blocks;
+
+    void start(const Sha256Stream& s)
+    {
+        ctx = s.ctx;
+        seg = s.segs;
+        end = s.segs + s.count;
+        off = 0;
+    }
+
+    void skip(size_t n)
+    {
+        off += n;
+
+        if ( off == seg->size )
+        {
+            ++seg;
+            off = 0;
+        }
+    }
+
+    // false when the stream is done; any partial block is left in ctx->buf
+    bool feed()
+    {
+        while ( seg != end )
+        {
+            if ( !seg->size )
+            {
+                ++seg;
+                continue;
+            }
+            const uint8_t* p = seg->data + off;
+            size_t n = seg->size - off;
+            unsigned used = ctx->bytes % SHA256_BLOCK_SIZE;
+
+            if ( !used and n >= SHA256_BLOCK_SIZE )
+            {
+                run = p;
+                blocks = n / SHA256_BLOCK_SIZE;
+                return true;
+            }
+            size_t take = std::min(n, (size_t)(SHA256_BLOCK_SIZE - used));
+            memcpy(ctx->buf + used, p, take);
+            ctx->bytes += take;
+            skip(take);
+
+            if ( used + take == SHA256_BLOCK_SIZE )
+            {
+                run = ctx->buf;
+                blocks = 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // after compressing n blocks of the run
+    void consume(size_t n)
+    {
+        if ( run == ctx->buf )
+            return;
+
+        ctx->bytes += n * SHA256_BLOCK_SIZE;
+        skip(n * SHA256_BLOCK_SIZE);
+    }
+};
+}
+
+void sha256_update_mb(const Sha256Stream* streams, unsigned count)
+{
+    KernelInfo ki = get_kernel(sha256_isa);
+    assert(ki.lanes <= MAX_LANES);
+
+    Lane lanes[MAX_LANES];
+    unsigned active = 0;
+    unsigned next = 0;
+
+    uint32_t spare[8];
+    uint32_t* h[MAX_LANES];
+    const uint8_t* p[MAX_LANES];
+
+    while ( true )
+    {
+        while ( active < ki.lanes and next < count )
+        {
+            lanes[active].start(streams[next++]);
+
+            if ( lanes[active].feed() )
+                ++active;
+        }
+
+        if ( !active )
+            break;
+
+        if ( active < ki.min_active )
+        {
+            // too few to fill the lanes so finish these alone
+            for ( unsigned i = 0; i < active; ++i )
+            {
+                Lane& l = lanes[i];
+
+                do
+                {
+                    compress(l.ctx->h, l.run, l.blocks);
+                    l.consume(l.blocks);
+                }
+                while ( l.feed() );
+            }
+            active = 0;
+            continue;
+        }
+
+        size_t blocks = lanes[0].blocks;
+
+        for ( unsigned i = 1; i < active; ++i )
+            blocks = std::min(blocks, lanes[i].blocks);
+
+        // idle lanes hash a copy of lane 0 into scratch
+        for ( unsigned i = 0; i < ki.lanes; ++i )
+        {
+            h[i] = (i < active) ? lanes[i].ctx->h : spare;
+            p[i] = (i < active) ? lanes[i].run : lanes[0].run;
+        }
+
+        ki.kernel(h, p, blocks);
+
+        for ( unsigned i = 0; i < active; )
+        {
+            Lane& l = lanes[i];
+            l.consume(blocks);
+
+            if ( l.blocks > blocks and l.run != l.ctx->buf )
+            {
+                l.run += blocks * SHA256_BLOCK_SIZE;
+                l.blocks -= blocks;
+                ++i;
+            }
+            else if ( l.feed() )
+                ++i;
+
+            else
+                l = lanes[--active];
+        }
+    }
+}
+}
+
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// sha256_mb.h
+
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+
+// sha256 with a context that can be advanced for several messages at once.
+// sha256_update_mb() compresses one block from each of up to 8 messages
+// per step, one message per 32 bit lane of an sse2 or avx2 register, or
+// two interleaved messages with the sha extensions, so throughput grows
+// with the number of messages in the batch instead of being bound by the
+// latency of one message's rounds.  single messages go through openssl's
+// block function, which is what SHA256_Update() uses.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "main/snort_types.h"
+
+namespace snort
+{
+#define SHA256_BLOCK_SIZE 64
+
+struct Sha256Ctx
+{
+    uint32_t h[8];
+    uint64_t bytes;
+    uint8_t buf[SHA256_BLOCK_SIZE];
+};
+
+SO_PUBLIC void sha256_init(Sha256Ctx&);
+SO_PUBLIC void sha256_update(Sha256Ctx&, const uint8_t* data, size_t size);
+
+// digest must be SHA256_HASH_SIZE bytes; the context is not changed so it
+// may be updated further
+SO_PUBLIC void sha256_final(const Sha256Ctx&, uint8_t* digest);
+
+struct Sha256Seg
+{
+    const uint8_t* data;
+    size_t size;
+};
+
+// the message data to add to one context, in order
+struct Sha256Stream
+{
+    Sha256Ctx* ctx;
+    const Sha256Seg* segs;
+    unsigned count;
+};
+
+// same result as calling sha256_update() for each segment of each stream.
+// each stream must have its own context.
+SO_PUBLIC void sha256_update_mb(const Sha256Stream*, unsigned count);
+
+enum Sha256Isa { SHA256_SCALAR, SHA256_SSE2, SHA256_AVX2, SHA256_SHANI, SHA256_ISA_MAX };
+
+// best kernel to use; set from the cpu at startup and may be lowered to
+// check the others
+extern SO_PUBLIC Sha256Isa sha256_isa;
+
+SO_PUBLIC bool sha256_isa_supported(Sha256Isa);
+SO_PUBLIC const char* sha256_isa_name(Sha256Isa);
+
+// number of messages a sha256_update_mb() step advances together
+SO_PUBLIC unsigned sha256_lanes();
+}
+#endif
+
@@ -0,0 +1,431 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// bucket_hash_test.cc
+// unit tests for BucketHash and lookup benchmark against ZHash
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hash/bucket_hash.h"
+#include "hash/hashfcn.h"
+#include "hash/zhash.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#include <cstdio>
+#endif
+
+#include "main/snort_config.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+// Stubs whose sole purpose is to make the test code link
+static SnortConfig my_config;
+THREAD_LOCAL SnortConfig *snort_conf = &my_config;
+
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ snort_conf->run_flags = 0;} // run_flags is used indirectly from HashFnc class by calling SnortConfig::static_hash()
+
+SnortConfig::~SnortConfig() = default;
+
+SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+// same size and hash as FlowKey
+struct TestKey
+{
+    uint32_t w[12];
+};
+
+static unsigned test_key_hash(HashFnc* hf, const unsigned char* p, int)
+{
+    uint32_t a, b, c;
+    a = b = c = hf->hardener;
+
+    const uint32_t* d = (const uint32_t*)p;
+
+    a += d[0]; b += d[1]; c += d[2];
+    mix(a, b, c);
+    a += d[3]; b += d[4]; c += d[5];
+    mix(a, b, c);
+    a += d[6]; b += d[7]; c += d[8];
+    mix(a, b, c);
+    a += d[9]; b += d[10]; c += d[11];
+    finalize(a, b, c);
+
+    return c;
+}
+
+static int test_key_cmp(const void* s1, const void* s2, size_t n)
+{ return memcmp(s1, s2, n); }
+
+static void make_key(TestKey& k, unsigned i)
+{
+    memset(&k, 0, sizeof(k));
+    k.w[3] = 0x0a000000 + i;
+    k.w[7] = 0xc0a80000 + (i >> 16);
+    k.w[9] = (i & 0xFFFF) << 16 | 80;
+}
+
+static void fill_nodes(LruHashTable& ht, std::vector<unsigned>& data)
+{
+    for ( auto& d : data )
+        ht.push(&d);
+}
+
+TEST_GROUP(bucket_hash)
+{
+};
+
+TEST(bucket_hash, get_find_remove)
+{
+    const unsigned n = 100;
+    std::vector<unsigned> data(n);
+    BucketHash ht(n, sizeof(TestKey));
+    ht.set_keyops(test_key_hash, test_key_cmp);
+    fill_nodes(ht, data);
+
+    TestKey k;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        bool new_node = false;
+        make_key(k, i);
+        auto p = (unsigned*)ht.get(&k, &new_node);
+        CHECK(p != nullptr);
+        CHECK(new_node);
+        *p = i;
+    }
+    CHECK(ht.get_count() == n);
+
+    // no more free nodes
+    make_key(k, n);
+    CHECK(ht.get(&k) == nullptr);
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        bool new_node = false;
+        make_key(k, i);
+        auto p = (unsigned*)ht.get(&k, &new_node);
+        CHECK(p != nullptr and *p == i);
+        CHECK(!new_node);
+        CHECK(ht.find(&k) == p);
+    }
+
+    for ( unsigned i = 0; i < n; i += 2 )
+    {
+        make_key(k, i);
+        CHECK(ht.remove(&k));
+        CHECK(!ht.remove(&k));
+        CHECK(ht.find(&k) == nullptr);
+    }
+    CHECK(ht.get_count() == n / 2);
+
+    for ( unsigned i = 1; i < n; i += 2 )
+    {
+        make_key(k, i);
+        auto p = (unsigned*)ht.find(&k);
+        CHECK(p != nullptr and *p == i);
+    }
+
+    unsigned popped = 0;
+    while ( ht.pop() )
+        ++popped;
+    CHECK(popped == n / 2);
+}
+
+TEST(bucket_hash, lru_order)
+{
+    const unsigned n = 8;
+    std::vector<unsigned> data(n);
+    BucketHash ht(n, sizeof(TestKey));
+    ht.set_keyops(test_key_hash, test_key_cmp);
+    fill_nodes(ht, data);
+
+    TestKey k;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        make_key(k, i);
+        *(unsigned*)ht.get(&k) = i;
+    }
+
+    // 0 was added first so it is the oldest until touched by find
+    CHECK(*(unsigned*)ht.first() == 0);
+    make_key(k, 0);
+    ht.find(&k);
+    CHECK(*(unsigned*)ht.first() == 1);
+    CHECK(*(unsigned*)ht.next() == 2);
+    CHECK(*(unsigned*)ht.current() == 2);
+
+    // touch moves 2 to the front and the cursor to 3
+    CHECK(ht.touch());
+    CHECK(*(unsigned*)ht.current() == 3);
+
+    // remove at cursor
+    CHECK(ht.remove());
+    CHECK(ht.get_count() == n - 1);
+    make_key(k, 3);
+    CHECK(ht.find(&k) == nullptr);
+
+    unsigned expect[] = { 1, 4, 5, 6, 7, 0, 2 };
+    unsigned i = 0;
+
+    for ( auto p = (unsigned*)ht.first(); p; p = (unsigned*)ht.next() )
+    {
+        CHECK(i < n - 1);
+        CHECK(*p == expect[i++]);
+    }
+    CHECK(i == n - 1);
+}
+
+TEST(bucket_hash, prefetch)
+{
+    const unsigned n = 16;
+    std::vector<unsigned> data(n);
+    BucketHash ht(n, sizeof(TestKey));
+    ht.set_keyops(test_key_hash, test_key_cmp);
+    fill_nodes(ht, data);
+
+    TestKey k;
+    make_key(k, 1);
+    void* one = ht.get(&k);
+    make_key(k, 2);
+    void* two = ht.get(&k);
+
+    // prefetch is only a hint; nothing is added and the lru order is unchanged
+    make_key(k, 1);
+    ht.prefetch(&k);
+    make_key(k, 3);
+    ht.prefetch(&k);
+
+    CHECK(ht.get_count() == 2);
+    CHECK(ht.first() == one);
+    CHECK(ht.next() == two);
+    CHECK(ht.find(&k) == nullptr);
+}
+
+// same operations on both tables must give the same results
+TEST(bucket_hash, matches_zhash)
+{
+    const unsigned n = 4096;
+    std::vector<unsigned> zdata(n), bdata(n);
+
+    ZHash zh(n, sizeof(TestKey));
+    zh.set_keyops(test_key_hash, test_key_cmp);
+    fill_nodes(zh, zdata);
+
+    BucketHash bh(n, sizeof(TestKey));
+    bh.set_keyops(test_key_hash, test_key_cmp);
+    fill_nodes(bh, bdata);
+
+    TestKey k;
+    uint32_t seed = 12345;
+
+    for ( unsigned op = 0; op < 200000; ++op )
+    {
+        seed = seed * 1664525 + 1013904223;
+        make_key(k, (seed >> 8) % (2 * n));
+
+        switch ( (seed >> 28) & 3 )
+        {
+        case 0:
+        case 1:
+        {
+            bool zn = false, bn = false;
+            bool zok = zh.get(&k, &zn) != nullptr;
+            bool bok = bh.get(&k, &bn) != nullptr;
+            CHECK(zok == bok);
+            CHECK(zn == bn);
+            break;
+        }
+        case 2:
+            CHECK((zh.find(&k) != nullptr) == (bh.find(&k) != nullptr));
+            break;
+        case 3:
+            CHECK(zh.remove(&k) == bh.remove(&k));
+            break;
+        }
+        CHECK(zh.get_count() == bh.get_count());
+
+        // keep some room
+        if ( zh.get_count() > n - 16 )
+        {
+            zh.first();
+            bh.first();
+            CHECK(zh.remove() == bh.remove());
+        }
+    }
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// lookups/sec with the table full and random access to all keys
+//--------------------------------------------------------------------------
+
+static double lookup_rate(LruHashTable& ht, unsigned n, unsigned lookups)
+{
+    std::vector<unsigned> data(n);
+    fill_nodes(ht, data);
+
+    TestKey k;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        make_key(k, i);
+        ht.get(&k);
+    }
+
+    uint32_t seed = 777;
+    unsigned found = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned i = 0; i < lookups; ++i )
+    {
+        seed = seed * 1664525 + 1013904223;
+        make_key(k, seed % n);
+
+        if ( ht.find(&k) )
+            ++found;
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    CHECK(found == lookups);
+
+    while ( ht.pop() );
+    return lookups / secs.count();
+}
+
+TEST_GROUP(bucket_hash_benchmark)
+{
+};
+
+TEST(bucket_hash_benchmark, lookups)
+{
+    const unsigned lookups = 4000000;
+    const unsigned sizes[] = { 1 << 20, 1 << 22, 1 << 24 };
+
+    printf("\n%10s %16s %16s %8s\n", "flows", "zhash lookup/s", "bucket lookup/s", "speedup");
+
+    for ( auto n : sizes )
+    {
+        double z, b;
+        {
+            ZHash zh(n, sizeof(TestKey));
+            zh.set_keyops(test_key_hash, test_key_cmp);
+            z = lookup_rate(zh, n, lookups);
+        }
+        {
+            BucketHash bh(n, sizeof(TestKey));
+            bh.set_keyops(test_key_hash, test_key_cmp);
+            b = lookup_rate(bh, n, lookups);
+        }
+        printf("%10u %16.0f %16.0f %8.2f\n", n, z, b, b / z);
+    }
+}
+
+//--------------------------------------------------------------------------
+// batched lookups prefetching depth keys ahead like the analyzer does with
+// a receive batch
+//--------------------------------------------------------------------------
+
+static double batch_rate(LruHashTable& ht, unsigned n, unsigned lookups, unsigned depth)
+{
+    const unsigned batch = 64;
+    std::vector<TestKey> keys(batch);
+    uint32_t seed = 777;
+    unsigned found = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned i = 0; i < lookups; i += batch )
+    {
+        for ( auto& k : keys )
+        {
+            seed = seed * 1664525 + 1013904223;
+            make_key(k, seed % n);
+        }
+        for ( unsigned j = 0; j < depth; ++j )
+            ht.prefetch(&keys[j]);
+
+        for ( unsigned j = 0; j < batch; ++j )
+        {
+            if ( depth and j + depth < batch )
+                ht.prefetch(&keys[j + depth]);
+
+            if ( ht.find(&keys[j]) )
+                ++found;
+        }
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    CHECK(found == lookups);
+    return lookups / secs.count();
+}
+
+static void fill_table(LruHashTable& ht, std::vector<unsigned>& data)
+{
+    fill_nodes(ht, data);
+    TestKey k;
+
+    for ( unsigned i = 0; i < data.size(); ++i )
+    {
+        make_key(k, i);
+        ht.get(&k);
+    }
+}
+
+TEST(bucket_hash_benchmark, prefetch)
+{
+    const unsigned n = 1 << 22;
+    const unsigned lookups = 4000000;
+    const unsigned depths[] = { 0, 2, 4, 8, 16 };
+
+    std::vector<unsigned> zdata(n), bdata(n);
+
+    ZHash zh(n, sizeof(TestKey));
+    zh.set_keyops(test_key_hash, test_key_cmp);
+    fill_table(zh, zdata);
+
+    BucketHash bh(n, sizeof(TestKey));
+    bh.set_keyops(test_key_hash, test_key_cmp);
+    fill_table(bh, bdata);
+
+    printf("\n%10s %16s %16s\n", "depth", "zhash lookup/s", "bucket lookup/s");
+
+    for ( auto d : depths )
+    {
+        double z = batch_rate(zh, n, lookups, d);
+        double b = batch_rate(bh, n, lookups, d);
+        printf("%10u %16.0f %16.0f\n", d, z, b);
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
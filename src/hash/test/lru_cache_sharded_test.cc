@@ -0,0 +1,237 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lru_cache_sharded_test.cc
+// unit tests and contention benchmark for LruCacheSharded class
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hash/lru_cache_sharded.h"
+
+#include <cstring>
+#include <string>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#endif
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+typedef LruCacheSharded<int, std::string, std::hash<int> > ShardedCache;
+
+TEST_GROUP(lru_cache_sharded)
+{
+};
+
+//  Test LruCacheSharded constructor and member access.
+TEST(lru_cache_sharded, constructor_test)
+{
+    ShardedCache lru_cache(5);
+
+    CHECK(lru_cache.get_max_size() == 5);
+    CHECK(lru_cache.size() == 0);
+    CHECK(lru_cache.get_num_shards() == ShardedCache::default_shards);
+
+    ShardedCache one_shard(5, 0);
+    CHECK(one_shard.get_num_shards() == 1);
+}
+
+//  Test find, operator[] and get_all_data ordering across shards.
+TEST(lru_cache_sharded, insert_test)
+{
+    ShardedCache lru_cache(3);
+
+    auto data = lru_cache[0];
+    CHECK(data == lru_cache.find(0));
+    data->assign("zero");
+
+    data = lru_cache[1];
+    CHECK(data == lru_cache.find(1));
+    data->assign("one");
+
+    data = lru_cache[2];
+    CHECK(data == lru_cache.find(2));
+    data->assign("two");
+
+    auto vec = lru_cache.get_all_data();
+    CHECK(3 == vec.size());
+    CHECK(vec[0].first == 2 and *vec[0].second == "two");
+    CHECK(vec[1].first == 1 and *vec[1].second == "one");
+    CHECK(vec[2].first == 0 and *vec[2].second == "zero");
+
+    //  Touch the oldest entry, then add a new one; 1 is now the oldest.
+    CHECK(lru_cache.find(0) != nullptr);
+    bool new_data = false;
+    data = lru_cache.find_else_create(3, &new_data);
+    CHECK(new_data);
+
+    CHECK(lru_cache.size() == 3);
+    CHECK(lru_cache.find(1) == nullptr);
+
+    vec = lru_cache.get_all_data();
+    CHECK(3 == vec.size());
+    CHECK(vec[0].first == 3);
+    CHECK(vec[1].first == 0 and *vec[1].second == "zero");
+    CHECK(vec[2].first == 2 and *vec[2].second == "two");
+}
+
+//  Test that eviction is in global LRU order even with one entry per shard.
+TEST(lru_cache_sharded, prune_order_test)
+{
+    ShardedCache lru_cache(100);
+
+    for (int i = 0; i < 64; i++)
+        lru_cache[i];
+
+    for (int i = 0; i < 64; i += 2)
+        lru_cache.find(i);
+
+    CHECK(lru_cache.set_max_size(32) == true);
+    CHECK(lru_cache.size() == 32);
+
+    for (int i = 0; i < 64; i++)
+    {
+        if ( i % 2 )
+            CHECK(lru_cache.find(i) == nullptr);
+        else
+            CHECK(lru_cache.find(i) != nullptr);
+    }
+}
+
+//  Test statistics counters; same expectations as LruCacheShared.
+TEST(lru_cache_sharded, stats_test)
+{
+    ShardedCache lru_cache(5);
+
+    for (int i = 0; i < 10; i++)
+        lru_cache[i];
+
+    lru_cache.find(7);     //  Hits
+    lru_cache.find(8);
+    lru_cache.find(9);
+
+    lru_cache.find(10);    //  Misses; in addition to previous 10
+    lru_cache.find(11);
+
+    CHECK(lru_cache.set_max_size(3) == true); // change size prunes; in addition to previous 5
+
+    lru_cache.remove(7);    // Removes - hit
+    lru_cache.remove(10);   // Removes - miss
+
+    lru_cache.lock();
+    PegCount* stats = lru_cache.get_counts();
+    lru_cache.unlock();
+
+    CHECK(stats[0] == 10);  //  adds
+    CHECK(stats[1] == 7);   //  prunes
+    CHECK(stats[2] == 3);   //  find hits
+    CHECK(stats[3] == 12);  //  find misses
+    CHECK(stats[4] == 1);   //  removes
+
+    const PegInfo* pegs = lru_cache.get_pegs();
+    CHECK(!strcmp(pegs[0].name, "lru_cache_adds"));
+    CHECK(!strcmp(pegs[4].name, "lru_cache_removes"));
+}
+
+//  Test remove functions.
+TEST(lru_cache_sharded, remove_test)
+{
+    std::shared_ptr<std::string> data;
+    ShardedCache lru_cache(5);
+
+    for (int i = 0; i < 5; i++)
+    {
+        lru_cache[i];
+        CHECK(lru_cache.remove(i) == true);
+        CHECK(lru_cache.remove(i) == false);
+    }
+    CHECK(lru_cache.size() == 0);
+
+    auto found = lru_cache[42];
+    found->assign("forty-two");
+    CHECK(lru_cache.remove(42, data) == true);
+    CHECK(data != nullptr and *data == "forty-two");
+    CHECK(lru_cache.remove(42, data) == false);
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// contention benchmark: 1..32 threads hammering find_else_create() on a
+// hot working set that fits in the cache plus some misses to force prunes
+//--------------------------------------------------------------------------
+
+template<typename Cache>
+static double run_contention(Cache& cache, unsigned num_threads, unsigned ops_per_thread)
+{
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned t = 0; t < num_threads; ++t )
+    {
+        threads.emplace_back([&cache, t, ops_per_thread]()
+        {
+            uint32_t seed = 0x9e3779b9 * (t + 1);
+
+            for ( unsigned i = 0; i < ops_per_thread; ++i )
+            {
+                seed = seed * 1664525 + 1013904223;
+                cache.find_else_create((int)(seed >> 12) % 65536, nullptr);
+            }
+        });
+    }
+    for ( auto& th : threads )
+        th.join();
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return (num_threads * (double)ops_per_thread) / secs.count();
+}
+
+TEST_GROUP(lru_cache_sharded_benchmark)
+{
+};
+
+TEST(lru_cache_sharded_benchmark, contention)
+{
+    const unsigned ops = 200000;
+
+    printf("\n%8s %16s %16s %8s\n", "threads", "shared ops/s", "sharded ops/s", "speedup");
+
+    for ( unsigned n = 1; n <= 32; n *= 2 )
+    {
+        LruCacheShared<int, std::string, std::hash<int> > shared(32768);
+        ShardedCache sharded(32768);
+
+        double a = run_contention(shared, n, ops);
+        double b = run_contention(sharded, n, ops);
+
+        printf("%8u %16.0f %16.0f %8.2f\n", n, a, b, b / a);
+        CHECK(sharded.size() <= 32768);
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,370 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+
+// sha256_mb_test.cc
+// unit tests for multi-buffer sha256 and throughput benchmark against openssl
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hash/hashes.h"
+#include "hash/sha256_mb.h"
+
+#include <openssl/sha.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#include <cstdio>
+#endif
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+// cut size bytes into segments of random length no more than max
+static void make_segs(const std::vector<uint8_t>& data, size_t max, std::mt19937& gen,
+    std::vector<Sha256Seg>& segs)
+{
+    size_t off = 0;
+
+    while ( off < data.size() )
+    {
+        size_t n = std::min(data.size() - off, (size_t)(gen() % (max + 1)));
+        segs.push_back({ data.data() + off, n });
+        off += n;
+    }
+}
+
+static void random_data(std::vector<uint8_t>& data, size_t size, std::mt19937& gen)
+{
+    data.resize(size);
+
+    for ( auto& b : data )
+        b = (uint8_t)gen();
+}
+
+static void check_digest(const Sha256Ctx& c, const std::vector<uint8_t>& data)
+{
+    uint8_t expect[SHA256_HASH_SIZE];
+    uint8_t digest[SHA256_HASH_SIZE];
+
+    SHA256(data.data(), data.size(), expect);
+    sha256_final(c, digest);
+
+    MEMCMP_EQUAL(expect, digest, sizeof(digest));
+}
+
+//--------------------------------------------------------------------------
+// one message
+//--------------------------------------------------------------------------
+
+TEST_GROUP(sha256_single)
+{
+};
+
+TEST(sha256_single, lengths)
+{
+    std::mt19937 gen(1);
+    std::vector<uint8_t> data;
+
+    for ( size_t n = 0; n < 300; ++n )
+    {
+        random_data(data, n, gen);
+
+        Sha256Ctx c;
+        sha256_init(c);
+        sha256_update(c, data.data(), data.size());
+
+        check_digest(c, data);
+    }
+}
+
+TEST(sha256_single, segments)
+{
+    std::mt19937 gen(2);
+    std::vector<uint8_t> data;
+
+    for ( unsigned i = 0; i < 100; ++i )
+    {
+        random_data(data, gen() % 5000, gen);
+        std::vector<Sha256Seg> segs;
+        make_segs(data, 200, gen, segs);
+
+        Sha256Ctx c;
+        sha256_init(c);
+
+        for ( auto& s : segs )
+            sha256_update(c, s.data, s.size);
+
+        check_digest(c, data);
+    }
+}
+
+TEST(sha256_single, final_keeps_context)
+{
+    std::vector<uint8_t> data(1000, 'x');
+    Sha256Ctx c;
+    sha256_init(c);
+    sha256_update(c, data.data(), 500);
+
+    std::vector<uint8_t> half(data.begin(), data.begin() + 500);
+    check_digest(c, half);
+
+    sha256_update(c, data.data() + 500, 500);
+    check_digest(c, data);
+}
+
+//--------------------------------------------------------------------------
+// many messages with each kernel
+//--------------------------------------------------------------------------
+
+static void check_mb(Sha256Isa isa, unsigned seed, unsigned count, size_t max_size, size_t max_seg)
+{
+    Sha256Isa save = sha256_isa;
+    sha256_isa = isa;
+
+    std::mt19937 gen(seed);
+    std::vector<std::vector<uint8_t>> data(count);
+    std::vector<std::vector<Sha256Seg>> segs(count);
+    std::vector<Sha256Ctx> ctx(count);
+    std::vector<Sha256Stream> streams;
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        random_data(data[i], gen() % (max_size + 1), gen);
+
+        // start some contexts part way through a block
+        size_t pre = std::min(data[i].size(), (size_t)(gen() % 100));
+        sha256_init(ctx[i]);
+        sha256_update(ctx[i], data[i].data(), pre);
+
+        std::vector<uint8_t> rest(data[i].begin() + pre, data[i].end());
+        size_t off = pre;
+
+        make_segs(rest, max_seg, gen, segs[i]);
+
+        for ( auto& s : segs[i] )
+        {
+            s.data = data[i].data() + off;
+            off += s.size;
+        }
+        streams.push_back({ &ctx[i], segs[i].data(), (unsigned)segs[i].size() });
+    }
+
+    sha256_update_mb(streams.data(), streams.size());
+
+    for ( unsigned i = 0; i < count; ++i )
+        check_digest(ctx[i], data[i]);
+
+    sha256_isa = save;
+}
+
+TEST_GROUP(sha256_mb)
+{
+};
+
+TEST(sha256_mb, kernels)
+{
+    for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+    {
+        Sha256Isa isa = (Sha256Isa)i;
+
+        if ( !sha256_isa_supported(isa) )
+            continue;
+
+        for ( unsigned count = 0; count <= 20; ++count )
+        {
+            check_mb(isa, count, count, 2000, 1500);
+            check_mb(isa, count + 100, count, 10000, 70);
+        }
+    }
+}
+
+TEST(sha256_mb, empty_segments)
+{
+    uint8_t data[128] = { };
+    Sha256Seg segs[] = { { data, 0 }, { data, 64 }, { data, 0 }, { data + 64, 64 } };
+    Sha256Ctx c[2];
+    Sha256Stream streams[] = { { &c[0], segs, 4 }, { &c[1], segs, 0 } };
+
+    sha256_init(c[0]);
+    sha256_init(c[1]);
+    sha256_update_mb(streams, 2);
+
+    check_digest(c[0], std::vector<uint8_t>(data, data + 128));
+    check_digest(c[1], std::vector<uint8_t>());
+}
+
+TEST(sha256_mb, uneven_lengths)
+{
+    // one long message and several short ones so lanes go idle
+    for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+    {
+        Sha256Isa isa = (Sha256Isa)i;
+
+        if ( !sha256_isa_supported(isa) )
+            continue;
+
+        Sha256Isa save = sha256_isa;
+        sha256_isa = isa;
+
+        std::mt19937 gen(7);
+        std::vector<std::vector<uint8_t>> data(9);
+        Sha256Ctx ctx[9];
+        Sha256Seg segs[9];
+        Sha256Stream streams[9];
+
+        for ( unsigned j = 0; j < 9; ++j )
+        {
+            random_data(data[j], j ? 64 * j + 3 : 100000, gen);
+            sha256_init(ctx[j]);
+            segs[j] = { data[j].data(), data[j].size() };
+            streams[j] = { &ctx[j], &segs[j], 1 };
+        }
+        sha256_update_mb(streams, 9);
+
+        for ( unsigned j = 0; j < 9; ++j )
+            check_digest(ctx[j], data[j]);
+
+        sha256_isa = save;
+    }
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// GB/s hashing files of the given size in packet sized segments
+//--------------------------------------------------------------------------
+
+struct BenchFiles
+{
+    BenchFiles(unsigned files, size_t size, size_t seg) : data(files), segs(files), ctx(files)
+    {
+        std::mt19937 gen(9);
+
+        for ( unsigned i = 0; i < files; ++i )
+        {
+            random_data(data[i], size, gen);
+
+            for ( size_t off = 0; off < size; off += seg )
+                segs[i].push_back({ data[i].data() + off, std::min(seg, size - off) });
+        }
+    }
+
+    size_t bytes() const
+    { return data.size() * data[0].size(); }
+
+    std::vector<std::vector<uint8_t>> data;
+    std::vector<std::vector<Sha256Seg>> segs;
+    std::vector<Sha256Ctx> ctx;
+};
+
+// what FileContext did: each segment into its file's SHA256_CTX
+static double openssl_rate(BenchFiles& bf, unsigned reps)
+{
+    std::vector<SHA256_CTX> ctx(bf.data.size());
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned r = 0; r < reps; ++r )
+    {
+        for ( unsigned i = 0; i < bf.data.size(); ++i )
+        {
+            SHA256_Init(&ctx[i]);
+
+            for ( auto& s : bf.segs[i] )
+                SHA256_Update(&ctx[i], s.data, s.size);
+        }
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return bf.bytes() * reps / secs.count() / 1e9;
+}
+
+// all files at once, as the batches see them
+static double mb_rate(BenchFiles& bf, unsigned reps, Sha256Isa isa)
+{
+    Sha256Isa save = sha256_isa;
+    sha256_isa = isa;
+
+    std::vector<Sha256Stream> streams;
+
+    for ( unsigned i = 0; i < bf.data.size(); ++i )
+        streams.push_back({ &bf.ctx[i], bf.segs[i].data(), (unsigned)bf.segs[i].size() });
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned r = 0; r < reps; ++r )
+    {
+        for ( auto& c : bf.ctx )
+            sha256_init(c);
+
+        sha256_update_mb(streams.data(), streams.size());
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+    for ( unsigned i = 0; i < bf.data.size(); ++i )
+        check_digest(bf.ctx[i], bf.data[i]);
+
+    sha256_isa = save;
+    return bf.bytes() * reps / secs.count() / 1e9;
+}
+
+TEST_GROUP(sha256_mb_benchmark)
+{
+};
+
+TEST(sha256_mb_benchmark, throughput)
+{
+    const unsigned files[] = { 1, 2, 4, 8, 16 };
+    const size_t size = 1 << 20;
+    const size_t seg = 1460;
+
+    printf("\n%6s %9s", "files", "openssl");
+
+    for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+        if ( sha256_isa_supported((Sha256Isa)i) )
+            printf(" %9s", sha256_isa_name((Sha256Isa)i));
+
+    printf("   (GB/s, 1 MB files in %zu byte segments)\n", seg);
+
+    for ( auto n : files )
+    {
+        BenchFiles bf(n, size, seg);
+        unsigned reps = 64 / n;
+
+        printf("%6u %9.2f", n, openssl_rate(bf, reps));
+
+        for ( int i = SHA256_SCALAR; i < SHA256_ISA_MAX; ++i )
+            if ( sha256_isa_supported((Sha256Isa)i) )
+                printf(" %9.2f", mb_rate(bf, reps, (Sha256Isa)i));
+
+        printf("\n");
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
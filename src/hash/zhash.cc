@@ -348,6 +348,14 @@ void* ZHash::find(const void* key)
     return nullptr;
 }
 
+void ZHash::prefetch(const void* key)
+{
+    unsigned hashkey = hashfcn->hash_fcn(
+        hashfcn, (const unsigned char*)key, keysize);
+
+    __builtin_prefetch(table + (hashkey & (nrows - 1)));
+}
+
 void* ZHash::first()
 {
     cursor = gtail;
@@ -22,37 +22,39 @@
 
 #include <cstddef>
 
-struct HashFnc;
+#include "hash/lru_hash_table.h"
+
 struct ZHashNode;
 
-class ZHash
+class ZHash : public LruHashTable
 {
 public:
     ZHash(int nrows, int keysize);
-    ~ZHash();
+    ~ZHash() override;
 
     ZHash(const ZHash&) = delete;
     ZHash& operator=(const ZHash&) = delete;
 
-    void* push(void* p);
-    void* pop();
+    void* push(void* p) override;
+    void* pop() override;
 
-    void* first();
-    void* next();
-    void* current();
-    bool touch();
+    void* first() override;
+    void* next() override;
+    void* current() override;
+    bool touch() override;
 
-    void* find(const void* key);
-    void* get(const void* key, bool *new_node = nullptr);
+    void* find(const void* key) override;
+    void* get(const void* key, bool *new_node = nullptr) override;
+    void prefetch(const void* key) override;
 
-    bool remove(const void* key);
-    bool remove();
+    bool remove(const void* key) override;
+    bool remove() override;
 
-    inline unsigned get_count() { return count; }
+    unsigned get_count() override { return count; }
 
     int set_keyops(
         unsigned (* hash_fcn)(HashFnc* p, const unsigned char* d, int n),
-        int (* keycmp_fcn)(const void* s1, const void* s2, size_t n));
+        int (* keycmp_fcn)(const void* s1, const void* s2, size_t n)) override;
 
 private:
     ZHashNode* get_free_node();
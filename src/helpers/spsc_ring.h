@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// spsc_ring.h
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+// lock free ring for passing items from exactly one producer thread to
+// exactly one consumer thread.  the producer only writes tail and the
+// consumer only writes head, each on its own cache line; the release /
+// acquire pairs publish the slot contents.  unlike Ring, this is safe
+// between threads (Ring is for signal handlers on the same thread).
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T>
+class SpscRing
+{
+public:
+    // capacity is rounded up to a power of 2
+    SpscRing(size_t size);
+    ~SpscRing();
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer side; false if full
+    bool push(const T&);
+
+    // consumer side; false if empty
+    bool pop(T&);
+
+    // approximate unless called from the producer or consumer
+    size_t count() const;
+
+    bool empty() const
+    { return !count(); }
+
+    size_t capacity() const
+    { return mask + 1; }
+
+private:
+    static const size_t line_size = 64;
+
+    // padded rather than aligned since c++11 new ignores over alignment
+    std::atomic<size_t> head;
+    char head_pad[line_size - sizeof(std::atomic<size_t>)];
+
+    std::atomic<size_t> tail;
+    char tail_pad[line_size - sizeof(std::atomic<size_t>)];
+
+    size_t mask;
+    T* store;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(size_t size) : head(0), tail(0)
+{
+    size_t n = 1;
+
+    while ( n < size )
+        n <<= 1;
+
+    mask = n - 1;
+    store = new T[n];
+}
+
+template <typename T>
+SpscRing<T>::~SpscRing()
+{
+    delete[] store;
+}
+
+template <typename T>
+bool SpscRing<T>::push(const T& v)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+
+    if ( t - head.load(std::memory_order_acquire) > mask )
+        return false;
+
+    store[t & mask] = v;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscRing<T>::pop(T& v)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+
+    if ( h == tail.load(std::memory_order_acquire) )
+        return false;
+
+    v = store[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t SpscRing<T>::count() const
+{
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+#endif
+
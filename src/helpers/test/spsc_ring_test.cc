@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// spsc_ring_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "helpers/spsc_ring.h"
+
+#include <thread>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(spsc_ring)
+{
+};
+
+TEST(spsc_ring, capacity)
+{
+    SpscRing<int> r3(3);
+    CHECK(r3.capacity() == 4);
+
+    SpscRing<int> r8(8);
+    CHECK(r8.capacity() == 8);
+}
+
+TEST(spsc_ring, fill_drain)
+{
+    SpscRing<int> ring(4);
+    int v = 0;
+
+    CHECK(ring.empty());
+    CHECK(!ring.pop(v));
+
+    for ( int i = 0; i < 4; ++i )
+        CHECK(ring.push(i));
+
+    CHECK(!ring.push(4));
+    CHECK(ring.count() == 4);
+
+    for ( int i = 0; i < 4; ++i )
+    {
+        CHECK(ring.pop(v));
+        CHECK(v == i);
+    }
+    CHECK(!ring.pop(v));
+    CHECK(ring.empty());
+}
+
+TEST(spsc_ring, wrap)
+{
+    SpscRing<unsigned> ring(2);
+    unsigned v = 0;
+
+    for ( unsigned i = 0; i < 100; ++i )
+    {
+        CHECK(ring.push(i));
+        CHECK(ring.pop(v));
+        CHECK(v == i);
+    }
+}
+
+// everything pushed by one thread is popped by the other in order
+TEST(spsc_ring, threads)
+{
+    const unsigned num = 100000;
+    SpscRing<unsigned> ring(16);
+
+    std::thread producer([&ring]()
+    {
+        for ( unsigned i = 0; i < num; )
+        {
+            if ( ring.push(i) )
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    unsigned expected = 0;
+    unsigned v;
+
+    while ( expected < num )
+    {
+        if ( !ring.pop(v) )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if ( v != expected )
+            break;
+        ++expected;
+    }
+    producer.join();
+
+    CHECK(expected == num);
+    CHECK(ring.empty());
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
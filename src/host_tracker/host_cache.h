@@ -26,7 +26,7 @@
 
 #include <cassert>
 
-#include "hash/lru_cache_shared.h"
+#include "hash/lru_cache_sharded.h"
 #include "host_cache_interface.h"
 #include "host_cache_allocator.h"
 #include "host_tracker.h"
@@ -47,20 +47,19 @@ struct HashIp
 };
 
 template<typename Key, typename Value, typename Hash>
-class LruCacheSharedMemcap : public LruCacheShared<Key, Value, Hash>, public HostCacheInterface
+class LruCacheSharedMemcap : public LruCacheSharded<Key, Value, Hash>, public HostCacheInterface
 {
 public:
-    using LruBase = LruCacheShared<Key, Value, Hash>;
+    using LruBase = LruCacheSharded<Key, Value, Hash>;
 
     LruCacheSharedMemcap() = delete;
     LruCacheSharedMemcap(const LruCacheSharedMemcap& arg) = delete;
     LruCacheSharedMemcap& operator=(const LruCacheSharedMemcap& arg) = delete;
 
-    LruCacheSharedMemcap(const size_t initial_size) : LruCacheShared<Key, Value, Hash>(initial_size) {}
+    LruCacheSharedMemcap(const size_t initial_size) : LruBase(initial_size) {}
 
     size_t mem_size() override
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
         return current_size;
     }
 
@@ -68,10 +67,9 @@ public:
     {
         if ( snort::SnortConfig::log_verbose() )
         {
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
-
             snort::LogLabel("host_cache");
-            snort::LogMessage("    memcap: %zu bytes\n", max_size);
+            snort::LogMessage("    memcap: %zu bytes\n", (size_t)max_size);
+            snort::LogMessage("    shards: %u\n", LruBase::get_num_shards());
         }
 
     }
@@ -82,7 +80,6 @@ public:
     using LruBase::current_size;
     using LruBase::max_size;
     using LruBase::mem_chunk;
-    using LruBase::cache_mutex;
 
     template <class T>
     friend class HostCacheAllocIp;
@@ -91,7 +88,8 @@ private:
 
     // Only the allocator calls this. The allocator, in turn, is called e.g.
     // from HostTracker::add_service(), which locks the host tracker
-    // but not the cache. Therefore, update() must lock the cache.
+    // but not the cache. The size is a global atomic, so no shard lock is
+    // needed except by prune(), which takes them one at a time.
     //
     // Note that any cache item object that is not yet owned by the cache
     // will increase / decrease the current_size of the cache any time it
@@ -108,13 +106,9 @@ private:
     void update(int size) override
     {
         // Same idea as in LruCacheShared::remove(), use shared pointers
-        // to hold the pruned data until after the cache is unlocked.
-        // Do not change the order of data and cache_lock, as the data must
-        // self destruct after cache_lock.
+        // to hold the pruned data until after the shards are unlocked.
         std::list<Data> data;
 
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
-
         if (size < 0)
             assert( current_size >= (size_t) -size );
         current_size += size;
@@ -122,7 +116,7 @@ private:
             LruBase::prune(data);
     }
 
-    // These get called only from within the LRU and assume the LRU is locked.
+    // These get called only from within the LRU, possibly under a shard lock.
     void increase_size() override
     {
         current_size += mem_chunk;
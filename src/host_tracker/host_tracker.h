@@ -117,6 +117,8 @@ private:
     // Only the host cache can create them ...
     template<class Key, class Value, class Hash>
     friend class LruCacheShared;
+    template<class Key, class Value, class Hash>
+    friend class LruCacheSharded;
 
     // ... and some unit tests. See Utest.h and UtestMacros.h in cpputest.
     friend class TEST_host_tracker_add_find_service_test_Test;
@@ -28,6 +28,7 @@
 #include "log/messages.h"
 #include "main/snort_config.h"
 #include "protocols/packet.h"
+#include "time/latency_histogram.h"
 #include "utils/stats.h"
 
 #include "latency_config.h"
@@ -43,6 +44,8 @@
 using namespace snort;
 
 static THREAD_LOCAL uint64_t elapsed = 0;
+static THREAD_LOCAL uint64_t elapsed_ticks = 0;
+static THREAD_LOCAL LatencyHistogram* histogram = nullptr;
 
 namespace packet_latency
 {
@@ -151,6 +154,7 @@ inline bool Impl<Clock>::pop(const Packet* p)
     }
 
     elapsed = clock_usecs(TO_USECS(timer.elapsed()));
+    elapsed_ticks = TO_TICKS(timer.elapsed());
 
     timers.pop_back();
     return timed_out;
@@ -240,6 +244,9 @@ void PacketLatency::pop(const Packet* p)
             latency_stats.max_usecs = elapsed;
 
         latency_stats.total_usecs += elapsed;
+
+        if ( histogram )
+            histogram->record(elapsed_ticks);
     }
 }
 
@@ -251,6 +258,9 @@ bool PacketLatency::fastpath()
     return false;
 }
 
+void PacketLatency::set_histogram(LatencyHistogram* h)
+{ histogram = h; }
+
 void PacketLatency::tterm()
 {
     using packet_latency::impl;
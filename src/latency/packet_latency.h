@@ -21,6 +21,10 @@
 #ifndef PACKET_LATENCY_H
 #define PACKET_LATENCY_H
 
+#include "main/snort_types.h"
+
+class LatencyHistogram;
+
 namespace snort
 {
 struct Packet;
@@ -35,6 +39,9 @@ public:
 
     static void tterm();
 
+    // packet thread owned; records each packet's elapsed ticks
+    SO_PUBLIC static void set_histogram(LatencyHistogram*);
+
     class Context
     {
     public:
@@ -30,6 +30,7 @@
 #include "main/snort_config.h"
 #include "log/messages.h"
 #include "protocols/packet.h"
+#include "time/latency_histogram.h"
 #include "utils/stats.h"
 
 #include "latency_config.h"
@@ -46,6 +47,9 @@
 
 using namespace snort;
 
+static THREAD_LOCAL uint64_t elapsed_ticks = 0;
+static THREAD_LOCAL LatencyHistogram* histogram = nullptr;
+
 namespace rule_latency
 {
 // -----------------------------------------------------------------------------
@@ -254,6 +258,8 @@ inline bool Impl<Clock, RuleTree>::pop()
         }
     }
 
+    elapsed_ticks = TO_TICKS(timer.elapsed());
+
     timers.pop_back();
     return timed_out;
 }
@@ -353,6 +359,9 @@ void RuleLatency::pop()
     {
         if ( rule_latency::get_impl().pop() )
             ++latency_stats.rule_eval_timeouts;
+
+        if ( histogram )
+            histogram->record(elapsed_ticks);
     }
 }
 
@@ -364,6 +373,9 @@ bool RuleLatency::suspended()
     return false;
 }
 
+void RuleLatency::set_histogram(LatencyHistogram* h)
+{ histogram = h; }
+
 void RuleLatency::tterm()
 {
     using rule_latency::impl;
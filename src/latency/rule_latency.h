@@ -21,6 +21,9 @@
 #ifndef RULE_LATENCY_H
 #define RULE_LATENCY_H
 
+#include "main/snort_types.h"
+
+class LatencyHistogram;
 struct detection_option_tree_root_t;
 namespace snort
 {
@@ -36,6 +39,9 @@ public:
 
     static void tterm();
 
+    // packet thread owned; records each rule tree evaluation's elapsed ticks
+    SO_PUBLIC static void set_histogram(LatencyHistogram*);
+
     class Context
     {
     public:
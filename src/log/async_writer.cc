@@ -0,0 +1,450 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// async_writer.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "async_writer.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "helpers/spsc_ring.h"
+#include "main/snort_config.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+// -----------------------------------------------------------------------------
+// stats
+// -----------------------------------------------------------------------------
+
+struct AsyncStats
+{
+    PegCount records;
+    PegCount drops;
+    PegCount blocks;
+    PegCount overflows;
+    PegCount depth;
+    PegCount max_depth;
+};
+
+static const PegInfo async_pegs[] =
+{
+    { CountType::SUM, "async_records", "log records queued for the writer threads" },
+    { CountType::SUM, "async_drops", "log records dropped because the ring was full" },
+    { CountType::SUM, "async_blocks", "log records that waited for room in the ring" },
+    { CountType::SUM, "async_overflows", "log records discarded and counted by the count policy" },
+    { CountType::NOW, "async_depth", "log records waiting to be written" },
+    { CountType::MAX, "async_max_depth", "maximum log records waiting to be written" },
+    { CountType::END, nullptr, nullptr }
+};
+
+static THREAD_LOCAL AsyncStats async_stats;
+
+// -----------------------------------------------------------------------------
+// queues
+// -----------------------------------------------------------------------------
+
+struct Record
+{
+    AsyncWriter::Sink sink;
+    void* ctx;
+    char* buf;
+    unsigned len;
+};
+
+struct Queue
+{
+    Queue(unsigned size, AsyncWriter::Policy p) : ring(size), policy(p) { }
+
+    SpscRing<Record> ring;
+    std::atomic<uint64_t> done { 0 };  // written by the writer
+
+    // producer only
+    AsyncWriter::Policy policy;
+    uint64_t pushed = 0;
+};
+
+static THREAD_LOCAL Queue* s_queue = nullptr;
+
+// s_mutex guards everything below it
+static std::mutex s_mutex;
+static std::condition_variable s_cond;
+static std::condition_variable s_room;  // writers made progress
+static std::vector<std::thread*> s_writers;
+static std::vector<Queue*> s_queues;
+static unsigned s_gen = 0;
+static unsigned s_users = 0;
+static bool s_stop = false;
+
+// -----------------------------------------------------------------------------
+// writers
+// -----------------------------------------------------------------------------
+
+static bool service(Queue* q)
+{
+    Record r;
+    bool any = false;
+
+    while ( q->ring.pop(r) )
+    {
+        r.sink(r.ctx, r.buf, r.len);
+        snort_free(r.buf);
+        q->done.fetch_add(1, std::memory_order_release);
+        any = true;
+    }
+    return any;
+}
+
+// writer id of n services every nth queue.  queues are only freed after
+// the writers are joined so the snapshot can be used unlocked.
+static void writer(unsigned id, unsigned n)
+{
+    std::vector<Queue*> mine;
+    unsigned gen = ~0u;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    while ( true )
+    {
+        if ( gen != s_gen )
+        {
+            mine.clear();
+
+            for ( unsigned i = id; i < s_queues.size(); i += n )
+                mine.emplace_back(s_queues[i]);
+
+            gen = s_gen;
+        }
+        bool stop = s_stop;
+        lock.unlock();
+
+        bool idle = true;
+
+        for ( auto q : mine )
+            idle = !service(q) and idle;
+
+        lock.lock();
+
+        // producers waiting for room or a drain recheck under the lock
+        if ( !idle )
+            s_room.notify_all();
+
+        if ( stop and idle )
+            break;
+
+        // producers don't signal each record; they only kick us when waiting
+        if ( idle )
+            s_cond.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+static void start(unsigned size, AsyncWriter::Policy policy, unsigned writers)
+{
+    if ( !size or s_queue )
+        return;
+
+    s_queue = new Queue(size, policy);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_queues.emplace_back(s_queue);
+    ++s_gen;
+
+    if ( s_users++ )
+        return;
+
+    assert(s_writers.empty());
+    s_stop = false;
+
+    for ( unsigned i = 0; i < writers; ++i )
+        s_writers.emplace_back(new std::thread(writer, i, writers));
+}
+
+static void stop()
+{
+    if ( !s_queue )
+        return;
+
+    AsyncWriter::drain();
+    s_queue = nullptr;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    if ( --s_users )
+        return;
+
+    s_stop = true;
+    s_cond.notify_all();
+    lock.unlock();
+
+    for ( auto t : s_writers )
+    {
+        t->join();
+        delete t;
+    }
+    s_writers.clear();
+
+    for ( auto q : s_queues )
+        delete q;
+
+    s_queues.clear();
+}
+
+// -----------------------------------------------------------------------------
+// producers
+// -----------------------------------------------------------------------------
+
+static bool push(const Record& r)
+{
+    if ( !s_queue->ring.push(r) )
+        return false;
+
+    ++s_queue->pushed;
+    return true;
+}
+
+// sleep until ready() holds.  ready() is checked with s_mutex held and the
+// writers notify s_room with it held after each pass that wrote anything,
+// so a wakeup can't be missed; the timeout is only a backstop.
+template<typename Ready>
+static void wait(Ready ready)
+{
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    while ( !ready() )
+    {
+        // idle writers only poll every millisecond otherwise
+        s_cond.notify_all();
+        s_room.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
+
+static void update_depth()
+{
+    async_stats.depth = s_queue->pushed - s_queue->done.load(std::memory_order_relaxed);
+
+    if ( async_stats.depth > async_stats.max_depth )
+        async_stats.max_depth = async_stats.depth;
+}
+
+// -----------------------------------------------------------------------------
+// api
+// -----------------------------------------------------------------------------
+
+void AsyncWriter::thread_init(const SnortConfig* sc)
+{
+    start(sc->async_log_ring, (Policy)sc->async_log_policy, sc->async_log_writers);
+}
+
+void AsyncWriter::thread_term()
+{ stop(); }
+
+bool AsyncWriter::write(Sink sink, void* ctx, const char* buf, unsigned len)
+{
+    if ( !s_queue )
+        return false;
+
+    Record r { sink, ctx, (char*)snort_alloc(len), len };
+    memcpy(r.buf, buf, len);
+
+    if ( !push(r) )
+    {
+        switch ( s_queue->policy )
+        {
+        case DROP:
+            snort_free(r.buf);
+            ++async_stats.drops;
+            return true;
+
+        case BLOCK:
+            ++async_stats.blocks;
+            wait([&r]() { return push(r); });
+            break;
+
+        case COUNT:
+            snort_free(r.buf);
+            ++async_stats.overflows;
+            return true;
+        }
+    }
+    ++async_stats.records;
+    update_depth();
+    return true;
+}
+
+void AsyncWriter::drain()
+{
+    if ( !s_queue )
+        return;
+
+    wait([]() { return s_queue->done.load(std::memory_order_acquire) == s_queue->pushed; });
+
+    update_depth();
+}
+
+const PegInfo* AsyncWriter::get_pegs()
+{ return async_pegs; }
+
+PegCount* AsyncWriter::get_counts()
+{ return (PegCount*)&async_stats; }
+
+// -----------------------------------------------------------------------------
+// unit tests
+// -----------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static void append(void* ctx, const char* buf, unsigned len)
+{
+    ((std::string*)ctx)->append(buf, len);
+}
+
+static void check_order(AsyncWriter::Policy policy, unsigned writers)
+{
+    std::string expected, actual;
+    async_stats = { };
+
+    start(4, policy, writers);
+
+    for ( unsigned i = 0; i < 1000; ++i )
+    {
+        std::string s = std::to_string(i) + ",";
+        expected += s;
+        CHECK( AsyncWriter::write(append, &actual, s.c_str(), s.size()) );
+    }
+    AsyncWriter::drain();
+    CHECK( async_stats.depth == 0 );
+    stop();
+
+    if ( policy == AsyncWriter::DROP )
+    {
+        CHECK( async_stats.records + async_stats.drops == 1000 );
+        CHECK( async_stats.overflows == 0 );
+        CHECK( actual.size() <= expected.size() );
+    }
+    else if ( policy == AsyncWriter::COUNT )
+    {
+        CHECK( async_stats.records + async_stats.overflows == 1000 );
+        CHECK( async_stats.drops == 0 );
+        CHECK( actual.size() <= expected.size() );
+    }
+    else
+    {
+        CHECK( async_stats.records == 1000 );
+        CHECK( actual == expected );
+    }
+    // one more may be popped but not yet written
+    CHECK( async_stats.max_depth <= 5 );
+}
+
+// the first record stalls the writer like a hung disk
+static std::atomic<bool> s_stalled { false };
+
+static void stall(void* ctx, const char* buf, unsigned len)
+{
+    if ( !s_stalled.exchange(true) )
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    append(ctx, buf, len);
+}
+
+static double thread_cpu_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+TEST_CASE( "async writer disabled", "[async_writer]" )
+{
+    std::string out;
+    CHECK_FALSE( AsyncWriter::write(append, &out, "x", 1) );
+    AsyncWriter::drain();
+    CHECK( out.empty() );
+}
+
+TEST_CASE( "async writer policies", "[async_writer]" )
+{
+    SECTION( "block" )
+    {
+        check_order(AsyncWriter::BLOCK, 1);
+    }
+    SECTION( "count" )
+    {
+        check_order(AsyncWriter::COUNT, 1);
+    }
+    SECTION( "drop" )
+    {
+        check_order(AsyncWriter::DROP, 1);
+    }
+    SECTION( "two writers" )
+    {
+        check_order(AsyncWriter::BLOCK, 2);
+    }
+}
+
+TEST_CASE( "async writer stalled", "[async_writer]" )
+{
+    std::string out;
+    async_stats = { };
+    s_stalled = false;
+
+    SECTION( "block sleeps" )
+    {
+        start(2, AsyncWriter::BLOCK, 1);
+        double cpu = thread_cpu_ms();
+
+        for ( unsigned i = 0; i < 10; ++i )
+            CHECK( AsyncWriter::write(stall, &out, "x", 1) );
+
+        AsyncWriter::drain();
+        cpu = thread_cpu_ms() - cpu;
+        stop();
+
+        CHECK( out == "xxxxxxxxxx" );
+        CHECK( async_stats.blocks > 0 );
+        CHECK( cpu < 50.0 );
+    }
+    SECTION( "count holds nothing" )
+    {
+        start(2, AsyncWriter::COUNT, 1);
+
+        for ( unsigned i = 0; i < 1000; ++i )
+            CHECK( AsyncWriter::write(stall, &out, "x", 1) );
+
+        CHECK( async_stats.overflows >= 1000 - 3 );
+        CHECK( async_stats.max_depth <= 3 );
+        stop();
+    }
+}
+
+#endif
+
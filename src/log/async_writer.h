@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// async_writer.h
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+// moves log file writes off the packet threads.  each packet thread copies
+// formatted records onto its own spsc ring and one or more writer threads
+// drain the rings and do the file io.  records queued by one packet thread
+// are written in order.  a sink may be used by the writers as long as
+// anything queued for it is outstanding so call drain() before closing it.
+// when disabled (or on other threads) write() returns false and the caller
+// writes synchronously as before.
+
+#include "framework/counts.h"
+#include "main/snort_types.h"
+
+namespace snort
+{
+struct SnortConfig;
+}
+
+class SO_PUBLIC AsyncWriter
+{
+public:
+    // what to do when this thread's ring is full
+    enum Policy
+    {
+        DROP,   // discard the record
+        BLOCK,  // wait for the writer to make room
+        COUNT   // discard it and count it separately from drops
+    };
+
+    // called on a writer thread for each record queued with write()
+    typedef void (*Sink)(void* ctx, const char* buf, unsigned len);
+
+    // packet thread calls.  the first thread in starts the writers and the
+    // last one out stops them.
+    static void thread_init(const snort::SnortConfig*);
+    static void thread_term();
+
+    // queue a copy of buf for sink; false if the caller must write it
+    static bool write(Sink, void* ctx, const char* buf, unsigned len);
+
+    // wait until everything this thread queued has been written
+    static void drain();
+
+    static const PegInfo* get_pegs();
+    static PegCount* get_counts();
+};
+
+#endif
+
@@ -0,0 +1,384 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// batch_writer.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "batch_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace snort;
+
+BatchWriter::BatchWriter(size_t fs, unsigned usecs, bool d) :
+    flush_size(fs), flush_time(usecs), direct(d)
+{ }
+
+BatchWriter::~BatchWriter()
+{
+    close();
+
+    for ( auto c : chunks )
+        free(c);
+}
+
+//-------------------------------------------------------------------------
+// pending records are kept back to back across chunks starting at offset 0
+//-------------------------------------------------------------------------
+
+uint8_t* BatchWriter::get_chunk(size_t off)
+{
+    size_t idx = off / chunk_size;
+
+    while ( idx >= chunks.size() )
+    {
+        void* c = nullptr;
+
+        if ( posix_memalign(&c, page_size, chunk_size) )
+            throw std::bad_alloc();
+
+        chunks.emplace_back((uint8_t*)c);
+    }
+    return chunks[idx];
+}
+
+void BatchWriter::put(const uint8_t* buf, size_t len)
+{
+    while ( len )
+    {
+        size_t off = pending % chunk_size;
+        size_t n = std::min(len, chunk_size - off);
+
+        memcpy(get_chunk(pending) + off, buf, n);
+
+        buf += n;
+        len -= n;
+        pending += n;
+        size += n;
+    }
+}
+
+void BatchWriter::copy_out(size_t off, size_t len, std::vector<uint8_t>& out)
+{
+    while ( len )
+    {
+        size_t o = off % chunk_size;
+        size_t n = std::min(len, chunk_size - o);
+        const uint8_t* c = chunks[off / chunk_size] + o;
+
+        out.insert(out.end(), c, c + n);
+        off += n;
+        len -= n;
+    }
+}
+
+// drop the first len pending bytes, moving anything left to the front
+void BatchWriter::shift(size_t len)
+{
+    size_t src = len, dst = 0;
+
+    while ( src < pending )
+    {
+        size_t so = src % chunk_size, dof = dst % chunk_size;
+        size_t n = std::min(pending - src, chunk_size - std::max(so, dof));
+
+        memmove(chunks[dst / chunk_size] + dof, chunks[src / chunk_size] + so, n);
+        src += n;
+        dst += n;
+    }
+    pending -= len;
+
+    auto keep = std::upper_bound(ends.begin(), ends.end(), len);
+    ends.erase(ends.begin(), keep);
+
+    for ( auto& e : ends )
+        e -= len;
+
+    if ( pending )
+        oldest = Clock::now();
+}
+
+// put buf in front of the pending records; only used to recover from errors
+void BatchWriter::prepend(const std::vector<uint8_t>& buf)
+{
+    std::vector<uint8_t> rest;
+    copy_out(0, pending, rest);
+
+    size_t save = size;
+    pending = 0;
+
+    put(buf.data(), buf.size());
+    put(rest.data(), rest.size());
+    size = save;
+
+    for ( auto& e : ends )
+        e += buf.size();
+}
+
+// the end of the last whole record within the first limit pending bytes
+size_t BatchWriter::last_end(size_t limit) const
+{
+    auto it = std::upper_bound(ends.begin(), ends.end(), limit);
+    return it == ends.begin() ? 0 : *(it - 1);
+}
+
+void BatchWriter::clear_direct()
+{
+#ifdef O_DIRECT
+    if ( aligned )
+    {
+        int flags = fcntl(fd, F_GETFL);
+
+        if ( flags != -1 )
+            fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+    aligned = false;
+}
+
+//-------------------------------------------------------------------------
+// io
+//-------------------------------------------------------------------------
+
+bool BatchWriter::flush(size_t len)
+{
+    if ( fd < 0 )
+    {
+        errno = EBADF;
+        return false;
+    }
+
+    if ( len <= written )
+        return true;
+
+    iovs.clear();
+
+    for ( size_t off = written; off < len; )
+    {
+        size_t o = off % chunk_size;
+        size_t n = std::min(chunk_size - o, len - off);
+
+        iovs.push_back({ chunks[off / chunk_size] + o, n });
+        off += n;
+    }
+
+    size_t done = written;
+    unsigned first = 0;
+    int error = 0;
+
+    while ( done < len )
+    {
+        ssize_t n = writev(fd, &iovs[first], std::min(iovs.size() - first, (size_t)IOV_MAX));
+
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            error = errno;
+            break;
+        }
+        done += n;
+
+        // skip what was written in case of a short write
+        while ( n > 0 and (size_t)n >= iovs[first].iov_len )
+            n -= iovs[first++].iov_len;
+
+        if ( n > 0 )
+        {
+            iovs[first].iov_base = (uint8_t*)iovs[first].iov_base + n;
+            iovs[first].iov_len -= n;
+        }
+    }
+    ++flushes;
+
+    if ( !error )
+    {
+        complete(len);
+        return true;
+    }
+
+    rollback(done);
+    errno = error;
+    return false;
+}
+
+// the first len pending bytes are in the file
+void BatchWriter::complete(size_t len)
+{
+    size_t end = last_end(len);
+
+    // with direct the flush can end inside a record
+    if ( end == len )
+        torn.clear();
+
+    else
+    {
+        if ( end )
+            torn.clear();
+
+        copy_out(end, len - end, torn);
+    }
+    shift(len);
+    written = 0;
+}
+
+// a write failed after the first reached pending bytes were written.  cut
+// the file back to the last whole record and keep the torn one pending.
+void BatchWriter::rollback(size_t reached)
+{
+    size_t end = last_end(reached);
+
+    // the torn record may have started in an earlier direct flush
+    size_t head = end ? 0 : torn.size();
+    off_t target = (off_t)(size - pending + end - head);
+
+    // o_direct can't carry on from an unaligned offset
+    clear_direct();
+
+    bool cut = !ftruncate(fd, target) and lseek(fd, target, SEEK_SET) == target;
+
+    shift(end);
+
+    if ( head )
+        prepend(torn);
+
+    torn.clear();
+    written = cut ? 0 : reached - end + head;
+}
+
+bool BatchWriter::flush()
+{
+    // o_direct writes must be page multiples; the tail waits
+    return flush(aligned ? pending & ~(page_size - 1) : pending);
+}
+
+bool BatchWriter::tick()
+{
+    if ( !pending or !flush_time.count() or Clock::now() - oldest < flush_time )
+        return true;
+
+    return flush();
+}
+
+bool BatchWriter::finish()
+{
+    if ( aligned )
+    {
+        if ( !flush() )
+            return false;
+
+        clear_direct();
+    }
+    return flush(pending);
+}
+
+bool BatchWriter::write(const struct iovec* iov, unsigned n)
+{
+    if ( fd < 0 )
+    {
+        errno = EBADF;
+        return false;
+    }
+
+    if ( !pending )
+        oldest = Clock::now();
+
+    for ( unsigned i = 0; i < n; ++i )
+        put((const uint8_t*)iov[i].iov_base, iov[i].iov_len);
+
+    ends.emplace_back(pending);
+    ++records;
+
+    if ( pending >= flush_size )
+        return flush();
+
+    return tick();
+}
+
+bool BatchWriter::open(const char* path)
+{
+    bool ok = true;
+
+    if ( fd >= 0 )
+    {
+        ok = finish();
+        ::close(fd);
+        fd = -1;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+    if ( direct )
+    {
+        fd = ::open(path, flags | O_DIRECT, 0666);
+
+        // not all file systems support it
+        aligned = fd >= 0;
+    }
+#endif
+
+    if ( fd < 0 )
+        fd = ::open(path, flags, 0666);
+
+    // anything we couldn't write to the last file starts this one, whole
+    size = pending;
+    written = 0;
+    torn.clear();
+
+    if ( !pending )
+        oldest = Clock::now();
+
+    return ok and fd >= 0;
+}
+
+void BatchWriter::discard()
+{
+    size -= pending;
+    pending = 0;
+    written = 0;
+    ends.clear();
+    torn.clear();
+}
+
+bool BatchWriter::close()
+{
+    if ( fd < 0 )
+        return true;
+
+    bool ok = finish();
+    ::close(fd);
+
+    fd = -1;
+    aligned = false;
+    return ok;
+}
+
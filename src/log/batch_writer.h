@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// batch_writer.h
+
+#ifndef BATCH_WRITER_H
+#define BATCH_WRITER_H
+
+// buffered writer for binary log files.  records are appended to a set of
+// page aligned chunks and each flush writes all pending chunks with one
+// writev() instead of an fwrite() and fflush() per record.  a flush only
+// ever writes whole records (unless direct, see below) and records are
+// never split across files.
+//
+// the end of each pending record is tracked so a write that fails part way
+// can be rolled back: the file is truncated to the last whole record and
+// the torn record stays pending, whole.  if the file can't be truncated,
+// the next flush to the same file carries on where the failed write
+// stopped, while a new file from open() still starts with the whole record.
+//
+// a flush happens when flush_size bytes are pending, when the oldest
+// pending record is older than flush_usecs (checked on the next write or
+// by calling tick() when idle), on open() of the next file, and on close().
+// flush_size = 0 writes each record as it arrives and flush_usecs = 0 turns
+// off the time limit.
+//
+// with direct the file is opened O_DIRECT (if the file system allows it)
+// so every flush is a multiple of the page size; the unaligned tail of the
+// last record is kept for the next flush and written normally at close.
+
+#include <sys/uio.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "main/snort_types.h"
+
+namespace snort
+{
+class SO_PUBLIC BatchWriter
+{
+public:
+    BatchWriter(size_t flush_size, unsigned flush_usecs, bool direct = false);
+    ~BatchWriter();
+
+    BatchWriter(const BatchWriter&) = delete;
+    BatchWriter& operator=(const BatchWriter&) = delete;
+
+    // if a file is already open, pending records are flushed to it first.
+    // if that fails they are kept and go to the new file instead.
+    bool open(const char* path);
+    bool close();
+
+    bool is_open() const
+    { return fd >= 0; }
+
+    // true if the current file was opened O_DIRECT
+    bool is_direct() const
+    { return aligned; }
+
+    // append a record gathered from n pieces; false if the writer is closed
+    // or a flush failed (errno is set)
+    bool write(const struct iovec*, unsigned n);
+
+    bool write(const void* buf, size_t len)
+    {
+        struct iovec iov = { const_cast<void*>(buf), len };
+        return write(&iov, 1);
+    }
+
+    bool flush();
+    bool tick();
+
+    // drop pending records, eg when a failed close() shouldn't carry them
+    // over to a new file
+    void discard();
+
+    // bytes written to the current file including pending records
+    size_t get_size() const
+    { return size; }
+
+    size_t get_pending() const
+    { return pending; }
+
+    uint64_t get_records() const
+    { return records; }
+
+    uint64_t get_flushes() const
+    { return flushes; }
+
+    static const size_t chunk_size = 64 * 1024;
+    static const size_t page_size = 4096;
+
+private:
+    uint8_t* get_chunk(size_t off);
+    void put(const uint8_t*, size_t);
+    void copy_out(size_t off, size_t len, std::vector<uint8_t>&);
+    void shift(size_t);
+    void prepend(const std::vector<uint8_t>&);
+    size_t last_end(size_t limit) const;
+    void clear_direct();
+
+    bool flush(size_t len);
+    void complete(size_t len);
+    void rollback(size_t reached);
+    bool finish();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<uint8_t*> chunks;
+    std::vector<struct iovec> iovs;
+
+    // end offset of each pending record
+    std::vector<size_t> ends;
+
+    // with direct, the part of the first pending record written by the
+    // last flush
+    std::vector<uint8_t> torn;
+
+    size_t flush_size;
+    std::chrono::microseconds flush_time;
+    Clock::time_point oldest;
+
+    size_t pending = 0;
+    size_t size = 0;
+
+    // pending bytes already in the file after a failed rollback
+    size_t written = 0;
+
+    uint64_t records = 0;
+    uint64_t flushes = 0;
+
+    int fd = -1;
+    bool direct;
+    bool aligned = false;
+};
+}
+#endif
+
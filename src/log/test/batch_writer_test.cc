@@ -0,0 +1,330 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// batch_writer_test.cc
+
+// unit tests and records/sec benchmark for BatchWriter
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../batch_writer.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+static std::string get_path(const char* name)
+{
+    return std::string("batch_writer_test_") + std::to_string(getpid()) + "_" + name;
+}
+
+static std::string slurp(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// records of varying size with a recognizable pattern
+static std::string make_record(unsigned i)
+{
+    unsigned len = 16 + (i * 7919) % 3000;
+    std::string s(len, 'a' + i % 26);
+    snprintf(&s[0], len, "%u:", i);
+    return s;
+}
+
+TEST_GROUP(batch_writer)
+{
+    std::string one, two;
+
+    void setup() override
+    {
+        one = get_path("one");
+        two = get_path("two");
+    }
+
+    void teardown() override
+    {
+        unlink(one.c_str());
+        unlink(two.c_str());
+    }
+};
+
+TEST(batch_writer, closed)
+{
+    BatchWriter bw(1024, 0);
+    CHECK_FALSE(bw.is_open());
+    CHECK_FALSE(bw.write("x", 1));
+    CHECK_TRUE(bw.close());
+}
+
+TEST(batch_writer, whole_records)
+{
+    BatchWriter bw(100000, 0);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    std::string expected;
+
+    for ( unsigned i = 0; i < 1000; ++i )
+    {
+        std::string r = make_record(i);
+        CHECK_TRUE(bw.write(r.data(), r.size()));
+        expected += r;
+
+        // nothing is written unless whole records are pending
+        CHECK(bw.get_pending() < 100000);
+    }
+    CHECK(bw.get_size() == expected.size());
+    CHECK(bw.get_records() == 1000);
+    CHECK(bw.get_flushes() > 1);
+    CHECK(bw.get_flushes() < 1000);
+
+    CHECK_TRUE(bw.close());
+    CHECK(slurp(one) == expected);
+}
+
+TEST(batch_writer, gather)
+{
+    BatchWriter bw(1 << 20, 0);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    char hdr[] = "hdr:";
+    std::string body(BatchWriter::chunk_size + 10, 'b');
+
+    struct iovec iov[2] = { { hdr, 4 }, { &body[0], body.size() } };
+    CHECK_TRUE(bw.write(iov, 2));
+    CHECK(bw.get_pending() == 4 + body.size());
+
+    CHECK_TRUE(bw.close());
+    CHECK(slurp(one) == std::string("hdr:") + body);
+}
+
+TEST(batch_writer, unbuffered)
+{
+    BatchWriter bw(0, 0);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    for ( unsigned i = 0; i < 10; ++i )
+    {
+        CHECK_TRUE(bw.write("rec", 3));
+        CHECK(bw.get_pending() == 0);
+    }
+    CHECK(bw.get_flushes() == 10);
+    CHECK(slurp(one) == "recrecrecrecrecrecrecrecrecrec");
+}
+
+TEST(batch_writer, timeout)
+{
+    BatchWriter bw(1 << 20, 1000);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    CHECK_TRUE(bw.write("first", 5));
+    CHECK_TRUE(bw.tick());
+    CHECK(bw.get_pending() == 5);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    CHECK_TRUE(bw.tick());
+    CHECK(bw.get_pending() == 0);
+    CHECK(slurp(one) == "first");
+}
+
+TEST(batch_writer, rotate)
+{
+    BatchWriter bw(1 << 20, 0);
+    CHECK_TRUE(bw.open(one.c_str()));
+    CHECK_TRUE(bw.write("old", 3));
+
+    // pending records go to the file they were written for
+    CHECK_TRUE(bw.open(two.c_str()));
+    CHECK(bw.get_size() == 0);
+    CHECK_TRUE(bw.write("new", 3));
+    CHECK(bw.get_size() == 3);
+
+    CHECK_TRUE(bw.close());
+    CHECK(slurp(one) == "old");
+    CHECK(slurp(two) == "new");
+}
+
+TEST(batch_writer, direct)
+{
+    BatchWriter bw(BatchWriter::page_size * 3, 0, true);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    std::string expected;
+
+    for ( unsigned i = 0; i < 500; ++i )
+    {
+        std::string r = make_record(i);
+        CHECK_TRUE(bw.write(r.data(), r.size()));
+        expected += r;
+
+        // o_direct leaves only an unaligned tail behind
+        if ( bw.is_direct() )
+            CHECK(bw.get_pending() < BatchWriter::page_size * 3 + r.size());
+    }
+    CHECK_TRUE(bw.close());
+    CHECK(slurp(one) == expected);
+}
+
+// writes past the file size limit are cut short and then fail with EFBIG,
+// leaving a record torn across the limit
+static void torn_write(const std::string& one, const std::string& two, bool direct)
+{
+    struct rlimit save;
+    getrlimit(RLIMIT_FSIZE, &save);
+
+    struct rlimit limit = save;
+    limit.rlim_cur = 7 * BatchWriter::page_size + 1234;
+
+    auto handler = signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &limit);
+
+    BatchWriter bw(BatchWriter::page_size * 3, 0, direct);
+    CHECK_TRUE(bw.open(one.c_str()));
+
+    std::string all;
+    std::set<size_t> ends;
+    bool failed = false;
+
+    for ( unsigned i = 0; i < 100 and !failed; ++i )
+    {
+        std::string r = make_record(i);
+        failed = !bw.write(r.data(), r.size());
+        all += r;
+        ends.insert(all.size());
+    }
+    CHECK_TRUE(failed);
+
+    // with o_direct the write at the limit fails outright instead
+    CHECK(errno == EFBIG or (direct and errno == EINVAL));
+
+    // the first file was cut back to the last whole record
+    std::string first = slurp(one);
+    CHECK(first.size() <= limit.rlim_cur);
+    CHECK(ends.count(first.size()));
+    CHECK(!all.compare(0, first.size(), first));
+
+    // the old file only takes whole records up to the limit, so the new one
+    // starts with the torn record
+    CHECK_FALSE(bw.open(two.c_str()));
+
+    first = slurp(one);
+    CHECK(first.size() <= limit.rlim_cur);
+    CHECK(ends.count(first.size()));
+    CHECK(!all.compare(0, first.size(), first));
+
+    setrlimit(RLIMIT_FSIZE, &save);
+    signal(SIGXFSZ, handler);
+
+    CHECK_TRUE(bw.close());
+    CHECK(slurp(two) == all.substr(first.size()));
+}
+
+TEST(batch_writer, torn_write)
+{
+    torn_write(one, two, false);
+}
+
+TEST(batch_writer, torn_direct_write)
+{
+    torn_write(one, two, true);
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// records/sec for fwrite + fflush per record (what unified2 did) vs
+// batched writev
+//--------------------------------------------------------------------------
+
+static double run_stdio(const std::string& path, const std::string& rec, unsigned num)
+{
+    auto start = std::chrono::steady_clock::now();
+    FILE* f = fopen(path.c_str(), "wb");
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        fwrite(rec.data(), rec.size(), 1, f);
+        fflush(f);
+    }
+    fclose(f);
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return num / secs.count();
+}
+
+static double run_batch(const std::string& path, const std::string& rec, unsigned num, bool direct)
+{
+    auto start = std::chrono::steady_clock::now();
+    BatchWriter bw(1 << 20, 1000000, direct);
+    bw.open(path.c_str());
+
+    for ( unsigned i = 0; i < num; ++i )
+        bw.write(rec.data(), rec.size());
+
+    bw.close();
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return num / secs.count();
+}
+
+TEST(batch_writer, benchmark)
+{
+    const unsigned num = 200000;
+
+    printf("\n%8s %14s %14s %14s %8s\n", "rec size", "fflush rec/s", "batch rec/s", "direct rec/s",
+        "speedup");
+
+    for ( unsigned sz : { 64, 256, 1500 } )
+    {
+        std::string rec(sz, 'x');
+
+        double a = run_stdio(one, rec, num);
+        double b = run_batch(one, rec, num, false);
+        double c = run_batch(one, rec, num, true);
+
+        printf("%8u %14.0f %14.0f %14.0f %8.2f\n", sz, a, b, c, b / a);
+        CHECK(slurp(one).size() == (size_t)sz * num);
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -37,6 +37,7 @@
 
 #include "utils/util.h"
 
+#include "async_writer.h"
 #include "log.h"
 
 using namespace snort;
@@ -145,6 +146,7 @@ void TextLog_Term(TextLog* const txt)
         return;
 
     TextLog_Flush(txt);
+    AsyncWriter::drain();
     TextLog_Close(txt->file);
 
     if ( txt->name )
@@ -175,8 +177,14 @@ static void TextLog_Roll(TextLog* const txt)
 
 /*-------------------------------------------------------------------
  * TextLog_Flush: write buffered stream to file
+ * (or queue it for an async writer thread)
  *-------------------------------------------------------------------
  */
+static void TextLog_Sink(void* file, const char* buf, unsigned len)
+{
+    fwrite(buf, len, 1, (FILE*)file);
+}
+
 bool TextLog_Flush(TextLog* const txt)
 {
     int ok;
@@ -185,7 +193,18 @@ bool TextLog_Flush(TextLog* const txt)
         return false;
 
     if ( txt->maxFile and txt->size + txt->pos > txt->maxFile )
+    {
+        // anything queued goes to the old file
+        AsyncWriter::drain();
         TextLog_Roll(txt);
+    }
+
+    if ( AsyncWriter::write(TextLog_Sink, txt->file, txt->buf, txt->pos) )
+    {
+        txt->size += txt->pos;
+        TextLog_Reset(txt);
+        return true;
+    }
 
     ok = fwrite(txt->buf, txt->pos, 1, txt->file);
 
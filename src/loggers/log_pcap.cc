@@ -24,8 +24,10 @@
 
 #include <pcap.h>
 
+#include "framework/data_bus.h"
 #include "framework/logger.h"
 #include "framework/module.h"
+#include "log/batch_writer.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
 #include "packet_io/sfdaq.h"
@@ -47,16 +49,42 @@ using namespace std;
 #define PCAP_FILE_HDR_SZ (24)
 #define PCAP_PKT_HDR_SZ  (16)
 
+// same as pcap_dump_open() and pcap_dump() write
+struct PcapFileHdr
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct PcapPktHdr
+{
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
+static_assert(sizeof(PcapFileHdr) == PCAP_FILE_HDR_SZ, "pcap file header size");
+static_assert(sizeof(PcapPktHdr) == PCAP_PKT_HDR_SZ, "pcap packet header size");
+
 struct LtdConfig
 {
     string file;
     size_t limit;
+    size_t flush_size;
+    unsigned flush_timeout;
+    bool direct;
 };
 
 struct LtdContext
 {
     char* file;
-    pcap_dumper_t* dumpd;
+    BatchWriter* writer;
     time_t lastTime;
     size_t size;
     int log_cnt;
@@ -75,9 +103,17 @@ static void TcpdumpRollLogFile(LtdConfig*);
 
 static const Parameter s_params[] =
 {
+    { "direct", Parameter::PT_BOOL, nullptr, "false",
+      "bypass the page cache with O_DIRECT where supported" },
+
+    { "flush_size", Parameter::PT_INT, "0:max32", "0",
+      "write when this many bytes of packets are pending (0 writes each packet)" },
+
+    { "flush_timeout", Parameter::PT_INT, "0:60000", "1000",
+      "write pending packets at least this often in milliseconds (0 is unlimited)" },
+
     { "limit", Parameter::PT_INT, "0:maxSZ", "0",
       "set maximum size in MB before rollover (0 is unlimited)" },
-
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -97,6 +133,9 @@ public:
 
 public:
     size_t limit;
+    size_t flush_size;
+    unsigned flush_timeout;
+    bool direct;
 };
 
 bool TcpdumpModule::set(const char*, Value& v, SnortConfig*)
@@ -104,6 +143,15 @@ bool TcpdumpModule::set(const char*, Value& v, SnortConfig*)
     if ( v.is("limit") )
         limit = v.get_size() * 1024 * 1024;
 
+    else if ( v.is("flush_size") )
+        flush_size = v.get_uint32();
+
+    else if ( v.is("flush_timeout") )
+        flush_timeout = v.get_uint32();
+
+    else if ( v.is("direct") )
+        direct = v.get_bool();
+
     else
         return false;
 
@@ -113,6 +161,9 @@ bool TcpdumpModule::set(const char*, Value& v, SnortConfig*)
 bool TcpdumpModule::begin(const char*, int, SnortConfig*)
 {
     limit = 0;
+    flush_size = 0;
+    flush_timeout = 1000;
+    direct = false;
     return true;
 }
 
@@ -133,17 +184,22 @@ static void LogTcpdumpSingle(
     if ( data->limit && (context.size + dumpSize > data->limit) )
         TcpdumpRollLogFile(data);
 
-    struct pcap_pkthdr pcaphdr;
-    pcaphdr.ts = p->pkth->ts;
+    PcapPktHdr pcaphdr;
+    pcaphdr.sec = (uint32_t)p->pkth->ts.tv_sec;
+    pcaphdr.usec = (uint32_t)p->pkth->ts.tv_usec;
     pcaphdr.caplen = p->pktlen;
     pcaphdr.len = p->pkth->pktlen;
-    pcap_dump((uint8_t*)context.dumpd, &pcaphdr, p->pkt);
-    context.size += dumpSize;
 
-    if (!SnortConfig::line_buffered_logging())  // FIXIT-L misnomer
+    struct iovec iov[2] =
     {
-        fflush( (FILE*)context.dumpd);
-    }
+        { &pcaphdr, sizeof(pcaphdr) },
+        { const_cast<uint8_t*>(p->pkt), p->pktlen }
+    };
+
+    if ( !context.writer->write(iov, 2) )
+        ErrorMessage("%s: can't write %s: %s\n", S_NAME, context.file, get_error(errno));
+
+    context.size += dumpSize;
 }
 
 static void LogTcpdumpStream(
@@ -177,20 +233,19 @@ static void TcpdumpInitLogFile(LtdConfig*, bool no_timestamp)
     if ( dlt == DLT_IPV4 || dlt == DLT_IPV6 )
         dlt = DLT_RAW;
 
-    pcap_t* pcap;
-    pcap = pcap_open_dead(dlt, SnortConfig::get_conf()->daq_config->get_mru_size());
+    if ( !context.writer->open(file.c_str()) and !context.writer->is_open() )
+        FatalError("%s: can't open %s: %s\n", S_NAME, file.c_str(), get_error(errno));
 
-    if ( !pcap )
-        FatalError("%s: can't get pcap context\n", S_NAME);
+    PcapFileHdr hdr;
+    hdr.magic = 0xa1b2c3d4;
+    hdr.version_major = PCAP_VERSION_MAJOR;
+    hdr.version_minor = PCAP_VERSION_MINOR;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = SnortConfig::get_conf()->daq_config->get_mru_size();
+    hdr.linktype = dlt;
 
-    context.dumpd = pcap ? pcap_dump_open(pcap, file.c_str()) : nullptr;
-
-    if (context.dumpd == nullptr)
-    {
-        FatalError("%s: can't open %s: %s\n",
-            S_NAME, file.c_str(), pcap_geterr(pcap));
-    }
-    pcap_close(pcap);
+    context.writer->write(&hdr, sizeof(hdr));
 
     context.file = snort_strdup(file.c_str());
     context.size = PCAP_FILE_HDR_SZ;
@@ -207,10 +262,14 @@ static void TcpdumpRollLogFile(LtdConfig* data)
         return;
 
     /* close the output file */
-    if ( context.dumpd != nullptr )
+    if ( context.writer->is_open() )
     {
-        pcap_dump_close(context.dumpd);
-        context.dumpd = nullptr;
+        // don't carry packets over ahead of the next file header
+        if ( !context.writer->close() )
+        {
+            ErrorMessage("%s: can't write %s: %s\n", S_NAME, context.file, get_error(errno));
+            context.writer->discard();
+        }
         context.size = 0;
         snort_free(context.file);
         context.file = nullptr;
@@ -243,10 +302,25 @@ static void SpoLogTcpdumpCleanup(LtdConfig*)
 // logger stuff
 //-------------------------------------------------------------------------
 
+// packets that don't fill a batch are written after flush_timeout even if
+// nothing more is logged; checked after each batch of packets and when idle
+class PcapFlushHandler : public DataHandler
+{
+public:
+    PcapFlushHandler(SnortConfig* sc, DataEventId id) : DataHandler(S_NAME)
+    { DataBus::subscribe_default(id, this, sc); }
+
+    void handle(DataEvent&, Flow*) override
+    {
+        if ( context.writer )
+            context.writer->tick();
+    }
+};
+
 class PcapLogger : public Logger
 {
 public:
-    PcapLogger(TcpdumpModule*);
+    PcapLogger(TcpdumpModule*, SnortConfig*);
     ~PcapLogger() override;
 
     void open() override;
@@ -259,10 +333,16 @@ private:
     LtdConfig* config;
 };
 
-PcapLogger::PcapLogger(TcpdumpModule* m)
+PcapLogger::PcapLogger(TcpdumpModule* m, SnortConfig* sc)
 {
     config = new LtdConfig;
     config->limit = m->limit;
+    config->flush_size = m->flush_size;
+    config->flush_timeout = m->flush_timeout;
+    config->direct = m->direct;
+
+    new PcapFlushHandler(sc, THREAD_BATCH_EVENT_ID);
+    new PcapFlushHandler(sc, THREAD_IDLE_EVENT_ID);
 }
 
 PcapLogger::~PcapLogger()
@@ -272,6 +352,11 @@ PcapLogger::~PcapLogger()
 
 void PcapLogger::open()
 {
+    if ( !context.writer )
+    {
+        context.writer = new BatchWriter(
+            config->flush_size, config->flush_timeout * 1000, config->direct);
+    }
     TcpdumpInitLogFile(config, SnortConfig::output_no_timestamp());
 }
 
@@ -279,10 +364,13 @@ void PcapLogger::close()
 {
     SpoLogTcpdumpCleanup(nullptr);
 
-    if ( context.dumpd )
+    if ( context.writer )
     {
-        pcap_dump_close(context.dumpd);
-        context.dumpd = nullptr;
+        if ( !context.writer->close() and context.file )
+            ErrorMessage("%s: can't write %s: %s\n", S_NAME, context.file, get_error(errno));
+
+        delete context.writer;
+        context.writer = nullptr;
     }
     if ( context.file )
         snort_free(context.file);
@@ -290,7 +378,7 @@ void PcapLogger::close()
 
 void PcapLogger::log(Packet* p, const char* msg, Event* event)
 {
-    if(!context.dumpd)
+    if ( !context.writer or !context.writer->is_open() )
         open();
 
     context.log_cnt++;
@@ -302,7 +390,7 @@ void PcapLogger::log(Packet* p, const char* msg, Event* event)
 
 void PcapLogger::reset()
 {
-    if(!context.dumpd)
+    if ( !context.writer or !context.writer->is_open() )
         open();
     else
         TcpdumpRollLogFile(config);
@@ -318,8 +406,8 @@ static Module* mod_ctor()
 static void mod_dtor(Module* m)
 { delete m; }
 
-static Logger* tcpdump_ctor(SnortConfig*, Module* mod)
-{ return new PcapLogger((TcpdumpModule*)mod); }
+static Logger* tcpdump_ctor(SnortConfig* sc, Module* mod)
+{ return new PcapLogger((TcpdumpModule*)mod, sc); }
 
 static void tcpdump_dtor(Logger* p)
 { delete p; }
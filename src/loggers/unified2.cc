@@ -34,8 +34,10 @@
 #include "detection/signature.h"
 #include "detection/detection_util.h"
 #include "events/event.h"
+#include "framework/data_bus.h"
 #include "framework/logger.h"
 #include "framework/module.h"
+#include "log/batch_writer.h"
 #include "log/messages.h"
 #include "log/obfuscator.h"
 #include "log/unified2.h"
@@ -63,14 +65,16 @@ using namespace std;
 struct Unified2Config
 {
     size_t limit;
+    size_t flush_size;
+    unsigned flush_timeout;
     int nostamp;
     bool legacy_events;
+    bool direct;
 };
 
 struct U2
 {
-    FILE* stream;
-    unsigned int current;
+    BatchWriter* writer;
     int base_proto;
     uint32_t timestamp;
     char filepath[STD_BUF];
@@ -91,14 +95,6 @@ static THREAD_LOCAL uint8_t* write_pkt_buffer = nullptr;
     (MAX_XFF_WRITE_BUF_LENGTH - \
     sizeof(struct in6_addr) + DECODE_BLEN)
 
-/* This buffer is used in lieu of the underlying default stream buf to
- * prevent flushing in the middle of a record.  Every write is force
- * flushed to disk immediately after the entire record is written so
- * spoolers get an entire record */
-
-/* use the size of the buffer we copy record data into */
-static THREAD_LOCAL char* io_buffer = nullptr;
-
 /* -------------------- Local Functions -----------------------*/
 
 static void Unified2Write(uint8_t*, uint32_t, Unified2Config*);
@@ -127,24 +123,17 @@ static void Unified2InitFile(Unified2Config* config)
         fname_ptr = u2.filepath;
     }
 
-    if ((u2.stream = fopen(fname_ptr, "wb")) == nullptr)
-    {
-        FatalError("unified2 could not open %s: %s\n", fname_ptr, get_error(errno));
-    }
+    /* records pending for the current file are flushed to it first */
+    u2.writer->open(fname_ptr);
 
-    /* Set buffer to size of record buffer so the system doesn't flush
-     * part of a record if it's greater than BUFSIZ */
-    if (setvbuf(u2.stream, io_buffer, _IOFBF, u2_buf_sz) != 0)
+    if ( !u2.writer->is_open() )
     {
-        ErrorMessage("unified2 could not set I/O buffer: %s. "
-            "Using system default.\n", get_error(errno));
+        FatalError("unified2 could not open %s: %s\n", fname_ptr, get_error(errno));
     }
 }
 
 static inline void Unified2RotateFile(Unified2Config* config)
 {
-    fclose(u2.stream);
-    u2.current = 0;
     Unified2InitFile(config);
 }
 
@@ -229,7 +218,7 @@ static void alert_event(Packet* p, const char*, Unified2Config* config, const Ev
     Serial_Unified2_Header hdr;
     uint32_t write_len = sizeof(hdr) + sizeof(u2_event);
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
+    if ( config->limit && (u2.writer->get_size() + write_len) > config->limit )
         Unified2RotateFile(config);
 
     hdr.length = htonl(sizeof(Unified2Event));
@@ -275,7 +264,7 @@ static void _WriteExtraData(Unified2Config* config,
     if (write_len > sizeof(write_buffer))
         return;
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
+    if ( config->limit && (u2.writer->get_size() + write_len) > config->limit )
         Unified2RotateFile(config);
 
     hdr.length = htonl(write_len - sizeof(hdr));
@@ -370,7 +359,7 @@ static void _Unified2LogPacketAlert(
         logheader.packet_length = 0;
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
+    if ( config->limit && (u2.writer->get_size() + write_len) > config->limit )
         Unified2RotateFile(config);
 
     hdr.length = htonl(sizeof(Serial_Unified2Packet) - 4 + pkt_length + u2h_len);
@@ -418,21 +407,20 @@ static void _Unified2LogPacketAlert(
  *
  * Main function for writing to the unified2 file.
  *
- * For low level I/O errors, the current unified2 file is closed and a new
- * one created and a write to the new unified2 file is done.  It was found
- * that when writing to an NFS mounted share that is using a soft mount option,
- * writes sometimes fail and leave the unified2 file corrupted.  If the write
- * to the newly created unified2 file fails, Snort will fatal error.
+ * Records are batched by the BatchWriter and written with writev() once
+ * flush_size bytes are pending or the oldest record is flush_timeout ms
+ * old.  Flushes only write whole records so spoolers still see an entire
+ * record.  Interrupted writes are retried by the BatchWriter.
  *
- * In the case of interrupt errors, the write is retried, but only for a
- * finite number of times.
+ * For low level I/O errors, the current unified2 file is closed and a new
+ * one created and the pending records are written to the new unified2
+ * file.  It was found that when writing to an NFS mounted share that is
+ * using a soft mount option, writes sometimes fail and leave the unified2
+ * file corrupted.  If the write to the newly created unified2 file fails,
+ * Snort will fatal error.
  *
  * All other errors are treated as non-recoverable and Snort will fatal error.
  *
- * Upon successful completion of write, the length of the data written is
- * added to the current amount of total data written thus far to the
- * unified2 file.
- *
  * Arguments
  *  uint8_t *
  *      The buffer containing the data to write
@@ -444,138 +432,55 @@ static void _Unified2LogPacketAlert(
  * Returns: None
  *
  ******************************************************************************/
-static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config)
+static void Unified2Error(int error, Unified2Config* config)
 {
-    size_t fwcount = 0;
-    int ffstatus = 0;
+    if (config->nostamp)
+    {
+        ErrorMessage("unified2 failed to write to file (%s): %s\n",
+            u2.filepath, get_error(error));
+    }
+    else
+    {
+        ErrorMessage("unified2 failed to write to file (%s.%u): %s\n",
+            u2.filepath, u2.timestamp, get_error(error));
+    }
+}
 
+static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config)
+{
     /* Nothing to write or nothing to write to */
-    if ((buf == nullptr) || (config == nullptr) || (u2.stream == nullptr))
+    if ((buf == nullptr) || (config == nullptr) || (u2.writer == nullptr))
         return;
 
-    /* Don't use fsync().  It is a total performance killer */
-    if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) != 1) ||
-        ((ffstatus = fflush(u2.stream)) != 0))
-    {
-        /* errno is saved just to avoid other intervening calls
-         * (e.g. ErrorMessage) potentially resetting it to something else. */
-        int error = errno;
-        int max_retries = 3;
-
-        /* On iterations other than the first, the only non-zero error will be
-         * EINTR or interrupt.  Only iterate a maximum of max_retries times so
-         * there is no chance of infinite looping if for some reason the write
-         * is constantly interrupted */
-        while ((error != 0) && (max_retries != 0))
-        {
-            if (config->nostamp)
-            {
-                ErrorMessage("unified2 failed to write to file (%s): %s\n",
-                    u2.filepath, get_error(error));
-            }
-            else
-            {
-                ErrorMessage("unified2 failed to write to file (%s.%u): %s\n",
-                    u2.filepath, u2.timestamp, get_error(error));
-            }
+    if ( u2.writer->write(buf, buf_len) )
+        return;
 
-            while ((error == EINTR) && (max_retries != 0))
-            {
-                max_retries--;
-
-                /* Supposedly an interrupt can only occur before anything
-                 * has been written.  Try again */
-                if (fwcount != 1)
-                {
-                    /* fwrite() failed.  Redo fwrite and fflush */
-                    if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) == 1) &&
-                        ((ffstatus = fflush(u2.stream)) == 0))
-                    {
-                        error = 0;
-                        break;
-                    }
-                }
-                else if ((ffstatus = fflush(u2.stream)) == 0)
-                {
-                    error = 0;
-                    break;
-                }
-
-                error = errno;
-            }
+    int error = errno;
+    Unified2Error(error, config);
 
-            /* If we've reached the maximum number of interrupt retries,
-             * just bail out of the main while loop */
-            if (max_retries == 0)
-                continue;
+    if ( error != EIO )
+        FatalError("unified2 cannot write to device.\n");
 
-            switch (error)
-            {
-            case 0:
-                break;
-
-            case EIO:
-                ErrorMessage("unified2 file is possibly corrupt. "
-                    "Closing this unified2 file and creating a new one.\n");
-
-                Unified2RotateFile(config);
-
-                if (config->nostamp)
-                {
-                    ErrorMessage("unified2 rotated file: %s\n", u2.filepath);
-                }
-                else
-                {
-                    ErrorMessage("unified2 rotated file: %s.%u\n", u2.filepath, u2.timestamp);
-                }
-
-                if (((fwcount = fwrite(buf, (size_t)buf_len, 1, u2.stream)) == 1) &&
-                    ((ffstatus = fflush(u2.stream)) == 0))
-                {
-                    error = 0;
-                    break;
-                }
-
-                error = errno;
-
-                /* Loop again if interrupt */
-                if (error == EINTR)
-                    break;
-
-                /* Write out error message again, then fall through and fatal */
-                if (config->nostamp)
-                {
-                    ErrorMessage("unified2 failed to write to file (%s): %s\n",
-                        u2.filepath, get_error(error));
-                }
-                else
-                {
-                    ErrorMessage("unified2 failed to write to file (%s.%u): %s\n",
-                        u2.filepath, u2.timestamp, get_error(error));
-                }
-
-            /* Fall through */
-
-            case EAGAIN:      /* We're not in non-blocking mode */
-            case EBADF:
-            case EFAULT:
-            case EFBIG:
-            case EINVAL:
-            case ENOSPC:
-            case EPIPE:
-            default:
-                FatalError("unified2 cannot write to device.\n");
-            }
-        }
+    ErrorMessage("unified2 file is possibly corrupt. "
+        "Closing this unified2 file and creating a new one.\n");
 
-        if ((max_retries == 0) && (error != 0))
-        {
-            FatalError("unified2 cannot write to device. "
-                "Maximum number of interrupts exceeded.\n");
-        }
+    /* the records that couldn't be written are still pending */
+    Unified2RotateFile(config);
+
+    if (config->nostamp)
+    {
+        ErrorMessage("unified2 rotated file: %s\n", u2.filepath);
+    }
+    else
+    {
+        ErrorMessage("unified2 rotated file: %s.%u\n", u2.filepath, u2.timestamp);
     }
 
-    u2.current += buf_len;
+    if ( !u2.writer->flush() )
+    {
+        Unified2Error(errno, config);
+        FatalError("unified2 cannot write to device.\n");
+    }
 }
 
 //--------------------------------------------------------------------------
@@ -681,7 +586,7 @@ static void _AlertIP4_v2(Packet* p, const char*, Unified2Config* config, const E
                 app_name, strlen(app_name) + 1);
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
+    if ( config->limit && (u2.writer->get_size() + write_len) > config->limit )
         Unified2RotateFile(config);
 
     hdr.length = htonl(sizeof(alertdata));
@@ -769,7 +674,7 @@ static void _AlertIP6_v2(Packet* p, const char*, Unified2Config* config, const E
                 app_name, strlen(app_name) + 1);
     }
 
-    if ( config->limit && (u2.current + write_len) > config->limit )
+    if ( config->limit && (u2.writer->get_size() + write_len) > config->limit )
         Unified2RotateFile(config);
 
     hdr.length = htonl(sizeof(Unified2IDSEventIPv6));
@@ -790,6 +695,15 @@ static void _AlertIP6_v2(Packet* p, const char*, Unified2Config* config, const E
 
 static const Parameter s_params[] =
 {
+    { "direct", Parameter::PT_BOOL, nullptr, "false",
+      "bypass the page cache with O_DIRECT where supported" },
+
+    { "flush_size", Parameter::PT_INT, "0:max32", "0",
+      "write when this many bytes of records are pending (0 writes each record)" },
+
+    { "flush_timeout", Parameter::PT_INT, "0:60000", "1000",
+      "write pending records at least this often in milliseconds (0 is unlimited)" },
+
     { "legacy_events", Parameter::PT_BOOL, nullptr, "false",
       "generate Snort 2.X style events for barnyard2 compatibility" },
 
@@ -818,8 +732,11 @@ public:
 
 public:
     size_t limit;
+    size_t flush_size;
+    unsigned flush_timeout;
     bool nostamp;
     bool legacy_events;
+    bool direct;
 };
 
 bool U2Module::set(const char*, Value& v, SnortConfig*)
@@ -827,6 +744,15 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
     if ( v.is("limit") )
         limit = v.get_size() * 1024 * 1024;
 
+    else if ( v.is("flush_size") )
+        flush_size = v.get_uint32();
+
+    else if ( v.is("flush_timeout") )
+        flush_timeout = v.get_uint32();
+
+    else if ( v.is("direct") )
+        direct = v.get_bool();
+
     else if ( v.is("nostamp") )
         nostamp = v.get_bool();
 
@@ -842,8 +768,11 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
 bool U2Module::begin(const char*, int, SnortConfig*)
 {
     limit = 0;
+    flush_size = 0;
+    flush_timeout = 1000;
     nostamp = SnortConfig::output_no_timestamp();
     legacy_events = false;
+    direct = false;
     return true;
 }
 
@@ -851,10 +780,25 @@ bool U2Module::begin(const char*, int, SnortConfig*)
 // logger stuff
 //-------------------------------------------------------------------------
 
+// records that don't fill a batch are written after flush_timeout even if
+// nothing more is logged; checked after each batch of packets and when idle
+class U2FlushHandler : public DataHandler
+{
+public:
+    U2FlushHandler(SnortConfig* sc, DataEventId id) : DataHandler(S_NAME)
+    { DataBus::subscribe_default(id, this, sc); }
+
+    void handle(DataEvent&, Flow*) override
+    {
+        if ( u2.writer )
+            u2.writer->tick();
+    }
+};
+
 class U2Logger : public Logger
 {
 public:
-    U2Logger(U2Module*);
+    U2Logger(U2Module*, SnortConfig*);
 
     void open() override;
     void close() override;
@@ -870,11 +814,17 @@ private:
     Unified2Config config;
 };
 
-U2Logger::U2Logger(U2Module* m)
+U2Logger::U2Logger(U2Module* m, SnortConfig* sc)
 {
     config.limit = m->limit;
+    config.flush_size = m->flush_size;
+    config.flush_timeout = m->flush_timeout;
     config.nostamp = m->nostamp;
     config.legacy_events = m->legacy_events;
+    config.direct = m->direct;
+
+    new U2FlushHandler(sc, THREAD_BATCH_EVENT_ID);
+    new U2FlushHandler(sc, THREAD_IDLE_EVENT_ID);
 }
 
 
@@ -895,7 +845,7 @@ void U2Logger::open()
     u2.base_proto = htonl(SFDAQ::get_base_protocol());
 
     write_pkt_buffer = new uint8_t[u2_buf_sz];
-    io_buffer = new char[u2_buf_sz];
+    u2.writer = new BatchWriter(config.flush_size, config.flush_timeout * 1000, config.direct);
 
     Unified2InitFile(&config);
 
@@ -904,14 +854,15 @@ void U2Logger::open()
 
 void U2Logger::close()
 {
-    if ( u2.stream )
-        fclose(u2.stream);
+    if ( u2.writer and !u2.writer->close() )
+        ErrorMessage("unified2 failed to write to file (%s): %s\n",
+            u2.filepath, get_error(errno));
 
     delete[] write_pkt_buffer;
-    delete[] io_buffer;
+    delete u2.writer;
 
     write_pkt_buffer = nullptr;
-    io_buffer = nullptr;
+    u2.writer = nullptr;
 }
 
 void U2Logger::alert_legacy(Packet* p, const char* msg, const Event& event)
@@ -1006,8 +957,8 @@ static Module* mod_ctor()
 static void mod_dtor(Module* m)
 { delete m; }
 
-static Logger* u2_ctor(SnortConfig*, Module* mod)
-{ return new U2Logger((U2Module*)mod); }
+static Logger* u2_ctor(SnortConfig* sc, Module* mod)
+{ return new U2Logger((U2Module*)mod, sc); }
 
 static void u2_dtor(Logger* p)
 { delete p; }
@@ -28,6 +28,7 @@
 
 #include <thread>
 
+#include "decompress/decomp_pool.h"
 #include "detection/context_switcher.h"
 #include "detection/detect.h"
 #include "detection/detection_engine.h"
@@ -43,6 +44,7 @@
 #include "framework/data_bus.h"
 #include "latency/packet_latency.h"
 #include "latency/rule_latency.h"
+#include "log/async_writer.h"
 #include "log/messages.h"
 #include "main/swapper.h"
 #include "main.h"
@@ -60,7 +62,9 @@
 #include "pub_sub/finalize_packet_event.h"
 #include "side_channel/side_channel.h"
 #include "stream/stream.h"
+#include "time/clock_defs.h"
 #include "time/packet_time.h"
+#include "time/stopwatch.h"
 #include "utils/stats.h"
 
 #include "analyzer_command.h"
@@ -73,6 +77,7 @@ using namespace snort;
 using namespace std;
 
 static MainHook_f main_hook = snort_ignore;
+static const DataEventId finalize_packet_event = DataBus::get_id(FINALIZE_PACKET_EVENT);
 
 THREAD_LOCAL ProfileStats daqPerfStats;
 static THREAD_LOCAL Analyzer* local_analyzer = nullptr;
@@ -168,7 +173,19 @@ static void process_daq_sof_eof_msg(DAQ_Msg_h msg)
     else
         packet_time_update(&stats->sof_timestamp);
 
-    DataBus::publish(DAQ_META_EVENT, nullptr, daq_msg_get_type(msg), (const uint8_t*) stats);
+    DataBus::publish(DAQ_META_EVENT_ID, nullptr, daq_msg_get_type(msg), (const uint8_t*) stats);
+}
+
+// packets are only hashed here; decode still happens one at a time when the
+// packet is processed since it needs the packet's context
+static void prefetch_flow(DAQ_Msg_h msg, int dlt)
+{
+    if (!msg || daq_msg_get_type(msg) != DAQ_MSG_TYPE_PACKET)
+        return;
+
+    const DAQ_PktHdr_t* pkthdr = daq_msg_get_pkthdr(msg);
+    Stream::prefetch_flow(dlt, daq_msg_get_data(msg), daq_msg_get_data_len(msg),
+        pkthdr->address_space_id);
 }
 
 static bool process_packet(Packet* p)
@@ -304,7 +321,7 @@ void Analyzer::post_process_daq_pkt_msg(Packet* p)
         if (p->flow and p->flow->trigger_finalize_event)
         {
             FinalizePacketEvent event(p, verdict);
-            DataBus::publish(FINALIZE_PACKET_EVENT, event);
+            DataBus::publish(finalize_packet_event, event);
         }
         {
             Profile profile(daqPerfStats);
@@ -463,7 +480,7 @@ const char* Analyzer::get_state_string()
 void Analyzer::idle()
 {
     // FIXIT-L this whole thing could be pub-sub
-    DataBus::publish(THREAD_IDLE_EVENT, nullptr);
+    DataBus::publish(THREAD_IDLE_EVENT_ID, nullptr);
     if (SnortConfig::read_mode())
         Stream::timeout_flows(packet_time());
     else
@@ -503,6 +520,8 @@ void Analyzer::init_unprivileged()
     EventTrace_Init();
     detection_filter_init(sc->detection_filter_config);
 
+    AsyncWriter::thread_init(sc);
+    DecompPool::thread_init(sc->decomp_max_idle);
     EventManager::open_outputs();
     IpsManager::setup_options();
     ActionManager::thread_init(sc);
@@ -519,6 +538,8 @@ void Analyzer::init_unprivileged()
     // init filters hash tables that depend on alerts
     sfthreshold_alloc(sc->threshold_config->memcap, sc->threshold_config->memcap);
     SFRF_Alloc(sc->rate_filter_config->memcap);
+
+    Profiler::thread_init();
 }
 
 void Analyzer::reinit(SnortConfig* sc)
@@ -544,6 +565,8 @@ void Analyzer::term()
 
     IpsManager::clear_options();
     EventManager::close_outputs();
+    AsyncWriter::thread_term();
+    DecompPool::thread_term();
     CodecManager::thread_term();
     HighAvailabilityManager::thread_term();
     SideChannelManager::thread_term();
@@ -566,6 +589,7 @@ void Analyzer::term()
     RuleLatency::tterm();
 
     Profiler::consolidate_stats();
+    Profiler::thread_term();
 
     DetectionEngine::thread_term();
     detection_filter_term();
@@ -725,10 +749,26 @@ DAQ_RecvStatus Analyzer::process_messages()
         rstat = daq_instance->receive_messages(max_recv);
     }
 
+    Stopwatch<SnortClock> batch_timer;
+    batch_timer.start();
+
+    // Prefetch the flows for the first few packets of the batch, then keep
+    // prefetching depth packets ahead of the one being processed.
+    unsigned prefetch_depth = daq_instance->get_prefetch_depth();
+    int dlt = daq_instance->get_base_protocol();
+
+    for (unsigned i = 0; i < prefetch_depth; i++)
+        prefetch_flow(daq_instance->peek_message(i), dlt);
+
     unsigned num_recv = 0;
+    unsigned num_msgs = 0;
     DAQ_Msg_h msg;
     while ((msg = daq_instance->next_message()) != nullptr)
     {
+        num_msgs++;
+        if (prefetch_depth)
+            prefetch_flow(daq_instance->peek_message(prefetch_depth - 1), dlt);
+
         // Dispose of any messages to be skipped first.
         if (skip_cnt > 0)
         {
@@ -747,6 +787,19 @@ DAQ_RecvStatus Analyzer::process_messages()
         handle_uncompleted_commands();
     }
 
+    if (num_msgs)
+    {
+        PegCount usecs = clock_usecs(TO_USECS(batch_timer.get()));
+        aux_counts.batches++;
+        aux_counts.batch_usecs += usecs;
+        if (usecs > aux_counts.max_batch_usecs)
+            aux_counts.max_batch_usecs = usecs;
+    }
+
+    // the idle event only comes on a receive timeout; this one lets time
+    // based work such as log flushes keep up under traffic
+    DataBus::publish(THREAD_BATCH_EVENT_ID, nullptr);
+
     if (exit_after_cnt && (exit_after_cnt -= num_recv) == 0)
         stop();
     if (pause_after_cnt && (pause_after_cnt -= num_recv) == 0)
@@ -865,5 +918,5 @@ void Analyzer::reload_daq()
 
 void Analyzer::rotate()
 {
-    DataBus::publish(THREAD_ROTATE_EVENT, nullptr);
+    DataBus::publish(THREAD_ROTATE_EVENT_ID, nullptr);
 }
@@ -28,6 +28,7 @@
 #include <sys/resource.h>
 
 #include "codecs/codec_module.h"
+#include "decompress/decomp_pool.h"
 #include "detection/fp_config.h"
 #include "filters/detection_filter.h"
 #include "filters/rate_filter.h"
@@ -39,6 +40,7 @@
 #include "host_tracker/host_tracker_module.h"
 #include "host_tracker/host_cache_module.h"
 #include "latency/latency_module.h"
+#include "log/async_writer.h"
 #include "log/messages.h"
 #include "managers/module_manager.h"
 #include "managers/plugin_manager.h"
@@ -85,7 +87,7 @@ static const Parameter detection_params[] =
       "minimum sizeof PDU to offload fast pattern search (defaults to disabled)" },
 
     { "offload_threads", Parameter::PT_INT, "0:max32", "0",
-      "maximum number of simultaneous offloads (defaults to disabled)" },
+      "number of offload threads shared by all packet threads and maximum simultaneous offloads per packet thread (defaults to disabled)" },
 
     { "pcre_enable", Parameter::PT_BOOL, nullptr, "true",
       "disable pcre pattern matching" },
@@ -113,7 +115,6 @@ public:
         Module("detection", detection_help, detection_params, false, &TRACE_NAME(detection)) {}
 
     bool set(const char*, Value&, SnortConfig*) override;
-    bool end(const char*, int, SnortConfig*) override;
 
     const PegInfo* get_pegs() const override
     { return pc_names; }
@@ -125,14 +126,6 @@ public:
     { return GLOBAL; }
 };
 
-bool DetectionModule::end(const char*, int, SnortConfig* sc)
-{
-    if ( sc->offload_threads and ThreadConfig::get_instance_max() != 1 )
-        ParseError("You can not enable experimental offload with more than one packet thread.");
-
-    return true;
-}
-
 bool DetectionModule::set(const char* fqn, Value& v, SnortConfig* sc)
 {
     if ( v.is("asn1") )
@@ -281,6 +274,9 @@ static const Parameter search_engine_params[] =
     { "enable_single_rule_group", Parameter::PT_BOOL, nullptr, "false",
       "put all rules into one group" },
 
+    { "compile_threads", Parameter::PT_INT, "0:256", "0",
+      "number of threads used to compile rule groups (0 means one per cpu)" },
+
     { "debug", Parameter::PT_BOOL, nullptr, "false",
       "print verbose fast pattern info" },
 
@@ -314,6 +310,12 @@ static const Parameter search_engine_params[] =
     { "search_optimize", Parameter::PT_BOOL, nullptr, "true",
       "tweak state machine construction for better performance" },
 
+    { "reuse_rule_dbs", Parameter::PT_BOOL, nullptr, "true",
+      "share compiled search engine state of unchanged rule groups across reloads" },
+
+    { "rule_db_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for compiled search engine databases reused across restarts and processes" },
+
     { "show_fast_patterns", Parameter::PT_BOOL, nullptr, "false",
       "print fast pattern info for each rule" },
 
@@ -376,6 +378,9 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
         if ( v.get_bool() )
             fp->set_single_rule_group();
     }
+    else if ( v.is("compile_threads") )
+        fp->set_compile_threads(v.get_uint16());
+
     else if ( v.is("debug") )
     {
         if ( v.get_bool() )
@@ -423,6 +428,12 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("search_optimize") )
         fp->set_search_opt(v.get_bool());
 
+    else if ( v.is("reuse_rule_dbs") )
+        fp->set_reuse_rule_dbs(v.get_bool());
+
+    else if ( v.is("rule_db_dir") )
+        fp->set_rule_db_dir(v.get_string());
+
     else if ( v.is("show_fast_patterns") )
         fp->set_debug_print_fast_patterns(v.get_bool());
 
@@ -491,6 +502,17 @@ static const Parameter profiler_rule_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter profiler_sample_params[] =
+{
+    { "rate", Parameter::PT_INT, "0:10000", "0",
+      "packet thread samples per second (0 = disabled)" },
+
+    { "file", Parameter::PT_STRING, nullptr, "profile.folded",
+      "folded stacks are written to this file in the log directory" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
 static const Parameter profiler_params[] =
 {
     { "modules", Parameter::PT_TABLE, profiler_time_params, nullptr,
@@ -502,6 +524,9 @@ static const Parameter profiler_params[] =
     { "rules", Parameter::PT_TABLE, profiler_rule_params, nullptr,
       "rule time profiling" },
 
+    { "sample", Parameter::PT_TABLE, profiler_sample_params, nullptr,
+      "low overhead sampling of modules and rules" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -555,6 +580,7 @@ bool ProfilerModule::set(const char* fqn, Value& v, SnortConfig* sc)
     const char* spt = "profiler.modules";
     const char* spm = "profiler.memory";
     const char* spr = "profiler.rules";
+    const char* sps = "profiler.sample";
 
     if ( !strncmp(fqn, spt, strlen(spt)) )
         return s_profiler_module_set(sc->profiler->time, v);
@@ -565,6 +591,20 @@ bool ProfilerModule::set(const char* fqn, Value& v, SnortConfig* sc)
     else if ( !strncmp(fqn, spr, strlen(spr)) )
         return s_profiler_module_set(sc->profiler->rule, v);
 
+    else if ( !strncmp(fqn, sps, strlen(sps)) )
+    {
+        if ( v.is("rate") )
+            sc->profiler->sample.rate = v.get_uint32();
+
+        else if ( v.is("file") )
+            sc->profiler->sample.file = v.get_string();
+
+        else
+            return false;
+
+        return true;
+    }
+
     return false;
 }
 
@@ -828,8 +868,25 @@ static const Parameter output_event_trace_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter output_async_params[] =
+{
+    { "ring_size", Parameter::PT_INT, "0:max32", "0",
+      "log records each packet thread can queue for the writer threads (0 writes from the packet threads)" },
+
+    { "policy", Parameter::PT_ENUM, "drop | block | count", "block",
+      "when a ring is full drop the record, wait for room, or drop it and count it as an overflow" },
+
+    { "writers", Parameter::PT_INT, "1:32", "1",
+      "number of writer threads" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
 static const Parameter output_params[] =
 {
+    { "async", Parameter::PT_TABLE, output_async_params, nullptr,
+      "write text logs from dedicated threads" },
+
     { "dump_chars_only", Parameter::PT_BOOL, nullptr, "false",
       "turns on character dumps (same as -C)" },
 
@@ -879,6 +936,12 @@ public:
     OutputModule() : Module("output", output_help, output_params) { }
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return AsyncWriter::get_pegs(); }
+
+    PegCount* get_counts() const override
+    { return AsyncWriter::get_counts(); }
+
     Usage get_usage() const override
     { return GLOBAL; }
 };
@@ -918,6 +981,57 @@ bool OutputModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("obfuscate") )
         v.update_mask(sc->output_flags, OUTPUT_FLAG__OBFUSCATE);
 
+    else if ( v.is("ring_size") )
+        sc->async_log_ring = v.get_uint32();
+
+    else if ( v.is("policy") )
+        sc->async_log_policy = v.get_uint8();
+
+    else if ( v.is("writers") )
+        sc->async_log_writers = v.get_uint8();
+
+    else
+        return false;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// decompress module
+//-------------------------------------------------------------------------
+
+static const Parameter decompress_params[] =
+{
+    { "max_idle_contexts", Parameter::PT_INT, "0:256", "8",
+      "inflate contexts kept per packet thread for reuse (0 disables pooling)" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+#define decompress_help \
+    "configure the decompression contexts shared by file decompression and inspectors"
+
+class DecompressModule : public Module
+{
+public:
+    DecompressModule() : Module("decompress", decompress_help, decompress_params) { }
+    bool set(const char*, Value&, SnortConfig*) override;
+
+    const PegInfo* get_pegs() const override
+    { return DecompPool::get_pegs(); }
+
+    PegCount* get_counts() const override
+    { return DecompPool::get_counts(); }
+
+    Usage get_usage() const override
+    { return GLOBAL; }
+};
+
+bool DecompressModule::set(const char*, Value& v, SnortConfig* sc)
+{
+    if ( v.is("max_idle_contexts") )
+        sc->decomp_max_idle = v.get_uint16();
+
     else
         return false;
 
@@ -2042,6 +2156,7 @@ void module_init()
     // these modules are not policy specific
     ModuleManager::add_module(new ClassificationsModule);
     ModuleManager::add_module(new CodecModule);
+    ModuleManager::add_module(new DecompressModule);
     ModuleManager::add_module(new DetectionModule);
     ModuleManager::add_module(new MemoryModule);
     ModuleManager::add_module(new PacketTracerModule);
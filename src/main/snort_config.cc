@@ -334,6 +334,12 @@ void SnortConfig::setup()
     IpsManager::verify(this);
     ModuleManager::load_commands(policy_map->get_shell());
 
+    // offload threads are shared by all packet threads but async engines
+    // may return a response to any packet thread
+    if ( offload_threads and ThreadConfig::get_instance_max() != 1 and
+        DetectionEngine::offload_is_async(this) )
+        ParseError("You can not enable async search engine offload with more than one packet thread.");
+
     fpCreateFastPacketDetection(this);
 }
 
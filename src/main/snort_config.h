@@ -217,6 +217,12 @@ public:
     uint32_t tagged_packet_limit = 256;
     uint16_t event_trace_max = 0;
 
+    uint32_t async_log_ring = 0;     // disabled
+    uint8_t async_log_policy = 1;    // AsyncWriter::BLOCK
+    uint8_t async_log_writers = 1;
+
+    uint16_t decomp_max_idle = 8;    // pooled contexts per packet thread
+
     std::string log_dir;
 
     //------------------------------------------------------
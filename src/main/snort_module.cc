@@ -601,7 +601,6 @@ public:
 
     bool begin(const char*, int, SnortConfig*) override;
     bool set(const char*, Value&, SnortConfig*) override;
-    bool end(const char*, int, SnortConfig*) override;
 
     const PegInfo* get_pegs() const override
     { return proc_names; }
@@ -1047,14 +1046,6 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
     return true;
 }
 
-bool SnortModule::end(const char*, int, SnortConfig* sc)
-{
-    if ( sc->offload_threads and ThreadConfig::get_instance_max() != 1 )
-        ParseError("You can not enable experimental offload with more than one packet thread.");
-
-    return true;
-}
-
 ProfileStats* SnortModule::get_profile(
     unsigned index, const char*& name, const char*& parent) const
 {
@@ -1004,7 +1004,7 @@ void InspectorManager::bumble(Packet* p)
 {
     Flow* flow = p->flow;
 
-    DataBus::publish(FLOW_SERVICE_CHANGE_EVENT, p);
+    DataBus::publish(FLOW_SERVICE_CHANGE_EVENT_ID, p);
 
     flow->clear_clouseau();
 
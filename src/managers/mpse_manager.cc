@@ -184,6 +184,12 @@ bool MpseManager::is_regex_capable(const MpseApi* api)
     return (api->flags & MPSE_REGEX) != 0;
 }
 
+bool MpseManager::is_mt_build_capable(const MpseApi* api)
+{
+    assert(api);
+    return (api->flags & MPSE_MTBLD) != 0;
+}
+
 bool MpseManager::is_poll_capable(const MpseApi* api)
 {
     assert(api);
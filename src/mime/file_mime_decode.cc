@@ -156,12 +156,10 @@ DecodeResult MimeDecode::decompress_data(const uint8_t* buf_in, uint32_t size_in
         return result;
 
     uint8_t* decompress_buf = MimeDecodeContextData::get_decompress_buf();
-    fd_state->Next_In = buf_in;
-    fd_state->Avail_In = size_in;
-    fd_state->Next_Out = decompress_buf;
-    fd_state->Avail_Out = MAX_DEPTH;
+    uint32_t decompressed;
 
-    const fd_status_t status = File_Decomp(fd_state);
+    const fd_status_t status = File_Decomp_Run(fd_state, buf_in, size_in,
+        decompress_buf, MAX_DEPTH, &decompressed);
 
     switch ( status )
     {
@@ -173,7 +171,7 @@ DecodeResult MimeDecode::decompress_data(const uint8_t* buf_in, uint32_t size_in
         break;
     default:
         buf_out = decompress_buf;
-        size_out = fd_state->Next_Out - decompress_buf;
+        size_out = decompressed;
         break;
     }
 
@@ -53,6 +53,8 @@
 
 using namespace snort;
 
+static const DataEventId appid_change_event = DataBus::get_id(APPID_EVENT_ANY_CHANGE);
+
 AppIdDiscovery::AppIdDiscovery()
 {
     tcp_patterns = new SearchTool("ac_full", true);
@@ -165,7 +167,7 @@ void AppIdDiscovery::publish_appid_event(AppidChangeBits& change_bits, snort::Fl
         return;
 
     AppidEvent app_event(change_bits);
-    DataBus::publish(APPID_EVENT_ANY_CHANGE, app_event, flow);
+    DataBus::publish(appid_change_event, app_event, flow);
     if (appidDebug->is_active())
     {
         std::string str;
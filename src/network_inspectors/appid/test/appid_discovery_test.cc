@@ -105,7 +105,8 @@ void IpApi::set(const SfIp& sip, const SfIp& dip)
 // Stubs for publish
 static bool databus_publish_called = false;
 static char test_log[256];
-void DataBus::publish(const char*, DataEvent& event, Flow*)
+DataEventId DataBus::get_id(const char*) { return 0; }
+void DataBus::publish(DataEventId, DataEvent& event, Flow*)
 {
     databus_publish_called = true;
     AppidEvent* appid_event = (AppidEvent*)&event;
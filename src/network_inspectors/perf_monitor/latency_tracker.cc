@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// latency_tracker.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "latency_tracker.h"
+
+#include "latency/packet_latency.h"
+#include "latency/rule_latency.h"
+#include "profiler/profiler_defs.h"
+#include "time/clock_defs.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+#define TRACKER_NAME PERF_NAME "_latency"
+
+using namespace snort;
+
+LatencyTracker::LatencyTracker(PerfConfig* perf) : PerfTracker(perf, TRACKER_NAME)
+{
+    packet = add_section("packet");
+    rule = add_section("rule");
+
+    for ( ModuleConfig& mod : perf->modules )
+    {
+        if ( mod.ptr->get_usage() != Module::INSPECT )
+            continue;
+
+        ProfileStats* ps = mod.ptr->get_profile();
+
+        if ( !ps or ps->time.hist )
+            continue;
+
+        Section* s = add_section(mod.ptr->get_name());
+        s->profile = ps;
+        ps->time.hist = &s->hist;
+    }
+    formatter->finalize_fields();
+
+    PacketLatency::set_histogram(&packet->hist);
+    RuleLatency::set_histogram(&rule->hist);
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    PacketLatency::set_histogram(nullptr);
+    RuleLatency::set_histogram(nullptr);
+
+    for ( auto s : sections )
+    {
+        if ( s->profile )
+            s->profile->time.hist = nullptr;
+
+        delete s;
+    }
+}
+
+LatencyTracker::Section* LatencyTracker::add_section(const std::string& name)
+{
+    Section* s = new Section;
+    sections.emplace_back(s);
+
+    formatter->register_section(name);
+    formatter->register_field("count", &s->count);
+    formatter->register_field("p50", &s->p50);
+    formatter->register_field("p90", &s->p90);
+    formatter->register_field("p99", &s->p99);
+    formatter->register_field("p999", &s->p999);
+    formatter->register_field("max", &s->max);
+
+    return s;
+}
+
+void LatencyTracker::reset()
+{
+    for ( auto s : sections )
+        s->hist.reset();
+}
+
+void LatencyTracker::process(bool)
+{
+    for ( auto s : sections )
+    {
+        const LatencyHistogram& h = s->hist;
+
+        s->count = h.get_count();
+        s->p50 = clock_nsecs(h.get_quantile(0.5));
+        s->p90 = clock_nsecs(h.get_quantile(0.9));
+        s->p99 = clock_nsecs(h.get_quantile(0.99));
+        s->p999 = clock_nsecs(h.get_quantile(0.999));
+        s->max = clock_nsecs(h.get_max());
+    }
+
+    write();
+
+    for ( auto s : sections )
+        s->hist.reset();
+}
+
+#ifdef UNIT_TEST
+
+class TestLatencyTracker : public LatencyTracker
+{
+public:
+    PerfFormatter* output;
+
+    TestLatencyTracker(PerfConfig* perf) : LatencyTracker(perf)
+    { output = formatter; }
+
+    LatencyHistogram& get_packet()
+    { return packet->hist; }
+};
+
+TEST_CASE("latency quantiles", "[latency_tracker]")
+{
+    PerfConfig config;
+    config.format = PerfFormat::MOCK;
+    TestLatencyTracker tracker(&config);
+    MockFormatter* formatter = (MockFormatter*)tracker.output;
+
+    tracker.reset();
+
+    for ( uint64_t v = 1; v <= 100; ++v )
+        tracker.get_packet().record(v);
+
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["packet.count"].pc == 100);
+    CHECK(*formatter->public_values["packet.max"].pc == clock_nsecs(100));
+    CHECK(*formatter->public_values["packet.p50"].pc <= clock_nsecs(53));
+    CHECK(*formatter->public_values["packet.p50"].pc >= clock_nsecs(50));
+    CHECK(*formatter->public_values["rule.count"].pc == 0);
+
+    tracker.process(false);
+    CHECK(*formatter->public_values["packet.count"].pc == 0);
+    CHECK(*formatter->public_values["packet.p99"].pc == 0);
+}
+
+#endif
+
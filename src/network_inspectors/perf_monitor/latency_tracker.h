@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// latency_tracker.h
+
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+// reports latency quantiles (in nanoseconds) for packets, rule tree
+// evaluations, and each profiled inspector.  the histograms are owned here
+// and fed on this packet thread by PacketLatency, RuleLatency, and the
+// inspector's TimeProfilerStats so they only fill when latency and/or
+// time profiling are enabled.
+
+#include "time/latency_histogram.h"
+
+#include "perf_tracker.h"
+
+namespace snort
+{
+struct ProfileStats;
+}
+
+class LatencyTracker : public PerfTracker
+{
+public:
+    LatencyTracker(PerfConfig*);
+    ~LatencyTracker() override;
+
+    void reset() override;
+    void process(bool) override;
+
+protected:
+    struct Section
+    {
+        LatencyHistogram hist;
+        snort::ProfileStats* profile = nullptr;
+
+        PegCount count = 0;
+        PegCount p50 = 0;
+        PegCount p90 = 0;
+        PegCount p99 = 0;
+        PegCount p999 = 0;
+        PegCount max = 0;
+    };
+
+    Section* packet;
+    Section* rule;
+
+private:
+    Section* add_section(const std::string&);
+
+    std::vector<Section*> sections;
+};
+
+#endif
+
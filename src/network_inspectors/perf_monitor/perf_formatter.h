@@ -42,6 +42,10 @@
 // init_output should be implemented where metadata needs to be written on
 // output open.
 //
+// formatters that map their own file rather than writing to a FILE return
+// true from is_mapped and open the file in map_output instead of
+// init_output.  write is then called with a null FILE.
+//
 
 #include <ctime>
 #include <string>
@@ -79,6 +83,12 @@ public:
     virtual std::string get_tracker_name() final
     { return tracker_name; }
 
+    virtual bool is_mapped()
+    { return false; }
+
+    virtual bool map_output(const std::string&)
+    { return false; }
+
     virtual void register_section(const std::string&);
     virtual void register_field(const std::string&, PegCount*);
     virtual void register_field(const std::string&, const char*);
@@ -30,11 +30,41 @@
 
 #include "perf_module.h"
 
+#include <lua.hpp>
+
 #include "log/messages.h"
 #include "managers/module_manager.h"
 
+#include "rule_cost_tracker.h"
+
 using namespace snort;
 
+//-------------------------------------------------------------------------
+// perf commands
+//-------------------------------------------------------------------------
+
+static int show_rule_costs(lua_State* L)
+{
+    RuleCostTracker::show(luaL_optinteger(L, 1, 0));
+    return 0;
+}
+
+static const Parameter rule_cost_params[] =
+{
+    { "count", Parameter::PT_INT, "0:max32", "0",
+      "number of rules to show (0 = all reported)" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const Command perf_cmds[] =
+{
+    { "rule_costs", show_rule_costs, rule_cost_params,
+      "show the most expensive rules of the last interval" },
+
+    { nullptr, nullptr, nullptr, nullptr }
+};
+
 //-------------------------------------------------------------------------
 // perf attributes
 //-------------------------------------------------------------------------
@@ -64,6 +94,15 @@ static const Parameter s_params[] =
     { "flow_ip", Parameter::PT_BOOL, nullptr, "false",
       "enable statistics on host pairs" },
 
+    { "latency", Parameter::PT_BOOL, nullptr, "false",
+      "enable packet, rule, and inspector latency quantiles" },
+
+    { "rules", Parameter::PT_BOOL, nullptr, "false",
+      "enable reporting of the most expensive rules of each interval" },
+
+    { "rule_count", Parameter::PT_INT, "1:1000", "10",
+      "number of rules to report per interval" },
+
     { "packets", Parameter::PT_INT, "0:max32", "10000",
       "minimum packets to report" },
 
@@ -85,9 +124,12 @@ static const Parameter s_params[] =
     { "modules", Parameter::PT_LIST, module_params, nullptr,
       "gather statistics from the specified modules" },
 
-    { "format", Parameter::PT_ENUM, "csv | text | json" FLATBUFFERS_ENUM, "csv",
+    { "format", Parameter::PT_ENUM, "csv | text | json | ring" FLATBUFFERS_ENUM, "csv",
       "output format for stats" },
 
+    { "ring_size", Parameter::PT_INT, "2:max32", "4096",
+      "number of records kept in each ring format file" },
+
     { "summary", Parameter::PT_BOOL, nullptr, "false",
       "output summary at shutdown" },
 
@@ -108,6 +150,9 @@ PerfMonModule::~PerfMonModule()
         delete config;
 }
 
+const Command* PerfMonModule::get_commands() const
+{ return perf_cmds; }
+
 ProfileStats* PerfMonModule::get_profile() const
 { return &perfmonStats; }
 
@@ -136,6 +181,20 @@ bool PerfMonModule::set(const char*, Value& v, SnortConfig*)
         if ( v.get_bool() )
             config->perf_flags |= PERF_FLOWIP;
     }
+    else if ( v.is("latency") )
+    {
+        if ( v.get_bool() )
+            config->perf_flags |= PERF_LATENCY;
+    }
+    else if ( v.is("rules") )
+    {
+        if ( v.get_bool() )
+            config->perf_flags |= PERF_RULES;
+    }
+    else if ( v.is("rule_count") )
+    {
+        config->rule_count = v.get_uint32();
+    }
     else if ( v.is("packets") )
     {
         config->pkt_cnt = v.get_uint32();
@@ -165,6 +224,10 @@ bool PerfMonModule::set(const char*, Value& v, SnortConfig*)
     {
         config->format = (PerfFormat)v.get_uint8();
     }
+    else if ( v.is("ring_size") )
+    {
+        config->ring_size = v.get_uint32();
+    }
     else if ( v.is("name") )
     {
         config->modules.back().set_name(v.get_string());
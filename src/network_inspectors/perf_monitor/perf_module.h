@@ -36,6 +36,8 @@
 #define PERF_BASE_MAX   0x00000010
 #define PERF_FLOWIP     0x00000020
 #define PERF_SUMMARY    0x00000040
+#define PERF_LATENCY    0x00000080
+#define PERF_RULES      0x00000100
 
 #define ROLLOVER_THRESH     512
 #define MAX_PERF_FILE_SIZE  UINT64_MAX
@@ -46,6 +48,7 @@ enum class PerfFormat
     CSV,
     TEXT,
     JSON,
+    RING,
     FBS,
     MOCK
 };
@@ -81,6 +84,8 @@ struct PerfConfig
     uint64_t max_file_size = 0;
     int flow_max_port_to_track = 0;
     size_t flowip_memcap = 0;
+    unsigned rule_count = 10;
+    uint32_t ring_size = 4096;
     PerfFormat format = PerfFormat::CSV;
     PerfOutput output = PerfOutput::TO_FILE;
     std::vector<ModuleConfig> modules;
@@ -100,6 +105,7 @@ public:
     bool begin(const char*, int, snort::SnortConfig*) override;
     bool end(const char*, int, snort::SnortConfig*) override;
 
+    const snort::Command* get_commands() const override;
     const PegInfo* get_pegs() const override;
     PegCount* get_counts() const override;
     snort::ProfileStats* get_profile() const override;
@@ -38,7 +38,9 @@
 #include "cpu_tracker.h"
 #include "flow_ip_tracker.h"
 #include "flow_tracker.h"
+#include "latency_tracker.h"
 #include "perf_module.h"
+#include "rule_cost_tracker.h"
 
 #ifdef UNIT_TEST
 #include "catch/snort_catch.h"
@@ -170,6 +172,14 @@ void PerfMonitor::show(SnortConfig*)
     }
     LogMessage("  CPU Stats:    %s\n",
         (config->perf_flags & PERF_CPU) ? "ACTIVE" : "INACTIVE");
+    LogMessage("  Latency Stats:    %s\n",
+        (config->perf_flags & PERF_LATENCY) ? "ACTIVE" : "INACTIVE");
+    LogMessage("  Rule Costs:       %s\n",
+        (config->perf_flags & PERF_RULES) ? "ACTIVE" : "INACTIVE");
+    if (config->perf_flags & PERF_RULES)
+    {
+        LogMessage("    Rule Count:       %u\n", config->rule_count);
+    }
     switch ( config->output )
     {
         case PerfOutput::TO_CONSOLE:
@@ -190,6 +200,10 @@ void PerfMonitor::show(SnortConfig*)
         case PerfFormat::JSON:
             LogMessage("    Output Format:  json\n");
             break;
+        case PerfFormat::RING:
+            LogMessage("    Output Format:  ring\n");
+            LogMessage("    Ring Size:      %u\n", config->ring_size);
+            break;
 #ifdef HAVE_FLATBUFFERS
         case PerfFormat::FBS:
             LogMessage("    Output Format:  flatbuffers\n");
@@ -246,6 +260,12 @@ void PerfMonitor::tinit()
     if (config->perf_flags & PERF_CPU )
         trackers->emplace_back(new CPUTracker(config));
 
+    if (config->perf_flags & PERF_LATENCY )
+        trackers->emplace_back(new LatencyTracker(config));
+
+    if (config->perf_flags & PERF_RULES )
+        trackers->emplace_back(new RuleCostTracker(config));
+
     for (unsigned i = 0; i < trackers->size(); i++)
     {
         if (!(*trackers)[i]->open(true))
@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// perf_ring.h
+
+#ifndef PERF_RING_H
+#define PERF_RING_H
+
+// layout of the perf_monitor ring format file.  this is shared with
+// tools/perfring so keep it free of other snort dependencies.
+//
+// the file is a header page, the column names, and then one array of
+// capacity uint64_t values per column.  the arrays are back to back
+// starting on the page boundary at data_offset.  column 0 is the
+// timestamp.  record n (counting from the creation of the file) is in slot
+// n % capacity of every column.  the writer fills in a slot and then
+// publishes it by advancing count (release).  a reader loads count
+// (acquire), copies slots, issues an acquire fence, reloads count, and
+// discards any record the writer may have reused in the meantime
+// (n + capacity <= count, since record count may be in progress).
+//
+// values are stored in host byte order.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace perf_ring
+{
+static const uint32_t version = 1;
+static const size_t page_size = 4096;
+static const size_t name_size = 64;  // per column, nul terminated
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;              // including the timestamp
+    uint64_t capacity;             // records per column
+    uint64_t data_offset;          // of column 0
+    std::atomic<uint64_t> count;   // records written since creation
+};
+
+static_assert(sizeof(Header) <= page_size, "header fits on first page");
+
+inline void set_magic(Header* h)
+{ memcpy(h->magic, "SNORTPRF", sizeof(h->magic)); }
+
+inline bool check_magic(const Header* h)
+{ return !memcmp(h->magic, "SNORTPRF", sizeof(h->magic)); }
+
+inline size_t get_data_offset(uint32_t columns)
+{
+    size_t n = page_size + columns * name_size;
+    return (n + page_size - 1) & ~(page_size - 1);
+}
+
+inline size_t get_file_size(uint32_t columns, uint64_t capacity)
+{ return get_data_offset(columns) + columns * capacity * sizeof(uint64_t); }
+
+inline char* get_name(uint8_t* base, unsigned col)
+{ return (char*)(base + page_size + col * name_size); }
+
+inline const char* get_name(const uint8_t* base, unsigned col)
+{ return (const char*)(base + page_size + col * name_size); }
+
+inline uint64_t* get_column(uint8_t* base, const Header* h, unsigned col)
+{ return (uint64_t*)(base + h->data_offset) + col * h->capacity; }
+
+inline const uint64_t* get_column(const uint8_t* base, const Header* h, unsigned col)
+{ return (const uint64_t*)(base + h->data_offset) + col * h->capacity; }
+}
+
+#endif
+
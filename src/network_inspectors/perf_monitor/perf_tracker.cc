@@ -39,6 +39,7 @@
 
 #include "csv_formatter.h"
 #include "json_formatter.h"
+#include "ring_formatter.h"
 #include "text_formatter.h"
 
 using namespace snort;
@@ -69,6 +70,7 @@ PerfTracker::PerfTracker(PerfConfig* config, const char* tracker_name)
         case PerfFormat::CSV: formatter = new CSVFormatter(tracker_name); break;
         case PerfFormat::TEXT: formatter = new TextFormatter(tracker_name); break;
         case PerfFormat::JSON: formatter = new JSONFormatter(tracker_name); break;
+        case PerfFormat::RING: formatter = new RingFormatter(tracker_name, config->ring_size); break;
 #ifdef HAVE_FLATBUFFERS
         case PerfFormat::FBS: formatter = new FbsFormatter(tracker_name); break;
 #endif
@@ -99,6 +101,20 @@ PerfTracker::~PerfTracker()
 
 bool PerfTracker::open(bool append)
 {
+    if ( formatter->is_mapped() )
+    {
+        if ( fname.empty() )
+        {
+            ErrorMessage("perfmonitor: %s output requires a file.\n", tracker_name.c_str());
+            return false;
+        }
+        // the file is a fixed size ring so there is nothing to rotate
+        mode_t old_umask = umask(022);
+        bool ok = formatter->map_output(fname);
+        umask(old_umask);
+        return ok;
+    }
+
     if (fname.length())
     {
         // FIXIT-L this should be deleted; was added as 1-time workaround to
@@ -0,0 +1,280 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// ring_formatter.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ring_formatter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include "log/messages.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include <cstdio>
+
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+using namespace perf_ring;
+
+RingFormatter::~RingFormatter()
+{ unmap(); }
+
+void RingFormatter::finalize_fields()
+{
+    names.emplace_back("timestamp");
+
+    for ( unsigned i = 0; i < section_names.size(); i++ )
+    {
+        for ( unsigned j = 0; j < field_names[i].size(); j++ )
+        {
+            if ( types[i][j] != FT_PEG_COUNT )
+                continue;
+
+            names.emplace_back(section_names[i] + "." + field_names[i][j]);
+            pegs.emplace_back(values[i][j].pc);
+        }
+    }
+    section_names.clear();
+    field_names.clear();
+}
+
+void RingFormatter::unmap()
+{
+    if ( !base )
+        return;
+
+    msync(base, size, MS_ASYNC);
+    munmap(base, size);
+
+    base = nullptr;
+    header = nullptr;
+    columns.clear();
+}
+
+// continue an existing file only if the schema is unchanged
+bool RingFormatter::reuse(int fd, size_t sz)
+{
+    struct stat st;
+
+    if ( fstat(fd, &st) or (size_t)st.st_size != sz )
+        return false;
+
+    void* p = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if ( p == MAP_FAILED )
+        return false;
+
+    base = (uint8_t*)p;
+    size = sz;
+    header = (Header*)base;
+
+    bool same = check_magic(header) and header->version == version and
+        header->columns == names.size() and header->capacity == capacity and
+        header->data_offset == get_data_offset(names.size());
+
+    for ( unsigned i = 0; same and i < names.size(); ++i )
+        same = !strncmp(get_name(base, i), names[i].c_str(), name_size - 1);
+
+    if ( !same )
+        unmap();
+
+    return same;
+}
+
+bool RingFormatter::map_output(const std::string& fname)
+{
+    unmap();
+
+    int fd = open(fname.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("perfmonitor: Cannot open stats file '%s'.\n", fname.c_str());
+        return false;
+    }
+
+    size_t sz = get_file_size(names.size(), capacity);
+
+    if ( !reuse(fd, sz) )
+    {
+        void* p = MAP_FAILED;
+
+        if ( !ftruncate(fd, 0) and !ftruncate(fd, sz) )
+            p = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if ( p == MAP_FAILED )
+        {
+            ErrorMessage("perfmonitor: Cannot map stats file '%s': %s.\n",
+                fname.c_str(), get_error(errno));
+            close(fd);
+            return false;
+        }
+        base = (uint8_t*)p;
+        size = sz;
+
+        // the file is zero filled
+        header = new(base) Header;
+        set_magic(header);
+        header->version = version;
+        header->columns = names.size();
+        header->capacity = capacity;
+        header->data_offset = get_data_offset(names.size());
+
+        for ( unsigned i = 0; i < names.size(); ++i )
+            strncpy(get_name(base, i), names[i].c_str(), name_size - 1);
+
+        header->count.store(0, std::memory_order_release);
+    }
+    close(fd);
+
+    for ( unsigned i = 0; i < names.size(); ++i )
+        columns.emplace_back(get_column(base, header, i));
+
+    return true;
+}
+
+void RingFormatter::write(FILE*, time_t timestamp)
+{
+    if ( !header )
+        return;
+
+    uint64_t n = header->count.load(std::memory_order_relaxed);
+    uint64_t slot = n % capacity;
+
+    // readers only allow for record n being in progress so the last count
+    // must be visible before its slot is overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+
+    columns[0][slot] = (uint64_t)timestamp;
+
+    for ( unsigned i = 0; i < pegs.size(); ++i )
+        columns[i + 1][slot] = *pegs[i];
+
+    header->count.store(n + 1, std::memory_order_release);
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE("ring output", "[RingFormatter]")
+{
+    PegCount one = 1, two = 2;
+    char str[] = "skipped";
+    std::vector<PegCount> kvp;
+
+    char fname[] = "/tmp/ring_formatter_XXXXXX";
+    int fd = mkstemp(fname);
+    REQUIRE( fd >= 0 );
+    close(fd);
+
+    {
+        RingFormatter f("ring_formatter", 2);
+
+        f.register_section("name");
+        f.register_field("one", &one);
+        f.register_field("str", str);
+        f.register_section("other");
+        f.register_field("kvp", &kvp);
+        f.register_field("two", &two);
+        f.finalize_fields();
+
+        REQUIRE( f.map_output(fname) );
+
+        f.write(nullptr, (time_t)100);
+        one = 10;
+        f.write(nullptr, (time_t)200);
+        two = 20;
+        f.write(nullptr, (time_t)300);
+    }
+
+    fd = open(fname, O_RDONLY);
+    REQUIRE( fd >= 0 );
+
+    struct stat st;
+    REQUIRE( !fstat(fd, &st) );
+    CHECK( (size_t)st.st_size == get_file_size(3, 2) );
+
+    const uint8_t* b = (const uint8_t*)mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    REQUIRE( b != MAP_FAILED );
+    const Header* h = (const Header*)b;
+
+    CHECK( check_magic(h) );
+    CHECK( h->columns == 3 );
+    CHECK( h->capacity == 2 );
+    CHECK( h->count == 3 );
+
+    CHECK( !strcmp(get_name(b, 0), "timestamp") );
+    CHECK( !strcmp(get_name(b, 1), "name.one") );
+    CHECK( !strcmp(get_name(b, 2), "other.two") );
+
+    // record 2 wrapped into slot 0; record 1 is in slot 1
+    const uint64_t* ts = get_column(b, h, 0);
+    CHECK( ts[0] == 300 );
+    CHECK( ts[1] == 200 );
+    CHECK( get_column(b, h, 1)[0] == 10 );
+    CHECK( get_column(b, h, 2)[0] == 20 );
+    CHECK( get_column(b, h, 2)[1] == 2 );
+
+    // same schema continues the file
+    {
+        RingFormatter f("ring_formatter", 2);
+        f.register_section("name");
+        f.register_field("one", &one);
+        f.register_section("other");
+        f.register_field("two", &two);
+        f.finalize_fields();
+
+        REQUIRE( f.map_output(fname) );
+        f.write(nullptr, (time_t)400);
+    }
+    CHECK( h->count == 4 );
+    CHECK( ts[1] == 400 );
+
+    // a different schema starts over
+    {
+        RingFormatter f("ring_formatter", 2);
+        f.register_section("name");
+        f.register_field("one", &one);
+        f.finalize_fields();
+
+        REQUIRE( f.map_output(fname) );
+        f.write(nullptr, (time_t)500);
+    }
+    munmap((void*)b, st.st_size);
+
+    REQUIRE( !fstat(fd, &st) );
+    CHECK( (size_t)st.st_size == get_file_size(2, 2) );
+
+    close(fd);
+    unlink(fname);
+}
+
+#endif
+
@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// ring_formatter.h
+
+#ifndef RING_FORMATTER_H
+#define RING_FORMATTER_H
+
+// writes each record into a columnar ring file (see perf_ring.h) that is
+// memory mapped so a write is just stores, no system calls.  the schema is
+// fixed when fields are finalized and only peg counts are kept; strings and
+// indexed peg counts are left to the other formats.  if the existing file
+// has the same schema and capacity it is continued, otherwise it is
+// recreated.
+
+#include <ctime>
+
+#include "perf_formatter.h"
+#include "perf_ring.h"
+
+class RingFormatter : public PerfFormatter
+{
+public:
+    RingFormatter(const std::string& tracker_name, uint64_t capacity) :
+        PerfFormatter(tracker_name), capacity(capacity) {}
+
+    ~RingFormatter() override;
+
+    const char* get_extension() override
+    { return ".ring"; }
+
+    bool is_mapped() override
+    { return true; }
+
+    void finalize_fields() override;
+    bool map_output(const std::string&) override;
+    void write(FILE*, time_t) override;
+
+private:
+    bool reuse(int fd, size_t size);
+    void unmap();
+
+private:
+    std::vector<std::string> names;
+    std::vector<PegCount*> pegs;
+    std::vector<uint64_t*> columns;
+
+    uint64_t capacity;
+    perf_ring::Header* header = nullptr;
+    uint8_t* base = nullptr;
+    size_t size = 0;
+};
+
+#endif
+
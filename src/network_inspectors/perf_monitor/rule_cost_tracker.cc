@@ -0,0 +1,198 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// rule_cost_tracker.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rule_cost_tracker.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#include "log/messages.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+#define TRACKER_NAME PERF_NAME "_rules"
+
+using namespace snort;
+
+// latest report of each packet thread
+static std::mutex s_report_mutex;
+static std::map<unsigned, std::vector<RuleCostEntry>> s_reports;
+
+RuleCostTracker::RuleCostTracker(PerfConfig* perf) : PerfTracker(perf, TRACKER_NAME),
+    slots(perf->rule_count)
+{
+    for ( unsigned i = 0; i < slots.size(); ++i )
+    {
+        Slot& s = slots[i];
+
+        formatter->register_section("rule_" + std::to_string(i + 1));
+        formatter->register_field("gid", &s.gid);
+        formatter->register_field("sid", &s.sid);
+        formatter->register_field("rev", &s.rev);
+        formatter->register_field("evals", &s.evals);
+        formatter->register_field("matches", &s.matches);
+        formatter->register_field("false_pos", &s.false_pos);
+        formatter->register_field("nsecs", &s.nsecs);
+        formatter->register_field("bytes", &s.bytes);
+    }
+    formatter->finalize_fields();
+
+    RuleCostContext::set_enabled(true);
+}
+
+RuleCostTracker::~RuleCostTracker()
+{
+    RuleCostContext::set_enabled(false);
+
+    std::lock_guard<std::mutex> lock(s_report_mutex);
+    s_reports.erase(get_instance_id());
+}
+
+void RuleCostTracker::reset()
+{ RuleCostContext::get_top(0, top); }
+
+void RuleCostTracker::process(bool)
+{
+    RuleCostContext::get_top(slots.size(), top);
+
+    for ( unsigned i = 0; i < slots.size(); ++i )
+    {
+        Slot& s = slots[i];
+
+        if ( i >= top.size() )
+        {
+            s = Slot();
+            continue;
+        }
+
+        const RuleCostEntry& e = top[i];
+
+        s.gid = e.gid;
+        s.sid = e.sid;
+        s.rev = e.rev;
+        s.evals = e.evals;
+        s.matches = e.matches;
+        s.false_pos = e.evals - e.matches;
+        s.nsecs = e.nsecs;
+        s.bytes = e.bytes;
+    }
+
+    write();
+
+    std::lock_guard<std::mutex> lock(s_report_mutex);
+    s_reports[get_instance_id()] = top;
+}
+
+void RuleCostTracker::show(unsigned count)
+{
+    std::map<std::pair<uint32_t, uint32_t>, RuleCostEntry> rules;
+
+    {
+        std::lock_guard<std::mutex> lock(s_report_mutex);
+
+        for ( const auto& r : s_reports )
+        {
+            for ( const auto& e : r.second )
+            {
+                auto it = rules.emplace(std::make_pair(e.gid, e.sid), e);
+
+                if ( it.second )
+                    continue;
+
+                RuleCostEntry& sum = it.first->second;
+                sum.evals += e.evals;
+                sum.matches += e.matches;
+                sum.nsecs += e.nsecs;
+                sum.bytes += e.bytes;
+            }
+        }
+    }
+
+    std::vector<RuleCostEntry> top;
+
+    for ( const auto& r : rules )
+        top.emplace_back(r.second);
+
+    std::sort(top.begin(), top.end(),
+        [](const RuleCostEntry& lhs, const RuleCostEntry& rhs)
+        { return lhs.nsecs > rhs.nsecs; });
+
+    if ( count and top.size() > count )
+        top.resize(count);
+
+    LogMessage("== most expensive rules of the last interval\n");
+
+    if ( top.empty() )
+    {
+        LogMessage("none\n");
+        return;
+    }
+
+    LogMessage("%4s %10s %6s %10s %10s %6s %12s %10s %12s\n", "#", "gid:sid", "rev",
+        "evals", "matches", "fp %", "usecs", "ns/eval", "bytes");
+
+    unsigned n = 0;
+
+    for ( const auto& e : top )
+    {
+        std::string gs = std::to_string(e.gid) + ":" + std::to_string(e.sid);
+
+        LogMessage("%4u %10s %6u %10" PRIu64 " %10" PRIu64 " %6.1f %12" PRIu64
+            " %10" PRIu64 " %12" PRIu64 "\n", ++n, gs.c_str(), e.rev, e.evals, e.matches,
+            100.0 * (e.evals - e.matches) / e.evals, e.nsecs / 1000, e.nsecs / e.evals, e.bytes);
+    }
+}
+
+#ifdef UNIT_TEST
+
+class TestRuleCostTracker : public RuleCostTracker
+{
+public:
+    PerfFormatter* output;
+
+    TestRuleCostTracker(PerfConfig* perf) : RuleCostTracker(perf)
+    { output = formatter; }
+};
+
+TEST_CASE("rule cost sections", "[rule_cost_tracker]")
+{
+    PerfConfig config;
+    config.format = PerfFormat::MOCK;
+    config.rule_count = 3;
+
+    TestRuleCostTracker tracker(&config);
+    MockFormatter* formatter = (MockFormatter*)tracker.output;
+
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["rule_1.evals"].pc == 0);
+    CHECK(*formatter->public_values["rule_3.nsecs"].pc == 0);
+    CHECK(formatter->public_values.find("rule_4.nsecs") == formatter->public_values.end());
+}
+
+#endif
+
@@ -0,0 +1,62 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// rule_cost_tracker.h
+
+#ifndef RULE_COST_TRACKER_H
+#define RULE_COST_TRACKER_H
+
+// reports the most expensive rules of each interval (see profiler/rule_cost.h).
+// the latest report from each packet thread is also kept so the control
+// channel can show it on demand.
+
+#include "profiler/rule_cost.h"
+
+#include "perf_tracker.h"
+
+class RuleCostTracker : public PerfTracker
+{
+public:
+    RuleCostTracker(PerfConfig*);
+    ~RuleCostTracker() override;
+
+    void reset() override;
+    void process(bool) override;
+
+    // main thread; logs the latest top rules across all packet threads
+    static void show(unsigned count);
+
+private:
+    struct Slot
+    {
+        PegCount gid = 0;
+        PegCount sid = 0;
+        PegCount rev = 0;
+        PegCount evals = 0;
+        PegCount matches = 0;
+        PegCount false_pos = 0;
+        PegCount nsecs = 0;
+        PegCount bytes = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<RuleCostEntry> top;
+};
+
+#endif
+
@@ -67,6 +67,7 @@ SFDAQConfig::SFDAQConfig()
 {
     batch_size = BATCH_SIZE_UNSET;
     mru_size = SNAPLEN_UNSET;
+    prefetch_depth = PREFETCH_DEPTH_UNSET;
     timeout = TIMEOUT_DEFAULT;
 }
 
@@ -106,6 +107,11 @@ void SFDAQConfig::set_mru_size(int mru_size_value)
     mru_size = mru_size_value;
 }
 
+void SFDAQConfig::set_prefetch_depth(int prefetch_depth_value)
+{
+    prefetch_depth = prefetch_depth_value;
+}
+
 void SFDAQConfig::overlay(const SFDAQConfig* other)
 {
     if (!other->module_dirs.empty())
@@ -127,5 +133,7 @@ void SFDAQConfig::overlay(const SFDAQConfig* other)
         batch_size = other->batch_size;
     if (other->mru_size != SNAPLEN_UNSET)
         mru_size = other->mru_size;
+    if (other->prefetch_depth != PREFETCH_DEPTH_UNSET)
+        prefetch_depth = other->prefetch_depth;
     timeout = other->timeout;
 }
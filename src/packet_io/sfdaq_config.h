@@ -59,9 +59,11 @@ struct SFDAQConfig
     void add_module_dir(const char*);
     void set_batch_size(uint32_t);
     void set_mru_size(int);
+    void set_prefetch_depth(int);
 
     uint32_t get_batch_size() const { return (batch_size == BATCH_SIZE_UNSET) ? BATCH_SIZE_DEFAULT : batch_size; }
     uint32_t get_mru_size() const { return (mru_size == SNAPLEN_UNSET) ? SNAPLEN_DEFAULT : mru_size; }
+    uint32_t get_prefetch_depth() const { return (prefetch_depth == PREFETCH_DEPTH_UNSET) ? PREFETCH_DEPTH_DEFAULT : prefetch_depth; }
 
     void overlay(const SFDAQConfig*);
 
@@ -71,6 +73,7 @@ struct SFDAQConfig
     std::vector<std::string> inputs;
     uint32_t batch_size;
     int mru_size;
+    int prefetch_depth;
     unsigned int timeout;
     std::vector<SFDAQModuleConfig*> module_configs;
 
@@ -80,6 +83,8 @@ struct SFDAQConfig
     static constexpr uint32_t BATCH_SIZE_DEFAULT = 64;
     static constexpr int SNAPLEN_DEFAULT = 1518;
     static constexpr unsigned TIMEOUT_DEFAULT = 1000;
+    static constexpr int PREFETCH_DEPTH_UNSET = -1;
+    static constexpr int PREFETCH_DEPTH_DEFAULT = 0;
 };
 
 #endif
@@ -40,6 +40,7 @@ SFDAQInstance::SFDAQInstance(const char* input, const SFDAQConfig* cfg)
     if (input)
         input_spec = input;
     batch_size = cfg->get_batch_size();
+    prefetch_depth = cfg->get_prefetch_depth();
     daq_msgs = new DAQ_Msg_h[batch_size];
 }
 
@@ -176,6 +177,9 @@ bool SFDAQInstance::start()
     pool_available = mpool_info.available;
     assert(pool_size == pool_available);
 
+    // leave room for a batch in process and the next one
+    max_held = (pool_size > 2 * batch_size) ? pool_size - 2 * batch_size : 0;
+
     dlt = daq_instance_get_datalink_type(instance);
     get_tunnel_capabilities();
 
@@ -199,12 +203,67 @@ DAQ_RecvStatus SFDAQInstance::receive_messages(unsigned max_recv)
 
 int SFDAQInstance::finalize_message(DAQ_Msg_h msg, DAQ_Verdict verdict)
 {
+    if (!held_msgs.empty())
+    {
+        auto it = held_msgs.find(msg);
+        if (it != held_msgs.end())
+        {
+            it->second.verdict = verdict;
+            it->second.finalized = true;
+            return DAQ_SUCCESS;
+        }
+    }
+
     int rval = daq_instance_msg_finalize(instance, msg, verdict);
     if (rval == DAQ_SUCCESS)
         pool_available++;
     return rval;
 }
 
+bool SFDAQInstance::hold_message(DAQ_Msg_h msg)
+{
+    auto it = held_msgs.find(msg);
+
+    if (it == held_msgs.end())
+    {
+        if (held_msgs.size() >= max_held)
+            return false;
+
+        it = held_msgs.emplace(msg, HeldMsg()).first;
+    }
+    it->second.refs++;
+    return true;
+}
+
+void SFDAQInstance::release_message(DAQ_Msg_h msg)
+{
+    auto it = held_msgs.find(msg);
+
+    if (it == held_msgs.end())
+        return;
+
+    assert(it->second.refs);
+
+    if (--it->second.refs)
+        return;
+
+    HeldMsg held = it->second;
+    held_msgs.erase(it);
+
+    if (held.finalized)
+        finalize_message(msg, held.verdict);
+}
+
+// anything still referenced at this point won't be used again
+void SFDAQInstance::finalize_held_messages()
+{
+    auto held = std::move(held_msgs);
+    held_msgs.clear();
+
+    for (auto& it : held)
+        finalize_message(it.first, it.second.finalized ? it.second.verdict : DAQ_VERDICT_PASS);
+}
+
 const char* SFDAQInstance::get_error()
 {
     return daq_instance_get_error(instance);
@@ -255,6 +314,7 @@ bool SFDAQInstance::was_started()
 
 bool SFDAQInstance::stop()
 {
+    finalize_held_messages();
     assert(pool_size == pool_available);
 
     int rval = daq_instance_stop(instance);
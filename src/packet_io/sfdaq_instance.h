@@ -25,6 +25,7 @@
 #include <daq_common.h>
 
 #include <string>
+#include <unordered_map>
 
 #include "main/snort_types.h"
 #include "protocols/protocol_ids.h"
@@ -57,11 +58,29 @@ public:
             return daq_msgs[curr_batch_idx++];
         return nullptr;
     }
+    // look at a message further on in the current batch without taking it
+    DAQ_Msg_h peek_message(unsigned ahead)
+    {
+        unsigned idx = curr_batch_idx + ahead;
+        if (idx < curr_batch_size)
+            return daq_msgs[idx];
+        return nullptr;
+    }
     int finalize_message(DAQ_Msg_h msg, DAQ_Verdict verdict);
+
+    // Messages whose data is still referenced after the packet is done (eg by
+    // queued TCP segments) are held; finalize_message() is deferred until the
+    // last reference is released.  hold_message() fails when holding another
+    // message could starve the receive pool.
+    SO_PUBLIC bool hold_message(DAQ_Msg_h);
+    SO_PUBLIC void release_message(DAQ_Msg_h);
+    unsigned get_held_messages() { return held_msgs.size(); }
+
     const char* get_error();
 
     int get_base_protocol();
     uint32_t get_batch_size() { return batch_size; }
+    uint32_t get_prefetch_depth() { return prefetch_depth; }
     const char* get_input_spec();
     const DAQ_Stats_t* get_stats();
 
@@ -85,6 +104,14 @@ public:
 
 private:
     void get_tunnel_capabilities();
+    void finalize_held_messages();
+
+    struct HeldMsg
+    {
+        unsigned refs = 0;
+        DAQ_Verdict verdict = DAQ_VERDICT_PASS;
+        bool finalized = false;
+    };
 
     std::string input_spec;
     DAQ_Instance_h instance = nullptr;
@@ -92,8 +119,11 @@ private:
     unsigned curr_batch_size = 0;
     unsigned curr_batch_idx = 0;
     uint32_t batch_size;
+    uint32_t prefetch_depth;
     uint32_t pool_size = 0;
     uint32_t pool_available = 0;
+    uint32_t max_held = 0;
+    std::unordered_map<DAQ_Msg_h, HeldMsg> held_msgs;
     int dlt = -1;
     DAQ_Stats_t daq_stats = { };
     uint8_t daq_tunnel_mask = 0;
@@ -78,6 +78,7 @@ static const Parameter s_params[] =
     { "inputs", Parameter::PT_LIST, input_list_param, nullptr, "input sources" },
     { "snaplen", Parameter::PT_INT, "0:65535", "1518", "set snap length (same as -s)" },
     { "batch_size", Parameter::PT_INT, "1:", "64", "set receive batch size (same as --daq-batch-size)" },
+    { "prefetch_depth", Parameter::PT_INT, "0:64", "0", "number of packets ahead in a receive batch to prefetch flows for (0 disables)" },
     { "modules", Parameter::PT_LIST, daq_module_param, nullptr, "DAQ modules to use" },
 
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
@@ -122,6 +123,10 @@ bool SFDAQModule::set(const char* fqn, Value& v, SnortConfig*)
     {
         config->set_batch_size(v.get_long());
     }
+    else if (!strcmp(fqn, "daq.prefetch_depth"))
+    {
+        config->set_prefetch_depth(v.get_long());
+    }
     else if (!strcmp(fqn, "daq.modules.name"))
     {
         module_config->name = v.get_string();
@@ -186,6 +191,9 @@ struct DAQStats
     PegCount skipped;
     PegCount idle;
     PegCount rx_bytes;
+    PegCount batches;
+    PegCount batch_usecs;
+    PegCount max_batch_usecs;
 };
 
 const PegInfo daq_names[] =
@@ -213,6 +221,9 @@ const PegInfo daq_names[] =
     { CountType::SUM, "skipped", "packets skipped at startup" },
     { CountType::SUM, "idle", "attempts to acquire from DAQ without available packets" },
     { CountType::SUM, "rx_bytes", "total bytes received" },
+    { CountType::SUM, "batches", "nonempty receive batches processed" },
+    { CountType::SUM, "batch_usecs", "total time processing receive batches in usecs" },
+    { CountType::MAX, "max_batch_usecs", "maximum time processing a receive batch in usecs" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -283,6 +294,9 @@ void SFDAQModule::prep_counts()
     stats.skipped = aux_counts.skipped;
     stats.idle = aux_counts.idle;
     stats.rx_bytes = aux_counts.rx_bytes;
+    stats.batches = aux_counts.batches;
+    stats.batch_usecs = aux_counts.batch_usecs;
+    stats.max_batch_usecs = aux_counts.max_batch_usecs;
 
     memset(&aux_counts, 0, sizeof(AuxCount));
 
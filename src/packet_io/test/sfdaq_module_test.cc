@@ -63,6 +63,9 @@ TEST_CASE("parse sfdaq config", "[SFDAQModule]")
     Value batch_size(static_cast<double>(10));
     CHECK(sfdm.set("daq.batch_size", batch_size, &sc));
 
+    Value prefetch_depth(static_cast<double>(8));
+    CHECK(sfdm.set("daq.prefetch_depth", prefetch_depth, &sc));
+
     CHECK(sfdm.begin("daq.modules", 0, &sc));
 
     SECTION("empty module config")
@@ -107,6 +110,7 @@ TEST_CASE("parse sfdaq config", "[SFDAQModule]")
 
         CHECK((cfg->mru_size == 6666));
         CHECK((cfg->batch_size == 10));
+        CHECK((cfg->get_prefetch_depth() == 8));
 
         REQUIRE(cfg->module_configs.size() == 1);
         for (auto it : cfg->module_configs)
@@ -155,6 +159,8 @@ TEST_CASE("parse sfdaq config", "[SFDAQModule]")
 
         CHECK((cfg->mru_size == 3333));
         CHECK((cfg->batch_size == 12));
+        // not set on the command line
+        CHECK((cfg->get_prefetch_depth() == 8));
 
         REQUIRE(cfg->module_configs.size() == 2);
         for (auto it : cfg->module_configs)
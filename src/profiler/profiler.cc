@@ -33,6 +33,7 @@
 #include "memory_profiler.h"
 #include "profiler_nodes.h"
 #include "rule_profiler.h"
+#include "sample_profiler.h"
 #include "time_profiler.h"
 
 #ifdef UNIT_TEST
@@ -91,6 +92,17 @@ void Profiler::consolidate_stats(uint64_t num_pkts, uint64_t usecs)
     MemoryProfiler::consolidate_fallthrough_stats();
 }
 
+void Profiler::thread_init()
+{
+    const auto* config = SnortConfig::get_profiler();
+    assert(config);
+
+    sample_profiler_thread_init(config->sample);
+}
+
+void Profiler::thread_term()
+{ sample_profiler_thread_term(s_profiler_nodes); }
+
 void Profiler::reset_stats()
 {
     s_profiler_nodes.reset_nodes();
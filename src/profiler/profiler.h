@@ -37,6 +37,9 @@ public:
 
     static void consolidate_stats(uint64_t pkts = 0, uint64_t usecs = 0);
 
+    static void thread_init();
+    static void thread_term();
+
     static void reset_stats();
     static void show_stats();
 };
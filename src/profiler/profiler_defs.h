@@ -26,6 +26,7 @@
 #include "memory_defs.h"
 #include "memory_profiler_defs.h"
 #include "rule_profiler_defs.h"
+#include "sample_profiler_defs.h"
 #include "time_profiler_defs.h"
 
 namespace snort
@@ -37,6 +38,7 @@ struct ProfilerConfig
     TimeProfilerConfig time;
     RuleProfilerConfig rule;
     MemoryProfilerConfig memory;
+    SampleProfilerConfig sample;
 };
 
 struct SO_PUBLIC ProfileStats
@@ -75,7 +77,8 @@ inline ProfileStats& ProfileStats::operator+=(const ProfileStats& rhs)
 class SO_PUBLIC ProfileContext
 {
 public:
-    ProfileContext(ProfileStats& stats) : time(stats.time), memory(stats.memory)
+    ProfileContext(ProfileStats& stats) :
+        sample(&stats), time(stats.time), memory(stats.memory)
     {
         prev_time = curr_time;
         if ( prev_time )
@@ -91,6 +94,7 @@ public:
     }
 
 private:
+    SampleFrame sample;
     TimeContext time;
     MemoryContext memory;
     TimeContext* prev_time;
@@ -103,9 +107,10 @@ class NoMemContext
 {
 public:
     NoMemContext(ProfileStats& stats) :
-        time(stats.time) { }
+        sample(&stats), time(stats.time) { }
 
 private:
+    SampleFrame sample;
     TimeContext time;
 };
 
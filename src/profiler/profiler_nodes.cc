@@ -122,6 +122,9 @@ void ProfilerNode::accumulate()
     }
 }
 
+const ProfileStats* ProfilerNode::get_local_stats() const
+{ return is_set() ? (*getter)() : nullptr; }
+
 void ProfilerNodeMap::register_node(const std::string &n, const char* pn, Module* m)
 { setup_node(get_node(n), get_node(pn ? pn : ROOT_NODE), m); }
 
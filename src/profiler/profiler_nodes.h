@@ -46,8 +46,9 @@ public:
     bool is_set() const
     { return bool(getter); }
 
-    // thread local call
+    // thread local calls
     void accumulate();
+    const snort::ProfileStats* get_local_stats() const;
 
     const snort::ProfileStats& get_stats() const
     { return stats; }
@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// rule_cost.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rule_cost.h"
+
+#include <algorithm>
+
+#include "detection/detection_options.h"
+#include "detection/treenodes.h"
+#include "hash/ghash.h"
+#include "hash/xhash.h"
+#include "main/snort_config.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+THREAD_LOCAL bool RuleCostContext::enabled = false;
+
+void RuleCostContext::begin(unsigned bytes)
+{
+    ++state->cost_evals;
+    state->cost_bytes += bytes;
+    start = SnortClock::now();
+}
+
+void RuleCostContext::pause()
+{
+    if ( state )
+    {
+        hr_duration elapsed = SnortClock::now() - start;
+        state->cost_ticks += TO_TICKS(elapsed);
+    }
+}
+
+void RuleCostContext::count_match(OptTreeNode* otn)
+{
+    ++otn->state[get_instance_id()].cost_matches;
+}
+
+// charge each rule under node with the time of the nodes on its path.  the
+// evaluations and bytes are those of the first node on the path.
+static void charge_rules(
+    detection_option_tree_node_t* node, unsigned id, uint64_t ticks, uint64_t evals,
+    uint64_t bytes)
+{
+    dot_node_state_t& ns = node->state[id];
+
+    ticks += ns.cost_ticks;
+
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
+    {
+        OptTreeNode* otn = (OptTreeNode*)node->option_data;
+
+        if ( otn->state )
+        {
+            OtnState& state = otn->state[id];
+            state.cost_ticks += ticks;
+            state.cost_evals += evals;
+            state.cost_bytes += bytes;
+        }
+    }
+
+    for ( int i = 0; i < node->num_children; ++i )
+        charge_rules(node->children[i], id, ticks, evals, bytes);
+
+    ns.cost_ticks = ns.cost_evals = ns.cost_bytes = 0;
+}
+
+static bool more_expensive(const RuleCostEntry& lhs, const RuleCostEntry& rhs)
+{ return lhs.nsecs > rhs.nsecs; }
+
+void RuleCostContext::get_top(unsigned n, std::vector<RuleCostEntry>& top)
+{
+    top.clear();
+
+    SnortConfig* sc = SnortConfig::get_conf();
+
+    if ( !sc or !sc->otn_map )
+        return;
+
+    unsigned id = get_instance_id();
+
+    // the hash holds the first node of each distinct tree
+    if ( XHash* trees = sc->detection_option_tree_hash_table )
+    {
+        for ( auto h = xhash_findfirst(trees); h; h = xhash_findnext(trees) )
+        {
+            auto* node = (detection_option_tree_node_t*)h->data;
+            dot_node_state_t& ns = node->state[id];
+
+            if ( ns.cost_evals )
+                charge_rules(node, id, 0, ns.cost_evals, ns.cost_bytes);
+        }
+    }
+
+    GHash* otn_map = sc->otn_map;
+
+    for ( auto* h = ghash_findfirst(otn_map); h; h = ghash_findnext(otn_map) )
+    {
+        auto* otn = static_cast<OptTreeNode*>(h->data);
+
+        if ( !otn->state )
+            continue;
+
+        OtnState& state = otn->state[id];
+
+        if ( !state.cost_evals )
+            continue;
+
+        RuleCostEntry e
+        {
+            otn->sigInfo.gid, otn->sigInfo.sid, otn->sigInfo.rev,
+            state.cost_evals, state.cost_matches, clock_nsecs(state.cost_ticks),
+            state.cost_bytes
+        };
+        state.cost_evals = state.cost_matches = state.cost_ticks = state.cost_bytes = 0;
+
+        if ( top.size() < n )
+        {
+            top.emplace_back(e);
+            std::push_heap(top.begin(), top.end(), more_expensive);
+        }
+        else if ( n and more_expensive(e, top.front()) )
+        {
+            std::pop_heap(top.begin(), top.end(), more_expensive);
+            top.back() = e;
+            std::push_heap(top.begin(), top.end(), more_expensive);
+        }
+    }
+    std::sort_heap(top.begin(), top.end(), more_expensive);
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "rule cost context", "[profiler][rule_cost]" )
+{
+    dot_node_state_t ns { };
+    OptTreeNode otn;
+    OtnState state;
+    otn.state = &state;
+
+    RuleCostContext::set_enabled(false);
+    {
+        RuleCostContext ctx(ns, 100);
+        RuleCostContext::match(&otn);
+    }
+    CHECK( ns.cost_evals == 0 );
+    CHECK( state.cost_matches == 0 );
+
+    RuleCostContext::set_enabled(true);
+    {
+        RuleCostContext ctx(ns, 100);
+    }
+    {
+        RuleCostContext ctx(ns, 50);
+        RuleCostPause pause(ctx);
+        RuleCostContext::match(&otn);
+    }
+    RuleCostContext::set_enabled(false);
+
+    CHECK( ns.cost_evals == 2 );
+    CHECK( ns.cost_bytes == 150 );
+    CHECK( state.cost_matches == 1 );
+}
+
+TEST_CASE( "rule cost paths", "[profiler][rule_cost]" )
+{
+    // a shared content node with a cheap rule a and an expensive pcre
+    // leading to rule b
+    OptTreeNode a, b;
+    OtnState sa, sb;
+    a.state = &sa;
+    b.state = &sb;
+
+    dot_node_state_t ns[4] { };
+    detection_option_tree_node_t content { }, pcre { }, leaf_a { }, leaf_b { };
+
+    detection_option_tree_node_t* content_kids[] = { &leaf_a, &pcre };
+    detection_option_tree_node_t* pcre_kids[] = { &leaf_b };
+
+    content.option_type = RULE_OPTION_TYPE_CONTENT;
+    content.num_children = 2;
+    content.children = content_kids;
+    content.state = &ns[0];
+
+    pcre.option_type = RULE_OPTION_TYPE_BUFFER_USE;
+    pcre.num_children = 1;
+    pcre.children = pcre_kids;
+    pcre.state = &ns[1];
+
+    leaf_a.option_type = RULE_OPTION_TYPE_LEAF_NODE;
+    leaf_a.option_data = &a;
+    leaf_a.state = &ns[2];
+
+    leaf_b.option_type = RULE_OPTION_TYPE_LEAF_NODE;
+    leaf_b.option_data = &b;
+    leaf_b.state = &ns[3];
+
+    ns[0].cost_evals = 10;
+    ns[0].cost_bytes = 1000;
+    ns[0].cost_ticks = 100;
+    ns[1].cost_ticks = 5000;
+    ns[2].cost_ticks = 1;
+    ns[3].cost_ticks = 2;
+    sa.cost_matches = 3;
+
+    charge_rules(&content, 0, 0, ns[0].cost_evals, ns[0].cost_bytes);
+
+    CHECK( sa.cost_ticks == 101 );
+    CHECK( sb.cost_ticks == 5102 );
+    CHECK( sa.cost_evals == 10 );
+    CHECK( sb.cost_evals == 10 );
+    CHECK( sa.cost_bytes == 1000 );
+    CHECK( sb.cost_matches == 0 );
+
+    for ( auto& n : ns )
+        CHECK( n.cost_ticks == 0 );
+}
+
+#endif
@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// rule_cost.h
+
+#ifndef RULE_COST_H
+#define RULE_COST_H
+
+// rolling per rule cost accounting.  unlike rule profiling, which reports
+// at shutdown, the counters are harvested (and cleared) periodically on the
+// packet thread, eg by perf_monitor.  costs are charged the way rule
+// profiling does it: each option node evaluation is timed exclusive of its
+// children and a rule is charged for every node on its path through the
+// tree, so a node shared by several rules counts for each of them.  a
+// rule's evaluations are those of the first node on its path; the ones that
+// don't end in a match of that rule are its fast pattern false positives.
+
+#include <cstdint>
+#include <vector>
+
+#include "main/snort_types.h"
+#include "main/thread.h"
+#include "time/clock_defs.h"
+
+struct OptTreeNode;
+struct dot_node_state_t;
+
+struct RuleCostEntry
+{
+    uint32_t gid;
+    uint32_t sid;
+    uint32_t rev;
+
+    uint64_t evals;
+    uint64_t matches;
+    uint64_t nsecs;
+    uint64_t bytes;
+};
+
+// times one option node evaluation of bytes of payload
+class SO_PUBLIC RuleCostContext
+{
+public:
+    RuleCostContext(dot_node_state_t& s, unsigned bytes) : state(enabled ? &s : nullptr)
+    {
+        if ( state )
+            begin(bytes);
+    }
+
+    ~RuleCostContext()
+    {
+        if ( state )
+            pause();
+    }
+
+    // exclude the children
+    void pause();
+
+    void resume()
+    {
+        if ( state )
+            start = SnortClock::now();
+    }
+
+    // the rule's leaf was reached and it matched
+    static void match(OptTreeNode* otn)
+    {
+        if ( enabled )
+            count_match(otn);
+    }
+
+    // packet thread calls
+    static void set_enabled(bool b)
+    { enabled = b; }
+
+    // the n rules with the most time since the last call, most expensive
+    // first; clears all counters for this thread
+    static void get_top(unsigned n, std::vector<RuleCostEntry>&);
+
+private:
+    void begin(unsigned bytes);
+    static void count_match(OptTreeNode*);
+
+    dot_node_state_t* state;
+    hr_time start;
+
+    static THREAD_LOCAL bool enabled;
+};
+
+class RuleCostPause
+{
+public:
+    RuleCostPause(RuleCostContext& ctx) : ctx(ctx)
+    { ctx.pause(); }
+
+    ~RuleCostPause()
+    { ctx.resume(); }
+
+private:
+    RuleCostContext& ctx;
+};
+
+#endif
+
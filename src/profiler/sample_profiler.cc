@@ -0,0 +1,314 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sample_profiler.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sample_profiler.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "detection/treenodes.h"
+#include "log/messages.h"
+#include "main/snort_config.h"
+
+#include "profiler_nodes.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+THREAD_LOCAL SampleStack* SampleFrame::curr_stack = nullptr;
+
+uint64_t SampleFrame::get_rule_frame(const OptTreeNode* otn)
+{
+    return ((uint64_t)otn->sigInfo.gid << 33) | ((uint64_t)otn->sigInfo.sid << 1) | 1;
+}
+
+// -----------------------------------------------------------------------------
+// sampler
+// -----------------------------------------------------------------------------
+
+using Stack = std::vector<uint64_t>;
+
+struct SampledThread
+{
+    SampleStack stack;
+    std::map<Stack, uint64_t> samples;
+    unsigned id = 0;
+};
+
+static THREAD_LOCAL SampledThread* s_local = nullptr;
+
+// s_mutex guards everything below it
+static std::mutex s_mutex;
+static std::condition_variable s_cond;
+static std::thread* s_sampler = nullptr;
+static bool s_stop = false;
+static unsigned s_users = 0;
+
+static std::vector<SampledThread*> s_threads;
+static std::map<std::string, uint64_t> s_folded;
+static std::string s_file;
+
+static void take_samples()
+{
+    Stack stack;
+
+    for ( auto t : s_threads )
+    {
+        unsigned depth = t->stack.depth.load(std::memory_order_acquire);
+
+        if ( depth > SampleStack::max_depth )
+            depth = SampleStack::max_depth;
+
+        stack.resize(depth);
+
+        for ( unsigned i = 0; i < depth; ++i )
+            stack[i] = t->stack.frames[i].load(std::memory_order_relaxed);
+
+        ++t->samples[stack];
+    }
+}
+
+static void sampler(std::chrono::microseconds period)
+{
+    std::unique_lock<std::mutex> lock(s_mutex);
+    auto next = std::chrono::steady_clock::now();
+
+    while ( true )
+    {
+        next += period;
+
+        if ( s_cond.wait_until(lock, next, [] { return s_stop; }) )
+            break;
+
+        take_samples();
+    }
+}
+
+static void write_folded()
+{
+    std::string path = SnortConfig::get_conf()->log_dir;
+
+    if ( path.empty() )
+        path = ".";
+
+    path += "/" + s_file;
+
+    std::ofstream out(path);
+
+    if ( !out )
+    {
+        ErrorMessage("can't open sample profile %s\n", path.c_str());
+        return;
+    }
+
+    uint64_t total = 0;
+
+    for ( const auto& f : s_folded )
+    {
+        out << f.first << " " << f.second << "\n";
+        total += f.second;
+    }
+
+    LogMessage("sample profile: " STDu64 " samples written to %s\n", total, path.c_str());
+    s_folded.clear();
+}
+
+// -----------------------------------------------------------------------------
+// folding
+// -----------------------------------------------------------------------------
+
+using NameMap = std::unordered_map<uint64_t, std::string>;
+
+static std::string get_frame_name(const NameMap& names, uint64_t w)
+{
+    if ( SampleFrame::is_rule_frame(w) )
+        return "rule_" + std::to_string(w >> 33) + ":" + std::to_string((uint32_t)(w >> 1));
+
+    auto it = names.find(w);
+
+    if ( it == names.end() )
+        return "unknown";
+
+    return it->second;
+}
+
+static std::string fold(const NameMap& names, const std::string& root, const Stack& stack)
+{
+    std::string s = root;
+
+    if ( stack.empty() )
+        s += ";unprofiled";
+
+    for ( auto w : stack )
+        s += ";" + get_frame_name(names, w);
+
+    return s;
+}
+
+// -----------------------------------------------------------------------------
+// api
+// -----------------------------------------------------------------------------
+
+void sample_profiler_thread_init(const SampleProfilerConfig& config)
+{
+    if ( !config.rate or s_local )
+        return;
+
+    s_local = new SampledThread;
+    s_local->id = get_instance_id();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_threads.emplace_back(s_local);
+
+    if ( !s_users++ )
+    {
+        assert(!s_sampler);
+        s_stop = false;
+        s_file = config.file;
+        s_sampler = new std::thread(sampler, std::chrono::microseconds(1000000 / config.rate));
+    }
+
+    SampleFrame::set_stack(&s_local->stack);
+}
+
+void sample_profiler_thread_term(const ProfilerNodeMap& nodes)
+{
+    if ( !s_local )
+        return;
+
+    SampleFrame::set_stack(nullptr);
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    for ( auto it = s_threads.begin(); it != s_threads.end(); ++it )
+    {
+        if ( *it == s_local )
+        {
+            s_threads.erase(it);
+            break;
+        }
+    }
+    lock.unlock();
+
+    // the stats are thread local so the names must be resolved on this thread
+    NameMap names;
+
+    for ( const auto& node : nodes )
+    {
+        if ( const ProfileStats* ps = node.second.get_local_stats() )
+            names[(uint64_t)(uintptr_t)ps] = node.first;
+    }
+
+    const std::string root = "packet_" + std::to_string(s_local->id);
+    std::map<std::string, uint64_t> folded;
+
+    for ( const auto& s : s_local->samples )
+        folded[fold(names, root, s.first)] += s.second;
+
+    delete s_local;
+    s_local = nullptr;
+
+    lock.lock();
+
+    for ( const auto& f : folded )
+        s_folded[f.first] += f.second;
+
+    if ( --s_users )
+        return;
+
+    s_stop = true;
+    s_cond.notify_one();
+    lock.unlock();
+
+    s_sampler->join();
+    delete s_sampler;
+    s_sampler = nullptr;
+
+    write_folded();
+}
+
+// -----------------------------------------------------------------------------
+// unit tests
+// -----------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "sample frames", "[profiler][sample_profiler]" )
+{
+    SampleStack stack;
+    ProfileStats outer, inner;
+
+    SampleFrame::set_stack(&stack);
+    {
+        SampleFrame f1(&outer);
+        CHECK( stack.depth == 1 );
+        {
+            SampleFrame f2(&inner);
+            CHECK( stack.depth == 2 );
+            CHECK( stack.frames[0] == (uint64_t)(uintptr_t)&outer );
+            CHECK( stack.frames[1] == (uint64_t)(uintptr_t)&inner );
+            CHECK_FALSE( SampleFrame::is_rule_frame(stack.frames[1]) );
+        }
+        CHECK( stack.depth == 1 );
+    }
+    CHECK( stack.depth == 0 );
+
+    SampleFrame::set_stack(nullptr);
+    {
+        SampleFrame f(&outer);
+        CHECK( stack.depth == 0 );
+    }
+}
+
+TEST_CASE( "sample folding", "[profiler][sample_profiler]" )
+{
+    NameMap names;
+    names[8] = "detection";
+    names[16] = "mpse";
+
+    OptTreeNode otn;
+    otn.sigInfo.gid = 1;
+    otn.sigInfo.sid = 2000;
+
+    uint64_t rule = SampleFrame::get_rule_frame(&otn);
+    CHECK( SampleFrame::is_rule_frame(rule) );
+
+    CHECK( fold(names, "packet_0", { }) == "packet_0;unprofiled" );
+    CHECK( fold(names, "packet_0", { 8, 16 }) == "packet_0;detection;mpse" );
+    CHECK( fold(names, "packet_1", { 8, rule }) == "packet_1;detection;rule_1:2000" );
+    CHECK( fold(names, "packet_1", { 24 }) == "packet_1;unknown" );
+}
+
+#endif
+
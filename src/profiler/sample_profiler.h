@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sample_profiler.h
+
+#ifndef SAMPLE_PROFILER_H
+#define SAMPLE_PROFILER_H
+
+class ProfilerNodeMap;
+struct SampleProfilerConfig;
+
+// packet thread calls.  the first thread in starts the sampler thread and
+// the last one out stops it and writes the folded stacks, one per line
+// (frame;frame;... count), ready for flamegraph.pl and friends.
+void sample_profiler_thread_init(const SampleProfilerConfig&);
+void sample_profiler_thread_term(const ProfilerNodeMap&);
+
+#endif
+
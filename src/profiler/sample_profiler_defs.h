@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sample_profiler_defs.h
+
+#ifndef SAMPLE_PROFILER_DEFS_H
+#define SAMPLE_PROFILER_DEFS_H
+
+// the sample profiler periodically snapshots what each packet thread is
+// doing instead of timing every scope.  each Profile scope (and each rule
+// tree evaluation) pushes a word onto a small per-thread stack; a separate
+// thread reads those stacks at the configured rate and counts the distinct
+// stacks seen.  the packet thread cost is a couple of stores per scope and
+// nothing at all when sampling is disabled.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "main/snort_types.h"
+#include "main/thread.h"
+
+struct OptTreeNode;
+
+struct SampleProfilerConfig
+{
+    unsigned rate = 0;   // samples per second; 0 disables sampling
+    std::string file = "profile.folded";
+};
+
+namespace snort
+{
+// written only by the owning packet thread; read racily by the sampler
+// which may see a torn stack now and then.  that is fine for sampling.
+struct SampleStack
+{
+    static constexpr unsigned max_depth = 32;
+
+    std::atomic<unsigned> depth { 0 };
+    std::atomic<uint64_t> frames[max_depth];
+};
+
+class SO_PUBLIC SampleFrame
+{
+public:
+    // frames are either a ProfileStats address (always even) or an odd
+    // word holding a rule's gid and sid
+    SampleFrame(const void* stats) : stack(curr_stack)
+    {
+        if ( stack )
+            push((uint64_t)(uintptr_t)stats);
+    }
+
+    SampleFrame(const OptTreeNode* otn) : stack(curr_stack)
+    {
+        if ( stack )
+            push(get_rule_frame(otn));
+    }
+
+    ~SampleFrame()
+    {
+        if ( stack )
+            stack->depth.store(stack->depth.load(std::memory_order_relaxed) - 1,
+                std::memory_order_release);
+    }
+
+    SampleFrame(const SampleFrame&) = delete;
+    SampleFrame& operator=(const SampleFrame&) = delete;
+
+    static bool is_rule_frame(uint64_t w)
+    { return w & 1; }
+
+    static uint64_t get_rule_frame(const OptTreeNode*);
+
+    static void set_stack(SampleStack* s)
+    { curr_stack = s; }
+
+private:
+    void push(uint64_t w)
+    {
+        unsigned d = stack->depth.load(std::memory_order_relaxed);
+
+        if ( d < SampleStack::max_depth )
+            stack->frames[d].store(w, std::memory_order_relaxed);
+
+        stack->depth.store(d + 1, std::memory_order_release);
+    }
+
+    SampleStack* stack;
+    static THREAD_LOCAL SampleStack* curr_stack;
+};
+
+} // namespace snort
+#endif
+
@@ -23,6 +23,7 @@
 
 #include "main/snort_types.h"
 #include "time/clock_defs.h"
+#include "time/latency_histogram.h"
 #include "time/stopwatch.h"
 
 struct TimeProfilerConfig
@@ -47,6 +48,7 @@ struct SO_PUBLIC TimeProfilerStats
     hr_duration elapsed;
     uint64_t checks;
     mutable unsigned int ref_count;
+    LatencyHistogram* hist;  // optional, set by perf_monitor on the owning thread
     static bool enabled;
 
     static void set_enabled(bool b)
@@ -56,7 +58,13 @@ struct SO_PUBLIC TimeProfilerStats
     { return enabled; }
 
     void update(hr_duration delta)
-    { elapsed += delta; ++checks; }
+    {
+        elapsed += delta;
+        ++checks;
+
+        if ( hist )
+            hist->record(TO_TICKS(delta));
+    }
 
     void reset()
     { elapsed = 0_ticks; checks = 0; }
@@ -75,7 +83,7 @@ struct SO_PUBLIC TimeProfilerStats
         TimeProfilerStats(elapsed, checks, 0) { }
 
     constexpr TimeProfilerStats(hr_duration elapsed, uint64_t checks, unsigned int ref_count) :
-        elapsed(elapsed), checks(checks), ref_count(ref_count) { }
+        elapsed(elapsed), checks(checks), ref_count(ref_count), hist(nullptr) { }
 };
 
 inline bool operator==(const TimeProfilerStats& lhs, const TimeProfilerStats& rhs)
@@ -80,6 +80,15 @@ public:
 
     int get_pattern_count() const override
     { return acsmPatternCount2(obj); }
+
+    bool get_hash(std::string& hash) override
+    { return acsmGetHash2(obj, hash); }
+
+    bool serialize(uint8_t*& buf, size_t& len) override
+    { return acsmSerialize2(obj, buf, len); }
+
+    bool deserialize(SnortConfig* sc, const uint8_t* buf, size_t len) override
+    { return acsmDeserialize2(sc, obj, buf, len); }
 };
 
 //-------------------------------------------------------------------------
@@ -77,6 +77,17 @@ public:
         return bnfaCompile(sc, obj);
     }
 
+    int compile_patterns() override
+    {
+        return bnfaCompileStates(obj);
+    }
+
+    int finish_patterns(SnortConfig* sc) override
+    {
+        bnfaFinishStates(sc, obj);
+        return 0;
+    }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
@@ -98,6 +109,21 @@ public:
     {
         return bnfaPatternCount(obj);
     }
+
+    bool get_hash(std::string& hash) override
+    {
+        return bnfaGetHash(obj, hash);
+    }
+
+    bool serialize(uint8_t*& buf, size_t& len) override
+    {
+        return bnfaSerialize(obj, buf, len);
+    }
+
+    bool deserialize(SnortConfig* sc, const uint8_t* buf, size_t len) override
+    {
+        return bnfaDeserialize(sc, obj, buf, len);
+    }
 };
 
 //-------------------------------------------------------------------------
@@ -140,7 +166,7 @@ static const MpseApi bnfa_api =
         nullptr,
         nullptr
     },
-    MPSE_BASE,
+    MPSE_MTBLD,
     nullptr,
     nullptr,
     nullptr,
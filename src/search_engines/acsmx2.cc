@@ -119,7 +119,10 @@
 
 #include <cassert>
 #include <list>
+#include <unordered_map>
+#include <vector>
 
+#include "hash/hashes.h"
 #include "log/messages.h"
 #include "utils/stats.h"
 #include "utils/util.h"
@@ -138,6 +141,7 @@ static int acsm2_dfa_memory = 0;
 static int acsm2_dfa1_memory = 0;
 static int acsm2_dfa2_memory = 0;
 static int acsm2_dfa4_memory = 0;
+static int acsm2_mapped_memory = 0;
 static int acsm2_failstate_memory = 0;
 
 struct acsm_summary_t
@@ -174,6 +178,7 @@ void acsm_init_summary()
     acsm2_transtable_memory = 0;
     acsm2_dfa_memory = 0;
     acsm2_failstate_memory = 0;
+    acsm2_mapped_memory = 0;
 }
 
 /*
@@ -1116,6 +1121,7 @@ ACSM_STRUCT2* acsmNew2(const MpseAgent* agent, int format)
         p->acsmSparseMaxRowNodes = 256;
         p->acsmSparseMaxZcnt = 10;
         p->dfa = false;
+        p->mapped = false;
     }
 
     return p;
@@ -1984,7 +1990,8 @@ void acsmFree2(ACSM_STRUCT2* acsm)
             AC_FREE(ilist, 0, ACSM2_MEMORY_TYPE__NONE);
         }
 
-        AC_FREE_DFA(acsm->acsmNextState[i], 0, 0);
+        if ( !acsm->mapped )
+            AC_FREE_DFA(acsm->acsmNextState[i], 0, 0);
     }
 
     for (plist = acsm->acsmPatterns; plist; )
@@ -2002,11 +2009,549 @@ void acsmFree2(ACSM_STRUCT2* acsm)
     }
 
     AC_FREE_DFA(acsm->acsmNextState, 0, 0);
-    AC_FREE(acsm->acsmFailState, 0, ACSM2_MEMORY_TYPE__NONE);
+
+    if ( !acsm->mapped )
+        AC_FREE(acsm->acsmFailState, 0, ACSM2_MEMORY_TYPE__NONE);
+
     AC_FREE(acsm->acsmMatchList, 0, ACSM2_MEMORY_TYPE__NONE);
     AC_FREE(acsm, 0, ACSM2_MEMORY_TYPE__NONE);
 }
 
+/*
+*   Compiled state serialization
+*
+*   Layout, all words in native byte order:
+*
+*     AcsmDbHeader
+*     num_states    byte offset of each state's row from the start of rows
+*     fail_words    acsmFailState (nfa only), used in place when loaded
+*     match_words   for each state with matches: state, count, and the
+*                   index of each pattern in acsmPatterns in list order
+*     row_bytes     the state rows in their final storage format, each
+*                   padded to a word; used in place when loaded
+*
+*   Pattern indices are only meaningful for the same patterns added in the
+*   same order; acsmGetHash2() covers both along with the options that
+*   change the rows.
+*/
+#define ACSM_DB_MAGIC   0x32534341  // "ACS2"
+#define ACSM_DB_VERSION 1
+
+struct AcsmDbHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pattern_count;
+    uint32_t num_states;
+    uint32_t num_trans;
+    uint32_t format;
+    uint32_t sizeofstate;
+    uint32_t dfa;
+    uint32_t fail_words;
+    uint32_t match_words;
+    uint32_t match_states;
+    uint32_t row_bytes;
+};
+
+static unsigned acsm_row_size(const ACSM_STRUCT2* acsm, const acstate_t* p)
+{
+    if ( acsm->acsmFormat == ACF_FULL )
+        return acsm->sizeofstate * (acsm->acsmAlphabetSize + 2);
+
+    switch ( p[0] )
+    {
+    case ACF_FULL:
+        return sizeof(acstate_t) * (acsm->acsmAlphabetSize + 2);
+
+    case ACF_SPARSE:
+        return sizeof(acstate_t) * (3 + 2 * p[2]);
+
+    case ACF_BANDED:
+        return sizeof(acstate_t) * (4 + p[2]);
+
+    case ACF_SPARSE_BANDS:
+    {
+        unsigned m = 3;
+
+        for ( acstate_t i = 0; i < p[2]; i++ )
+            m += 2 + p[m];
+
+        return sizeof(acstate_t) * m;
+    }
+    }
+    return 0;
+}
+
+static inline unsigned acsm_word_align(unsigned n)
+{ return (n + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1); }
+
+bool acsmGetHash2(ACSM_STRUCT2* acsm, std::string& hash)
+{
+    std::string blob;
+
+    const uint32_t opts[] =
+    {
+        ACSM_DB_VERSION, (uint32_t)acsm->acsmFormat, (uint32_t)acsm->dfa,
+        (uint32_t)acsm->compress_states, (uint32_t)acsm->acsmAlphabetSize,
+        (uint32_t)acsm->acsmSparseMaxRowNodes, (uint32_t)acsm->acsmSparseMaxZcnt,
+        (uint32_t)acsm->numPatterns
+    };
+    blob.append((const char*)opts, sizeof(opts));
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+    {
+        const uint32_t pat[] = { (uint32_t)p->n, (uint32_t)p->nocase, (uint32_t)p->negative };
+        blob.append((const char*)pat, sizeof(pat));
+        blob.append((const char*)p->casepatrn, p->n);
+    }
+
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256((const uint8_t*)blob.data(), blob.size(), digest);
+
+    const char* hex = "0123456789abcdef";
+    hash.clear();
+
+    for ( auto b : digest )
+    {
+        hash += hex[b >> 4];
+        hash += hex[b & 0xf];
+    }
+    return true;
+}
+
+bool acsmSerialize2(ACSM_STRUCT2* acsm, uint8_t*& buf, size_t& len)
+{
+    if ( !acsm->acsmNextState )
+        return false;
+
+    std::unordered_map<const void*, uint32_t> index;
+    uint32_t n = 0;
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+        index[p->patrn] = n++;
+
+    AcsmDbHeader hdr;
+    hdr.magic = ACSM_DB_MAGIC;
+    hdr.version = ACSM_DB_VERSION;
+    hdr.pattern_count = acsm->numPatterns;
+    hdr.num_states = acsm->acsmNumStates;
+    hdr.num_trans = acsm->acsmNumTrans;
+    hdr.format = acsm->acsmFormat;
+    hdr.sizeofstate = acsm->sizeofstate;
+    hdr.dfa = acsm->dfa;
+    hdr.fail_words = acsm->acsmFailState ? acsm->acsmNumStates : 0;
+    hdr.match_words = 0;
+    hdr.match_states = 0;
+    hdr.row_bytes = 0;
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+    {
+        hdr.row_bytes += acsm_word_align(acsm_row_size(acsm, acsm->acsmNextState[i]));
+
+        if ( !acsm->acsmMatchList[i] )
+            continue;
+
+        hdr.match_states++;
+        hdr.match_words += 2;
+
+        for ( ACSM_PATTERN2* mn = acsm->acsmMatchList[i]; mn; mn = mn->next )
+            hdr.match_words++;
+    }
+
+    len = sizeof(hdr) + hdr.row_bytes + sizeof(uint32_t) *
+        ((size_t)hdr.num_states + hdr.fail_words + hdr.match_words);
+
+    buf = (uint8_t*)snort_calloc(len);
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    uint32_t* offs = (uint32_t*)(buf + sizeof(hdr));
+    uint32_t* pw = offs + hdr.num_states;
+
+    if ( hdr.fail_words )
+    {
+        memcpy(pw, acsm->acsmFailState, hdr.fail_words * sizeof(uint32_t));
+        pw += hdr.fail_words;
+    }
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+    {
+        if ( !acsm->acsmMatchList[i] )
+            continue;
+
+        *pw++ = i;
+        uint32_t* count = pw++;
+        *count = 0;
+
+        // match entries are copies of the pattern so go by its buffer
+        for ( ACSM_PATTERN2* mn = acsm->acsmMatchList[i]; mn; mn = mn->next )
+        {
+            *pw++ = index[mn->patrn];
+            ++*count;
+        }
+    }
+
+    uint8_t* rows = (uint8_t*)pw;
+    uint32_t off = 0;
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+    {
+        unsigned size = acsm_row_size(acsm, acsm->acsmNextState[i]);
+        memcpy(rows + off, acsm->acsmNextState[i], size);
+        offs[i] = off;
+        off += acsm_word_align(size);
+    }
+    return true;
+}
+
+// already compiled - switch to the identical rows and fail states in a db
+// so that the memory is shared with other users of the db.  the match lists
+// and trees are kept.
+static bool acsm_rebase(
+    ACSM_STRUCT2* acsm, const AcsmDbHeader& hdr, const uint32_t* offs,
+    const uint32_t* fail, const uint8_t* rows)
+{
+    if ( hdr.num_states != (uint32_t)acsm->acsmNumStates or
+        hdr.sizeofstate != (uint32_t)acsm->sizeofstate or
+        (hdr.fail_words != 0) != (acsm->acsmFailState != nullptr) )
+        return false;
+
+    if ( hdr.fail_words and
+        memcmp(fail, acsm->acsmFailState, hdr.fail_words * sizeof(uint32_t)) )
+        return false;
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+    {
+        unsigned size = acsm_row_size(acsm, acsm->acsmNextState[i]);
+
+        if ( offs[i] + size > hdr.row_bytes or
+            memcmp(rows + offs[i], acsm->acsmNextState[i], size) )
+            return false;
+    }
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+    {
+        if ( !acsm->mapped )
+            AC_FREE_DFA(acsm->acsmNextState[i], 0, 0);
+
+        acsm->acsmNextState[i] = (acstate_t*)(rows + offs[i]);
+    }
+
+    if ( hdr.fail_words )
+    {
+        if ( !acsm->mapped )
+            AC_FREE(acsm->acsmFailState, 0, ACSM2_MEMORY_TYPE__NONE);
+
+        acsm->acsmFailState = (acstate_t*)fail;
+    }
+
+    if ( !acsm->mapped )
+        acsm2_mapped_memory += hdr.row_bytes + hdr.fail_words * sizeof(uint32_t);
+
+    acsm->mapped = true;
+    return true;
+}
+
+static inline bool acsm_check_states(const acstate_t* p, size_t n, uint32_t num_states)
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        if ( p[i] >= num_states )
+            return false;
+    }
+    return true;
+}
+
+template<typename T>
+static bool acsm_check_full(const uint8_t* row, unsigned alpha, uint32_t num_states)
+{
+    const T* p = (const T*)row;
+
+    if ( p[0] != ACF_FULL )
+        return false;
+
+    for ( unsigned i = 0; i < alpha; i++ )
+    {
+        if ( p[2 + i] >= num_states )
+            return false;
+    }
+    return true;
+}
+
+// a mapped db is used as is, so everything the searches rely on is checked
+// before it is accepted: each row must fit, have a format the engine uses
+// and only lead to existing states.  returns the row size or 0 if bad.
+static size_t acsm_check_row(
+    const AcsmDbHeader& hdr, unsigned alpha, const uint8_t* row, size_t room)
+{
+    if ( hdr.format == ACF_FULL )
+    {
+        size_t size = hdr.sizeofstate * (alpha + 2);
+
+        if ( size > room )
+            return 0;
+
+        bool ok;
+
+        if ( hdr.sizeofstate == 1 )
+            ok = acsm_check_full<uint8_t>(row, alpha, hdr.num_states);
+        else if ( hdr.sizeofstate == 2 )
+            ok = acsm_check_full<uint16_t>(row, alpha, hdr.num_states);
+        else
+            ok = acsm_check_full<uint32_t>(row, alpha, hdr.num_states);
+
+        return ok ? size : 0;
+    }
+
+    const acstate_t* p = (const acstate_t*)row;
+    size_t words = room / sizeof(acstate_t);
+    size_t m;
+
+    if ( hdr.sizeofstate != sizeof(acstate_t) or words < 3 )
+        return 0;
+
+    switch ( p[0] )
+    {
+    case ACF_FULL:
+        m = 2 + alpha;
+
+        if ( hdr.format != ACF_SPARSE or m > words or
+            !acsm_check_states(p + 2, alpha, hdr.num_states) )
+            return 0;
+        break;
+
+    case ACF_SPARSE:
+        m = 3 + 2 * (size_t)p[2];
+
+        if ( hdr.format != ACF_SPARSE or p[2] > alpha or m > words )
+            return 0;
+
+        for ( acstate_t i = 0; i < p[2]; i++ )
+        {
+            if ( p[4 + 2 * i] >= hdr.num_states )
+                return 0;
+        }
+        break;
+
+    case ACF_BANDED:
+        if ( hdr.format != ACF_BANDED or words < 4 or p[2] > alpha )
+            return 0;
+
+        m = 4 + p[2];
+
+        if ( m > words or !acsm_check_states(p + 4, p[2], hdr.num_states) )
+            return 0;
+        break;
+
+    case ACF_SPARSE_BANDS:
+        if ( hdr.format != ACF_SPARSE_BANDS or p[2] > alpha )
+            return 0;
+
+        m = 3;
+
+        for ( acstate_t i = 0; i < p[2]; i++ )
+        {
+            if ( m + 2 > words or p[m] > alpha )
+                return 0;
+
+            size_t n = p[m];
+            m += 2;
+
+            if ( m + n > words or !acsm_check_states(p + m, n, hdr.num_states) )
+                return 0;
+
+            m += n;
+        }
+        break;
+
+    default:
+        return 0;
+    }
+    return m * sizeof(acstate_t);
+}
+
+// the nfa follows fail states until a row has a transition; only the root
+// always has one so every chain must end there
+static bool acsm_check_fail(const uint32_t* fail, uint32_t num_states)
+{
+    enum { NEW, ON_CHAIN, ROOTED };
+    std::vector<uint8_t> seen(num_states, NEW);
+    seen[0] = ROOTED;
+
+    for ( uint32_t i = 1; i < num_states; i++ )
+    {
+        uint32_t s = i;
+
+        while ( seen[s] == NEW )
+        {
+            if ( fail[s] >= num_states )
+                return false;
+
+            seen[s] = ON_CHAIN;
+            s = fail[s];
+        }
+
+        if ( seen[s] == ON_CHAIN )
+            return false;
+
+        for ( s = i; seen[s] == ON_CHAIN; s = fail[s] )
+            seen[s] = ROOTED;
+    }
+    return true;
+}
+
+static bool acsm_check_db(
+    const AcsmDbHeader& hdr, unsigned alpha, const uint32_t* offs, const uint32_t* fail,
+    const uint8_t* rows)
+{
+    for ( uint32_t i = 0; i < hdr.num_states; i++ )
+    {
+        if ( !acsm_check_row(hdr, alpha, rows + offs[i], hdr.row_bytes - offs[i]) )
+            return false;
+    }
+
+    if ( hdr.dfa )
+        return true;
+
+    // a sparse row fails on inputs below its first transition even at the root
+    if ( hdr.format != ACF_FULL and ((const acstate_t*)(rows + offs[0]))[0] == ACF_SPARSE )
+        return false;
+
+    return acsm_check_fail(fail, hdr.num_states);
+}
+
+bool acsmDeserialize2(
+    snort::SnortConfig* sc, ACSM_STRUCT2* acsm, const uint8_t* buf, size_t len)
+{
+    AcsmDbHeader hdr;
+
+    if ( len < sizeof(hdr) or ((uintptr_t)buf % sizeof(uint32_t)) )
+        return false;
+
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    if ( hdr.magic != ACSM_DB_MAGIC or hdr.version != ACSM_DB_VERSION or
+        hdr.pattern_count != (uint32_t)acsm->numPatterns or !hdr.num_states or
+        hdr.format != (uint32_t)acsm->acsmFormat or hdr.dfa != (uint32_t)acsm->dfa or
+        (hdr.fail_words and hdr.fail_words != hdr.num_states) or
+        (!hdr.dfa and !hdr.fail_words) )
+        return false;
+
+    if ( hdr.sizeofstate != 1 and hdr.sizeofstate != 2 and hdr.sizeofstate != 4 )
+        return false;
+
+    size_t words = (size_t)hdr.num_states + hdr.fail_words + hdr.match_words;
+
+    if ( len != sizeof(hdr) + sizeof(uint32_t) * words + hdr.row_bytes )
+        return false;
+
+    const uint32_t* offs = (const uint32_t*)(buf + sizeof(hdr));
+    const uint32_t* fail = offs + hdr.num_states;
+    const uint32_t* match = fail + hdr.fail_words;
+    const uint32_t* end = match + hdr.match_words;
+    const uint8_t* rows = (const uint8_t*)end;
+
+    for ( uint32_t i = 0; i < hdr.num_states; i++ )
+    {
+        if ( offs[i] >= hdr.row_bytes or (offs[i] % sizeof(uint32_t)) )
+            return false;
+    }
+
+    if ( acsm->acsmNextState )
+        return acsm_rebase(acsm, hdr, offs, fail, rows);
+
+    if ( !acsm_check_db(hdr, acsm->acsmAlphabetSize, offs, fail, rows) )
+        return false;
+
+    std::vector<ACSM_PATTERN2*> patterns;
+
+    for ( ACSM_PATTERN2* p = acsm->acsmPatterns; p; p = p->next )
+        patterns.emplace_back(p);
+
+    // check the match lists before building anything
+    for ( const uint32_t* pw = match; pw < end; )
+    {
+        if ( end - pw < 2 or pw[0] >= hdr.num_states or !pw[1] or pw[1] > (uint32_t)(end - pw - 2) )
+            return false;
+
+        for ( uint32_t k = 0; k < pw[1]; k++ )
+        {
+            if ( pw[2 + k] >= hdr.pattern_count )
+                return false;
+        }
+        pw += 2 + pw[1];
+    }
+
+    acsm->acsmNumStates = hdr.num_states;
+    acsm->acsmNumTrans = hdr.num_trans;
+    acsm->sizeofstate = hdr.sizeofstate;
+
+    for ( auto p : patterns )
+        acsm->acsmMaxStates += p->n;
+
+    acsm->acsmMaxStates++;
+
+    acsm->acsmMatchList = (ACSM_PATTERN2**)AC_MALLOC(
+        sizeof(ACSM_PATTERN2*) * acsm->acsmNumStates, ACSM2_MEMORY_TYPE__MATCHLIST);
+    MEMASSERT(acsm->acsmMatchList, "acsmDeserialize2");
+
+    for ( const uint32_t* pw = match; pw < end; pw += 2 + pw[1] )
+    {
+        ACSM_PATTERN2** tail = &acsm->acsmMatchList[pw[0]];
+
+        while ( *tail )
+            tail = &(*tail)->next;
+
+        for ( uint32_t k = 0; k < pw[1]; k++ )
+        {
+            ACSM_PATTERN2* mn = CopyMatchListEntry(patterns[pw[2 + k]]);
+            mn->next = nullptr;
+            *tail = mn;
+            tail = &mn->next;
+        }
+    }
+
+    // the db is read only; the searches never write the rows
+    acsm->acsmNextState = (acstate_t**)AC_MALLOC_DFA(
+        acsm->acsmNumStates * sizeof(acstate_t*), acsm->sizeofstate);
+    MEMASSERT(acsm->acsmNextState, "acsmDeserialize2-NextState");
+
+    for ( int i = 0; i < acsm->acsmNumStates; i++ )
+        acsm->acsmNextState[i] = (acstate_t*)(rows + offs[i]);
+
+    acsm->acsmFailState = hdr.fail_words ? (acstate_t*)fail : nullptr;
+    acsm->mapped = true;
+
+    acsm2_mapped_memory += hdr.row_bytes + hdr.fail_words * sizeof(uint32_t);
+
+    for ( auto p : patterns )
+    {
+        summary.num_patterns++;
+        summary.num_characters += p->n;
+    }
+
+    if ( acsm->compress_states )
+    {
+        if ( acsm->sizeofstate == 1 )
+            summary.num_1byte_instances++;
+        else if ( acsm->sizeofstate == 2 )
+            summary.num_2byte_instances++;
+        else
+            summary.num_4byte_instances++;
+    }
+
+    summary.num_match_states += hdr.match_states;
+    summary.num_states += acsm->acsmNumStates;
+    summary.num_transitions += acsm->acsmNumTrans;
+    summary.num_instances++;
+
+    memcpy(&summary.acsm, acsm, sizeof(ACSM_STRUCT2));
+
+    if ( acsm->agent )
+        acsmBuildMatchStateTrees2(sc, acsm);
+
+    return true;
+}
+
 int acsmPatternCount2(ACSM_STRUCT2* acsm)
 {
     return acsm->numPatterns;
@@ -2179,6 +2724,9 @@ int acsmPrintSummaryInfo2()
     LogStat("transition memory", acsm2_transtable_memory/scale);
     LogStat("fail state memory", acsm2_failstate_memory/scale);
 
+    if ( acsm2_mapped_memory )
+        LogStat("mapped memory", acsm2_mapped_memory/scale);
+
 #if 0  // FIXIT-L clean up format; not all this should be printed all the time
     if (acsm2_dfa_memory > 0)
     {
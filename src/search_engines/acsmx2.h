@@ -24,7 +24,9 @@
 
 // Version 2.0
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "search_common.h"
 
@@ -127,6 +129,7 @@ struct ACSM_STRUCT2
     int compress_states;
 
     bool dfa;
+    bool mapped;  // rows and fail states are in a loaded db, not ours to free
 
     void enable_dfa()
     { dfa = true; }
@@ -169,6 +172,13 @@ void acsmCompressStates(ACSM_STRUCT2*, int);
 
 void acsmPrintInfo2(ACSM_STRUCT2* p);
 
+// compiled state serialization - see Mpse::serialize().  acsmDeserialize2
+// is used in place of acsmCompile2 or after it to share identical state,
+// and references buf for the state rows.
+bool acsmGetHash2(ACSM_STRUCT2*, std::string&);
+bool acsmSerialize2(ACSM_STRUCT2*, uint8_t*& buf, size_t& len);
+bool acsmDeserialize2(snort::SnortConfig*, ACSM_STRUCT2*, const uint8_t* buf, size_t len);
+
 int acsmPrintDetailInfo2(ACSM_STRUCT2*);
 int acsmPrintSummaryInfo2();
 void acsmx2_print_qinfo();
@@ -147,7 +147,10 @@
 #include "bnfa_search.h"
 
 #include <list>
+#include <unordered_map>
+#include <vector>
 
+#include "hash/hashes.h"
 #include "log/messages.h"
 #include "utils/stats.h"
 #include "utils/util.h"
@@ -895,6 +898,7 @@ static int _bnfa_conv_list_to_csparse_array(bnfa_struct_t* bnfa)
         return -1;
     }
     bnfa->bnfaTransList = ps;
+    bnfa->bnfaTransWords = nps;
 
     /*
        State Index list for pi - we need an array of bnfa_state_t items of size 'NumStates'
@@ -1279,8 +1283,9 @@ void bnfaFree(bnfa_struct_t* bnfa)
         bnfa->matchlist_memory);
     BNFA_FREE(bnfa->bnfaNextState,bnfa->bnfaNumStates*sizeof(bnfa_state_t*),
         bnfa->nextstate_memory);
-    BNFA_FREE(bnfa->bnfaTransList,(2*bnfa->bnfaNumStates+bnfa->bnfaNumTrans)*sizeof(bnfa_state_t*),
-        bnfa->nextstate_memory);
+    if ( !bnfa->bnfaTransMapped )
+        BNFA_FREE(bnfa->bnfaTransList,bnfa->bnfaTransWords*sizeof(bnfa_state_t),
+            bnfa->nextstate_memory);
     snort_free(bnfa);   /* cannot update memory tracker when deleting bnfa so just 'free' it !*/
 }
 
@@ -1448,19 +1453,32 @@ static inline int _bnfaCompile(bnfa_struct_t* bnfa)
 
     bnfa->bnfaMatchStates = cntMatchStates;
 
-    bnfaAccumInfo(bnfa);
-
     return 0;
 }
 
-int bnfaCompile(snort::SnortConfig* sc, bnfa_struct_t* bnfa)
+/*
+*   bnfaCompileStates only touches this bnfa so distinct instances may be
+*   compiled concurrently; bnfaFinishStates must then run in the main thread
+*/
+int bnfaCompileStates(bnfa_struct_t* bnfa)
 {
-    if ( int rval = _bnfaCompile (bnfa) )
-        return rval;
+    return _bnfaCompile(bnfa);
+}
+
+void bnfaFinishStates(snort::SnortConfig* sc, bnfa_struct_t* bnfa)
+{
+    bnfaAccumInfo(bnfa);
 
     if ( bnfa->agent )
         bnfaBuildMatchStateTrees(sc, bnfa);
+}
+
+int bnfaCompile(snort::SnortConfig* sc, bnfa_struct_t* bnfa)
+{
+    if ( int rval = bnfaCompileStates(bnfa) )
+        return rval;
 
+    bnfaFinishStates(sc, bnfa);
     return 0;
 }
 
@@ -1642,6 +1660,326 @@ int bnfaPatternCount(bnfa_struct_t* p)
     return p->bnfaPatternCnt;
 }
 
+/*
+*   Compiled state serialization
+*
+*   Layout, all words in native byte order:
+*
+*     bnfa_db_header_t
+*     trans_words   bnfaTransList, used in place when loaded
+*     match_words   for each state with matches: state, count, and the
+*                   index of each pattern in bnfaPatterns in list order
+*
+*   Pattern indices are only meaningful for the same patterns added in the
+*   same order; bnfaGetHash() covers both so a db is only loaded when the
+*   hash used to find it matches.
+*/
+#define BNFA_DB_MAGIC   0x41464e42  /* "BNFA" */
+#define BNFA_DB_VERSION 1
+
+struct bnfa_db_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pattern_count;
+    uint32_t num_states;
+    uint32_t num_trans;
+    uint32_t match_states;
+    uint32_t trans_words;
+    uint32_t match_words;
+};
+
+bool bnfaGetHash(bnfa_struct_t* bnfa, std::string& hash)
+{
+    std::string blob;
+
+    const uint32_t opts[] =
+    {
+        BNFA_DB_VERSION, (uint32_t)bnfa->bnfaFormat, (uint32_t)bnfa->bnfaCaseMode,
+        (uint32_t)bnfa->bnfaOpt, (uint32_t)bnfa->bnfaPatternCnt
+    };
+    blob.append((const char*)opts, sizeof(opts));
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+    {
+        const uint32_t pat[] = { p->n, (uint32_t)p->nocase, (uint32_t)p->negative };
+        blob.append((const char*)pat, sizeof(pat));
+        blob.append((const char*)p->casepatrn, p->n);
+    }
+
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256((const uint8_t*)blob.data(), blob.size(), digest);
+
+    const char* hex = "0123456789abcdef";
+    hash.clear();
+
+    for ( auto b : digest )
+    {
+        hash += hex[b >> 4];
+        hash += hex[b & 0xf];
+    }
+    return true;
+}
+
+bool bnfaSerialize(bnfa_struct_t* bnfa, uint8_t*& buf, size_t& len)
+{
+    if ( bnfa->bnfaFormat != BNFA_SPARSE or !bnfa->bnfaTransList )
+        return false;
+
+    std::unordered_map<const void*, uint32_t> index;
+    uint32_t n = 0;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+        index[p] = n++;
+
+    bnfa_db_header_t hdr;
+    hdr.magic = BNFA_DB_MAGIC;
+    hdr.version = BNFA_DB_VERSION;
+    hdr.pattern_count = bnfa->bnfaPatternCnt;
+    hdr.num_states = bnfa->bnfaNumStates;
+    hdr.num_trans = bnfa->bnfaNumTrans;
+    hdr.match_states = bnfa->bnfaMatchStates;
+    hdr.trans_words = bnfa->bnfaTransWords;
+    hdr.match_words = 0;
+
+    for ( int i = 0; i < bnfa->bnfaNumStates; i++ )
+    {
+        if ( !bnfa->bnfaMatchList[i] )
+            continue;
+
+        hdr.match_words += 2;
+
+        for ( bnfa_match_node_t* mn = bnfa->bnfaMatchList[i]; mn; mn = mn->next )
+            hdr.match_words++;
+    }
+
+    len = sizeof(hdr) + ((size_t)hdr.trans_words + hdr.match_words) * sizeof(uint32_t);
+    buf = (uint8_t*)snort_alloc(len);
+
+    memcpy(buf, &hdr, sizeof(hdr));
+    uint32_t* pw = (uint32_t*)(buf + sizeof(hdr));
+
+    memcpy(pw, bnfa->bnfaTransList, hdr.trans_words * sizeof(uint32_t));
+    pw += hdr.trans_words;
+
+    for ( int i = 0; i < bnfa->bnfaNumStates; i++ )
+    {
+        if ( !bnfa->bnfaMatchList[i] )
+            continue;
+
+        *pw++ = i;
+        uint32_t* count = pw++;
+        *count = 0;
+
+        for ( bnfa_match_node_t* mn = bnfa->bnfaMatchList[i]; mn; mn = mn->next )
+        {
+            *pw++ = index[mn->data];
+            ++*count;
+        }
+    }
+    return true;
+}
+
+/*
+*   Already compiled - switch to the identical transitions in a db so that
+*   the memory is shared with other users of the db.  The match lists and
+*   trees are kept.
+*/
+static bool bnfaRebase(
+    bnfa_struct_t* bnfa, const bnfa_db_header_t& hdr, const bnfa_state_t* trans)
+{
+    if ( hdr.num_states != (uint32_t)bnfa->bnfaNumStates or
+        hdr.trans_words != bnfa->bnfaTransWords or
+        memcmp(trans, bnfa->bnfaTransList, hdr.trans_words * sizeof(bnfa_state_t)) )
+        return false;
+
+    if ( !bnfa->bnfaTransMapped )
+        BNFA_FREE(bnfa->bnfaTransList,bnfa->bnfaTransWords*sizeof(bnfa_state_t),
+            bnfa->nextstate_memory);
+
+    bnfa->bnfaTransList = (bnfa_state_t*)trans;
+    bnfa->bnfaTransMapped = 1;
+    bnfa->mapped_memory = hdr.trans_words * sizeof(bnfa_state_t);
+
+    return true;
+}
+
+/*
+*   A mapped db is used as is, so everything the search relies on is checked
+*   before it is accepted: the rows must tile the transition list in state
+*   order, every next and fail index must be the start of a row, the root
+*   must be full, and following fail indices must always reach the root.
+*/
+static bool bnfaCheckTrans(const bnfa_db_header_t& hdr, const bnfa_state_t* trans)
+{
+    const uint32_t none = (uint32_t)-1;
+    std::vector<uint32_t> row(hdr.trans_words, none);
+    uint32_t k = 0;
+
+    for ( uint32_t i = 0; i < hdr.trans_words; k++ )
+    {
+        if ( k >= hdr.num_states or hdr.trans_words - i < 2 or trans[i] != k )
+            return false;
+
+        row[i] = k;
+        bnfa_state_t cw = trans[i + 1];
+        uint32_t n;
+
+        if ( cw & BNFA_SPARSE_FULL_BIT )
+            n = BNFA_MAX_ALPHABET_SIZE;
+        else
+            n = (cw & BNFA_SPARSE_COUNT_BITS) >> BNFA_SPARSE_COUNT_SHIFT;
+
+        if ( k == 0 and !(cw & BNFA_SPARSE_FULL_BIT) )
+            return false;
+
+        if ( n > hdr.trans_words - i - 2 )
+            return false;
+
+        i += 2 + n;
+    }
+
+    if ( k != hdr.num_states )
+        return false;
+
+    std::vector<uint32_t> fail(hdr.num_states);
+
+    for ( uint32_t i = 0; i < hdr.trans_words; )
+    {
+        bnfa_state_t cw = trans[i + 1];
+        uint32_t n = (cw & BNFA_SPARSE_FULL_BIT) ? BNFA_MAX_ALPHABET_SIZE :
+            (cw & BNFA_SPARSE_COUNT_BITS) >> BNFA_SPARSE_COUNT_SHIFT;
+
+        for ( uint32_t j = 0; j <= n; j++ )
+        {
+            uint32_t next = trans[i + 1 + j] & BNFA_SPARSE_MAX_STATE;
+
+            if ( next >= hdr.trans_words or row[next] == none )
+                return false;
+        }
+        fail[row[i]] = row[cw & BNFA_SPARSE_MAX_STATE];
+        i += 2 + n;
+    }
+
+    // the search follows fail indices until a row has a transition
+    enum { NEW, ON_CHAIN, ROOTED };
+    std::vector<uint8_t> seen(hdr.num_states, NEW);
+    seen[0] = ROOTED;
+
+    for ( uint32_t i = 1; i < hdr.num_states; i++ )
+    {
+        uint32_t s = i;
+
+        while ( seen[s] == NEW )
+        {
+            seen[s] = ON_CHAIN;
+            s = fail[s];
+        }
+
+        if ( seen[s] == ON_CHAIN )
+            return false;
+
+        for ( s = i; seen[s] == ON_CHAIN; s = fail[s] )
+            seen[s] = ROOTED;
+    }
+    return true;
+}
+
+bool bnfaDeserialize(
+    snort::SnortConfig* sc, bnfa_struct_t* bnfa, const uint8_t* buf, size_t len)
+{
+    bnfa_db_header_t hdr;
+
+    if ( len < sizeof(hdr) or ((uintptr_t)buf % sizeof(bnfa_state_t)) )
+        return false;
+
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    if ( hdr.magic != BNFA_DB_MAGIC or hdr.version != BNFA_DB_VERSION or
+        hdr.pattern_count != bnfa->bnfaPatternCnt or !hdr.num_states or
+        hdr.num_states > BNFA_SPARSE_MAX_STATE or hdr.trans_words > BNFA_SPARSE_MAX_STATE )
+        return false;
+
+    if ( len != sizeof(hdr) + ((size_t)hdr.trans_words + hdr.match_words) * sizeof(uint32_t) )
+        return false;
+
+    const bnfa_state_t* trans = (const bnfa_state_t*)(buf + sizeof(hdr));
+
+    if ( bnfa->bnfaTransList )
+        return bnfaRebase(bnfa, hdr, trans);
+
+    if ( !bnfaCheckTrans(hdr, trans) )
+        return false;
+
+    std::vector<bnfa_pattern_t*> patterns;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+        patterns.emplace_back(p);
+
+    const uint32_t* match = trans + hdr.trans_words;
+    const uint32_t* end = match + hdr.match_words;
+
+    // check the match lists before building anything
+    for ( const uint32_t* pw = match; pw < end; )
+    {
+        if ( end - pw < 2 or pw[0] >= hdr.num_states or !pw[1] or pw[1] > (uint32_t)(end - pw - 2) )
+            return false;
+
+        for ( uint32_t k = 0; k < pw[1]; k++ )
+        {
+            if ( pw[2 + k] >= hdr.pattern_count )
+                return false;
+        }
+        pw += 2 + pw[1];
+    }
+
+    bnfa->bnfaMatchList = (bnfa_match_node_t**)BNFA_MALLOC(
+        sizeof(void*) * hdr.num_states, bnfa->matchlist_memory);
+
+    if ( !bnfa->bnfaMatchList )
+        return false;
+
+    for ( const uint32_t* pw = match; pw < end; pw += 2 + pw[1] )
+    {
+        bnfa_match_node_t** tail = &bnfa->bnfaMatchList[pw[0]];
+
+        while ( *tail )
+            tail = &(*tail)->next;
+
+        for ( uint32_t k = 0; k < pw[1]; k++ )
+        {
+            bnfa_match_node_t* mn = (bnfa_match_node_t*)BNFA_MALLOC(
+                sizeof(bnfa_match_node_t), bnfa->matchlist_memory);
+
+            mn->data = patterns[pw[2 + k]];
+            *tail = mn;
+            tail = &mn->next;
+        }
+    }
+
+    for ( auto p : patterns )
+        bnfa->bnfaMaxStates += p->n;
+
+    bnfa->bnfaMaxStates++;
+
+    bnfa->bnfaNumStates = hdr.num_states;
+    bnfa->bnfaNumTrans = hdr.num_trans;
+    bnfa->bnfaMatchStates = hdr.match_states;
+
+    // the db is read only; the search never writes the transitions
+    bnfa->bnfaTransList = (bnfa_state_t*)trans;
+    bnfa->bnfaTransWords = hdr.trans_words;
+    bnfa->bnfaTransMapped = 1;
+    bnfa->mapped_memory = hdr.trans_words * sizeof(bnfa_state_t);
+
+    bnfaAccumInfo(bnfa);
+
+    if ( bnfa->agent )
+        bnfaBuildMatchStateTrees(sc, bnfa);
+
+    return true;
+}
+
 static bnfa_struct_t summary;
 static int summary_cnt = 0;
 
@@ -1678,6 +2016,9 @@ static void bnfaPrintInfoEx(bnfa_struct_t* p)
     LogStat("pattern memory", p->pat_memory/scale);
     LogStat("match list memory", p->matchlist_memory/scale);
     LogStat("transition memory", p->nextstate_memory/scale);
+
+    if ( p->mapped_memory )
+        LogStat("mapped memory", p->mapped_memory/scale);
 }
 
 void bnfaPrintInfo(bnfa_struct_t* p)
@@ -1714,5 +2055,6 @@ void bnfaAccumInfo(bnfa_struct_t* p)
     px->matchlist_memory += p->matchlist_memory;
     px->nextstate_memory += p->nextstate_memory;
     px->failstate_memory += p->failstate_memory;
+    px->mapped_memory    += p->mapped_memory;
 }
 
@@ -30,7 +30,9 @@
 ** date:   12/21/05
 */
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "search_common.h"
 
@@ -140,6 +142,9 @@ struct bnfa_struct_t
     bnfa_state_t* bnfaFailState;
     bnfa_state_t* bnfaTransList;
 
+    unsigned bnfaTransWords;   /* size of bnfaTransList */
+    int bnfaTransMapped;       /* bnfaTransList is in a loaded db, not ours to free */
+
     const MpseAgent* agent;
 
     int bnfaForceFullZeroState;
@@ -151,6 +156,7 @@ struct bnfa_struct_t
     int nextstate_memory;
     int failstate_memory;
     int matchlist_memory;
+    int mapped_memory;
 };
 
 /*
@@ -169,6 +175,8 @@ int bnfaAddPattern(
     bool nocase, bool negative, void* userdata);
 
 int bnfaCompile(snort::SnortConfig*, bnfa_struct_t*);
+int bnfaCompileStates(bnfa_struct_t*);
+void bnfaFinishStates(snort::SnortConfig*, bnfa_struct_t*);
 
 unsigned _bnfa_search_csparse_nfa(
     bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
@@ -176,6 +184,15 @@ unsigned _bnfa_search_csparse_nfa(
 
 int bnfaPatternCount(bnfa_struct_t* p);
 
+/*
+*   Compiled state serialization - see Mpse::serialize().  bnfaDeserialize
+*   is used in place of bnfaCompile or after it to share identical state,
+*   and references buf for the transitions.
+*/
+bool bnfaGetHash(bnfa_struct_t*, std::string&);
+bool bnfaSerialize(bnfa_struct_t*, uint8_t*& buf, size_t& len);
+bool bnfaDeserialize(snort::SnortConfig*, bnfa_struct_t*, const uint8_t* buf, size_t len);
+
 void bnfaPrint(bnfa_struct_t* pstruct);   /* prints the nfa states-verbose!! */
 void bnfaPrintInfo(bnfa_struct_t* pstruct);    /* print info on this search engine */
 
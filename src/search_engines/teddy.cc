@@ -0,0 +1,847 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// teddy.cc
+
+// teddy is a SIMD literal prefilter after the one in hyperscan.  patterns
+// are spread over 8 buckets and for each of the first m bytes of a pattern
+// (its fingerprint) a pair of 16 entry tables gives the buckets with that
+// low or high nibble at that position.  each table fits in a register so a
+// shuffle looks up a whole block of input at once and and-ing the results
+// for m consecutive offsets leaves the buckets that may start a match at
+// each position.  candidates are verified against the patterns with the
+// same case folded fingerprint.
+//
+// fingerprints are up to 3 bytes.  shorter patterns get their own matcher
+// so that a single 1 byte pattern doesn't ruin the filter for the rest.
+// candidates from the nibble tables are rechecked against exact per byte
+// tables, then confirmed with a hash of the fingerprint or, for patterns of
+// 8 bytes or more, of the first 8 bytes since rule patterns often share
+// short prefixes.
+//
+// the kernel is the best of avx512bw, avx2, and ssse3 the cpu supports; a
+// scalar loop handles the tail of a buffer and anything else.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define USE_TEDDY_SIMD
+#include <immintrin.h>
+#if defined(__clang__) or __GNUC__ >= 5
+#define USE_TEDDY_AVX512
+#endif
+#endif
+
+#include "framework/mpse.h"
+#include "log/messages.h"
+#include "utils/stats.h"
+
+using namespace snort;
+
+enum TeddyIsa
+{
+    TEDDY_SCALAR, TEDDY_SSSE3, TEDDY_AVX2, TEDDY_AVX512, TEDDY_MAX
+};
+
+static const char* const isa_names[TEDDY_MAX] = { "scalar", "ssse3", "avx2", "avx512bw" };
+
+// best kernel to use; set from the cpu at init and may be lowered to
+// check the others
+TeddyIsa teddy_isa = TEDDY_SCALAR;
+
+static const unsigned max_fp = 3;
+static const unsigned long_key = 8;
+static const unsigned num_buckets = 8;
+
+static uint8_t xlat[256];
+
+static void init_xlat()
+{
+    for ( unsigned i = 0; i < 256; ++i )
+        xlat[i] = (uint8_t)toupper(i);
+}
+
+static TeddyIsa get_cpu_isa()
+{
+#ifdef USE_TEDDY_SIMD
+    __builtin_cpu_init();
+
+#ifdef USE_TEDDY_AVX512
+    if ( __builtin_cpu_supports("avx512bw") )
+        return TEDDY_AVX512;
+#endif
+    if ( __builtin_cpu_supports("avx2") )
+        return TEDDY_AVX2;
+
+    if ( __builtin_cpu_supports("ssse3") )
+        return TEDDY_SSSE3;
+#endif
+    return TEDDY_SCALAR;
+}
+
+//-------------------------------------------------------------------------
+// patterns and match states
+//-------------------------------------------------------------------------
+
+struct TeddyPattern
+{
+    std::string pat;
+    bool no_case;
+    bool negated;
+    void* user;
+
+    TeddyPattern(const uint8_t* s, unsigned n, const Mpse::PatternDescriptor& d, void* u) :
+        pat((const char*)s, n), no_case(d.no_case), negated(d.negated), user(u)
+    { }
+};
+
+// identical patterns share a state (and tree) like the ac engines
+struct TeddyState
+{
+    std::string pat;    // upper case if no_case
+    bool no_case;
+
+    void* user = nullptr;
+    void* tree = nullptr;
+    void* list = nullptr;
+
+    std::vector<unsigned> pids;
+};
+
+static uint64_t get_key(const uint8_t* s, unsigned m)
+{
+    uint64_t key = 0;
+
+    for ( unsigned i = 0; i < m; ++i )
+        key |= (uint64_t)xlat[s[i]] << (8 * i);
+
+    return key;
+}
+
+static inline uint64_t hash_key(uint64_t key)
+{ return key * 0x9E3779B97F4A7C15ULL; }
+
+//-------------------------------------------------------------------------
+// matcher - one per fingerprint length
+//-------------------------------------------------------------------------
+
+struct TeddyScan;
+typedef bool (* TeddyScanFunc)(TeddyScan&);
+
+struct TeddySlot
+{
+    uint64_t key;
+    uint32_t begin;
+    uint32_t end;       // 0 if empty
+};
+
+// states keyed by their first klen bytes, case folded
+struct TeddyTable
+{
+    unsigned klen = 0;
+    unsigned shift = 0;
+
+    std::vector<TeddySlot> slots;
+    std::vector<unsigned> sids;
+
+    void build(const std::vector<TeddyState>&, std::vector<unsigned>&, unsigned klen);
+
+    const TeddySlot& find(uint64_t key) const
+    {
+        unsigned mask = slots.size() - 1;
+        unsigned i = hash_key(key) >> shift;
+
+        while ( slots[i].end and slots[i].key != key )
+            i = (i + 1) & mask;
+
+        return slots[i];
+    }
+};
+
+struct TeddyMatcher
+{
+    alignas(16) uint8_t lo[max_fp][16];
+    alignas(16) uint8_t hi[max_fp][16];
+
+    // exact per byte buckets for the scalar loop
+    uint8_t bt[max_fp][256];
+
+    unsigned m = 0;
+    TeddyScanFunc scan = nullptr;
+
+    TeddyTable tables[2];   // short and long keys
+
+    void build(const std::vector<TeddyState>&, std::vector<unsigned>&, unsigned m, TeddyIsa);
+
+    bool exact(const uint8_t* t) const
+    {
+        uint8_t b = bt[0][t[0]];
+
+        for ( unsigned i = 1; i < m and b; ++i )
+            b &= bt[i][t[i]];
+
+        return b != 0;
+    }
+};
+
+struct TeddyScan
+{
+    const TeddyMatcher* tm;
+    const TeddyState* states;
+
+    const uint8_t* T;
+    unsigned n;
+
+    MpseMatch match;
+    void* context;
+    int nfound;
+
+    bool verify(unsigned pos);
+    bool verify(const TeddyTable&, unsigned pos);
+};
+
+// return true to stop the search
+bool TeddyScan::verify(unsigned pos)
+{
+    for ( const auto& tab : tm->tables )
+    {
+        if ( tab.slots.empty() or tab.klen > n - pos )
+            continue;
+
+        if ( verify(tab, pos) )
+            return true;
+    }
+    return false;
+}
+
+bool TeddyScan::verify(const TeddyTable& tab, unsigned pos)
+{
+    const TeddySlot& slot = tab.find(get_key(T + pos, tab.klen));
+
+    for ( unsigned k = slot.begin; k < slot.end; ++k )
+    {
+        const TeddyState& s = states[tab.sids[k]];
+        unsigned len = s.pat.size();
+
+        if ( len > n - pos )
+            continue;
+
+        const uint8_t* t = T + pos;
+        const uint8_t* p = (const uint8_t*)s.pat.data();
+
+        if ( s.no_case )
+        {
+            unsigned j = tab.klen;
+
+            while ( j < len and xlat[t[j]] == p[j] )
+                ++j;
+
+            if ( j < len )
+                continue;
+        }
+        else if ( memcmp(t, p, len) )
+            continue;
+
+        nfound++;
+
+        if ( match(s.user, s.tree, pos + len, context, s.list) > 0 )
+            return true;
+    }
+    return false;
+}
+
+template<unsigned M>
+static bool scan_tail(TeddyScan& ts, unsigned pos)
+{
+    const TeddyMatcher& tm = *ts.tm;
+
+    for ( ; pos + M <= ts.n; ++pos )
+    {
+        if ( tm.exact(ts.T + pos) and ts.verify(pos) )
+            return true;
+    }
+    return false;
+}
+
+template<unsigned M>
+static bool scan_scalar(TeddyScan& ts)
+{ return scan_tail<M>(ts, 0); }
+
+#ifdef USE_TEDDY_SIMD
+template<unsigned M>
+__attribute__((target("ssse3")))
+static bool scan_ssse3(TeddyScan& ts)
+{
+    const TeddyMatcher& tm = *ts.tm;
+    const __m128i nib = _mm_set1_epi8(0x0f);
+    __m128i lo[M], hi[M];
+
+    for ( unsigned i = 0; i < M; ++i )
+    {
+        lo[i] = _mm_load_si128((const __m128i*)tm.lo[i]);
+        hi[i] = _mm_load_si128((const __m128i*)tm.hi[i]);
+    }
+
+    unsigned pos = 0;
+
+    for ( ; pos + 16 + M - 1 <= ts.n; pos += 16 )
+    {
+        __m128i r = _mm_set1_epi8(-1);
+
+        for ( unsigned i = 0; i < M; ++i )
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(ts.T + pos + i));
+            __m128i l = _mm_shuffle_epi8(lo[i], _mm_and_si128(v, nib));
+            __m128i h = _mm_shuffle_epi8(hi[i], _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+            r = _mm_and_si128(r, _mm_and_si128(l, h));
+        }
+
+        unsigned bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(r, _mm_setzero_si128())) & 0xFFFF;
+
+        while ( bits )
+        {
+            unsigned j = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if ( tm.exact(ts.T + pos + j) and ts.verify(pos + j) )
+                return true;
+        }
+    }
+    return scan_tail<M>(ts, pos);
+}
+
+template<unsigned M>
+__attribute__((target("avx2")))
+static bool scan_avx2(TeddyScan& ts)
+{
+    const TeddyMatcher& tm = *ts.tm;
+    const __m256i nib = _mm256_set1_epi8(0x0f);
+    __m256i lo[M], hi[M];
+
+    for ( unsigned i = 0; i < M; ++i )
+    {
+        lo[i] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)tm.lo[i]));
+        hi[i] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)tm.hi[i]));
+    }
+
+    unsigned pos = 0;
+
+    for ( ; pos + 32 + M - 1 <= ts.n; pos += 32 )
+    {
+        __m256i r = _mm256_set1_epi8(-1);
+
+        for ( unsigned i = 0; i < M; ++i )
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(ts.T + pos + i));
+            __m256i l = _mm256_shuffle_epi8(lo[i], _mm256_and_si256(v, nib));
+            __m256i h = _mm256_shuffle_epi8(hi[i], _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+            r = _mm256_and_si256(r, _mm256_and_si256(l, h));
+        }
+
+        uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(r, _mm256_setzero_si256()));
+
+        while ( bits )
+        {
+            unsigned j = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if ( tm.exact(ts.T + pos + j) and ts.verify(pos + j) )
+                return true;
+        }
+    }
+    return scan_tail<M>(ts, pos);
+}
+
+#ifdef USE_TEDDY_AVX512
+template<unsigned M>
+__attribute__((target("avx512bw")))
+static bool scan_avx512(TeddyScan& ts)
+{
+    const TeddyMatcher& tm = *ts.tm;
+    const __m512i nib = _mm512_set1_epi8(0x0f);
+    __m512i lo[M], hi[M];
+
+    for ( unsigned i = 0; i < M; ++i )
+    {
+        lo[i] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)tm.lo[i]));
+        hi[i] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)tm.hi[i]));
+    }
+
+    unsigned pos = 0;
+
+    for ( ; pos + 64 + M - 1 <= ts.n; pos += 64 )
+    {
+        __m512i r = _mm512_set1_epi8(-1);
+
+        for ( unsigned i = 0; i < M; ++i )
+        {
+            __m512i v = _mm512_loadu_si512((const void*)(ts.T + pos + i));
+            __m512i l = _mm512_shuffle_epi8(lo[i], _mm512_and_si512(v, nib));
+            __m512i h = _mm512_shuffle_epi8(hi[i], _mm512_and_si512(_mm512_srli_epi16(v, 4), nib));
+            r = _mm512_and_si512(r, _mm512_and_si512(l, h));
+        }
+
+        uint64_t bits = _mm512_test_epi8_mask(r, r);
+
+        while ( bits )
+        {
+            unsigned j = __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            if ( tm.exact(ts.T + pos + j) and ts.verify(pos + j) )
+                return true;
+        }
+    }
+    return scan_tail<M>(ts, pos);
+}
+#endif
+#endif
+
+static TeddyScanFunc get_scan(TeddyIsa isa, unsigned m)
+{
+    static const TeddyScanFunc scalar[max_fp] =
+    { scan_scalar<1>, scan_scalar<2>, scan_scalar<3> };
+
+#ifdef USE_TEDDY_SIMD
+    static const TeddyScanFunc ssse3[max_fp] =
+    { scan_ssse3<1>, scan_ssse3<2>, scan_ssse3<3> };
+
+    static const TeddyScanFunc avx2[max_fp] =
+    { scan_avx2<1>, scan_avx2<2>, scan_avx2<3> };
+
+#ifdef USE_TEDDY_AVX512
+    static const TeddyScanFunc avx512[max_fp] =
+    { scan_avx512<1>, scan_avx512<2>, scan_avx512<3> };
+#endif
+
+    switch ( isa )
+    {
+#ifdef USE_TEDDY_AVX512
+    case TEDDY_AVX512: return avx512[m - 1];
+#endif
+    case TEDDY_AVX2: return avx2[m - 1];
+    case TEDDY_SSSE3: return ssse3[m - 1];
+    default: break;
+    }
+#else
+    UNUSED(isa);
+#endif
+    return scalar[m - 1];
+}
+
+static void set_bucket(TeddyMatcher& tm, unsigned i, uint8_t c, uint8_t bit)
+{
+    tm.lo[i][c & 0xf] |= bit;
+    tm.hi[i][c >> 4] |= bit;
+    tm.bt[i][c] |= bit;
+}
+
+// sids are the states with at least m bytes
+void TeddyMatcher::build(
+    const std::vector<TeddyState>& states, std::vector<unsigned>& ids, unsigned fp, TeddyIsa isa)
+{
+    m = fp;
+    scan = get_scan(isa, m);
+
+    memset(lo, 0, sizeof(lo));
+    memset(hi, 0, sizeof(hi));
+    memset(bt, 0, sizeof(bt));
+
+    // sorting by fingerprint puts similar patterns in the same bucket
+    // which keeps the nibble tables sparse
+    std::sort(ids.begin(), ids.end(),
+        [&states, fp](unsigned a, unsigned b)
+        {
+            return get_key((const uint8_t*)states[a].pat.data(), fp) <
+                get_key((const uint8_t*)states[b].pat.data(), fp);
+        });
+
+    for ( unsigned k = 0; k < ids.size(); ++k )
+    {
+        const TeddyState& s = states[ids[k]];
+        uint8_t bit = 1 << (k * num_buckets / ids.size());
+
+        for ( unsigned i = 0; i < m; ++i )
+        {
+            uint8_t c = s.pat[i];
+            set_bucket(*this, i, c, bit);
+
+            if ( s.no_case and isalpha(c) )
+                set_bucket(*this, i, (uint8_t)tolower(c), bit);
+        }
+    }
+
+    std::vector<unsigned> short_ids, long_ids;
+
+    for ( auto id : ids )
+    {
+        if ( m == max_fp and states[id].pat.size() >= long_key )
+            long_ids.emplace_back(id);
+        else
+            short_ids.emplace_back(id);
+    }
+
+    tables[0].build(states, short_ids, m);
+    tables[1].build(states, long_ids, long_key);
+}
+
+void TeddyTable::build(
+    const std::vector<TeddyState>& states, std::vector<unsigned>& ids, unsigned len)
+{
+    if ( ids.empty() )
+        return;
+
+    klen = len;
+
+    auto key = [&states, len](unsigned id)
+    { return get_key((const uint8_t*)states[id].pat.data(), len); };
+
+    // states with the same key are contiguous
+    std::sort(ids.begin(), ids.end(),
+        [&key](unsigned a, unsigned b) { return key(a) < key(b); });
+
+    unsigned nkeys = 0;
+
+    for ( unsigned k = 0; k < ids.size(); ++k )
+    {
+        if ( !k or key(ids[k]) != key(ids[k - 1]) )
+            ++nkeys;
+    }
+
+    unsigned size = 2;
+    unsigned bits = 1;
+
+    while ( size < 2 * nkeys )
+    {
+        size <<= 1;
+        ++bits;
+    }
+
+    shift = 64 - bits;
+    slots.assign(size, TeddySlot());
+    sids = ids;
+
+    for ( unsigned k = 0; k < sids.size(); )
+    {
+        uint64_t kv = key(sids[k]);
+        unsigned end = k + 1;
+
+        while ( end < sids.size() and key(sids[end]) == kv )
+            ++end;
+
+        unsigned i = hash_key(kv) >> shift;
+
+        while ( slots[i].end )
+            i = (i + 1) & (size - 1);
+
+        slots[i] = { kv, k, end };
+        k = end;
+    }
+}
+
+//-------------------------------------------------------------------------
+// mpse
+//-------------------------------------------------------------------------
+
+class TeddyMpse : public Mpse
+{
+public:
+    TeddyMpse(SnortConfig*, const MpseAgent* a) : Mpse("teddy")
+    {
+        agent = a;
+        ++instances;
+    }
+
+    ~TeddyMpse() override
+    {
+        if ( agent )
+            user_dtor();
+
+        for ( auto tm : matchers )
+            delete tm;
+    }
+
+    int add_pattern(
+        SnortConfig*, const uint8_t* pat, unsigned len,
+        const PatternDescriptor& desc, void* user) override
+    {
+        if ( !len )
+            return -1;
+
+        pvector.emplace_back(pat, len, desc, user);
+        ++patterns;
+        return 0;
+    }
+
+    int prep_patterns(SnortConfig*) override;
+    int compile_patterns() override;
+    int finish_patterns(SnortConfig*) override;
+
+    int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
+
+    int get_pattern_count() const override
+    { return pvector.size(); }
+
+    int print_info() override;
+
+private:
+    void add_states();
+    void user_ctor(SnortConfig*);
+    void user_dtor();
+
+    const MpseAgent* agent;
+
+    std::vector<TeddyPattern> pvector;
+    std::vector<TeddyState> states;
+    std::vector<TeddyMatcher*> matchers;
+
+public:
+    static uint64_t instances;
+    static uint64_t patterns;
+};
+
+uint64_t TeddyMpse::instances = 0;
+uint64_t TeddyMpse::patterns = 0;
+
+void TeddyMpse::add_states()
+{
+    std::vector<unsigned> order(pvector.size());
+
+    for ( unsigned i = 0; i < order.size(); ++i )
+        order[i] = i;
+
+    auto norm = [this](unsigned i)
+    {
+        std::string s = pvector[i].pat;
+
+        if ( pvector[i].no_case )
+            std::transform(s.begin(), s.end(), s.begin(), [](char c) { return (char)xlat[(uint8_t)c]; });
+
+        return s;
+    };
+
+    std::vector<std::string> pats(pvector.size());
+
+    for ( unsigned i = 0; i < pats.size(); ++i )
+        pats[i] = norm(i);
+
+    std::stable_sort(order.begin(), order.end(),
+        [this, &pats](unsigned a, unsigned b)
+        {
+            if ( pvector[a].no_case != pvector[b].no_case )
+                return pvector[a].no_case < pvector[b].no_case;
+            return pats[a] < pats[b];
+        });
+
+    for ( unsigned i = 0; i < order.size(); ++i )
+    {
+        unsigned p = order[i];
+
+        if ( states.empty() or states.back().no_case != pvector[p].no_case or
+            states.back().pat != pats[p] )
+        {
+            states.emplace_back();
+            states.back().pat = pats[p];
+            states.back().no_case = pvector[p].no_case;
+            states.back().user = pvector[p].user;
+        }
+        states.back().pids.emplace_back(p);
+    }
+}
+
+int TeddyMpse::prep_patterns(SnortConfig* sc)
+{
+    if ( int rval = compile_patterns() )
+        return rval;
+
+    return finish_patterns(sc);
+}
+
+int TeddyMpse::compile_patterns()
+{
+    if ( pvector.empty() )
+        return -1;
+
+    add_states();
+
+    std::vector<unsigned> ids[max_fp];
+
+    for ( unsigned i = 0; i < states.size(); ++i )
+        ids[std::min((unsigned)states[i].pat.size(), max_fp) - 1].emplace_back(i);
+
+    for ( unsigned m = 1; m <= max_fp; ++m )
+    {
+        if ( ids[m - 1].empty() )
+            continue;
+
+        TeddyMatcher* tm = new TeddyMatcher;
+        tm->build(states, ids[m - 1], m, teddy_isa);
+        matchers.emplace_back(tm);
+    }
+
+    return 0;
+}
+
+int TeddyMpse::finish_patterns(SnortConfig* sc)
+{
+    if ( agent )
+        user_ctor(sc);
+
+    return 0;
+}
+
+void TeddyMpse::user_ctor(SnortConfig* sc)
+{
+    for ( auto& s : states )
+    {
+        for ( auto p : s.pids )
+        {
+            TeddyPattern& tp = pvector[p];
+
+            if ( !tp.user )
+                continue;
+
+            if ( tp.negated )
+                agent->negate_list(tp.user, &s.list);
+            else
+                agent->build_tree(sc, tp.user, &s.tree);
+        }
+        agent->build_tree(sc, nullptr, &s.tree);
+    }
+}
+
+void TeddyMpse::user_dtor()
+{
+    for ( auto& p : pvector )
+    {
+        if ( p.user )
+            agent->user_free(p.user);
+    }
+
+    for ( auto& s : states )
+    {
+        if ( s.list )
+            agent->list_free(&s.list);
+
+        if ( s.tree )
+            agent->tree_free(&s.tree);
+    }
+}
+
+int TeddyMpse::_search(
+    const uint8_t* buf, int n, MpseMatch mf, void* pv, int* current_state)
+{
+    *current_state = 0;
+
+    if ( n <= 0 )
+        return 0;
+
+    TeddyScan ts { nullptr, states.data(), buf, (unsigned)n, mf, pv, 0 };
+
+    for ( auto tm : matchers )
+    {
+        ts.tm = tm;
+
+        if ( tm->scan(ts) )
+            break;
+    }
+    return ts.nfound;
+}
+
+int TeddyMpse::print_info()
+{
+    LogMessage("teddy: %zu patterns, %zu states, %zu matchers (%s)\n",
+        pvector.size(), states.size(), matchers.size(), isa_names[teddy_isa]);
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+static Mpse* teddy_ctor(
+    SnortConfig* sc, class Module*, const MpseAgent* a)
+{
+    return new TeddyMpse(sc, a);
+}
+
+static void teddy_dtor(Mpse* p)
+{
+    delete p;
+}
+
+static void teddy_init()
+{
+    init_xlat();
+    teddy_isa = get_cpu_isa();
+
+    TeddyMpse::instances = 0;
+    TeddyMpse::patterns = 0;
+}
+
+static void teddy_print()
+{
+    LogValue("kernel", isa_names[teddy_isa]);
+    LogCount("instances", TeddyMpse::instances);
+    LogCount("patterns", TeddyMpse::patterns);
+}
+
+static const MpseApi teddy_api =
+{
+    {
+        PT_SEARCH_ENGINE,
+        sizeof(MpseApi),
+        SEAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        "teddy",
+        "SIMD nibble filter with hashed verification (fast, low memory) MPSE",
+        nullptr,
+        nullptr
+    },
+    MPSE_MTBLD,
+    nullptr,  // activate
+    nullptr,  // setup
+    nullptr,  // start
+    nullptr,  // stop
+    teddy_ctor,
+    teddy_dtor,
+    teddy_init,
+    teddy_print,
+    nullptr,
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+#else
+const BaseApi* se_teddy[] =
+#endif
+{
+    &teddy_api.base,
+    nullptr
+};
@@ -0,0 +1,503 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// mpse_db_test.cc
+// round trip tests of compiled search engine state; a restored engine must
+// find exactly what the engine it was saved from finds
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "framework/base_api.h"
+#include "framework/mpse.h"
+#include "framework/mpse_batch.h"
+#include "main/snort_config.h"
+#include "utils/util.h"
+
+// must appear after snort_config.h to avoid broken c++ map include
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+//-------------------------------------------------------------------------
+// base stuff
+//-------------------------------------------------------------------------
+namespace snort
+{
+Mpse::Mpse(const char*) { }
+
+int Mpse::search(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+int Mpse::search_all(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+void Mpse::search(MpseBatch& batch, MpseType mpse_type)
+{
+    _search(batch, mpse_type);
+}
+
+void Mpse::_search(MpseBatch&, MpseType)
+{ }
+
+SnortConfig s_conf;
+THREAD_LOCAL SnortConfig* snort_conf = &s_conf;
+
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ }
+
+SnortConfig::~SnortConfig() = default;
+
+SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+unsigned get_instance_id()
+{ return 0; }
+
+SO_PUBLIC void LogMessage(const char*, ...) { }
+[[noreturn]] void FatalError(const char*,...) { exit(1); }
+void LogValue(const char*, const char*, FILE*) { }
+void LogCount(char const*, uint64_t, FILE*) { }
+void LogStat(const char*, double, FILE*) { }
+}
+
+//-------------------------------------------------------------------------
+// stubs, spies, etc.
+//-------------------------------------------------------------------------
+
+extern const BaseApi* se_ac_bnfa;
+extern const BaseApi* se_ac_full;
+extern const BaseApi* se_ac_sparse;
+extern const BaseApi* se_ac_banded;
+extern const BaseApi* se_ac_sparse_bands;
+
+// the tree is the user of the first pattern of a state
+static MpseAgent s_agent =
+{
+    [](struct SnortConfig*, void* pu, void** ppt)
+    {
+        if ( pu and !*ppt )
+            *ppt = pu;
+        return 0;
+    },
+    [](void* pu, void** ppl)
+    {
+        *ppl = pu;
+        return 0;
+    },
+
+    [](void*) { },
+    [](void**) { },
+    [](void**) { }
+};
+
+typedef std::pair<uintptr_t, int> Hit;
+static std::vector<Hit> hits;
+
+static int match(
+    void* /*user*/, void* tree, int index, void* /*context*/, void* /*list*/)
+{
+    hits.emplace_back((uintptr_t)tree, index);
+    return 0;
+}
+
+struct Pattern
+{
+    std::string s;
+    bool nocase;
+    bool negated;
+};
+
+static std::vector<Pattern> make_patterns(unsigned seed, unsigned num)
+{
+    std::mt19937 rng(seed);
+    const char* alpha = "abcdeABCDE\x01\xff";
+    std::vector<Pattern> pats;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        Pattern p;
+        unsigned len = 1 + rng() % 8;
+
+        for ( unsigned j = 0; j < len; ++j )
+            p.s += alpha[rng() % 12];
+
+        p.nocase = rng() % 2;
+        p.negated = !(rng() % 8);
+        pats.emplace_back(p);
+    }
+    return pats;
+}
+
+static std::string make_text(unsigned seed, unsigned len)
+{
+    std::mt19937 rng(seed);
+    const char* alpha = "abcdeABCDE\x01\xff";
+    std::string s;
+
+    for ( unsigned i = 0; i < len; ++i )
+        s += alpha[rng() % 12];
+
+    return s;
+}
+
+static Mpse* make_mpse(const BaseApi* base, int opt, const std::vector<Pattern>& pats)
+{
+    const MpseApi* api = (const MpseApi*)base;
+    api->init();
+
+    Mpse* mpse = api->ctor(snort_conf, nullptr, &s_agent);
+    CHECK(mpse);
+
+    mpse->set_api(api);
+
+    if ( opt >= 0 )
+        mpse->set_opt(opt);
+
+    uintptr_t id = 0;
+
+    for ( auto& p : pats )
+    {
+        Mpse::PatternDescriptor desc(p.nocase, p.negated);
+        CHECK(mpse->add_pattern(nullptr, (const uint8_t*)p.s.c_str(), p.s.size(),
+            desc, (void*)++id) == 0);
+    }
+    return mpse;
+}
+
+static std::vector<Hit> search(Mpse* mpse, const std::string& text)
+{
+    hits.clear();
+    int state = 0;
+    mpse->search((const uint8_t*)text.c_str(), text.size(), match, nullptr, &state);
+    return hits;
+}
+
+static void delete_mpse(Mpse* mpse)
+{ mpse->get_api()->dtor(mpse); }
+
+// build, save, restore into a new instance, and compare results
+static void round_trip(const BaseApi* base, int opt, unsigned seed)
+{
+    auto pats = make_patterns(seed, 200);
+    auto text = make_text(seed + 1, 20000);
+
+    Mpse* a = make_mpse(base, opt, pats);
+    CHECK(a->prep_patterns(snort_conf) == 0);
+
+    std::string ha;
+    CHECK(a->get_hash(ha));
+    CHECK(ha.size() == 64);
+
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    CHECK(a->serialize(buf, len));
+    CHECK(buf and len);
+
+    Mpse* b = make_mpse(base, opt, pats);
+
+    std::string hb;
+    CHECK(b->get_hash(hb));
+    CHECK(ha == hb);
+
+    CHECK(b->deserialize(snort_conf, buf, len));
+
+    auto expected = search(a, text);
+    auto actual = search(b, text);
+
+    CHECK(!expected.empty());
+    CHECK(expected == actual);
+
+    delete_mpse(a);
+    delete_mpse(b);
+    snort_free(buf);
+}
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(mpse_db)
+{ };
+
+TEST(mpse_db, bnfa)
+{
+    round_trip(se_ac_bnfa, 0, 1);
+    round_trip(se_ac_bnfa, 1, 2);
+}
+
+TEST(mpse_db, full_nfa)
+{ round_trip(se_ac_full, -1, 3); }
+
+TEST(mpse_db, full_dfa)
+{
+    round_trip(se_ac_full, 0, 4);
+    round_trip(se_ac_full, 1, 5);
+}
+
+TEST(mpse_db, sparse)
+{ round_trip(se_ac_sparse, 0, 6); }
+
+TEST(mpse_db, banded)
+{ round_trip(se_ac_banded, 0, 7); }
+
+TEST(mpse_db, sparse_bands)
+{ round_trip(se_ac_sparse_bands, 0, 8); }
+
+// a compiled engine switched to its own saved state finds the same
+static void rebase(const BaseApi* base, int opt, unsigned seed)
+{
+    auto pats = make_patterns(seed, 200);
+    auto text = make_text(seed + 1, 20000);
+
+    Mpse* a = make_mpse(base, opt, pats);
+    CHECK(a->prep_patterns(snort_conf) == 0);
+    auto expected = search(a, text);
+
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    CHECK(a->serialize(buf, len));
+
+    // different patterns compile to different state
+    pats.pop_back();
+    Mpse* b = make_mpse(base, opt, pats);
+    CHECK(b->prep_patterns(snort_conf) == 0);
+    CHECK(!b->deserialize(snort_conf, buf, len));
+
+    CHECK(a->deserialize(snort_conf, buf, len));
+    CHECK(expected == search(a, text));
+
+    delete_mpse(a);
+    delete_mpse(b);
+    snort_free(buf);
+}
+
+TEST(mpse_db, rebase)
+{
+    rebase(se_ac_bnfa, 1, 12);
+    rebase(se_ac_full, -1, 13);
+    rebase(se_ac_full, 1, 14);
+    rebase(se_ac_sparse, 0, 15);
+    rebase(se_ac_banded, 0, 16);
+    rebase(se_ac_sparse_bands, 0, 17);
+}
+
+// instances compiled concurrently and finished in order get the same
+// state and trees as when prepped one at a time
+TEST(mpse_db, parallel)
+{
+    const unsigned num = 4;
+    const MpseApi* api = (const MpseApi*)se_ac_bnfa;
+    CHECK((api->flags & MPSE_MTBLD) != 0);
+
+    std::vector<std::vector<Pattern>> pats;
+    std::vector<Mpse*> serial, parallel;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        pats.emplace_back(make_patterns(20 + i, 200));
+        serial.emplace_back(make_mpse(se_ac_bnfa, 1, pats.back()));
+        parallel.emplace_back(make_mpse(se_ac_bnfa, 1, pats.back()));
+        CHECK(serial.back()->prep_patterns(snort_conf) == 0);
+    }
+
+    std::vector<int> rvals(num, -1);
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < num; ++i )
+        threads.emplace_back([&, i]() { rvals[i] = parallel[i]->compile_patterns(); });
+
+    for ( auto& t : threads )
+        t.join();
+
+    auto text = make_text(30, 20000);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        CHECK(rvals[i] == 0);
+        CHECK(parallel[i]->finish_patterns(snort_conf) == 0);
+
+        uint8_t* sbuf = nullptr, * pbuf = nullptr;
+        size_t slen = 0, plen = 0;
+
+        CHECK(serial[i]->serialize(sbuf, slen));
+        CHECK(parallel[i]->serialize(pbuf, plen));
+        CHECK(slen == plen);
+        CHECK(!memcmp(sbuf, pbuf, slen));
+
+        CHECK(search(serial[i], text) == search(parallel[i], text));
+
+        snort_free(sbuf);
+        snort_free(pbuf);
+        delete_mpse(serial[i]);
+        delete_mpse(parallel[i]);
+    }
+}
+
+TEST(mpse_db, hash)
+{
+    auto pats = make_patterns(9, 50);
+
+    Mpse* a = make_mpse(se_ac_bnfa, 1, pats);
+    Mpse* b = make_mpse(se_ac_bnfa, 0, pats);
+
+    pats[10].nocase = !pats[10].nocase;
+    Mpse* c = make_mpse(se_ac_bnfa, 1, pats);
+
+    std::swap(pats[10], pats[11]);
+    Mpse* d = make_mpse(se_ac_bnfa, 1, pats);
+
+    std::string ha, hb, hc, hd;
+    CHECK(a->get_hash(ha));
+    CHECK(b->get_hash(hb));
+    CHECK(c->get_hash(hc));
+    CHECK(d->get_hash(hd));
+
+    CHECK(ha != hb);
+    CHECK(ha != hc);
+    CHECK(hc != hd);
+
+    delete_mpse(a);
+    delete_mpse(b);
+    delete_mpse(c);
+    delete_mpse(d);
+}
+
+TEST(mpse_db, reject)
+{
+    auto pats = make_patterns(10, 50);
+
+    Mpse* a = make_mpse(se_ac_bnfa, 1, pats);
+    CHECK(a->prep_patterns(snort_conf) == 0);
+
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    CHECK(a->serialize(buf, len));
+
+    // truncated
+    Mpse* b = make_mpse(se_ac_bnfa, 1, pats);
+    CHECK(!b->deserialize(snort_conf, buf, len - 4));
+
+    // different engine
+    Mpse* c = make_mpse(se_ac_full, 1, pats);
+    CHECK(!c->deserialize(snort_conf, buf, len));
+
+    // fewer patterns
+    pats.pop_back();
+    Mpse* d = make_mpse(se_ac_bnfa, 1, pats);
+    CHECK(!d->deserialize(snort_conf, buf, len));
+
+    // a rejected db leaves the engine usable
+    CHECK(b->prep_patterns(snort_conf) == 0);
+    CHECK(c->prep_patterns(snort_conf) == 0);
+
+    auto text = make_text(11, 5000);
+    auto expected = search(a, text);
+    CHECK(expected == search(b, text));
+
+    delete_mpse(a);
+    delete_mpse(b);
+    delete_mpse(c);
+    delete_mpse(d);
+    snort_free(buf);
+}
+
+// a db of the right size with bad rows, counts, or states must be rejected
+// or be safe to search; the alphabet of the text covers every byte so that
+// corrupt transitions are taken
+static void corrupt(const BaseApi* base, int opt, unsigned seed)
+{
+    auto pats = make_patterns(seed, 50);
+    auto text = make_text(seed + 1, 1000);
+
+    for ( unsigned i = 0; i < 256; ++i )
+        text.insert(text.begin() + 4 * i, (char)i);
+
+    Mpse* a = make_mpse(base, opt, pats);
+    CHECK(a->prep_patterns(snort_conf) == 0);
+
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    CHECK(a->serialize(buf, len));
+
+    std::vector<uint8_t> bad(buf, buf + len);
+    uint32_t* words = (uint32_t*)bad.data();
+    size_t num = len / sizeof(uint32_t);
+
+    const uint32_t values[] = { 1, 255, 0x1000, 0x00ffffff, 0x40000001, 0xffffffff };
+    std::mt19937 rng(seed);
+    unsigned rejected = 0;
+
+    for ( unsigned i = 0; i < 1000; ++i )
+    {
+        // skip the header so the body is checked
+        size_t at = 8 + rng() % (num - 8);
+        uint32_t was = words[at];
+        words[at] = values[rng() % (sizeof(values) / sizeof(values[0]))];
+
+        Mpse* b = make_mpse(base, opt, pats);
+
+        if ( b->deserialize(snort_conf, bad.data(), len) )
+            search(b, text);
+        else
+            ++rejected;
+
+        delete_mpse(b);
+        words[at] = was;
+    }
+    CHECK(rejected > 0);
+
+    delete_mpse(a);
+    snort_free(buf);
+}
+
+TEST(mpse_db, corrupt)
+{
+    corrupt(se_ac_bnfa, 0, 40);
+    corrupt(se_ac_bnfa, 1, 41);
+    corrupt(se_ac_full, -1, 42);
+    corrupt(se_ac_full, 0, 43);
+    corrupt(se_ac_full, 1, 44);
+    corrupt(se_ac_sparse, 0, 45);
+    corrupt(se_ac_banded, 0, 46);
+    corrupt(se_ac_sparse_bands, 0, 47);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
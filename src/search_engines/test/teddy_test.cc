@@ -0,0 +1,569 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// teddy_test.cc
+// unit tests for the teddy mpse, differential tests of each kernel against
+// a naive search, and a throughput benchmark against ac_bnfa
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#include <cstdio>
+#endif
+
+#include "framework/base_api.h"
+#include "framework/mpse.h"
+#include "framework/mpse_batch.h"
+#include "main/snort_config.h"
+
+// must appear after snort_config.h to avoid broken c++ map include
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+//-------------------------------------------------------------------------
+// base stuff
+//-------------------------------------------------------------------------
+namespace snort
+{
+Mpse::Mpse(const char*) { }
+
+int Mpse::search(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+int Mpse::search_all(
+    const unsigned char* T, int n, MpseMatch match,
+    void* context, int* current_state)
+{
+    return _search(T, n, match, context, current_state);
+}
+
+void Mpse::search(MpseBatch& batch, MpseType mpse_type)
+{
+    _search(batch, mpse_type);
+}
+
+void Mpse::_search(MpseBatch&, MpseType)
+{ }
+
+SnortConfig s_conf;
+THREAD_LOCAL SnortConfig* snort_conf = &s_conf;
+
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ }
+
+SnortConfig::~SnortConfig() = default;
+
+SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+unsigned get_instance_id()
+{ return 0; }
+
+SO_PUBLIC void LogMessage(const char*, ...) { }
+void LogValue(const char*, const char*, FILE*) { }
+void LogCount(char const*, uint64_t, FILE*) { }
+void LogStat(const char*, double, FILE*) { }
+}
+
+//-------------------------------------------------------------------------
+// stubs, spies, etc.
+//-------------------------------------------------------------------------
+
+enum TeddyIsa
+{
+    TEDDY_SCALAR, TEDDY_SSSE3, TEDDY_AVX2, TEDDY_AVX512, TEDDY_MAX
+};
+
+extern TeddyIsa teddy_isa;
+extern const BaseApi* se_teddy;
+
+#ifdef BENCHMARK_TEST
+extern const BaseApi* se_ac_bnfa;
+#endif
+
+// the tree is the user of the first pattern of a state
+static MpseAgent s_agent =
+{
+    [](struct SnortConfig*, void* pu, void** ppt)
+    {
+        if ( pu and !*ppt )
+            *ppt = pu;
+        return 0;
+    },
+    [](void* pu, void** ppl)
+    {
+        *ppl = pu;
+        return 0;
+    },
+
+    [](void*) { },
+    [](void**) { },
+    [](void**) { }
+};
+
+typedef std::pair<uintptr_t, int> Hit;
+static std::vector<Hit> hits;
+static unsigned stop_after = 0;
+
+static int match(
+    void* /*user*/, void* tree, int index, void* /*context*/, void* /*list*/)
+{
+    hits.emplace_back((uintptr_t)tree, index);
+    return stop_after and hits.size() >= stop_after;
+}
+
+static void* id(uintptr_t i)
+{ return (void*)i; }
+
+//-------------------------------------------------------------------------
+// base tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(mpse_teddy_base)
+{
+    void setup() override
+    {
+        CHECK(se_teddy);
+    }
+};
+
+TEST(mpse_teddy_base, base)
+{
+    CHECK(se_teddy->type == PT_SEARCH_ENGINE);
+    CHECK(se_teddy->name);
+    CHECK(se_teddy->help);
+
+    CHECK(!strcmp(se_teddy->name, "teddy"));
+}
+
+TEST(mpse_teddy_base, mpse)
+{
+    const MpseApi* mpse_api = (MpseApi*)se_teddy;
+    CHECK(mpse_api->flags == MPSE_MTBLD);
+
+    CHECK(mpse_api->ctor);
+    CHECK(mpse_api->dtor);
+
+    CHECK(mpse_api->init);
+    CHECK(mpse_api->print);
+
+    mpse_api->init();
+    Mpse* p = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+    mpse_api->print();
+
+    CHECK(p);
+    mpse_api->dtor(p);
+}
+
+//-------------------------------------------------------------------------
+// match tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(mpse_teddy_match)
+{
+    Mpse* mpse = nullptr;
+    const MpseApi* mpse_api = (MpseApi*)se_teddy;
+
+    void setup() override
+    {
+        mpse_api->init();
+        mpse = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+        CHECK(mpse);
+        hits.clear();
+        stop_after = 0;
+    }
+    void teardown() override
+    {
+        mpse_api->dtor(mpse);
+    }
+
+    int search(const char* s)
+    {
+        int state = 0;
+        return mpse->search((const uint8_t*)s, strlen(s), match, nullptr, &state);
+    }
+};
+
+TEST(mpse_teddy_match, empty)
+{
+    CHECK(mpse->prep_patterns(snort_conf) != 0);
+    CHECK(mpse->get_pattern_count() == 0);
+    CHECK(search("foo") == 0);
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"", 0, Mpse::PatternDescriptor(), id(1)) != 0);
+}
+
+TEST(mpse_teddy_match, single)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"foo", 3, desc, id(1)) == 0);
+    CHECK(mpse->prep_patterns(snort_conf) == 0);
+    CHECK(mpse->get_pattern_count() == 1);
+
+    CHECK(search("foo") == 1);
+    CHECK(search("xfoo foo fo") == 2);
+    CHECK(search("fOo") == 0);
+
+    CHECK(hits.size() == 3);
+    CHECK(hits[0] == Hit(1, 3));
+    CHECK(hits[1] == Hit(1, 4));
+    CHECK(hits[2] == Hit(1, 8));
+}
+
+TEST(mpse_teddy_match, nocase)
+{
+    Mpse::PatternDescriptor desc(true);
+
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"foo", 3, desc, id(1)) == 0);
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"x", 1, desc, id(2)) == 0);
+    CHECK(mpse->prep_patterns(snort_conf) == 0);
+
+    CHECK(search("FoO") == 1);
+    CHECK(search("fOoX") == 2);
+    CHECK(search("f0o") == 0);
+}
+
+TEST(mpse_teddy_match, duplicates)
+{
+    Mpse::PatternDescriptor desc;
+    Mpse::PatternDescriptor neg(false, true);
+    Mpse::PatternDescriptor nocase(true);
+
+    // same state and tree for the first two, negated goes to the list
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"bar", 3, desc, id(1)) == 0);
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"bar", 3, desc, id(2)) == 0);
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"bar", 3, neg, id(3)) == 0);
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"BAR", 3, nocase, id(4)) == 0);
+    CHECK(mpse->prep_patterns(snort_conf) == 0);
+    CHECK(mpse->get_pattern_count() == 4);
+
+    CHECK(search("bar") == 2);
+    std::sort(hits.begin(), hits.end());
+    CHECK(hits[0] == Hit(1, 3));
+    CHECK(hits[1] == Hit(4, 3));
+}
+
+TEST(mpse_teddy_match, lengths)
+{
+    Mpse::PatternDescriptor desc;
+    const char* pats[] = { "a", "ab", "abc", "abcd", "abcdefghijklmnopqrstuvwxyz0123456789" };
+
+    for ( unsigned i = 0; i < 5; ++i )
+        CHECK(mpse->add_pattern(nullptr, (const uint8_t*)pats[i], strlen(pats[i]), desc, id(i + 1)) == 0);
+
+    CHECK(mpse->prep_patterns(snort_conf) == 0);
+
+    CHECK(search("abcdefghijklmnopqrstuvwxyz0123456789") == 5);
+    CHECK(search("abcdefghijklmnopqrstuvwxyz012345678") == 4);
+    CHECK(search("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxab") == 2);
+}
+
+TEST(mpse_teddy_match, stop)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(mpse->add_pattern(nullptr, (const uint8_t*)"ab", 2, desc, id(1)) == 0);
+    CHECK(mpse->prep_patterns(snort_conf) == 0);
+
+    std::string s;
+    for ( unsigned i = 0; i < 100; ++i )
+        s += "ab";
+
+    stop_after = 10;
+    CHECK(search(s.c_str()) == 10);
+}
+
+//-------------------------------------------------------------------------
+// differential tests - each kernel must find exactly what a naive search
+// finds, including matches across block boundaries and in the tail
+//-------------------------------------------------------------------------
+
+struct RefPattern
+{
+    std::string pat;
+    bool no_case;
+};
+
+static std::vector<Hit> naive(const std::vector<RefPattern>& pats, const std::string& text)
+{
+    std::vector<Hit> v;
+
+    for ( unsigned i = 0; i < pats.size(); ++i )
+    {
+        const std::string& p = pats[i].pat;
+
+        for ( unsigned pos = 0; pos + p.size() <= text.size(); ++pos )
+        {
+            bool hit = true;
+
+            for ( unsigned j = 0; j < p.size() and hit; ++j )
+            {
+                if ( pats[i].no_case )
+                    hit = toupper(text[pos + j]) == toupper(p[j]);
+                else
+                    hit = text[pos + j] == p[j];
+            }
+            if ( hit )
+                v.emplace_back(i + 1, pos + p.size());
+        }
+    }
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+static uint32_t seed = 1;
+
+static unsigned rnd(unsigned n)
+{
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) % n;
+}
+
+static std::string rnd_str(unsigned len, const char* alpha)
+{
+    std::string s;
+    unsigned n = strlen(alpha);
+
+    while ( s.size() < len )
+        s += alpha[rnd(n)];
+
+    return s;
+}
+
+static void differential(unsigned npats, unsigned min_len, unsigned max_len, const char* alpha)
+{
+    const MpseApi* mpse_api = (MpseApi*)se_teddy;
+    mpse_api->init();
+    const TeddyIsa best = teddy_isa;
+
+    for ( unsigned round = 0; round < 20; ++round )
+    {
+        std::vector<RefPattern> pats;
+
+        while ( pats.size() < npats )
+        {
+            RefPattern rp { rnd_str(min_len + rnd(max_len - min_len + 1), alpha), rnd(2) != 0 };
+            bool dup = false;
+
+            // no case patterns that fold to the same string share a state
+            for ( auto& p : pats )
+                dup = dup or (p.no_case == rp.no_case and (p.no_case ?
+                    !strcasecmp(p.pat.c_str(), rp.pat.c_str()) : p.pat == rp.pat));
+
+            if ( !dup )
+                pats.emplace_back(rp);
+        }
+
+        std::string text = rnd_str(rnd(300), alpha);
+        std::vector<Hit> expect = naive(pats, text);
+
+        for ( int isa = TEDDY_SCALAR; isa <= best; ++isa )
+        {
+            teddy_isa = (TeddyIsa)isa;
+            Mpse* mpse = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+
+            for ( unsigned i = 0; i < pats.size(); ++i )
+            {
+                Mpse::PatternDescriptor desc(pats[i].no_case);
+                mpse->add_pattern(nullptr, (const uint8_t*)pats[i].pat.data(),
+                    pats[i].pat.size(), desc, id(i + 1));
+            }
+            CHECK(mpse->prep_patterns(snort_conf) == 0);
+
+            hits.clear();
+            int state = 0;
+            int n = mpse->search((const uint8_t*)text.data(), text.size(), match, nullptr, &state);
+
+            std::sort(hits.begin(), hits.end());
+            CHECK(n == (int)expect.size());
+            CHECK(hits == expect);
+
+            mpse_api->dtor(mpse);
+        }
+        teddy_isa = best;
+    }
+}
+
+TEST_GROUP(mpse_teddy_differential)
+{
+    void setup() override
+    {
+        hits.clear();
+        stop_after = 0;
+    }
+};
+
+TEST(mpse_teddy_differential, few)
+{
+    differential(5, 1, 6, "abcAB");
+}
+
+TEST(mpse_teddy_differential, short_patterns)
+{
+    differential(20, 1, 3, "abcdefABCDEF\x01\xff");
+}
+
+TEST(mpse_teddy_differential, many)
+{
+    differential(300, 3, 12, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789/.-");
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// MB/s of teddy (each kernel) and ac_bnfa over the same synthetic traffic
+// for fast pattern sets of a few sizes; patterns are made of tokens that
+// are common in rules so the filters see realistic near misses
+//--------------------------------------------------------------------------
+
+static const char* tokens[] =
+{
+    "GET ", "POST ", "HTTP/1.", "User-Agent: ", "Content-Type: ", "Host: ",
+    "/cgi-bin/", ".php?", "cmd=", "select ", "union ", "<script", "eval(",
+    "\\x90\\x90", "%u9090", "../..", "admin", "passwd", "/etc/", "login",
+    "Cookie: ", "application/", "text/html", "charset=", "document.", "window.",
+    "unescape(", "fromCharCode", "ActiveXObject", "cmd.exe", "powershell", "base64",
+};
+
+static std::string traffic(unsigned len)
+{
+    std::string s;
+
+    while ( s.size() < len )
+    {
+        if ( rnd(4) )
+            s += rnd_str(1 + rnd(40), "abcdefghijklmnopqrstuvwxyz0123456789 =&/\r\n");
+        else
+            s += tokens[rnd(sizeof(tokens) / sizeof(tokens[0]))];
+    }
+    s.resize(len);
+    return s;
+}
+
+static std::vector<std::string> rule_patterns(unsigned n)
+{
+    std::vector<std::string> v;
+    const unsigned ntok = sizeof(tokens) / sizeof(tokens[0]);
+
+    while ( v.size() < n )
+        v.emplace_back(std::string(tokens[rnd(ntok)]) + rnd_str(2 + rnd(10), "abcdefghijklmnopqrstuvwxyz_=."));
+
+    return v;
+}
+
+static int count_match(void*, void*, int, void* ctx, void*)
+{
+    ++*(unsigned*)ctx;
+    return 0;
+}
+
+static double mbps(const MpseApi* api, const std::vector<std::string>& pats,
+    const std::vector<std::string>& bufs, unsigned reps, unsigned& nhits)
+{
+    Mpse* mpse = api->ctor(snort_conf, nullptr, &s_agent);
+
+    for ( unsigned i = 0; i < pats.size(); ++i )
+    {
+        Mpse::PatternDescriptor desc(i % 2 == 0);
+        mpse->add_pattern(snort_conf, (const uint8_t*)pats[i].data(), pats[i].size(), desc, id(i + 1));
+    }
+    mpse->prep_patterns(snort_conf);
+
+    size_t bytes = 0;
+    nhits = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned r = 0; r < reps; ++r )
+    {
+        for ( auto& b : bufs )
+        {
+            int state = 0;
+            mpse->search((const uint8_t*)b.data(), b.size(), count_match, &nhits, &state);
+            bytes += b.size();
+        }
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    api->dtor(mpse);
+
+    return bytes / secs.count() / 1e6;
+}
+
+TEST_GROUP(mpse_teddy_benchmark)
+{
+};
+
+TEST(mpse_teddy_benchmark, throughput)
+{
+    const MpseApi* teddy = (MpseApi*)se_teddy;
+    const MpseApi* bnfa = (MpseApi*)se_ac_bnfa;
+
+    std::vector<std::string> bufs;
+
+    for ( unsigned i = 0; i < 256; ++i )
+        bufs.emplace_back(traffic(1460));
+
+    bnfa->init();
+    teddy->init();
+    const TeddyIsa best = teddy_isa;
+    const char* names[] = { "scalar", "ssse3", "avx2", "avx512" };
+
+    printf("\n%8s %10s", "patterns", "ac_bnfa");
+    for ( int isa = TEDDY_SCALAR; isa <= best; ++isa )
+        printf(" %10s", names[isa]);
+    printf("   (MB/s)\n");
+
+    for ( unsigned n : { 10, 100, 1000, 5000 } )
+    {
+        std::vector<std::string> pats = rule_patterns(n);
+        unsigned bnfa_hits, teddy_hits;
+
+        printf("%8u %10.0f", n, mbps(bnfa, pats, bufs, 20, bnfa_hits));
+
+        for ( int isa = TEDDY_SCALAR; isa <= best; ++isa )
+        {
+            teddy_isa = (TeddyIsa)isa;
+            printf(" %10.0f", mbps(teddy, pats, bufs, 20, teddy_hits));
+        }
+        printf("\n");
+        teddy_isa = best;
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
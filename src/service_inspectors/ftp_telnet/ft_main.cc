@@ -190,7 +190,7 @@ int FTPCheckConfigs(snort::SnortConfig* sc, void* pData)
 
 void do_detection(snort::Packet* p)
 {
-    snort::DataBus::publish(PACKET_EVENT, p);
+    snort::DataBus::publish(PACKET_EVENT_ID, p);
     snort::DetectionEngine::disable_all(p);
 }
 
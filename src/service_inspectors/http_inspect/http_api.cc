@@ -25,6 +25,7 @@
 
 #include "http_context_data.h"
 #include "http_inspect.h"
+#include "http_scan.h"
 
 using namespace snort;
 
@@ -41,6 +42,7 @@ void HttpApi::http_init()
 {
     HttpFlowData::init();
     HttpContextData::init();
+    HttpScan::init();
 }
 
 const char* HttpApi::classic_buffer_names[] =
@@ -23,6 +23,8 @@
 
 #include "http_cutter.h"
 
+#include "http_scan.h"
+
 using namespace HttpEnums;
 
 ScanResult HttpStartCutter::cut(const uint8_t* buffer, uint32_t length,
@@ -166,6 +168,10 @@ ScanResult HttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
         switch (state)
         {
         case ZERO:
+            // Most of a header block is field content with no line endings. Skip to the next one.
+            k += HttpScan::find_cr_lf(buffer + k, length - k);
+            if (k >= length)
+                break;
             if (buffer[k] == '\r')
             {
                 state = HALF;
@@ -23,11 +23,13 @@
 
 #include "http_flow_data.h"
 
+#include "decompress/decomp_pool.h"
 #include "decompress/file_decomp.h"
 
 #include "http_cutter.h"
 #include "http_common.h"
 #include "http_enum.h"
+#include "http_js_norm.h"
 #include "http_module.h"
 #include "http_test_manager.h"
 #include "http_transaction.h"
@@ -80,11 +82,7 @@ HttpFlowData::~HttpFlowData()
         delete[] partial_buffer[k];
         HttpTransaction::delete_transaction(transaction[k], nullptr);
         delete cutter[k];
-        if (compress_stream[k] != nullptr)
-        {
-            inflateEnd(compress_stream[k]);
-            delete compress_stream[k];
-        }
+        DecompPool::release_inflate(compress_stream[k]);
         if (mime_state[k] != nullptr)
         {
             delete mime_state[k];
@@ -92,6 +90,7 @@ HttpFlowData::~HttpFlowData()
     }
 
     delete utf_state;
+    delete js_norm_state;
     if (fd_state != nullptr)
         File_Decomp_StopFree(fd_state);
     delete_pipeline();
@@ -121,8 +120,7 @@ void HttpFlowData::half_reset(SourceId source_id)
     compression[source_id] = CMP_NONE;
     if (compress_stream[source_id] != nullptr)
     {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
+        DecompPool::release_inflate(compress_stream[source_id]);
         compress_stream[source_id] = nullptr;
     }
     if (mime_state[source_id] != nullptr)
@@ -152,6 +150,8 @@ void HttpFlowData::half_reset(SourceId source_id)
         status_code_num = STAT_NOT_PRESENT;
         delete utf_state;
         utf_state = nullptr;
+        delete js_norm_state;
+        js_norm_state = nullptr;
         if (fd_state != nullptr)
         {
             File_Decomp_StopFree(fd_state);
@@ -166,8 +166,7 @@ void HttpFlowData::trailer_prep(SourceId source_id)
     compression[source_id] = CMP_NONE;
     if (compress_stream[source_id] != nullptr)
     {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
+        DecompPool::release_inflate(compress_stream[source_id]);
         compress_stream[source_id] = nullptr;
     }
     detection_status[source_id] = DET_REACTIVATING;
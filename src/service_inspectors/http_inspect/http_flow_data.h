@@ -35,6 +35,7 @@
 
 class HttpTransaction;
 class HttpJsNorm;
+struct HttpJsNormState;
 class HttpMsgSection;
 class HttpCutter;
 
@@ -131,6 +132,7 @@ private:
     FdCallbackContext fd_alert_context; // SRC_SERVER only
     snort::MimeSession* mime_state[2] = { nullptr, nullptr };
     snort::UtfDecodeSession* utf_state = nullptr; // SRC_SERVER only
+    HttpJsNormState* js_norm_state = nullptr; // SRC_SERVER only
     fd_session_t* fd_state = nullptr; // SRC_SERVER only
     int64_t file_depth_remaining[2] = { HttpCommon::STAT_NOT_PRESENT,
         HttpCommon::STAT_NOT_PRESENT };
@@ -24,6 +24,7 @@
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_header_normalizer.h"
+#include "http_scan.h"
 
 #include <cstring>
 
@@ -38,9 +39,12 @@ static int32_t derive_header_content(const uint8_t* value, int32_t length, uint8
     int32_t out_length = 0;
     bool beginning = true;
     bool last_white = true;
-    for (int32_t k=0; k < length; k++)
+    int32_t k = 0;
+    while (k < length)
     {
-        if (!is_sp_tab_cr_lf[value[k]])
+        // Copy each run of non-white space in one piece
+        const int32_t run = HttpScan::find_sp_tab_cr_lf(value + k, length - k);
+        if (run > 0)
         {
             if (alert_ws && last_white && !beginning)
             {
@@ -50,12 +54,18 @@ static int32_t derive_header_content(const uint8_t* value, int32_t length, uint8
             }
             beginning = false;
             last_white = false;
-            buffer[out_length++] = value[k];
+            memcpy(buffer + out_length, value + k, run);
+            out_length += run;
+            k += run;
         }
-        else if (!last_white)
+        if (k < length)
         {
-            last_white = true;
-            buffer[out_length++] = ' ';
+            if (!last_white)
+            {
+                last_white = true;
+                buffer[out_length++] = ' ';
+            }
+            k++;
         }
     }
     if ((out_length > 0) && (buffer[out_length - 1] == ' '))
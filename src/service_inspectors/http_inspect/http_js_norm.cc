@@ -23,7 +23,11 @@
 
 #include "http_js_norm.h"
 
-#include "utils/util_jsnorm.h"
+#include <strings.h>
+
+#include <cassert>
+#include <cstdint>
+
 #include "utils/safec.h"
 
 #include "http_enum.h"
@@ -74,33 +78,65 @@ void HttpJsNorm::configure()
     htmltype_search_mpse->prep();
 }
 
+// Normalization is incremental. A script that continues past the end of one body section is
+// resumed at the start of the next. A <script> tag without its closing angle bracket, a partial
+// <script at the very end, or a keyword or decoded call that is cut off by the end of the section
+// is held back and normalized at the front of the next section. last is set for the final section
+// of the body and nothing is held back then.
 void HttpJsNorm::normalize(const Field& input, Field& output, HttpInfractions* infractions,
-    HttpEventGen* events) const
+    HttpEventGen* events, HttpJsNormState* state, bool last) const
 {
-    bool js_present = false;
+    bool js_present = state->in_script;
     int index = 0;
-    const char* ptr = (const char*)input.start();
-    const char* const end = ptr + input.length();
+
+    // Anything held back from the previous section goes in front
+    uint8_t* joined = nullptr;
+    int32_t length = input.length();
+    const char* text = (const char*)input.start();
+    if (state->held_length > 0)
+    {
+        length += state->held_length;
+        joined = new uint8_t[length];
+        memcpy(joined, state->held, state->held_length);
+        memcpy(joined + state->held_length, input.start(), input.length());
+        text = (const char*)joined;
+        state->held_length = 0;
+    }
+
+    const char* ptr = text;
+    const char* const end = text + length;
+    // Where the octets to be held back for the next section begin
+    const char* stop = end;
 
     JSState js;
     js.allowed_spaces = max_javascript_whitespaces;
     js.allowed_levels = MAX_ALLOWED_OBFUSCATION;
     js.alerts = 0;
 
-    uint8_t* buffer = new uint8_t[input.length()];
+    uint8_t* buffer = new uint8_t[length];
 
-    while (ptr < end)
+    while (ptr < stop)
     {
-        int bytes_copied = 0;
-        int mindex;
-
-        // Search for beginning of a javascript
-        if (javascript_search_mpse->find(ptr, end-ptr, search_js_found, false, &mindex) > 0)
+        if (!state->in_script)
         {
+            int mindex;
+
+            // Search for beginning of a javascript
+            if (javascript_search_mpse->find(ptr, end-ptr, search_js_found, false, &mindex) <= 0)
+            {
+                if (!last)
+                    stop = partial_script_start(ptr, end);
+                break;
+            }
+
             const char* js_start = ptr + mindex;
             const char* const angle_bracket = (const char*)SnortStrnStr(js_start, end - js_start, ">");
             if (angle_bracket == nullptr)
+            {
+                if (!last && (end - js_start <= HttpJsNormState::max_hold))
+                    stop = js_start;
                 break;
+            }
 
             bool type_js = false;
             if (angle_bracket > js_start)
@@ -133,9 +169,7 @@ void HttpJsNorm::normalize(const Field& input, Field& output, HttpInfractions* i
             // Save before the <script> begins
             if (js_start > ptr)
             {
-                if ((js_start - ptr) > (input.length() - index))
-                    break;
-                memmove_s(buffer + index, input.length() - index, ptr, js_start - ptr);
+                memmove_s(buffer + index, length - index, ptr, js_start - ptr);
                 index += js_start - ptr;
             }
 
@@ -143,22 +177,62 @@ void HttpJsNorm::normalize(const Field& input, Field& output, HttpInfractions* i
             if (!type_js)
                 continue;
 
+            state->in_script = true;
+            state->stream = { };
+        }
+
+        // The normalizer takes at most 64K at a time but carries its position from one piece to
+        // the next
+        while (ptr < end)
+        {
+            const char* const piece_start = ptr;
+            const uint16_t piece = (end - ptr < UINT16_MAX) ? end - ptr : UINT16_MAX;
+            const bool final_piece = (ptr + piece == end);
+            uint16_t max_hold = (final_piece && last) ? 0 : HttpJsNormState::max_hold;
+            const uint16_t room = (length - index < UINT16_MAX) ? length - index : UINT16_MAX;
+            int bytes_copied = 0;
+
             // FIXIT-L need to fix this library so we don't have to cast away const here.
-            JSNormalizeDecode(js_start, (uint16_t)(end-js_start), (char*)buffer+index,
-                (uint16_t)(input.length() - index), &ptr, &bytes_copied, &js,
+            bool closed = JSNormalizeStream(ptr, piece, (char*)buffer + index, room, &ptr,
+                &bytes_copied, &js, &state->stream, max_hold,
                 uri_param.iis_unicode ? uri_param.unicode_map : nullptr);
 
+            if (!closed && (ptr == piece_start) && !final_piece)
+            {
+                // A held back construct would start the next piece where we are now. Take it as
+                // it is rather than make no progress.
+                closed = JSNormalizeStream(ptr, piece, (char*)buffer + index, room, &ptr,
+                    &bytes_copied, &js, &state->stream, 0,
+                    uri_param.iis_unicode ? uri_param.unicode_map : nullptr);
+            }
             index += bytes_copied;
+
+            if (closed)
+            {
+                state->in_script = false;
+                break;
+            }
+            if (final_piece)
+            {
+                stop = ptr;
+                break;
+            }
         }
-        else
-            break;
+    }
+
+    if (stop < end)
+    {
+        assert(end - stop <= HttpJsNormState::max_hold);
+        state->held_length = end - stop;
+        memcpy(state->held, stop, state->held_length);
     }
 
     if (js_present)
     {
-        if ((ptr < end) && ((input.length() - index) >= (end - ptr)))
+        if (ptr < stop)
         {
-            memmove_s(buffer + index, input.length() - index, ptr, end - ptr); index += end - ptr;
+            memmove_s(buffer + index, length - index, ptr, stop - ptr);
+            index += stop - ptr;
         }
         if (js.alerts)
         {
@@ -180,11 +254,29 @@ void HttpJsNorm::normalize(const Field& input, Field& output, HttpInfractions* i
         }
         output.set(index, buffer, true);
     }
-    else
+    else if ((joined == nullptr) && (stop == end))
     {
         delete[] buffer;
         output.set(input);
     }
+    else
+    {
+        memcpy(buffer, text, stop - text);
+        output.set(stop - text, buffer, true);
+    }
+    delete[] joined;
+}
+
+// A <SCRIPT that may be completed by the next section
+const char* HttpJsNorm::partial_script_start(const char* ptr, const char* end)
+{
+    for (int n = (end - ptr < script_start_length) ? end - ptr : script_start_length - 1; n > 0;
+        n--)
+    {
+        if (strncasecmp(end - n, script_start, n) == 0)
+            return end - n;
+    }
+    return end;
 }
 
 /* Returning non-zero stops search, which is okay since we only look for one at a time */
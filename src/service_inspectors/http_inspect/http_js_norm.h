@@ -23,11 +23,28 @@
 #include <cstring>
 
 #include "search_engines/search_tool.h"
+#include "utils/util_jsnorm.h"
 
 #include "http_field.h"
 #include "http_event.h"
 #include "http_module.h"
 
+//-------------------------------------------------------------------------
+// HttpJsNormState - carried from one response body section to the next so that a script or a
+// <script> tag that is split between sections is normalized as if it were contiguous
+//-------------------------------------------------------------------------
+
+struct HttpJsNormState
+{
+    // Longest tail of a section that will be held back and normalized with the next one
+    static const uint16_t max_hold = 1024;
+
+    snort::JSStream stream = { };
+    bool in_script = false;
+    uint16_t held_length = 0;
+    uint8_t held[max_hold];
+};
+
 //-------------------------------------------------------------------------
 // HttpJsNorm class
 //-------------------------------------------------------------------------
@@ -38,7 +55,7 @@ public:
     HttpJsNorm(int max_javascript_whitespaces_, const HttpParaList::UriParam& uri_param_);
     ~HttpJsNorm();
     void normalize(const Field& input, Field& output, HttpInfractions* infractions,
-        HttpEventGen* events) const;
+        HttpEventGen* events, HttpJsNormState* state, bool last) const;
     void configure();
 private:
     enum JsSearchId { JS_JAVASCRIPT };
@@ -53,6 +70,7 @@ private:
     snort::SearchTool* javascript_search_mpse;
     snort::SearchTool* htmltype_search_mpse;
 
+    static const char* partial_script_start(const char* ptr, const char* end);
     static int search_js_found(void*, void*, int index, void*, void*);
     static int search_html_found(void* id, void*, int, void*, void*);
 };
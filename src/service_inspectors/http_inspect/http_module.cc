@@ -283,6 +283,7 @@ bool HttpModule::end(const char*, int, SnortConfig*)
         ParseWarning(WARN_CONF, "Meaningless to do bare byte when not doing UTF-8");
         params->uri_param.utf8_bare_byte = false;
     }
+    params->uri_param.build_char_sets();
     if (params->uri_param.iis_unicode)
     {
         params->uri_param.unicode_map = new uint8_t[65536];
@@ -366,5 +367,37 @@ HttpParaList::UriParam::UriParam() :
     CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,
     CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT,  CHAR_EIGHTBIT
   }
-{}
+{
+    build_char_sets();
+}
+
+void HttpParaList::UriParam::build_char_sets()
+{
+    norm_chars = path_chars = percent_chars = bad_chars = HttpScan::ByteSet();
+
+    for (unsigned c = 0; c < 256; c++)
+    {
+        switch (uri_char[c])
+        {
+        case CHAR_PERCENT:
+            percent_chars.set(c);
+            // Fall through
+        case CHAR_SUBSTIT:
+            norm_chars.set(c);
+            // Fall through
+        case CHAR_PATH:
+            path_chars.set(c);
+            break;
+        case CHAR_EIGHTBIT:
+            // Possible start of two-byte (110xxxxx) or three-byte (1110xxxx) UTF-8
+            if (((c & 0xE0) == 0xC0) || ((c & 0xF0) == 0xE0))
+                percent_chars.set(c);
+            break;
+        case CHAR_NORMAL:
+            break;
+        }
+        if (bad_characters[c])
+            bad_chars.set(c);
+    }
+}
 
@@ -27,6 +27,7 @@
 #include "profiler/profiler.h"
 
 #include "http_enum.h"
+#include "http_scan.h"
 
 #define HTTP_NAME "http_inspect"
 #define HTTP_HELP "HTTP inspector"
@@ -75,6 +76,14 @@ public:
         std::bitset<256> bad_characters;
         std::bitset<256> unreserved_char;
         HttpEnums::CharAction uri_char[256];
+
+        // uri_char and bad_characters laid out for HttpScan::find_in_set(). Must be rebuilt
+        // whenever either one changes.
+        HttpScan::ByteSet norm_chars;     // percent and substitution
+        HttpScan::ByteSet path_chars;     // percent, substitution, and path
+        HttpScan::ByteSet percent_chars;  // percent and eight bit UTF-8 lead octets
+        HttpScan::ByteSet bad_chars;
+        void build_char_sets();
     };
     UriParam uri_param;
 
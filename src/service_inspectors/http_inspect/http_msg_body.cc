@@ -121,12 +121,10 @@ void HttpMsgBody::do_file_decompression(const Field& input, Field& output)
     uint8_t* buffer = new uint8_t[MAX_OCTETS];
     session_data->fd_alert_context.infractions = transaction->get_infractions(source_id);
     session_data->fd_alert_context.events = transaction->get_events(source_id);
-    session_data->fd_state->Next_In = input.start();
-    session_data->fd_state->Avail_In = (uint32_t)input.length();
-    session_data->fd_state->Next_Out = buffer;
-    session_data->fd_state->Avail_Out = MAX_OCTETS;
+    uint32_t out_length;
 
-    const fd_status_t status = File_Decomp(session_data->fd_state);
+    const fd_status_t status = File_Decomp_Run(session_data->fd_state, input.start(),
+        (uint32_t)input.length(), buffer, MAX_OCTETS, &out_length);
 
     switch(status)
     {
@@ -145,7 +143,7 @@ void HttpMsgBody::do_file_decompression(const Field& input, Field& output)
         create_event(EVENT_FILE_DECOMPR_OVERRUN);
         // Fall through
     default:
-        output.set(session_data->fd_state->Next_Out - buffer, buffer, true);
+        output.set(out_length, buffer, true);
         break;
     }
 }
@@ -194,8 +192,26 @@ void HttpMsgBody::do_js_normalization(const Field& input, Field& output)
         return;
     }
 
+    if (session_data->js_norm_state == nullptr)
+        session_data->js_norm_state = new HttpJsNormState;
+
+    // Using the trick that cutter is deleted when regular or chunked body is complete
+    const bool last = (session_data->cutter[source_id] == nullptr) || tcp_close;
+
+    if (session_data->partial_flush[source_id])
+    {
+        // This data will be inspected again with the rest of the message section so the flow's
+        // place in the script must not advance
+        HttpJsNormState scratch(*session_data->js_norm_state);
+        params->js_norm_param.js_norm->normalize(input, output,
+            transaction->get_infractions(source_id), transaction->get_events(source_id),
+            &scratch, last);
+        return;
+    }
+
     params->js_norm_param.js_norm->normalize(input, output,
-        transaction->get_infractions(source_id), transaction->get_events(source_id));
+        transaction->get_infractions(source_id), transaction->get_events(source_id),
+        session_data->js_norm_state, last);
 }
 
 void HttpMsgBody::do_file_processing(Field& file_data)
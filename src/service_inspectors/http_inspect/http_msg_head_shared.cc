@@ -24,6 +24,9 @@
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_msg_head_shared.h"
+#include "http_scan.h"
+
+#include <cstring>
 
 using namespace HttpCommon;
 using namespace HttpEnums;
@@ -148,7 +151,8 @@ int32_t HttpMsgHeadShared::find_next_header(const uint8_t* buffer, int32_t lengt
 
     for (k++; k < length; k++)
     {
-        if (is_cr_lf[buffer[k]])
+        k += HttpScan::find_cr_lf(buffer + k, length - k);
+        if (k < length)
         {
             // Check for wrapping
             if (((buffer[k] == '\r') && (buffer[k+1] == '\n') && !is_sp_tab[buffer[k+2]]) ||
@@ -176,14 +180,11 @@ void HttpMsgHeadShared::parse_header_lines()
 
     for (int k=0; k < num_headers; k++)
     {
-        int colon;
-        for (colon=0; colon < header_line[k].length(); colon++)
-        {
-            if (header_line[k].start()[colon] == ':')
-                break;
-        }
-        if (colon < header_line[k].length())
+        const uint8_t* const found = (const uint8_t*)memchr(header_line[k].start(), ':',
+            header_line[k].length());
+        if (found != nullptr)
         {
+            const int32_t colon = found - header_line[k].start();
             header_name[k].set(colon, header_line[k].start());
             header_value[k].set(header_line[k].length() - colon - 1,
                                 header_line[k].start() + colon + 1);
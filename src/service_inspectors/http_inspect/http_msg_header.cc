@@ -23,6 +23,7 @@
 
 #include "http_msg_header.h"
 
+#include "decompress/decomp_pool.h"
 #include "decompress/file_decomp.h"
 #include "file_api/file_flows.h"
 #include "file_api/file_service.h"
@@ -38,6 +39,9 @@ using namespace snort;
 using namespace HttpCommon;
 using namespace HttpEnums;
 
+static const DataEventId request_header_event = DataBus::get_id(HTTP_REQUEST_HEADER_EVENT_KEY);
+static const DataEventId response_header_event = DataBus::get_id(HTTP_RESPONSE_HEADER_EVENT_KEY);
+
 HttpMsgHeader::HttpMsgHeader(const uint8_t* buffer, const uint16_t buf_size,
     HttpFlowData* session_data_, SourceId source_id_, bool buf_owner, Flow* flow_,
     const HttpParaList* params_) :
@@ -51,10 +55,10 @@ void HttpMsgHeader::publish()
 {
     HttpEvent http_event(this);
 
-    const char* key = (source_id == SRC_CLIENT) ?
-        HTTP_REQUEST_HEADER_EVENT_KEY : HTTP_RESPONSE_HEADER_EVENT_KEY;
+    const DataEventId id = (source_id == SRC_CLIENT) ?
+        request_header_event : response_header_event;
 
-    DataBus::publish(key, http_event, flow);
+    DataBus::publish(id, http_event, flow);
 }
 
 const Field& HttpMsgHeader::get_true_ip()
@@ -418,18 +422,10 @@ void HttpMsgHeader::setup_encoding_decompression()
     if (compression == CMP_NONE)
         return;
 
-    session_data->compress_stream[source_id] = new z_stream;
-    session_data->compress_stream[source_id]->zalloc = Z_NULL;
-    session_data->compress_stream[source_id]->zfree = Z_NULL;
-    session_data->compress_stream[source_id]->next_in = Z_NULL;
-    session_data->compress_stream[source_id]->avail_in = 0;
     const int window_bits = (compression == CMP_GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
-    if (inflateInit2(session_data->compress_stream[source_id], window_bits) != Z_OK)
-    {
+    session_data->compress_stream[source_id] = DecompPool::acquire_inflate(window_bits);
+    if (session_data->compress_stream[source_id] == nullptr)
         session_data->compression[source_id] = CMP_NONE;
-        delete session_data->compress_stream[source_id];
-        session_data->compress_stream[source_id] = nullptr;
-    }
 }
 
 void HttpMsgHeader::setup_utf_decoding()
@@ -0,0 +1,288 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_scan.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "http_scan.h"
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define USE_HTTP_SCAN_SIMD
+#include <immintrin.h>
+#endif
+
+namespace HttpScan
+{
+Isa isa = ISA_SCALAR;
+
+static const char* const isa_names[ISA_MAX] = { "scalar", "sse2", "ssse3", "avx2" };
+
+void init()
+{
+#ifdef USE_HTTP_SCAN_SIMD
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        isa = ISA_AVX2;
+
+    else if ( __builtin_cpu_supports("ssse3") )
+        isa = ISA_SSSE3;
+
+    else if ( __builtin_cpu_supports("sse2") )
+        isa = ISA_SSE2;
+
+    else
+#endif
+        isa = ISA_SCALAR;
+}
+
+const char* get_isa_name(Isa i)
+{ return (i < ISA_MAX) ? isa_names[i] : "unknown"; }
+
+//-------------------------------------------------------------------------
+// scalar
+//-------------------------------------------------------------------------
+
+static inline bool is_cr_lf(uint8_t c)
+{ return (c == '\r') or (c == '\n'); }
+
+static inline bool is_sp_tab_cr_lf(uint8_t c)
+{ return (c == ' ') or (c == '\t') or is_cr_lf(c); }
+
+static int32_t tail_cr_lf(const uint8_t* buffer, int32_t k, int32_t length)
+{
+    for ( ; k < length and !is_cr_lf(buffer[k]); k++ );
+    return k;
+}
+
+static int32_t tail_sp_tab_cr_lf(const uint8_t* buffer, int32_t k, int32_t length)
+{
+    for ( ; k < length and !is_sp_tab_cr_lf(buffer[k]); k++ );
+    return k;
+}
+
+static int32_t tail_set(const ByteSet& bs, const uint8_t* buffer, int32_t k, int32_t length)
+{
+    for ( ; k < length and !bs.test(buffer[k]); k++ );
+    return k;
+}
+
+#ifdef USE_HTTP_SCAN_SIMD
+//-------------------------------------------------------------------------
+// sse2
+//-------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static int32_t sse2_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    int32_t k = 0;
+
+    for ( ; k + 16 <= length; k += 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + k));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf));
+        unsigned bits = _mm_movemask_epi8(m);
+
+        if ( bits )
+            return k + __builtin_ctz(bits);
+    }
+    return tail_cr_lf(buffer, k, length);
+}
+
+__attribute__((target("sse2")))
+static int32_t sse2_sp_tab_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    int32_t k = 0;
+
+    for ( ; k + 16 <= length; k += 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + k));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        unsigned bits = _mm_movemask_epi8(m);
+
+        if ( bits )
+            return k + __builtin_ctz(bits);
+    }
+    return tail_sp_tab_cr_lf(buffer, k, length);
+}
+
+//-------------------------------------------------------------------------
+// ssse3
+//-------------------------------------------------------------------------
+
+// Octets below 0x80 index lo and octets from 0x80 up index hi. pshufb yields zero for an index
+// with the high bit set so flipping that bit selects the table. The result is then masked with the
+// bit for the high nibble.
+__attribute__((target("ssse3")))
+static int32_t ssse3_set(const ByteSet& bs, const uint8_t* buffer, int32_t length)
+{
+    const __m128i lo = _mm_load_si128((const __m128i*)bs.lo);
+    const __m128i hi = _mm_load_si128((const __m128i*)bs.hi);
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i top = _mm_set1_epi8(-128);
+    const __m128i nib = _mm_set1_epi8(0x0f);
+    int32_t k = 0;
+
+    for ( ; k + 16 <= length; k += 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + k));
+        __m128i t = _mm_or_si128(_mm_shuffle_epi8(lo, v),
+            _mm_shuffle_epi8(hi, _mm_xor_si128(v, top)));
+        __m128i b = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+        __m128i m = _mm_cmpeq_epi8(_mm_and_si128(t, b), _mm_setzero_si128());
+        unsigned found = ~_mm_movemask_epi8(m) & 0xFFFF;
+
+        if ( found )
+            return k + __builtin_ctz(found);
+    }
+    return tail_set(bs, buffer, k, length);
+}
+
+//-------------------------------------------------------------------------
+// avx2
+//-------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static int32_t avx2_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    int32_t k = 0;
+
+    for ( ; k + 32 <= length; k += 32 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + k));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf));
+        unsigned bits = _mm256_movemask_epi8(m);
+
+        if ( bits )
+            return k + __builtin_ctz(bits);
+    }
+    return tail_cr_lf(buffer, k, length);
+}
+
+__attribute__((target("avx2")))
+static int32_t avx2_sp_tab_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    int32_t k = 0;
+
+    for ( ; k + 32 <= length; k += 32 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + k));
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        unsigned bits = _mm256_movemask_epi8(m);
+
+        if ( bits )
+            return k + __builtin_ctz(bits);
+    }
+    return tail_sp_tab_cr_lf(buffer, k, length);
+}
+
+__attribute__((target("avx2")))
+static int32_t avx2_set(const ByteSet& bs, const uint8_t* buffer, int32_t length)
+{
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)bs.lo));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)bs.hi));
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i top = _mm256_set1_epi8(-128);
+    const __m256i nib = _mm256_set1_epi8(0x0f);
+    int32_t k = 0;
+
+    for ( ; k + 32 <= length; k += 32 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + k));
+        __m256i t = _mm256_or_si256(_mm256_shuffle_epi8(lo, v),
+            _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, top)));
+        __m256i b = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+        __m256i m = _mm256_cmpeq_epi8(_mm256_and_si256(t, b), _mm256_setzero_si256());
+        unsigned found = ~(unsigned)_mm256_movemask_epi8(m);
+
+        if ( found )
+            return k + __builtin_ctz(found);
+    }
+    return tail_set(bs, buffer, k, length);
+}
+#endif
+
+//-------------------------------------------------------------------------
+// dispatch
+//-------------------------------------------------------------------------
+
+int32_t find_cr_lf(const uint8_t* buffer, int32_t length)
+{
+#ifdef USE_HTTP_SCAN_SIMD
+    switch ( isa )
+    {
+    case ISA_AVX2: return avx2_cr_lf(buffer, length);
+    case ISA_SSSE3:
+    case ISA_SSE2: return sse2_cr_lf(buffer, length);
+    default: break;
+    }
+#endif
+    return tail_cr_lf(buffer, 0, length);
+}
+
+int32_t find_sp_tab_cr_lf(const uint8_t* buffer, int32_t length)
+{
+#ifdef USE_HTTP_SCAN_SIMD
+    switch ( isa )
+    {
+    case ISA_AVX2: return avx2_sp_tab_cr_lf(buffer, length);
+    case ISA_SSSE3:
+    case ISA_SSE2: return sse2_sp_tab_cr_lf(buffer, length);
+    default: break;
+    }
+#endif
+    return tail_sp_tab_cr_lf(buffer, 0, length);
+}
+
+int32_t find_in_set(const ByteSet& bs, const uint8_t* buffer, int32_t length)
+{
+#ifdef USE_HTTP_SCAN_SIMD
+    switch ( isa )
+    {
+    case ISA_AVX2: return avx2_set(bs, buffer, length);
+    case ISA_SSSE3: return ssse3_set(bs, buffer, length);
+    default: break;
+    }
+#endif
+    return tail_set(bs, buffer, 0, length);
+}
+
+} // end namespace HttpScan
+
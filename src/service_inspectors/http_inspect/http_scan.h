@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_scan.h
+
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+// Delimiter searches used to cut and split header blocks and to normalize URIs. Each search
+// returns the index of the first matching octet or length if there is none. On x86 the search runs
+// 16 or 32 octets at a time using the best instruction set the CPU supports.
+
+#include <cstdint>
+
+namespace HttpScan
+{
+enum Isa { ISA_SCALAR, ISA_SSE2, ISA_SSSE3, ISA_AVX2, ISA_MAX };
+
+// best kernel to use; set from the cpu by init() and may be lowered to check the others
+extern Isa isa;
+
+void init();
+const char* get_isa_name(Isa);
+
+// CR or LF
+int32_t find_cr_lf(const uint8_t* buffer, int32_t length);
+
+// SP, tab, CR, or LF
+int32_t find_sp_tab_cr_lf(const uint8_t* buffer, int32_t length);
+
+// An arbitrary set of octets split by nibble so that membership of 16 octets can be tested with
+// two table lookups. Bit (c >> 4) & 7 of lo[c & 0xF] is set for members below 0x80 and the same
+// bit of hi[c & 0xF] for members from 0x80 up.
+struct ByteSet
+{
+    alignas(16) uint8_t lo[16] = { };
+    alignas(16) uint8_t hi[16] = { };
+
+    void set(uint8_t c)
+    { ((c & 0x80) ? hi : lo)[c & 0xF] |= 1 << ((c >> 4) & 7); }
+
+    bool test(uint8_t c) const
+    { return (((c & 0x80) ? hi : lo)[c & 0xF] & (1 << ((c >> 4) & 7))) != 0; }
+};
+
+int32_t find_in_set(const ByteSet&, const uint8_t* buffer, int32_t length);
+
+} // end namespace HttpScan
+
+#endif
+
@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 
+#include "decompress/decomp_pool.h"
 #include "protocols/packet.h"
 
 #include "http_inspect.h"
@@ -149,6 +150,8 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
         compress_stream->next_out = buffer + offset;
         compress_stream->avail_out = MAX_OCTETS - offset;
         int ret_val = inflate(compress_stream, Z_SYNC_FLUSH);
+        snort::DecompPool::count(length - compress_stream->avail_in,
+            MAX_OCTETS - offset - compress_stream->avail_out);
 
         if ((ret_val == Z_OK) || (ret_val == Z_STREAM_END))
         {
@@ -175,8 +178,7 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
                     events->create_event(EVENT_GZIP_OVERRUN);
                 }
                 compression = CMP_NONE;
-                inflateEnd(compress_stream);
-                delete compress_stream;
+                snort::DecompPool::release_inflate(compress_stream);
                 compress_stream = nullptr;
             }
             return;
@@ -202,8 +204,7 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
             *infractions += INF_GZIP_FAILURE;
             events->create_event(EVENT_GZIP_FAILURE);
             compression = CMP_NONE;
-            inflateEnd(compress_stream);
-            delete compress_stream;
+            snort::DecompPool::release_inflate(compress_stream);
             compress_stream = nullptr;
             // Since we failed to uncompress the data, fall through
         }
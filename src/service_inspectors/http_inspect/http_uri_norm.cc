@@ -23,9 +23,11 @@
 
 #include "http_uri_norm.h"
 
+#include <cstring>
 #include <sstream>
 
 #include "http_enum.h"
+#include "http_scan.h"
 #include "log/messages.h"
 
 using namespace HttpEnums;
@@ -67,16 +69,13 @@ bool UriNormalizer::need_norm(const Field& uri_component, bool do_path,
     return need_it;
 }
 
+// Most URIs need no normalization. These checks find the next octet that might need it many at a
+// time and only examine that octet and its neighbors individually.
 bool UriNormalizer::need_norm_no_path(const Field& uri_component,
     const HttpParaList::UriParam& uri_param)
 {
-    for (int32_t k = 0; k < uri_component.length(); k++)
-    {
-        if ((uri_param.uri_char[uri_component.start()[k]] == CHAR_PERCENT) ||
-            (uri_param.uri_char[uri_component.start()[k]] == CHAR_SUBSTIT))
-            return true;
-    }
-    return false;
+    return HttpScan::find_in_set(uri_param.norm_chars, uri_component.start(),
+        uri_component.length()) < uri_component.length();
 }
 
 bool UriNormalizer::need_norm_path(const Field& uri_component,
@@ -86,6 +85,11 @@ bool UriNormalizer::need_norm_path(const Field& uri_component,
     const uint8_t* const buf = uri_component.start();
     for (int32_t k = 0; k < length; k++)
     {
+        // Skip over CHAR_NORMAL and CHAR_EIGHTBIT
+        k += HttpScan::find_in_set(uri_param.path_chars, buf + k, length - k);
+        if (k >= length)
+            break;
+
         switch (uri_param.uri_char[buf[k]])
         {
         case CHAR_NORMAL:
@@ -144,6 +148,15 @@ int32_t UriNormalizer::norm_percent_processing(const Field& input, uint8_t* out_
     int32_t length = 0;
     for (int32_t k = 0; k < input.length(); k++)
     {
+        // Copy everything up to the next percent or possible UTF-8 lead octet in one piece
+        const int32_t run = HttpScan::find_in_set(uri_param.percent_chars, input.start() + k,
+            input.length() - k);
+        memcpy(out_buf + length, input.start() + k, run);
+        length += run;
+        k += run;
+        if (k >= input.length())
+            break;
+
         switch (uri_param.uri_char[input.start()[k]])
         {
         case CHAR_EIGHTBIT:
@@ -287,31 +300,37 @@ int32_t UriNormalizer::norm_double_decode(const Field& input, uint8_t* out_buf,
     int32_t length = 0;
     for (int32_t k = 0; k < input.length(); k++)
     {
-        if (input.start()[k] != '%')
-            out_buf[length++] = input.start()[k];
+        const uint8_t* const percent = (const uint8_t*)memchr(input.start() + k, '%',
+            input.length() - k);
+        const int32_t run = (percent != nullptr) ? percent - (input.start() + k) :
+            input.length() - k;
+        // Decoding is done in place so the copy may overlap
+        memmove(out_buf + length, input.start() + k, run);
+        length += run;
+        k += run;
+        if (k >= input.length())
+            break;
+
+        if (is_percent_encoding(input, k))
+        {
+            *infractions += INF_URI_DOUBLE_DECODE;
+            events->create_event(EVENT_DOUBLE_DECODE);
+            out_buf[length++] = extract_percent_encoding(input, k);
+            k += 2;
+        }
+        else if (uri_param.percent_u && is_u_encoding(input, k))
+        {
+            *infractions += INF_URI_DOUBLE_DECODE;
+            events->create_event(EVENT_DOUBLE_DECODE);
+            *infractions += INF_URI_U_ENCODE;
+            events->create_event(EVENT_U_ENCODE);
+            out_buf[length++] = reduce_to_eight_bits(extract_u_encoding(input, k), uri_param,
+                infractions, events);
+            k += 5;
+        }
         else
         {
-            if (is_percent_encoding(input, k))
-            {
-                *infractions += INF_URI_DOUBLE_DECODE;
-                events->create_event(EVENT_DOUBLE_DECODE);
-                out_buf[length++] = extract_percent_encoding(input, k);
-                k += 2;
-            }
-            else if (uri_param.percent_u && is_u_encoding(input, k))
-            {
-                *infractions += INF_URI_DOUBLE_DECODE;
-                events->create_event(EVENT_DOUBLE_DECODE);
-                *infractions += INF_URI_U_ENCODE;
-                events->create_event(EVENT_U_ENCODE);
-                out_buf[length++] = reduce_to_eight_bits(extract_u_encoding(input, k), uri_param,
-                    infractions, events);
-                k += 5;
-            }
-            else
-            {
-                out_buf[length++] = '%';
-            }
+            out_buf[length++] = '%';
         }
     }
     return length;
@@ -340,14 +359,11 @@ void UriNormalizer::detect_bad_char(const Field& uri_component,
     if (uri_param.bad_characters.count() == 0)
         return;
 
-    for (int32_t k = 0; k < uri_component.length(); k++)
+    if (HttpScan::find_in_set(uri_param.bad_chars, uri_component.start(),
+        uri_component.length()) < uri_component.length())
     {
-        if (uri_param.bad_characters[uri_component.start()[k]])
-        {
-            *infractions += INF_URI_BAD_CHAR;
-            events->create_event(EVENT_NON_RFC_CHAR);
-            return;
-        }
+        *infractions += INF_URI_BAD_CHAR;
+        events->create_event(EVENT_NON_RFC_CHAR);
     }
 }
 
@@ -0,0 +1,401 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_header_test.cc
+// unit test main
+// compares the header cutter and header content derivation against the per-octet loops they
+// replaced
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "service_inspectors/http_inspect/http_cutter.h"
+#include "service_inspectors/http_inspect/http_enum.h"
+#include "service_inspectors/http_inspect/http_field.h"
+#include "service_inspectors/http_inspect/http_header_normalizer.h"
+#include "service_inspectors/http_inspect/http_scan.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+
+using namespace snort;
+using namespace HttpEnums;
+
+namespace snort
+{
+// Stubs whose sole purpose is to make the test code link
+int DetectionEngine::queue_event(unsigned int, unsigned int, Actions::Type) { return 0; }
+const char* SnortStrnStr(const char*, int, const char*) { return nullptr; }
+}
+
+class RecordingEventGen : public HttpEventGen
+{
+public:
+    void create_event(int sid) override
+    {
+        HttpEventGen::create_event(sid);
+        sids.push_back(sid);
+    }
+    std::vector<int> sids;
+};
+
+// HttpHeaderCutter::cut() before the field content skip
+class RefHeaderCutter : public HttpCutter
+{
+public:
+    ScanResult cut(const uint8_t* buffer, uint32_t length, HttpInfractions* infractions,
+        HttpEventGen* events, uint32_t, bool) override
+    {
+        for (uint32_t k = 0; k < length; k++)
+        {
+            switch (state)
+            {
+            case ZERO:
+                if (buffer[k] == '\r')
+                {
+                    state = HALF;
+                    num_crlf++;
+                }
+                else if (buffer[k] == '\n')
+                {
+                    *infractions += INF_LF_WITHOUT_CR;
+                    events->create_event(EVENT_LF_WITHOUT_CR);
+                    state = ONE;
+                    num_crlf++;
+                }
+                break;
+            case HALF:
+                if (buffer[k] == '\r')
+                {
+                    *infractions += INF_CR_WITHOUT_LF;
+                    events->create_event(EVENT_CR_WITHOUT_LF);
+                    state = THREEHALF;
+                    num_crlf++;
+                }
+                else if (buffer[k] == '\n')
+                {
+                    state = ONE;
+                    num_crlf++;
+                }
+                else
+                {
+                    *infractions += INF_CR_WITHOUT_LF;
+                    events->create_event(EVENT_CR_WITHOUT_LF);
+                    state = ZERO;
+                    num_crlf = 0;
+                    num_head_lines++;
+                }
+                break;
+            case ONE:
+                if (buffer[k] == '\r')
+                {
+                    state = THREEHALF;
+                    num_crlf++;
+                }
+                else if (buffer[k] == '\n')
+                {
+                    *infractions += INF_LF_WITHOUT_CR;
+                    events->create_event(EVENT_LF_WITHOUT_CR);
+                    num_crlf++;
+                    num_flush = k + 1;
+                    return SCAN_FOUND;
+                }
+                else
+                {
+                    state = ZERO;
+                    num_crlf = 0;
+                    num_head_lines++;
+                }
+                break;
+            case THREEHALF:
+                if (buffer[k] == '\r')
+                {
+                    *infractions += INF_CR_WITHOUT_LF;
+                    events->create_event(EVENT_CR_WITHOUT_LF);
+                    num_crlf++;
+                }
+                else if (buffer[k] == '\n')
+                {
+                    num_crlf++;
+                    num_flush = k + 1;
+                    return SCAN_FOUND;
+                }
+                else
+                {
+                    *infractions += INF_CR_WITHOUT_LF;
+                    events->create_event(EVENT_CR_WITHOUT_LF);
+                    state = ZERO;
+                    num_crlf = 0;
+                    num_head_lines++;
+                }
+                break;
+            }
+        }
+        octets_seen += length;
+        return SCAN_NOT_FOUND;
+    }
+    uint32_t get_num_head_lines() const override { return num_head_lines; }
+
+private:
+    enum LineEndState { ZERO, HALF, ONE, THREEHALF };
+    LineEndState state = ONE;
+    int32_t num_head_lines = 0;
+};
+
+// derive_header_content() before it copied runs of non-white space in one piece
+static int32_t ref_derive_header_content(const uint8_t* value, int32_t length, uint8_t* buffer,
+    bool alert_ws, HttpInfractions* infractions, HttpEventGen* events)
+{
+    int32_t out_length = 0;
+    bool beginning = true;
+    bool last_white = true;
+    for (int32_t k=0; k < length; k++)
+    {
+        if (!is_sp_tab_cr_lf[value[k]])
+        {
+            if (alert_ws && last_white && !beginning)
+            {
+                *infractions += INF_BAD_HEADER_WHITESPACE;
+                events->create_event(EVENT_BAD_HEADER_WHITESPACE);
+            }
+            beginning = false;
+            last_white = false;
+            buffer[out_length++] = value[k];
+        }
+        else if (!last_white)
+        {
+            last_white = true;
+            buffer[out_length++] = ' ';
+        }
+    }
+    if ((out_length > 0) && (buffer[out_length - 1] == ' '))
+    {
+        out_length--;
+    }
+    return out_length;
+}
+
+struct HeaderResult
+{
+    std::vector<ScanResult> scans;
+    std::vector<uint32_t> seen;
+    std::vector<uint8_t> out;
+    std::vector<int> sids;
+    uint64_t inf[2] = { 0, 0 };
+    uint32_t num_flush = 0;
+    uint32_t num_excess = 0;
+    uint32_t num_head_lines = 0;
+
+    bool operator==(const HeaderResult& rhs) const
+    {
+        return (scans == rhs.scans) && (seen == rhs.seen) && (out == rhs.out) &&
+            (sids == rhs.sids) && (inf[0] == rhs.inf[0]) && (inf[1] == rhs.inf[1]) &&
+            (num_flush == rhs.num_flush) && (num_excess == rhs.num_excess) &&
+            (num_head_lines == rhs.num_head_lines);
+    }
+};
+
+// Feed the block to the cutter in the given pieces the way the splitter does, starting each piece
+// where the previous one ended until a cut is found
+template<typename Cutter>
+static HeaderResult run_cutter(const std::vector<uint8_t>& block,
+    const std::vector<uint32_t>& pieces)
+{
+    HeaderResult r;
+    HttpInfractions infractions;
+    RecordingEventGen events;
+    Cutter cutter;
+    uint32_t offset = 0;
+    for (uint32_t piece : pieces)
+    {
+        const ScanResult scan = cutter.cut(block.data() + offset, piece, &infractions, &events,
+            0, false);
+        r.scans.push_back(scan);
+        r.seen.push_back(cutter.get_octets_seen());
+        if (scan != SCAN_NOT_FOUND)
+            break;
+        offset += piece;
+    }
+    r.sids = events.sids;
+    r.inf[0] = infractions.get_raw();
+    r.inf[1] = infractions.get_raw2();
+    r.num_flush = cutter.get_num_flush();
+    r.num_excess = cutter.get_num_excess();
+    r.num_head_lines = cutter.get_num_head_lines();
+    return r;
+}
+
+static const HeaderNormalizer NORMALIZER_ALERT_WS
+    { EVENT__NONE, INF__NONE, true, nullptr, nullptr, nullptr };
+
+static HeaderResult run_normalizer(const std::vector<std::vector<uint8_t>>& values)
+{
+    HeaderResult r;
+    HttpInfractions infractions;
+    RecordingEventGen events;
+    std::vector<HeaderId> ids(values.size(), HEAD__OTHER);
+    Field* fields = new Field[values.size()];
+    for (unsigned k = 0; k < values.size(); k++)
+    {
+        // empty values still point into the message
+        const uint8_t* start = values[k].empty() ? (const uint8_t*)"" : values[k].data();
+        fields[k].set(values[k].size(), start);
+    }
+    Field result;
+    NORMALIZER_ALERT_WS.normalize(HEAD__OTHER, values.size(), &infractions, &events, ids.data(),
+        fields, values.size(), result);
+    r.out.assign(result.start(), result.start() + result.length());
+    delete[] fields;
+    r.sids = events.sids;
+    r.inf[0] = infractions.get_raw();
+    r.inf[1] = infractions.get_raw2();
+    return r;
+}
+
+static HeaderResult ref_normalizer(const std::vector<std::vector<uint8_t>>& values)
+{
+    HeaderResult r;
+    HttpInfractions infractions;
+    RecordingEventGen events;
+    for (unsigned k = 0; k < values.size(); k++)
+    {
+        if (k > 0)
+            r.out.push_back(',');
+        std::vector<uint8_t> buffer(values[k].size() + 1);
+        const int32_t length = ref_derive_header_content(values[k].data(), values[k].size(),
+            buffer.data(), true, &infractions, &events);
+        r.out.insert(r.out.end(), buffer.begin(), buffer.begin() + length);
+    }
+    r.sids = events.sids;
+    r.inf[0] = infractions.get_raw();
+    r.inf[1] = infractions.get_raw2();
+    return r;
+}
+
+TEST_GROUP(http_header_differential)
+{
+    HttpScan::Isa best = HttpScan::ISA_SCALAR;
+    std::mt19937 rng;
+
+    void setup() override
+    {
+        HttpScan::init();
+        best = HttpScan::isa;
+    }
+
+    void teardown() override
+    {
+        HttpScan::isa = best;
+    }
+
+    // Mostly field content with line endings and white space at a chosen density
+    std::vector<uint8_t> random_block(unsigned len)
+    {
+        static const uint8_t alphabet[] = { '\r', '\r', '\n', '\n', ' ', ' ', '\t', ':', ',',
+            0x00, 0x0b, 0x0c, 0x80, 0xff };
+        const unsigned density = 1 + rng() % 64;
+        std::vector<uint8_t> block;
+        while (block.size() < len)
+        {
+            if (rng() % density)
+                block.push_back('a' + rng() % 26);
+            else
+                block.push_back(alphabet[rng() % sizeof(alphabet)]);
+        }
+        return block;
+    }
+};
+
+TEST(http_header_differential, cutter)
+{
+    rng.seed(1);
+    for (unsigned iter = 0; iter < 20000; iter++)
+    {
+        std::vector<uint8_t> block = random_block(1 + rng() % 300);
+
+        // most blocks end properly so that cuts land in every piece
+        if (rng() % 4)
+        {
+            static const char* const ends[] = { "\r\n\r\n", "\n\n", "\r\n\n", "\n\r\n" };
+            const char* end = ends[rng() % 4];
+            block.insert(block.begin() + rng() % block.size(), end, end + strlen(end));
+        }
+
+        std::vector<uint32_t> pieces;
+        for (uint32_t left = block.size(); left > 0; )
+        {
+            const uint32_t piece = (rng() % 3) ? left : 1 + rng() % left;
+            pieces.push_back(piece);
+            left -= piece;
+        }
+
+        const HeaderResult expected = run_cutter<RefHeaderCutter>(block, pieces);
+        for (int i = HttpScan::ISA_SCALAR; i <= best; i++)
+        {
+            HttpScan::isa = (HttpScan::Isa)i;
+            CHECK(run_cutter<HttpHeaderCutter>(block, pieces) == expected);
+        }
+    }
+}
+
+TEST(http_header_differential, derive_header_content)
+{
+    rng.seed(2);
+    for (unsigned iter = 0; iter < 20000; iter++)
+    {
+        std::vector<std::vector<uint8_t>> values(1 + rng() % 3);
+        for (auto& value : values)
+            value = random_block(rng() % 200);
+
+        const HeaderResult expected = ref_normalizer(values);
+        for (int i = HttpScan::ISA_SCALAR; i <= best; i++)
+        {
+            HttpScan::isa = (HttpScan::Isa)i;
+            CHECK(run_normalizer(values) == expected);
+        }
+    }
+}
+
+TEST(http_header_differential, examples)
+{
+    HttpHeaderCutter cutter;
+    HttpInfractions infractions;
+    HttpEventGen events;
+    const uint8_t block[] = "Host: x\r\nAccept:  a,\tb \r\n\r\nbody";
+    CHECK(cutter.cut(block, sizeof(block) - 1, &infractions, &events, 0, false) == SCAN_FOUND);
+    CHECK(cutter.get_num_flush() == 27);
+    CHECK(cutter.get_num_excess() == 4);
+    CHECK(cutter.get_num_head_lines() == 2);
+
+    const std::vector<std::vector<uint8_t>> values {
+        { ' ', 'a', ',', ' ', '\t', 'b', ' ', ' ' }, { 'c' } };
+    const HeaderResult r = run_normalizer(values);
+    CHECK(r.out == std::vector<uint8_t>({ 'a', ',', ' ', 'b', ',', 'c' }));
+    CHECK(r.sids == std::vector<int>({ EVENT_BAD_HEADER_WHITESPACE }));
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_js_norm_stream_test.cc
+
+// unit tests for normalizing a script that arrives in pieces
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "utils/util_jsnorm.h"
+
+#include <string>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+static const char* const scripts[] =
+{
+    ">var a = unescape(\"%48%65%6C%6C%6F\");  document.write(a);</script>",
+    ">x = String.fromCharCode(72, 105, 33);\ny = 1;</SCRIPT>",
+    ">eval(decodeURIComponent('%61%6c%65%72%74%28%31%29'));</script>",
+    ">if (u)   {  user = 'US';   }\n\n\n  unescape('%u0041%u0042') </script >",
+    ">a = unescape(unescape('%2541%2542'));</script>",
+    ">var s = '\\x41\\x42'; var t = decodeURI('%41');</script>",
+};
+
+struct Result
+{
+    std::string out;
+    uint16_t alerts = 0;
+};
+
+static Result whole(const std::string& text)
+{
+    Result r;
+    JSState js = { 2, MAX_ALLOWED_OBFUSCATION, 0 };
+    std::vector<char> buf(text.size());
+    const char* ptr = text.data();
+    int copied = 0;
+    JSNormalizeDecode(text.data(), text.size(), buf.data(), buf.size(), &ptr, &copied, &js,
+        nullptr);
+    r.out.assign(buf.data(), copied);
+    r.alerts = js.alerts;
+    return r;
+}
+
+// Present text in pieces ending at each cut, carrying held back octets forward the way
+// HttpJsNorm does
+static Result pieces(const std::string& text, const std::vector<size_t>& cuts)
+{
+    Result r;
+    JSStream stream = { };
+    std::string held;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= cuts.size(); i++)
+    {
+        const size_t stop = (i < cuts.size()) ? cuts[i] : text.size();
+        const bool last = (i == cuts.size());
+        const std::string data = held + text.substr(start, stop - start);
+        start = stop;
+
+        JSState js = { 2, MAX_ALLOWED_OBFUSCATION, 0 };
+        std::vector<char> buf(data.size() + 1);
+        const char* ptr = data.data();
+        int copied = 0;
+        const bool closed = JSNormalizeStream(data.data(), data.size(), buf.data(), buf.size(),
+            &ptr, &copied, &js, &stream, last ? 0 : 1024, nullptr);
+
+        r.out.append(buf.data(), copied);
+        r.alerts |= js.alerts;
+        CHECK(ptr >= data.data());
+        CHECK(ptr <= data.data() + data.size());
+        held.assign(ptr, data.data() + data.size() - ptr);
+
+        if (closed)
+        {
+            // all the scripts end with </script>
+            CHECK(stop == text.size());
+            CHECK(held.empty());
+        }
+    }
+    CHECK(held.empty());
+    return r;
+}
+
+TEST_GROUP(js_norm_stream) { };
+
+TEST(js_norm_stream, one_piece)
+{
+    for (const char* s : scripts)
+    {
+        const std::string text(s);
+        const Result a = whole(text);
+        const Result b = pieces(text, { });
+        CHECK(a.out == b.out);
+        CHECK(a.alerts == b.alerts);
+    }
+}
+
+TEST(js_norm_stream, decodes)
+{
+    CHECK(whole(scripts[0]).out.find("Hello") != std::string::npos);
+    CHECK(whole(scripts[1]).out.find("Hi!") != std::string::npos);
+}
+
+// every single split point
+TEST(js_norm_stream, two_pieces)
+{
+    for (const char* s : scripts)
+    {
+        const std::string text(s);
+        const Result a = whole(text);
+
+        for (size_t cut = 0; cut <= text.size(); cut++)
+        {
+            const Result b = pieces(text, { cut });
+            CHECK(a.out == b.out);
+            CHECK(a.alerts == b.alerts);
+        }
+    }
+}
+
+// octet at a time is the worst case for held back keywords and calls
+TEST(js_norm_stream, octet_pieces)
+{
+    for (const char* s : scripts)
+    {
+        const std::string text(s);
+        std::vector<size_t> cuts;
+        for (size_t cut = 1; cut < text.size(); cut++)
+            cuts.push_back(cut);
+
+        const Result a = whole(text);
+        const Result b = pieces(text, cuts);
+        CHECK(a.out == b.out);
+        CHECK(a.alerts == b.alerts);
+    }
+}
+
+// A call argument longer than max_hold can't be held back and is decoded in two parts
+TEST(js_norm_stream, hold_limit)
+{
+    std::string text = ">a = unescape('";
+    for (unsigned i = 0; i < 600; i++)
+        text += "%41";
+    text += "');</script>";
+
+    const std::string data = text.substr(0, 1500);
+    JSStream stream = { };
+    JSState js = { 0, MAX_ALLOWED_OBFUSCATION, 0 };
+    std::vector<char> buf(data.size());
+    const char* ptr = data.data();
+    int copied = 0;
+
+    CHECK(!JSNormalizeStream(data.data(), data.size(), buf.data(), buf.size(), &ptr, &copied,
+        &js, &stream, 1024, nullptr));
+    CHECK(ptr == data.data() + data.size());
+    CHECK(copied > 0);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
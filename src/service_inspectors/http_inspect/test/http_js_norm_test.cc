@@ -0,0 +1,258 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_js_norm_test.cc
+
+// unit tests for normalizing a response body whose scripts are split between sections
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "service_inspectors/http_inspect/http_js_norm.h"
+
+#include <strings.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+
+using namespace snort;
+
+// Stubs whose sole purpose is to make the test code link
+HttpParaList::UriParam::UriParam() {}
+
+namespace snort
+{
+int DetectionEngine::queue_event(unsigned int, unsigned int, Actions::Type) { return 0; }
+
+// A SearchTool that reports the first case insensitive match the way the mpse does, with the
+// index just past the end of the match
+static std::map<const SearchTool*, std::vector<std::pair<std::string, int>>> patterns;
+
+SearchTool::SearchTool(const char*, bool) : mpsegrp(nullptr), max_len(0) {}
+SearchTool::~SearchTool() { patterns.erase(this); }
+void SearchTool::add(const char* pattern, unsigned len, int s_id, bool)
+{ patterns[this].emplace_back(std::string(pattern, len), s_id); }
+void SearchTool::prep() {}
+
+int SearchTool::find(const char* s, unsigned s_len, MpseMatch match, bool, void* user_data)
+{
+    for (unsigned end = 1; end <= s_len; end++)
+    {
+        for (const auto& p : patterns[this])
+        {
+            if ((p.first.size() <= end) &&
+                (strncasecmp(s + end - p.first.size(), p.first.c_str(), p.first.size()) == 0))
+            {
+                match((void*)(uintptr_t)p.second, nullptr, end, user_data, nullptr);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+}
+
+struct Result
+{
+    std::string out;
+    uint64_t inf = 0;
+    uint64_t events = 0;
+};
+
+// Normalize the body in sections ending at each cut, carrying the state from one to the next
+static Result sections(const std::string& body, const std::vector<size_t>& cuts,
+    HttpJsNormState* state = nullptr)
+{
+    HttpParaList::UriParam uri_param;
+    HttpJsNorm js_norm(200, uri_param);
+    js_norm.configure();
+    HttpJsNormState own_state;
+    if (state == nullptr)
+        state = &own_state;
+    HttpInfractions infractions;
+    HttpEventGen events;
+    Result r;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= cuts.size(); i++)
+    {
+        const size_t stop = (i < cuts.size()) ? cuts[i] : body.size();
+        const Field input(stop - start, (const uint8_t*)body.data() + start);
+        Field output;
+        js_norm.normalize(input, output, &infractions, &events, state, i == cuts.size());
+        CHECK(state->held_length <= HttpJsNormState::max_hold);
+        if (output.length() > 0)
+            r.out.append((const char*)output.start(), output.length());
+        start = stop;
+    }
+    CHECK(state->held_length == 0);
+    r.inf = infractions.get_raw();
+    r.events = events.get_raw();
+    return r;
+}
+
+static bool operator==(const Result& a, const Result& b)
+{ return (a.out == b.out) && (a.inf == b.inf) && (a.events == b.events); }
+
+static const std::string page =
+    "<html><body>hello <SCRIPT type=\"text/javascript\">var a = unescape(\"%48%65%6C%6C%6F\");"
+    "\ndocument.write(String.fromCharCode(72, 105));</script> bye <scr and <script>"
+    "b = unescape('%u0041%u0042');</script></body></html>";
+
+TEST_GROUP(http_js_norm) { };
+
+TEST(http_js_norm, one_section)
+{
+    const Result r = sections(page, { });
+    CHECK(r.out.find("Hello") != std::string::npos);
+    CHECK(r.out.find("Hi") != std::string::npos);
+    CHECK(r.out.find("AB") != std::string::npos);
+}
+
+// <scr|ipt> split at a section boundary is held back and rejoined
+TEST(http_js_norm, split_tag)
+{
+    const Result whole = sections(page, { });
+    const size_t tag = page.find("<SCRIPT");
+
+    for (size_t cut = tag; cut <= page.find('>', tag) + 1; cut++)
+    {
+        HttpJsNormState state;
+        CHECK(sections(page, { cut }, &state) == whole);
+    }
+
+    // the first section ends in "<scr" which is all held
+    HttpParaList::UriParam uri_param;
+    HttpJsNorm js_norm(200, uri_param);
+    js_norm.configure();
+    HttpJsNormState state;
+    HttpInfractions infractions;
+    HttpEventGen events;
+    Field output;
+    js_norm.normalize(Field(tag + 4, (const uint8_t*)page.data()), output, &infractions, &events,
+        &state, false);
+    CHECK(state.held_length == 4);
+    CHECK(memcmp(state.held, "<SCR", 4) == 0);
+    CHECK(output.length() == (int32_t)tag);
+}
+
+// every split point including those in the middle of escapes and decoded calls
+TEST(http_js_norm, split_anywhere)
+{
+    const Result whole = sections(page, { });
+
+    for (size_t cut = 0; cut <= page.size(); cut++)
+        CHECK(sections(page, { cut }) == whole);
+
+    std::vector<size_t> cuts;
+    for (size_t cut = 1; cut < page.size(); cut++)
+        cuts.push_back(cut);
+    CHECK(sections(page, cuts) == whole);
+}
+
+// a script body split mid-escape
+TEST(http_js_norm, split_escape)
+{
+    const Result whole = sections(page, { });
+    const size_t escape = page.find("%6C");
+    CHECK(sections(page, { escape + 1 }) == whole);
+    CHECK(sections(page, { escape + 2 }) == whole);
+    const size_t unicode = page.find("%u0041");
+    CHECK(sections(page, { unicode + 2, unicode + 4 }) == whole);
+}
+
+// A <script> tag is held back only while it fits in max_hold
+TEST(http_js_norm, hold_limit)
+{
+    HttpParaList::UriParam uri_param;
+    HttpJsNorm js_norm(200, uri_param);
+    js_norm.configure();
+    HttpInfractions infractions;
+    HttpEventGen events;
+
+    for (size_t pad : { HttpJsNormState::max_hold - 20, HttpJsNormState::max_hold + 20 })
+    {
+        const std::string body = "hi <script" + std::string(pad, 'x') + ">a = unescape('%41');"
+            "</script>";
+        const size_t cut = body.find('>');
+        const size_t tail = cut - body.find("<script");
+
+        HttpJsNormState state;
+        Field output;
+        js_norm.normalize(Field(cut, (const uint8_t*)body.data()), output, &infractions, &events,
+            &state, false);
+
+        if (tail <= HttpJsNormState::max_hold)
+        {
+            CHECK(state.held_length == tail);
+            CHECK(sections(body, { cut }) == sections(body, { }));
+        }
+        else
+        {
+            // more than max_hold octets of tag are passed along as they are
+            CHECK(state.held_length == 0);
+            CHECK(output.length() == (int32_t)cut);
+            CHECK(memcmp(output.start(), body.data(), cut) == 0);
+        }
+    }
+}
+
+// The last section releases whatever is held
+TEST(http_js_norm, last_releases)
+{
+    for (const std::string& body : { std::string("text <scr"), std::string("text <script a=b"),
+        std::string("<script>a = unescape('%41%4") })
+    {
+        const Result whole = sections(body, { });
+        CHECK(whole.out.size() > 0);
+        for (size_t cut = 0; cut <= body.size(); cut++)
+            CHECK(sections(body, { cut }) == whole);
+
+        // the final section may be empty
+        CHECK(sections(body, { body.size() }) == whole);
+    }
+    CHECK(sections("text <scr", { }).out == "text <scr");
+}
+
+// A script that runs through many full size sections comes out the same however it is divided
+TEST(http_js_norm, long_script)
+{
+    std::string body = "<script>";
+    while (body.size() < 150000)
+        body += "a = unescape('%41%42'); b = 'cd';\n";
+    body += "</script>";
+
+    const Result r = sections(body, { 30000, 60000, 90000, 120000 });
+    CHECK(r.out.find("a = unescape") == std::string::npos);
+    CHECK(r.out.find("AB") != std::string::npos);
+    CHECK(sections(body, { HttpEnums::MAX_OCTETS, 2 * HttpEnums::MAX_OCTETS }) == r);
+    CHECK(sections(body, { 12345, 12345 + HttpEnums::MAX_OCTETS, 12345 + 2 * HttpEnums::MAX_OCTETS })
+        == r);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,309 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// http_scan_test.cc
+
+// differential tests of each scan kernel against a byte loop and header and URI benchmarks
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "service_inspectors/http_inspect/http_scan.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace HttpScan;
+
+static int32_t ref_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    int32_t k = 0;
+    for (; k < length && buffer[k] != '\r' && buffer[k] != '\n'; k++);
+    return k;
+}
+
+static int32_t ref_sp_tab_cr_lf(const uint8_t* buffer, int32_t length)
+{
+    int32_t k = 0;
+    for (; k < length && buffer[k] != ' ' && buffer[k] != '\t' && buffer[k] != '\r' &&
+        buffer[k] != '\n'; k++);
+    return k;
+}
+
+TEST_GROUP(http_scan)
+{
+    Isa best = ISA_SCALAR;
+
+    void setup() override
+    {
+        init();
+        best = isa;
+    }
+
+    void teardown() override
+    {
+        isa = best;
+    }
+};
+
+TEST(http_scan, empty)
+{
+    for (int i = ISA_SCALAR; i <= best; i++)
+    {
+        isa = (Isa)i;
+        CHECK(find_cr_lf((const uint8_t*)"", 0) == 0);
+        CHECK(find_sp_tab_cr_lf((const uint8_t*)"", 0) == 0);
+    }
+}
+
+TEST(http_scan, examples)
+{
+    const std::string s = "Host: www.example.com\r\nUser-Agent: test\tagent\n";
+    const uint8_t* const p = (const uint8_t*)s.c_str();
+    const int32_t n = s.size();
+
+    for (int i = ISA_SCALAR; i <= best; i++)
+    {
+        isa = (Isa)i;
+        CHECK(find_cr_lf(p, n) == 21);
+        CHECK(find_cr_lf(p + 23, n - 23) == 22);
+        CHECK(find_sp_tab_cr_lf(p, n) == 5);
+        CHECK(find_sp_tab_cr_lf(p + 6, n - 6) == 15);
+        CHECK(find_sp_tab_cr_lf(p + 35, n - 35) == 4);
+        CHECK(find_cr_lf(p, 21) == 21);
+    }
+}
+
+// every position and length, with and without a delimiter, so each kernel sees a match in its
+// vector body, at each lane, and in its tail
+TEST(http_scan, positions)
+{
+    const uint8_t delims[] = { '\r', '\n', ' ', '\t' };
+    std::vector<uint8_t> buf(100);
+
+    for (int32_t len = 0; len <= 100; len++)
+    {
+        for (int32_t pos = -1; pos < len; pos++)
+        {
+            for (uint8_t d : delims)
+            {
+                std::fill(buf.begin(), buf.end(), 'a');
+                if (pos >= 0)
+                    buf[pos] = d;
+
+                const int32_t a = ref_cr_lf(buf.data(), len);
+                const int32_t b = ref_sp_tab_cr_lf(buf.data(), len);
+
+                for (int i = ISA_SCALAR; i <= best; i++)
+                {
+                    isa = (Isa)i;
+                    CHECK(find_cr_lf(buf.data(), len) == a);
+                    CHECK(find_sp_tab_cr_lf(buf.data(), len) == b);
+                }
+            }
+        }
+    }
+}
+
+// random header-like text including high bit octets and near misses such as VT and FF
+TEST(http_scan, differential)
+{
+    const uint8_t alphabet[] = { 'a', 'Z', ':', ' ', '\t', '\r', '\n', 0x0b, 0x0c, 0x00, 0x80,
+        0x8d, 0x8a, 0xa0, 0xff };
+    std::mt19937 rng(20190101);
+    std::vector<uint8_t> buf(512);
+
+    for (unsigned iter = 0; iter < 20000; iter++)
+    {
+        const int32_t len = rng() % buf.size();
+        // mostly filler so matches land far into the buffer
+        const unsigned density = 1 + rng() % 64;
+
+        for (int32_t k = 0; k < len; k++)
+            buf[k] = (rng() % density) ? 'x' : alphabet[rng() % sizeof(alphabet)];
+
+        const int32_t off = len ? rng() % (len + 1) : 0;
+        const int32_t a = ref_cr_lf(buf.data() + off, len - off);
+        const int32_t b = ref_sp_tab_cr_lf(buf.data() + off, len - off);
+
+        for (int i = ISA_SCALAR; i <= best; i++)
+        {
+            isa = (Isa)i;
+            CHECK(find_cr_lf(buf.data() + off, len - off) == a);
+            CHECK(find_sp_tab_cr_lf(buf.data() + off, len - off) == b);
+        }
+    }
+}
+
+// random sets, including ones with members on both sides of 0x80, against a byte loop
+TEST(http_scan, byte_set)
+{
+    std::mt19937 rng(20190102);
+    std::vector<uint8_t> buf(300);
+
+    for (unsigned iter = 0; iter < 2000; iter++)
+    {
+        ByteSet bs;
+        bool member[256] = { };
+        const unsigned num = rng() % 12;
+
+        for (unsigned i = 0; i < num; i++)
+        {
+            const uint8_t c = rng();
+            bs.set(c);
+            member[c] = true;
+        }
+        for (unsigned c = 0; c < 256; c++)
+            CHECK(bs.test(c) == member[c]);
+
+        const int32_t len = rng() % buf.size();
+        for (int32_t k = 0; k < len; k++)
+            buf[k] = rng();
+
+        int32_t expected = 0;
+        for (; expected < len && !member[buf[expected]]; expected++);
+
+        for (int i = ISA_SCALAR; i <= best; i++)
+        {
+            isa = (Isa)i;
+            CHECK(find_in_set(bs, buf.data(), len) == expected);
+        }
+    }
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// MB/s splitting a header block with long cookie and user agent fields into
+// lines and then into white space separated runs
+//--------------------------------------------------------------------------
+
+static std::string make_headers()
+{
+    std::string s = "Host: www.example.com\r\n";
+    s += "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/72.0.3626.121 Safari/537.36\r\n";
+    s += "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n";
+    s += "Cookie: ";
+    for (unsigned i = 0; i < 64; i++)
+        s += "session_token_" + std::to_string(i) + "=0123456789abcdef0123456789abcdef; ";
+    s += "\r\n";
+    for (unsigned i = 0; i < 32; i++)
+        s += "X-Custom-Header-" + std::to_string(i) + ": " + std::string(200, 'v') + "\r\n";
+    return s;
+}
+
+static double run(const std::string& s, unsigned num, unsigned& lines, unsigned& runs)
+{
+    const uint8_t* const p = (const uint8_t*)s.data();
+    const int32_t n = s.size();
+    auto start = std::chrono::steady_clock::now();
+
+    lines = runs = 0;
+    for (unsigned i = 0; i < num; i++)
+    {
+        for (int32_t k = 0; k < n; k++)
+        {
+            const int32_t end = k + find_cr_lf(p + k, n - k);
+            lines++;
+            for (int32_t j = k; j < end; j++)
+            {
+                j += find_sp_tab_cr_lf(p + j, end - j);
+                runs++;
+            }
+            k = end + 1;
+        }
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return (double)n * num / secs.count() / 1e6;
+}
+
+TEST(http_scan, benchmark)
+{
+    const std::string s = make_headers();
+    const unsigned num = 20000;
+    unsigned lines0 = 0, runs0 = 0;
+    double base = 0;
+
+    printf("\n%zu octet header block\n%8s %10s %8s\n", s.size(), "kernel", "MB/s", "speedup");
+
+    for (int i = ISA_SCALAR; i <= best; i++)
+    {
+        unsigned lines, runs;
+        isa = (Isa)i;
+        double mbs = run(s, num, lines, runs);
+
+        if (i == ISA_SCALAR)
+        {
+            base = mbs;
+            lines0 = lines;
+            runs0 = runs;
+        }
+        printf("%8s %10.0f %8.2f\n", get_isa_name(isa), mbs, mbs / base);
+        CHECK(lines == lines0);
+        CHECK(runs == runs0);
+    }
+}
+
+// MB/s checking a long URI with nothing to normalize against the default percent, substitution,
+// and path characters
+TEST(http_scan, benchmark_uri)
+{
+    std::string s = "/";
+    while (s.size() < 2000)
+        s += "static/assets/images/thumbnails/a1b2c3d4e5f6-";
+    const uint8_t* const p = (const uint8_t*)s.data();
+    const int32_t n = s.size();
+    const unsigned num = 100000;
+
+    ByteSet bs;
+    for (uint8_t c : { '%', '+' })
+        bs.set(c);
+
+    printf("\n%d octet URI\n%8s %10s %8s\n", n, "kernel", "MB/s", "speedup");
+    double base = 0;
+
+    for (int i = ISA_SCALAR; i <= best; i++)
+    {
+        isa = (Isa)i;
+        int32_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned j = 0; j < num; j++)
+            found += find_in_set(bs, p, n);
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        const double mbs = (double)n * num / secs.count() / 1e6;
+        if (i == ISA_SCALAR)
+            base = mbs;
+        printf("%8s %10.0f %8.2f\n", get_isa_name(isa), mbs, mbs / base);
+        CHECK(found == (int32_t)(n * num));
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
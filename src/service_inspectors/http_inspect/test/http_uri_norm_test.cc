@@ -25,7 +25,15 @@
 
 #include "log/messages.h"
 #include "service_inspectors/http_inspect/http_js_norm.h"
+#include "service_inspectors/http_inspect/http_scan.h"
+
+// the reference normalizer below uses the helpers that are not in the fast path
+#define private public
 #include "service_inspectors/http_inspect/http_uri_norm.h"
+#undef private
+
+#include <random>
+#include <vector>
 
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
@@ -149,6 +157,378 @@ TEST(http_double_decode_test, u_encode_all)
     CHECK(memcmp(result.start(), "/uri/to/normalize", 17) == 0);
 }
 
+// Every kernel, including the byte loop, must give the same result as the original one octet at a
+// time implementation kept here as a reference. Random URIs are built from octets that matter to
+// normalization so that escapes, UTF-8 sequences, and path characters are common and overlap
+// vector boundaries.
+
+using namespace HttpEnums;
+
+class RefUriNormalizer : public UriNormalizer
+{
+public:
+    static bool need_norm(const Field& uri_component, bool do_path,
+        const HttpParaList::UriParam& uri_param, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        bool need_it;
+        if (do_path && uri_param.simplify_path)
+            need_it = need_norm_path(uri_component, uri_param);
+        else
+            need_it = need_norm_no_path(uri_component, uri_param);
+
+        if (!need_it)
+            detect_bad_char(uri_component, uri_param, infractions, events);
+
+        return need_it;
+    }
+
+    static void normalize(const Field& input, Field& result, bool do_path, uint8_t* buffer,
+        const HttpParaList::UriParam& uri_param, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        int32_t data_length = norm_char_clean(input, buffer, uri_param, infractions, events);
+
+        detect_bad_char(Field(data_length, buffer), uri_param, infractions, events);
+
+        norm_substitute(buffer, data_length, uri_param, infractions, events);
+
+        if (do_path && uri_param.simplify_path)
+            data_length = norm_path_clean(buffer, data_length, infractions, events);
+
+        result.set(data_length, buffer);
+    }
+
+private:
+    static bool need_norm_no_path(const Field& uri_component,
+        const HttpParaList::UriParam& uri_param)
+    {
+        for (int32_t k = 0; k < uri_component.length(); k++)
+        {
+            if ((uri_param.uri_char[uri_component.start()[k]] == CHAR_PERCENT) ||
+                (uri_param.uri_char[uri_component.start()[k]] == CHAR_SUBSTIT))
+                return true;
+        }
+        return false;
+    }
+
+    static bool need_norm_path(const Field& uri_component,
+        const HttpParaList::UriParam& uri_param)
+    {
+        const int32_t length = uri_component.length();
+        const uint8_t* const buf = uri_component.start();
+        for (int32_t k = 0; k < length; k++)
+        {
+            switch (uri_param.uri_char[buf[k]])
+            {
+            case CHAR_NORMAL:
+            case CHAR_EIGHTBIT:
+                continue;
+            case CHAR_PERCENT:
+            case CHAR_SUBSTIT:
+                return true;
+            case CHAR_PATH:
+                if (buf[k] == '/')
+                {
+                    if ((k == 0) || (buf[k-1] != '/'))
+                        continue;
+                    return true;
+                }
+                else
+                {
+                    if (((k == 0) || (uri_param.uri_char[buf[k-1]] != CHAR_PATH)) &&
+                        ((k == length-1) || (uri_param.uri_char[buf[k+1]] != CHAR_PATH)))
+                        continue;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    static int32_t norm_char_clean(const Field& input, uint8_t* out_buf,
+        const HttpParaList::UriParam& uri_param, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        bool utf8_needed = false;
+        bool double_decoding_needed = false;
+        std::vector<bool> percent_encoded(input.length(), false);
+        int32_t length = norm_percent_processing(input, out_buf, uri_param, utf8_needed,
+            percent_encoded, double_decoding_needed, infractions, events);
+        if (uri_param.utf8 && utf8_needed)
+        {
+            length = norm_utf8_processing(Field(length, out_buf), out_buf, uri_param,
+                percent_encoded, double_decoding_needed, infractions, events);
+        }
+        if (uri_param.iis_double_decode && double_decoding_needed)
+        {
+            length = norm_double_decode(Field(length, out_buf), out_buf, uri_param, infractions,
+                events);
+        }
+        return length;
+    }
+
+    static int32_t norm_percent_processing(const Field& input, uint8_t* out_buf,
+        const HttpParaList::UriParam& uri_param, bool& utf8_needed,
+        std::vector<bool>& percent_encoded, bool& double_decoding_needed,
+        HttpInfractions* infractions, HttpEventGen* events)
+    {
+        int32_t length = 0;
+        for (int32_t k = 0; k < input.length(); k++)
+        {
+            switch (uri_param.uri_char[input.start()[k]])
+            {
+            case CHAR_EIGHTBIT:
+                if (uri_param.utf8_bare_byte &&
+                   (((input.start()[k] & 0xE0) == 0xC0) || ((input.start()[k] & 0xF0) == 0xE0)))
+                    utf8_needed = true;
+                // Fall through
+            case CHAR_NORMAL:
+            case CHAR_PATH:
+            case CHAR_SUBSTIT:
+                out_buf[length++] = input.start()[k];
+                break;
+            case CHAR_PERCENT:
+                if (is_percent_encoding(input, k))
+                {
+                    const uint8_t hex_val = extract_percent_encoding(input, k);
+                    percent_encoded[length] = true;
+                    if (((hex_val & 0xE0) == 0xC0) || ((hex_val & 0xF0) == 0xE0))
+                        utf8_needed = true;
+                    if (hex_val == '%')
+                        double_decoding_needed = true;
+                    out_buf[length++] = hex_val;
+                    k += 2;
+                }
+                else if ((k+1 < input.length()) && (input.start()[k+1] == '%'))
+                {
+                    double_decoding_needed = true;
+                    out_buf[length++] = '%';
+                    k += 1;
+                }
+                else if (uri_param.percent_u && is_u_encoding(input, k))
+                {
+                    *infractions += INF_URI_U_ENCODE;
+                    events->create_event(EVENT_U_ENCODE);
+                    percent_encoded[length] = true;
+                    const uint8_t byte_val = reduce_to_eight_bits(extract_u_encoding(input, k),
+                        uri_param, infractions, events);
+                    if (((byte_val & 0xE0) == 0xC0) || ((byte_val & 0xF0) == 0xE0))
+                        utf8_needed = true;
+                    if (byte_val == '%')
+                        double_decoding_needed = true;
+                    out_buf[length++] = byte_val;
+                    k += 5;
+                }
+                else
+                {
+                    *infractions += INF_URI_UNKNOWN_PERCENT;
+                    events->create_event(EVENT_UNKNOWN_PERCENT);
+                    double_decoding_needed = true;
+                    out_buf[length++] = '%';
+                }
+
+                if (uri_param.unreserved_char[out_buf[length-1]])
+                {
+                    *infractions += INF_URI_PERCENT_UNRESERVED;
+                    events->create_event(EVENT_ASCII);
+                }
+                break;
+            }
+        }
+        return length;
+    }
+
+    static int32_t norm_double_decode(const Field& input, uint8_t* out_buf,
+        const HttpParaList::UriParam& uri_param, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        int32_t length = 0;
+        for (int32_t k = 0; k < input.length(); k++)
+        {
+            if (input.start()[k] != '%')
+                out_buf[length++] = input.start()[k];
+            else
+            {
+                if (is_percent_encoding(input, k))
+                {
+                    *infractions += INF_URI_DOUBLE_DECODE;
+                    events->create_event(EVENT_DOUBLE_DECODE);
+                    out_buf[length++] = extract_percent_encoding(input, k);
+                    k += 2;
+                }
+                else if (uri_param.percent_u && is_u_encoding(input, k))
+                {
+                    *infractions += INF_URI_DOUBLE_DECODE;
+                    events->create_event(EVENT_DOUBLE_DECODE);
+                    *infractions += INF_URI_U_ENCODE;
+                    events->create_event(EVENT_U_ENCODE);
+                    out_buf[length++] = reduce_to_eight_bits(extract_u_encoding(input, k),
+                        uri_param, infractions, events);
+                    k += 5;
+                }
+                else
+                {
+                    out_buf[length++] = '%';
+                }
+            }
+        }
+        return length;
+    }
+
+    static void detect_bad_char(const Field& uri_component,
+        const HttpParaList::UriParam& uri_param, HttpInfractions* infractions,
+        HttpEventGen* events)
+    {
+        if (uri_param.bad_characters.count() == 0)
+            return;
+
+        for (int32_t k = 0; k < uri_component.length(); k++)
+        {
+            if (uri_param.bad_characters[uri_component.start()[k]])
+            {
+                *infractions += INF_URI_BAD_CHAR;
+                events->create_event(EVENT_NON_RFC_CHAR);
+                return;
+            }
+        }
+    }
+};
+
+class RecordingEventGen : public HttpEventGen
+{
+public:
+    void create_event(int sid) override
+    {
+        HttpEventGen::create_event(sid);
+        sids.push_back(sid);
+    }
+    std::vector<int> sids;
+};
+
+struct NormResult
+{
+    bool need;
+    std::vector<uint8_t> out;
+    std::vector<int> sids;
+    uint64_t inf[2];
+
+    bool operator==(const NormResult& rhs) const
+    {
+        return (need == rhs.need) && (out == rhs.out) && (sids == rhs.sids) &&
+            (inf[0] == rhs.inf[0]) && (inf[1] == rhs.inf[1]);
+    }
+};
+
+template<typename Normalizer>
+static NormResult run_norm(const std::vector<uint8_t>& uri, bool do_path,
+    const HttpParaList::UriParam& uri_param)
+{
+    NormResult r;
+    HttpInfractions infractions;
+    RecordingEventGen events;
+    Field input(uri.size(), uri.data());
+    r.need = Normalizer::need_norm(input, do_path, uri_param, &infractions, &events);
+    if (r.need)
+    {
+        std::vector<uint8_t> buffer(uri.size() + UriNormalizer::URI_NORM_EXPANSION);
+        Field result;
+        Normalizer::normalize(input, result, do_path, buffer.data(), uri_param, &infractions,
+            &events);
+        r.out.assign(result.start(), result.start() + result.length());
+    }
+    r.sids = events.sids;
+    r.inf[0] = infractions.get_raw();
+    r.inf[1] = infractions.get_raw2();
+    return r;
+}
+
+TEST_GROUP(http_uri_norm_differential)
+{
+    HttpScan::Isa best = HttpScan::ISA_SCALAR;
+
+    void setup() override
+    {
+        HttpScan::init();
+        best = HttpScan::isa;
+    }
+
+    void teardown() override
+    {
+        HttpScan::isa = best;
+    }
+
+    void check(const HttpParaList::UriParam& uri_param, unsigned seed)
+    {
+        static const uint8_t alphabet[] = { 'a', 'Z', '0', '5', 'c', 'E', 'f', 'u', 'U', '%', '%',
+            '/', '/', '.', '.', '\\', '+', '~', ' ', 0x00, 0x7f, 0x80, 0xa5, 0xbf, 0xc0, 0xc3,
+            0xdf, 0xe0, 0xef, 0xf0, 0xff };
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> uri;
+
+        for (unsigned iter = 0; iter < 5000; iter++)
+        {
+            const unsigned len = 1 + rng() % 200;
+            const unsigned density = 1 + rng() % 32;
+            uri.assign(1, '/');
+            while (uri.size() < len)
+            {
+                if (rng() % density)
+                    uri.push_back('a' + rng() % 26);
+                else
+                    uri.push_back(alphabet[rng() % sizeof(alphabet)]);
+            }
+
+            for (bool do_path : { true, false })
+            {
+                const NormResult expected = run_norm<RefUriNormalizer>(uri, do_path, uri_param);
+
+                for (int i = HttpScan::ISA_SCALAR; i <= best; i++)
+                {
+                    HttpScan::isa = (HttpScan::Isa)i;
+                    CHECK(run_norm<UriNormalizer>(uri, do_path, uri_param) == expected);
+                }
+            }
+        }
+    }
+};
+
+TEST(http_uri_norm_differential, defaults)
+{
+    HttpParaList::UriParam uri_param;
+    check(uri_param, 1);
+}
+
+TEST(http_uri_norm_differential, everything)
+{
+    HttpParaList::UriParam uri_param;
+    uri_param.percent_u = true;
+    uri_param.utf8_bare_byte = true;
+    uri_param.iis_double_decode = true;
+    uri_param.iis_unicode = true;
+    uri_param.unicode_map = new uint8_t[65536];
+    UriNormalizer::load_default_unicode_map(uri_param.unicode_map);
+    uri_param.backslash_to_slash = true;
+    uri_param.uri_char[(uint8_t)'\\'] = HttpEnums::CHAR_SUBSTIT;
+    uri_param.bad_characters[0x00] = true;
+    uri_param.bad_characters[0xff] = true;
+    uri_param.build_char_sets();
+    check(uri_param, 2);
+}
+
+TEST(http_uri_norm_differential, no_path_no_plus)
+{
+    HttpParaList::UriParam uri_param;
+    uri_param.simplify_path = false;
+    uri_param.plus_to_space = false;
+    uri_param.uri_char[(uint8_t)'+'] = HttpEnums::CHAR_NORMAL;
+    uri_param.uri_char[(uint8_t)'/'] = HttpEnums::CHAR_NORMAL;
+    uri_param.uri_char[(uint8_t)'.'] = HttpEnums::CHAR_NORMAL;
+    uri_param.utf8 = false;
+    uri_param.build_char_sets();
+    check(uri_param, 3);
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
@@ -248,7 +248,7 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                     if (RpcPrepRaw(data, rsdata->frag_len, p) != RPC_STATUS__SUCCESS)
                         return RPC_STATUS__ERROR;
 
-                    DataBus::publish(PACKET_EVENT, p);
+                    DataBus::publish(PACKET_EVENT_ID, p);
                 }
 
                 if ( (dsize > 0) )
@@ -319,7 +319,7 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                 if ( (dsize > 0) )
                     RpcPreprocEvent(rconfig, rsdata, RPC_MULTIPLE_RECORD);
 
-                DataBus::publish(PACKET_EVENT, p);
+                DataBus::publish(PACKET_EVENT_ID, p);
                 RpcBufClean(&rsdata->frag);
             }
 
@@ -39,6 +39,8 @@
 
 using namespace snort;
 
+static const DataEventId sip_dialog_event = DataBus::get_id(SIP_EVENT_TYPE_SIP_DIALOG_KEY);
+
 static void SIP_updateMedias(SIP_MediaSession*, SIP_MediaList*);
 static int SIP_compareMedias(SIP_MediaDataList, SIP_MediaDataList);
 static bool SIP_checkMediaChange(SIPMsg* sipMsg, SIP_DialogData* dialog);
@@ -587,7 +589,7 @@ static void sip_publish_data_bus(
     const Packet* p, const SIPMsg* sip_msg, const SIP_DialogData* dialog)
 {
     SipEvent event(p, sip_msg, dialog);
-    DataBus::publish(SIP_EVENT_TYPE_SIP_DIALOG_KEY, event, p->flow);
+    DataBus::publish(sip_dialog_event, event, p->flow);
 }
 
 /********************************************************************
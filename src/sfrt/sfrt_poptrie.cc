@@ -0,0 +1,711 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sfrt_poptrie.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sfrt.h"  // FIXIT-L these includes are circular
+#include "sfrt_poptrie.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define USE_POPTRIE_POPCNT
+#endif
+
+#define TOP_BITS 16
+#define TOP_SIZE (1u << TOP_BITS)
+#define NODE_BITS 6
+#define NODE_FLAG 0x80000000
+#define NO_LEAF 0x7fffffff
+
+// rebuild the whole trie rather than this many direct table slots
+#define MAX_SLOT_REBUILD 4096
+
+// don't bother compacting until this much is wasted
+#define MIN_GARBAGE (64 * 1024)
+
+namespace
+{
+// addresses in host order, left aligned so IPv4 and IPv6 walk alike
+struct Key
+{
+    uint64_t hi;
+    uint64_t lo;
+};
+
+struct Prefix
+{
+    Key addr;
+    uint8_t len;
+
+    bool operator<(const Prefix& rhs) const
+    {
+        if ( addr.hi != rhs.addr.hi )
+            return addr.hi < rhs.addr.hi;
+
+        if ( addr.lo != rhs.addr.lo )
+            return addr.lo < rhs.addr.lo;
+
+        return len < rhs.len;
+    }
+};
+
+// what the DIR tables would hold for every address under a prefix: the
+// data index and the length of the prefix that set it, or 0 and 0 where a
+// remove cleared it
+struct Route
+{
+    uint32_t index;
+    uint8_t len;
+
+    bool operator==(const Route& rhs) const
+    { return index == rhs.index and len == rhs.len; }
+};
+
+typedef std::map<Prefix, Route> PrefixMap;
+typedef PrefixMap::const_iterator PrefixIter;
+
+struct Node
+{
+    uint64_t vector;   // children that are nodes
+    uint64_t leafvec;  // leaf children that differ from the previous leaf
+    uint32_t base0;    // first leaf
+    uint32_t base1;    // first child node
+};
+
+#define LEAF_SIZE (sizeof(uint32_t) + sizeof(uint8_t))
+#define PREFIX_SIZE (sizeof(PrefixMap::value_type) + 4 * sizeof(void*))
+
+// n bits of k starting off bits from the top; bits past the end read as 0
+inline unsigned get_bits(const Key& k, unsigned off, unsigned n)
+{
+    const uint64_t mask = (1ull << n) - 1;
+    unsigned end = off + n;
+
+    if ( end <= 64 )
+        return (k.hi >> (64 - end)) & mask;
+
+    if ( off >= 64 )
+    {
+        end -= 64;
+        return (end <= 64 ? k.lo >> (64 - end) : k.lo << (end - 64)) & mask;
+    }
+    end -= 64;
+    return ((k.hi << end) | (k.lo >> (64 - end))) & mask;
+}
+
+inline Key mask_key(const Key& k, unsigned len)
+{
+    if ( !len )
+        return { 0, 0 };
+
+    if ( len <= 64 )
+        return { k.hi & (~0ull << (64 - len)), 0 };
+
+    return { k.hi, k.lo & (~0ull << (128 - len)) };
+}
+
+// first address past the prefix; false if it runs off the end
+inline bool next_key(const Key& k, unsigned len, Key& next)
+{
+    if ( !len )
+        return false;
+
+    if ( len <= 64 )
+    {
+        next = { k.hi + (1ull << (64 - len)), 0 };
+        return next.hi != 0;
+    }
+    next.lo = k.lo + (1ull << (128 - len));
+    next.hi = k.hi + (next.lo == 0 ? 1 : 0);
+    return next.hi or next.lo;
+}
+
+inline unsigned get_slot(const Key& k)
+{ return k.hi >> (64 - TOP_BITS); }
+
+inline Key get_key(const uint32_t* addr, int numAddrDwords)
+{
+    if ( numAddrDwords == 1 )
+        return { (uint64_t)ntohl(addr[0]) << 32, 0 };
+
+    return { ((uint64_t)ntohl(addr[0]) << 32) | ntohl(addr[1]),
+        ((uint64_t)ntohl(addr[2]) << 32) | ntohl(addr[3]) };
+}
+
+inline unsigned popcount(uint64_t u)
+{ return __builtin_popcountll(u); }
+
+inline bool contains(const Prefix& outer, const Prefix& inner)
+{
+    if ( outer.len > inner.len )
+        return false;
+
+    Key k = mask_key(inner.addr, outer.len);
+    return k.hi == outer.addr.hi and k.lo == outer.addr.lo;
+}
+
+class Poptrie
+{
+public:
+    Poptrie(uint32_t cap, unsigned w);
+
+    int insert(const Key&, unsigned len, word index, int behavior);
+    word remove(const Key&, unsigned len, int behavior);
+
+    inline tuple_t find(const Key&) const __attribute__((always_inline));
+
+    size_t usage() const;
+    void print() const;
+
+private:
+    // the prefix and everything under it
+    PrefixMap::iterator range_begin(const Prefix& p)
+    { return prefixes.lower_bound(p); }
+
+    PrefixMap::iterator range_end(const Prefix& p)
+    {
+        Key end;
+        return next_key(p.addr, p.len, end) ? prefixes.lower_bound({ end, 0 }) : prefixes.end();
+    }
+
+    void set_route(const Prefix& p, const Route& r)
+    {
+        auto res = prefixes.insert({ p, r });
+
+        if ( res.second )
+            ++counts[p.len];
+        else
+            res.first->second = r;
+    }
+
+    PrefixMap::iterator erase(PrefixMap::iterator it)
+    {
+        --counts[it->first.len];
+        return prefixes.erase(it);
+    }
+
+    void erase(PrefixMap::iterator first, PrefixMap::iterator last)
+    {
+        while ( first != last )
+            first = erase(first);
+    }
+
+    Route find_cover(const Key&, int max_len) const;
+    void prune(const Prefix&);
+
+    void update(const Prefix&);
+    void rebuild();
+    void build_slot(unsigned slot);
+    void set_slot(unsigned slot, PrefixIter first, PrefixIter last, const Route&);
+    void fill_node(uint32_t at, PrefixIter first, PrefixIter last, unsigned off, const Route&);
+    void discard(uint32_t node);
+
+    uint32_t add_leaf(const Route& r)
+    {
+        leaves.push_back(r.index);
+        lengths.push_back(r.len);
+        return leaves.size() - 1;
+    }
+
+private:
+    unsigned width;
+    size_t mem_cap;
+
+    PrefixMap prefixes;
+    unsigned counts[129] = { };  // prefixes of each length
+
+    std::vector<uint32_t> top;   // NODE_FLAG | node, else leaf
+    std::vector<Node> nodes;
+    std::vector<uint32_t> leaves;
+    std::vector<uint8_t> lengths;
+
+    size_t dead_nodes = 0;
+    size_t dead_leaves = 0;
+};
+
+Poptrie::Poptrie(uint32_t cap, unsigned w)
+{
+    width = w;
+    mem_cap = cap;
+    rebuild();
+}
+
+tuple_t Poptrie::find(const Key& k) const
+{
+    uint32_t t = top[get_slot(k)];
+    unsigned off = TOP_BITS;
+
+    while ( t & NODE_FLAG )
+    {
+        const Node& n = nodes[t & ~NODE_FLAG];
+        unsigned v = get_bits(k, off, NODE_BITS);
+        uint64_t below = (2ull << v) - 1;
+
+        if ( !(n.vector & (1ull << v)) )
+        {
+            t = n.base0 + popcount(n.leafvec & below) - 1;
+            break;
+        }
+        t = NODE_FLAG | (n.base1 + popcount(n.vector & below) - 1);
+        off += NODE_BITS;
+    }
+    return { leaves[t], lengths[t] };
+}
+
+// the route of the longest prefix of max_len or less covering k
+Route Poptrie::find_cover(const Key& k, int max_len) const
+{
+    for ( int l = max_len; l >= 0; --l )
+    {
+        if ( !counts[l] )
+            continue;
+
+        auto it = prefixes.find({ mask_key(k, l), (uint8_t)l });
+
+        if ( it != prefixes.end() )
+            return it->second;
+    }
+    return { 0, 0 };
+}
+
+// drop prefixes under p that route the same as the prefix above them; the
+// map is in address order so each prefix follows those that contain it
+void Poptrie::prune(const Prefix& p)
+{
+    std::vector<std::pair<Prefix, Route>> stack;
+    auto end = range_end(p);
+
+    // what is routed from above p was set by a prefix shorter than p
+    Route outer = { 0, 0 };
+    bool have_outer = false;
+
+    for ( auto it = range_begin(p); it != end; )
+    {
+        while ( !stack.empty() and !contains(stack.back().first, it->first) )
+            stack.pop_back();
+
+        bool same;
+
+        if ( !stack.empty() )
+            same = it->second == stack.back().second;
+
+        else if ( p.len and it->second.len >= p.len )
+            same = false;
+
+        else
+        {
+            if ( !have_outer )
+            {
+                outer = find_cover(p.addr, (int)p.len - 1);
+                have_outer = true;
+            }
+            same = it->second == outer;
+        }
+
+        if ( same )
+            it = erase(it);
+        else
+        {
+            stack.emplace_back(*it);
+            ++it;
+        }
+    }
+}
+
+// this follows the DIR tables: favoring time overwrites everything under the
+// new prefix; favoring the most specific only overwrites what was set by a
+// prefix no longer than the new one, including what removes cleared
+int Poptrie::insert(const Key& k, unsigned len, word index, int behavior)
+{
+    if ( len > width or index > 0xffffffff )
+        return RT_INSERT_FAILURE;
+
+    if ( usage() >= mem_cap )
+        return MEM_ALLOC_FAILURE;
+
+    Prefix p = { mask_key(k, len), (uint8_t)len };
+    Route r = { (uint32_t)index, (uint8_t)len };
+
+    if ( behavior == RT_FAVOR_TIME )
+        erase(range_begin(p), range_end(p));
+    else
+    {
+        auto end = range_end(p);
+
+        for ( auto it = range_begin(p); it != end; ++it )
+        {
+            if ( it->second.len <= len )
+                it->second = r;
+        }
+    }
+    set_route(p, r);
+
+    prune(p);
+    update(p);
+    return RT_SUCCESS;
+}
+
+// favoring time clears everything under the prefix; favoring the most
+// specific only clears what the prefix itself set.  as with the DIR tables,
+// what was cleared doesn't fall back to a shorter prefix.
+word Poptrie::remove(const Key& k, unsigned len, int behavior)
+{
+    if ( len > width )
+        return 0;
+
+    Prefix p = { mask_key(k, len), (uint8_t)len };
+    auto first = range_begin(p);
+    auto last = range_end(p);
+    word index = 0;
+
+    // DIR has no tables to clear under a prefix that was never inserted
+    if ( first == last )
+        return 0;
+
+    for ( auto it = first; it != last; ++it )
+    {
+        if ( it->second.len == len )
+        {
+            index = it->second.index;
+
+            if ( behavior != RT_FAVOR_TIME )
+                it->second = { 0, 0 };
+        }
+    }
+
+    if ( behavior == RT_FAVOR_TIME )
+    {
+        erase(first, last);
+        set_route(p, { 0, 0 });
+    }
+    else if ( !index )
+        return 0;
+
+    prune(p);
+    update(p);
+    return index;
+}
+
+void Poptrie::update(const Prefix& p)
+{
+    unsigned slot = get_slot(p.addr);
+
+    if ( p.len >= TOP_BITS )
+        build_slot(slot);
+
+    else if ( (1u << (TOP_BITS - p.len)) > MAX_SLOT_REBUILD )
+    {
+        rebuild();
+        return;
+    }
+    else
+    {
+        for ( unsigned n = 1u << (TOP_BITS - p.len); n; --n )
+            build_slot(slot++);
+    }
+
+    size_t dead = dead_nodes * sizeof(Node) + dead_leaves * LEAF_SIZE;
+    size_t live = nodes.size() * sizeof(Node) + leaves.size() * LEAF_SIZE - dead;
+
+    if ( dead > MIN_GARBAGE and dead > live )
+        rebuild();
+}
+
+void Poptrie::rebuild()
+{
+    // paint the direct table, shortest prefixes first
+    std::vector<Route> routes(TOP_SIZE, { 0, 0 });
+    std::vector<PrefixIter> shorts;
+
+    for ( auto it = prefixes.cbegin(); it != prefixes.cend(); ++it )
+    {
+        if ( it->first.len <= TOP_BITS )
+            shorts.push_back(it);
+    }
+    std::stable_sort(shorts.begin(), shorts.end(),
+        [](const PrefixIter& a, const PrefixIter& b)
+        { return a->first.len < b->first.len; });
+
+    for ( auto it : shorts )
+    {
+        unsigned slot = get_slot(it->first.addr);
+        unsigned n = 1u << (TOP_BITS - it->first.len);
+        std::fill(routes.begin() + slot, routes.begin() + slot + n, it->second);
+    }
+
+    size_t num_nodes = nodes.size() - dead_nodes;
+    size_t num_leaves = leaves.size() - dead_leaves;
+
+    std::vector<uint32_t>(TOP_SIZE, NO_LEAF).swap(top);
+    std::vector<Node>().swap(nodes);
+    std::vector<uint32_t>().swap(leaves);
+    std::vector<uint8_t>().swap(lengths);
+
+    nodes.reserve(num_nodes);
+    leaves.reserve(num_leaves);
+    lengths.reserve(num_leaves);
+
+    dead_nodes = dead_leaves = 0;
+
+    auto it = prefixes.cbegin();
+
+    for ( unsigned slot = 0; slot < TOP_SIZE; ++slot )
+    {
+        while ( it != prefixes.cend() and get_slot(it->first.addr) == slot and
+            it->first.len <= TOP_BITS )
+            ++it;
+
+        PrefixIter first = it;
+
+        while ( it != prefixes.cend() and get_slot(it->first.addr) == slot )
+            ++it;
+
+        set_slot(slot, first, it, routes[slot]);
+    }
+}
+
+void Poptrie::build_slot(unsigned slot)
+{
+    Key base = { (uint64_t)slot << (64 - TOP_BITS), 0 };
+    PrefixIter first = prefixes.lower_bound({ base, TOP_BITS + 1 });
+    PrefixIter last = prefixes.end();
+
+    if ( slot + 1 < TOP_SIZE )
+        last = prefixes.lower_bound({ { (uint64_t)(slot + 1) << (64 - TOP_BITS), 0 }, 0 });
+
+    if ( top[slot] & NODE_FLAG )
+        discard(top[slot] & ~NODE_FLAG);
+
+    set_slot(slot, first, last, find_cover(base, TOP_BITS));
+}
+
+// a slot that stays a leaf keeps its leaf; otherwise the old one is dead
+void Poptrie::set_slot(unsigned slot, PrefixIter first, PrefixIter last, const Route& r)
+{
+    bool leaf = !(top[slot] & NODE_FLAG) and top[slot] != NO_LEAF;
+
+    if ( first == last )
+    {
+        if ( leaf )
+        {
+            leaves[top[slot]] = r.index;
+            lengths[top[slot]] = r.len;
+        }
+        else
+            top[slot] = add_leaf(r);
+        return;
+    }
+    if ( leaf )
+        ++dead_leaves;
+
+    uint32_t at = nodes.size();
+    nodes.emplace_back();
+    fill_node(at, first, last, TOP_BITS, r);
+    top[slot] = NODE_FLAG | at;
+}
+
+// [first, last) holds the prefixes under the node at bit off; those no longer
+// than off were already applied to the route r
+void Poptrie::fill_node(
+    uint32_t at, PrefixIter first, PrefixIter last, unsigned off, const Route& r)
+{
+    const unsigned fan = 1u << NODE_BITS;
+    const unsigned end = off + NODE_BITS;
+
+    Route routes[fan];
+    std::fill(routes, routes + fan, r);
+
+    // at most 2 + 4 + ... + 64 prefixes end within a node
+    PrefixIter shorts[2 * fan];
+    unsigned num_shorts = 0;
+    uint64_t vector = 0;
+
+    for ( auto it = first; it != last; ++it )
+    {
+        if ( it->first.len <= off )
+            continue;
+
+        if ( it->first.len <= end )
+            shorts[num_shorts++] = it;
+        else
+            vector |= 1ull << get_bits(it->first.addr, off, NODE_BITS);
+    }
+
+    for ( unsigned l = off + 1; l <= end; ++l )
+    {
+        for ( unsigned i = 0; i < num_shorts; ++i )
+        {
+            if ( shorts[i]->first.len != l )
+                continue;
+
+            unsigned v = get_bits(shorts[i]->first.addr, off, NODE_BITS);
+            std::fill(routes + v, routes + v + (1u << (end - l)), shorts[i]->second);
+        }
+    }
+
+    Node node;
+    node.vector = vector;
+    node.leafvec = 0;
+    node.base0 = leaves.size();
+    node.base1 = nodes.size();
+
+    nodes.resize(nodes.size() + popcount(vector));
+
+    for ( unsigned v = 0; v < fan; ++v )
+    {
+        if ( vector & (1ull << v) )
+            continue;
+
+        if ( leaves.size() == node.base0 or
+            leaves.back() != routes[v].index or lengths.back() != routes[v].len )
+        {
+            node.leafvec |= 1ull << v;
+            add_leaf(routes[v]);
+        }
+    }
+    nodes[at] = node;
+
+    // the children's prefixes are contiguous since the map is in address order
+    uint32_t child = node.base1;
+    auto it = first;
+
+    while ( it != last )
+    {
+        if ( it->first.len <= end )
+        {
+            ++it;
+            continue;
+        }
+        unsigned v = get_bits(it->first.addr, off, NODE_BITS);
+        auto sub = it;
+
+        while ( it != last and get_bits(it->first.addr, off, NODE_BITS) == v )
+            ++it;
+
+        fill_node(child++, sub, it, end, routes[v]);
+    }
+}
+
+void Poptrie::discard(uint32_t at)
+{
+    const Node& n = nodes[at];
+    unsigned kids = popcount(n.vector);
+
+    ++dead_nodes;
+    dead_leaves += popcount(n.leafvec);
+
+    for ( unsigned i = 0; i < kids; ++i )
+        discard(n.base1 + i);
+}
+
+size_t Poptrie::usage() const
+{
+    return sizeof(*this) + top.capacity() * sizeof(top[0]) +
+        nodes.capacity() * sizeof(Node) +
+        leaves.capacity() * sizeof(leaves[0]) + lengths.capacity() * sizeof(lengths[0]) +
+        prefixes.size() * PREFIX_SIZE;
+}
+
+void Poptrie::print() const
+{
+    printf("Prefixes: %zu, Nodes: %zu (%zu dead), Leaves: %zu (%zu dead), Usage: %zu\n",
+        prefixes.size(), nodes.size(), dead_nodes, leaves.size(), dead_leaves, usage());
+}
+
+#ifdef USE_POPTRIE_POPCNT
+__attribute__((target("popcnt")))
+tuple_t find_popcnt(const Poptrie* table, const Key& k)
+{ return table->find(k); }
+
+static bool get_popcnt()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+}
+
+const bool have_popcnt = get_popcnt();
+#endif
+}
+
+void* sfrt_poptrie_new(uint32_t mem_cap, int width)
+{
+    if ( width != 32 and width != 128 )
+        return nullptr;
+
+    Poptrie* table = new Poptrie(mem_cap, width);
+
+    if ( table->usage() > mem_cap )
+    {
+        delete table;
+        return nullptr;
+    }
+    return table;
+}
+
+void sfrt_poptrie_free(void* table)
+{
+    delete (Poptrie*)table;
+}
+
+tuple_t sfrt_poptrie_lookup(const uint32_t* addr, int numAddrDwords, void* table)
+{
+    Key k = get_key(addr, numAddrDwords);
+
+#ifdef USE_POPTRIE_POPCNT
+    if ( have_popcnt )
+        return find_popcnt((Poptrie*)table, k);
+#endif
+
+    return ((Poptrie*)table)->find(k);
+}
+
+int sfrt_poptrie_insert(const uint32_t* addr, int numAddrDwords, int len, word data_index,
+    int behavior, void* table)
+{
+    return ((Poptrie*)table)->insert(get_key(addr, numAddrDwords), len, data_index, behavior);
+}
+
+word sfrt_poptrie_remove(const uint32_t* addr, int numAddrDwords, int len, int behavior,
+    void* table)
+{
+    return ((Poptrie*)table)->remove(get_key(addr, numAddrDwords), len, behavior);
+}
+
+uint32_t sfrt_poptrie_usage(void* table)
+{
+    if ( !table )
+        return 0;
+
+    size_t usage = ((Poptrie*)table)->usage();
+    return usage > 0xffffffff ? 0xffffffff : usage;
+}
+
+void sfrt_poptrie_print(void* table)
+{
+    if ( table )
+        ((Poptrie*)table)->print();
+}
+
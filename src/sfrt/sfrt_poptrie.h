@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// sfrt_poptrie.h
+
+#ifndef SFRT_POPTRIE_H
+#define SFRT_POPTRIE_H
+
+// Compressed multibit trie after Asai and Ohara's poptrie.  The top 16 bits
+// of the address index a direct table; below that every node covers 6 bits
+// with a pair of 64 bit maps, one marking the children that are nodes and
+// one marking where a run of identical leaves starts.  A child is found at
+// its parent's base plus the popcount of the map below it, so each node's
+// children and leaves are stored densely and contiguously.
+//
+// Prefixes are also kept in an ordered map.  Inserts and removes update the
+// map and rebuild only the subtrees under the direct table slots they
+// cover; the space left behind is reclaimed by rebuilding everything once
+// it outweighs the live trie.
+
+#include <cstdint>
+
+void* sfrt_poptrie_new(uint32_t mem_cap, int width);
+void sfrt_poptrie_free(void*);
+tuple_t sfrt_poptrie_lookup(const uint32_t* addr, int numAddrDwords, void* table);
+int sfrt_poptrie_insert(const uint32_t* addr, int numAddrDwords, int len, word data_index,
+    int behavior, void* table);
+word sfrt_poptrie_remove(const uint32_t* addr, int numAddrDwords, int len, int behavior,
+    void* table);
+uint32_t sfrt_poptrie_usage(void* table);
+void sfrt_poptrie_print(void* table);
+
+#endif
+
@@ -28,6 +28,12 @@
 
 #include "sfrt.h"
 
+#include <vector>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#endif
+
 using namespace snort;
 
 #define NUM_IPS 32
@@ -64,7 +70,7 @@ static IP_entry ip_lists[] =
 static int s_debug = 0;
 
 /* Add one ip, then delete that IP*/
-static void test_sfrt_remove_after_insert()
+static void test_sfrt_remove_after_insert(char type)
 {
     table_t* dir;
     unsigned num_entries;
@@ -74,7 +80,7 @@ static void test_sfrt_remove_after_insert()
     if ( s_debug )
         printf("Number of entries: %u \n",num_entries);
 
-    dir = sfrt_new(DIR_16_4x4_16x5_4x4, IPv6, num_entries + 1, 200);
+    dir = sfrt_new(type, IPv6, num_entries + 1, 200);
 
     CHECK(dir != nullptr); // "sfrt_new()"
 
@@ -148,7 +154,7 @@ static void test_sfrt_remove_after_insert()
 }
 
 /*Add all IPs, then delete all of them*/
-static void test_sfrt_remove_after_insert_all()
+static void test_sfrt_remove_after_insert_all(char type)
 {
     table_t* dir;
     unsigned num_entries;
@@ -159,7 +165,7 @@ static void test_sfrt_remove_after_insert_all()
     if ( s_debug )
         printf("Number of entries: %u \n",num_entries);
 
-    dir = sfrt_new(DIR_16_4x4_16x5_4x4, IPv6, num_entries + 1, 200);
+    dir = sfrt_new(type, IPv6, num_entries + 1, 200);
 
     CHECK(dir != nullptr); // "sfrt_new()"
 
@@ -242,11 +248,310 @@ TEST_CASE("sfrt", "[sfrt]")
 {
     SECTION("remove after insert")
     {
-        test_sfrt_remove_after_insert();
+        test_sfrt_remove_after_insert(DIR_16_4x4_16x5_4x4);
     }
     SECTION("remove after insert all")
     {
-        test_sfrt_remove_after_insert_all();
+        test_sfrt_remove_after_insert_all(DIR_16_4x4_16x5_4x4);
+    }
+    SECTION("poptrie remove after insert")
+    {
+        test_sfrt_remove_after_insert(POPTRIE);
+    }
+    SECTION("poptrie remove after insert all")
+    {
+        test_sfrt_remove_after_insert_all(POPTRIE);
+    }
+}
+
+//---------------------------------------------------------------
+// poptrie vs DIR: the same random mix of overlapping inserts and
+// removes must give the same lookups
+//---------------------------------------------------------------
+
+static uint32_t rand_next(uint32_t& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8 ^ seed << 24;
+}
+
+// a few shared leading bits so prefixes nest and overlap
+static void rand_prefix(uint32_t& seed, bool ip4, SfCidr& cidr)
+{
+    uint32_t addr[4];
+
+    for ( auto& a : addr )
+        a = rand_next(seed);
+
+    addr[0] = (addr[0] & 0x00ffffff) | ((rand_next(seed) % 4 + 10) << 24);
+    addr[1] = (addr[1] & 0x0000ffff) | ((rand_next(seed) % 4) << 16);
+
+    for ( auto& a : addr )
+        a = htonl(a);
+
+    unsigned len;
+
+    if ( ip4 )
+    {
+        cidr.set(addr, AF_INET);
+        len = 96 + 8 + rand_next(seed) % 25;
+    }
+    else
+    {
+        cidr.set(addr, AF_INET6);
+        len = rand_next(seed) % 4 ? 8 + rand_next(seed) % 57 : 65 + rand_next(seed) % 64;
+    }
+    cidr.set_bits(len);
+}
+
+static void rand_host(uint32_t& seed, const SfCidr& cidr, SfIp& ip)
+{
+    uint32_t addr[4];
+    memcpy(addr, cidr.get_addr()->get_ip6_ptr(), sizeof(addr));
+
+    unsigned bits = cidr.get_bits();
+
+    for ( unsigned i = 0; i < 4; ++i, bits = bits > 32 ? bits - 32 : 0 )
+    {
+        if ( bits < 32 )
+        {
+            uint32_t keep = bits ? ~0u << (32 - bits) : 0;
+            addr[i] = htonl((ntohl(addr[i]) & keep) | (rand_next(seed) & ~keep));
+        }
     }
+    ip.set(addr);
 }
 
+static void test_poptrie_matches_dir(bool ip4, unsigned num, uint32_t seed)
+{
+    table_t* dir = sfrt_new(DIR_8x16, IPv6, num + 1, 200);
+    table_t* pop = sfrt_new(POPTRIE, IPv6, num + 1, 200);
+
+    REQUIRE(dir != nullptr);
+    REQUIRE(pop != nullptr);
+
+    std::vector<SfCidr> cidrs(num);
+    std::vector<int> values(num);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        if ( i % 5 == 4 )
+        {
+            unsigned j = rand_next(seed) % i;
+
+            if ( j % 5 == 4 )
+                --j;
+
+            SfCidr& cidr = cidrs[j];
+            GENERIC data = &values[j];
+            int behavior = RT_FAVOR_SPECIFIC;
+
+            // DIR only clears a range it has tables under, so only favor
+            // time on a prefix that is still there
+            if ( rand_next(seed) % 2 and sfrt_lookup(cidr.get_addr(), dir) == data )
+                behavior = RT_FAVOR_TIME;
+
+            GENERIC dir_data = nullptr;
+            GENERIC pop_data = nullptr;
+
+            CHECK(sfrt_remove(&cidr, cidr.get_bits(), &dir_data, behavior, dir) == RT_SUCCESS);
+            CHECK(sfrt_remove(&cidr, cidr.get_bits(), &pop_data, behavior, pop) == RT_SUCCESS);
+
+            // DIR loses a prefix entirely covered by longer ones before it
+            // was inserted; the poptrie still finds it to remove
+            CHECK((dir_data == pop_data or !dir_data));
+            CHECK(sfrt_lookup(cidr.get_addr(), dir) == sfrt_lookup(cidr.get_addr(), pop));
+            continue;
+        }
+        rand_prefix(seed, ip4, cidrs[i]);
+        int behavior = rand_next(seed) % 4 ? RT_FAVOR_SPECIFIC : RT_FAVOR_TIME;
+
+        CHECK(sfrt_insert(&cidrs[i], cidrs[i].get_bits(), &values[i], behavior, dir) ==
+            RT_SUCCESS);
+        CHECK(sfrt_insert(&cidrs[i], cidrs[i].get_bits(), &values[i], behavior, pop) ==
+            RT_SUCCESS);
+    }
+
+    unsigned mismatch = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        if ( i % 5 == 4 )
+            continue;
+
+        SfIp ip;
+
+        for ( unsigned j = 0; j < 8; ++j )
+        {
+            if ( j )
+                rand_host(seed, cidrs[i], ip);
+            else
+                ip.set(*cidrs[i].get_addr());
+
+            if ( sfrt_lookup(&ip, dir) != sfrt_lookup(&ip, pop) )
+                ++mismatch;
+        }
+    }
+    CHECK(mismatch == 0);
+    CHECK(sfrt_num_entries(pop) <= sfrt_num_entries(dir));
+
+    sfrt_free(dir);
+    sfrt_free(pop);
+}
+
+TEST_CASE("sfrt poptrie", "[sfrt]")
+{
+    SECTION("ip4 matches dir")
+    {
+        test_poptrie_matches_dir(true, 20000, 1);
+    }
+    SECTION("ip6 matches dir")
+    {
+        test_poptrie_matches_dir(false, 20000, 2);
+    }
+    SECTION("nested ip4")
+    {
+        table_t* pop = sfrt_new(POPTRIE, IPv6, 8, 20);
+        REQUIRE(pop != nullptr);
+
+        int a = 1, b = 2, c = 3;
+        SfCidr net, sub, host;
+        SfIp ip;
+
+        net.set("10.0.0.0/8");
+        sub.set("10.1.0.0/16");
+        host.set("10.1.2.3");
+
+        CHECK(sfrt_insert(&host, host.get_bits(), &c, RT_FAVOR_SPECIFIC, pop) == RT_SUCCESS);
+        CHECK(sfrt_insert(&net, net.get_bits(), &a, RT_FAVOR_SPECIFIC, pop) == RT_SUCCESS);
+        CHECK(sfrt_insert(&sub, sub.get_bits(), &b, RT_FAVOR_SPECIFIC, pop) == RT_SUCCESS);
+
+        ip.set("10.1.2.3");
+        CHECK(sfrt_lookup(&ip, pop) == &c);
+        ip.set("10.1.2.4");
+        CHECK(sfrt_lookup(&ip, pop) == &b);
+        ip.set("10.2.0.1");
+        CHECK(sfrt_lookup(&ip, pop) == &a);
+        ip.set("11.0.0.1");
+        CHECK(sfrt_lookup(&ip, pop) == nullptr);
+
+        // favoring time drops what the new prefix covers
+        CHECK(sfrt_insert(&sub, sub.get_bits(), &b, RT_FAVOR_TIME, pop) == RT_SUCCESS);
+        ip.set("10.1.2.3");
+        CHECK(sfrt_lookup(&ip, pop) == &b);
+
+        GENERIC data = nullptr;
+        CHECK(sfrt_remove(&sub, sub.get_bits(), &data, RT_FAVOR_SPECIFIC, pop) == RT_SUCCESS);
+        CHECK(data == &b);
+        CHECK(sfrt_lookup(&ip, pop) == nullptr);
+        ip.set("10.2.0.1");
+        CHECK(sfrt_lookup(&ip, pop) == &a);
+
+        sfrt_free(pop);
+    }
+}
+
+
+#ifdef BENCHMARK_TEST
+//---------------------------------------------------------------
+// lookup rate and memory of DIR vs poptrie with a routing table
+// sized prefix set; half the lookups hit a prefix
+//---------------------------------------------------------------
+
+static void bench_prefix(uint32_t& seed, bool ip4, SfCidr& cidr)
+{
+    uint32_t addr[4];
+
+    for ( auto& a : addr )
+        a = htonl(rand_next(seed));
+
+    unsigned r = rand_next(seed) % 10;
+    unsigned len;
+
+    if ( ip4 )
+    {
+        cidr.set(addr, AF_INET);
+        len = r < 6 ? 24 : (r < 9 ? 16 + rand_next(seed) % 8 : 25 + rand_next(seed) % 8);
+        len += 96;
+    }
+    else
+    {
+        cidr.set(addr, AF_INET6);
+        len = r < 6 ? 48 : (r < 9 ? 32 + rand_next(seed) % 16 : 49 + rand_next(seed) % 16);
+    }
+    cidr.set_bits(len);
+}
+
+static void bench_table(
+    const char* name, char type, const std::vector<SfCidr>& cidrs, const std::vector<SfIp>& ips)
+{
+    table_t* table = sfrt_new(type, IPv6, cidrs.size() + 1, 4000);
+    REQUIRE(table != nullptr);
+
+    int value = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( auto cidr : cidrs )
+        CHECK(sfrt_insert(&cidr, cidr.get_bits(), &value, RT_FAVOR_SPECIFIC, table) == RT_SUCCESS);
+
+    auto built = std::chrono::steady_clock::now();
+    const unsigned rounds = 4;
+    unsigned hits = 0;
+
+    for ( unsigned i = 0; i < rounds; ++i )
+    {
+        for ( const auto& ip : ips )
+            hits += sfrt_lookup(&ip, table) ? 1 : 0;
+    }
+    auto done = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> insert = built - start;
+    std::chrono::duration<double> lookup = done - built;
+
+    printf("%-14s %7.2f M lookups/s %9.1f MB %7.2f s to insert (%u hits)\n",
+        name, rounds * ips.size() / lookup.count() / 1e6, sfrt_usage(table) / 1048576.0,
+        insert.count(), hits / rounds);
+
+    sfrt_free(table);
+}
+
+static void bench_family(bool ip4, unsigned num_prefixes, unsigned num_ips)
+{
+    uint32_t seed = 12345;
+    std::vector<SfCidr> cidrs(num_prefixes);
+    std::vector<SfIp> ips(num_ips);
+
+    for ( auto& cidr : cidrs )
+        bench_prefix(seed, ip4, cidr);
+
+    for ( unsigned i = 0; i < num_ips; ++i )
+    {
+        if ( i % 2 )
+        {
+            rand_host(seed, cidrs[rand_next(seed) % num_prefixes], ips[i]);
+            continue;
+        }
+        uint32_t addr[4];
+
+        for ( auto& a : addr )
+            a = htonl(rand_next(seed));
+
+        ips[i].set(addr, ip4 ? AF_INET : AF_INET6);
+    }
+    printf("\n%s: %u prefixes, %u addresses\n", ip4 ? "ip4" : "ip6", num_prefixes, num_ips);
+
+    if ( ip4 )
+        bench_table("DIR_16x7_4x4", DIR_16x7_4x4, cidrs, ips);
+
+    bench_table("DIR_8x16", DIR_8x16, cidrs, ips);
+    bench_table("POPTRIE", POPTRIE, cidrs, ips);
+}
+
+TEST_CASE("sfrt benchmark", "[sfrt]")
+{
+    // a 16 bit DIR level per IPv6 prefix is too big to run here
+    bench_family(true, 500000, 1000000);
+    bench_family(false, 20000, 1000000);
+}
+#endif
+
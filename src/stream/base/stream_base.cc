@@ -180,6 +180,8 @@ void StreamBase::show(SnortConfig*)
     LogMessage("Stream Base config:\n");
     LogMessage("    Max flows: %d\n", config.flow_cache_cfg.max_flows);
     LogMessage("    Pruning timeout: %d\n", config.flow_cache_cfg.pruning_timeout);
+    LogMessage("    Flow table engine: %s\n",
+        config.flow_cache_cfg.engine == FlowTableEngine::BUCKET ? "bucket" : "zhash");
 }
 
 void StreamBase::eval(Packet* p)
@@ -201,7 +203,7 @@ void StreamBase::eval(Packet* p)
             bool new_flow = false;
             flow_con->process(PktType::IP, p, &new_flow);
             if ( new_flow )
-                DataBus::publish(STREAM_IP_NEW_FLOW_EVENT, p);
+                DataBus::publish(STREAM_IP_NEW_FLOW_EVENT_ID, p);
         }
         break;
 
@@ -219,7 +221,7 @@ void StreamBase::eval(Packet* p)
             bool new_flow = false;
             flow_con->process(PktType::UDP, p, &new_flow);
             if ( new_flow )
-                DataBus::publish(STREAM_UDP_NEW_FLOW_EVENT, p);
+                DataBus::publish(STREAM_UDP_NEW_FLOW_EVENT_ID, p);
         }
         break;
 
@@ -230,7 +232,7 @@ void StreamBase::eval(Packet* p)
             if ( !flow_con->process(PktType::ICMP, p, &new_flow) )
                 flow_con->process(PktType::IP, p, &new_flow);
             if ( new_flow )
-                DataBus::publish(STREAM_ICMP_NEW_FLOW_EVENT, p);
+                DataBus::publish(STREAM_ICMP_NEW_FLOW_EVENT_ID, p);
         }
         break;
 
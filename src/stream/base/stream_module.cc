@@ -69,6 +69,9 @@ static const Parameter s_params[] =
     { "ip_frags_only", Parameter::PT_BOOL, nullptr, "false",
             "don't process non-frag flows" },
 
+    { "flow_table_engine", Parameter::PT_ENUM, "zhash | bucket", "zhash",
+            "flow hash table; zhash is chained, bucket is open addressed with cache line buckets" },
+
     { "max_flows", Parameter::PT_INT, "2:max32", "476288",
                 "maximum simultaneous flows tracked before pruning" },
 
@@ -142,6 +145,11 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig* c)
             c->set_run_flags(RUN_FLAG__IP_FRAGS_ONLY);
         return true;
     }
+    else if ( v.is("flow_table_engine") )
+    {
+        config.flow_cache_cfg.engine = static_cast<FlowTableEngine>(v.get_uint8());
+        return true;
+    }
     else if ( v.is("max_flows") )
     {
         config.flow_cache_cfg.max_flows = v.get_uint32();
@@ -182,7 +190,8 @@ static int check_stream_config(const FlowCacheConfig& new_cfg, const FlowCacheCo
     int ret = 0;
 
     if ( saved_cfg.max_flows != new_cfg.max_flows
-            or saved_cfg.pruning_timeout != new_cfg.pruning_timeout )
+            or saved_cfg.pruning_timeout != new_cfg.pruning_timeout
+            or saved_cfg.engine != new_cfg.engine )
     {
         ReloadError("Change of stream flow cache options requires a restart\n");
         ret = 1;
@@ -39,6 +39,7 @@
 #include "target_based/snort_protocols.h"
 #include "utils/util.h"
 
+#include "tcp/tcp_segment_node.h"
 #include "tcp/tcp_session.h"
 #include "libtcp/tcp_stream_session.h"
 
@@ -73,6 +74,12 @@ Flow* Stream::get_flow(const FlowKey* key)
 Flow* Stream::new_flow(const FlowKey* key)
 { return flow_con->new_flow(key); }
 
+void Stream::prefetch_flow(int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id)
+{
+    if ( flow_con )
+        flow_con->prefetch_flow(dlt, data, len, address_space_id);
+}
+
 void Stream::delete_flow(const FlowKey* key)
 { flow_con->delete_flow(key); }
 
@@ -364,6 +371,10 @@ void Stream::timeout_flows(time_t cur_time)
 
 void Stream::prune_flows()
 {
+    // idle tcp segment nodes count against the memcap so they go first
+    if ( TcpSegmentNode::trim() )
+        return;
+
     if ( !flow_con )
         return;
 
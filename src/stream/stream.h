@@ -87,6 +87,12 @@ public:
     // If a new session object can not be allocated the program is terminated.
     static Flow* new_flow(const FlowKey*);
 
+    // Starts loading the flow table memory for the flow of the raw packet
+    // so that the lookup when the packet is processed is more likely to hit
+    // the cache.  Only common, unfragmented tcp, udp, and icmp packets are
+    // recognized; anything else is ignored.
+    static void prefetch_flow(int dlt, const uint8_t* data, uint32_t len, uint16_t address_space_id);
+
     // Removes the flow session object from the flow cache table and returns
     // the resources allocated to that flow to the free list.
     static void delete_flow(const FlowKey*);
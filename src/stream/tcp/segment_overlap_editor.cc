@@ -239,7 +239,7 @@ int SegmentOverlapEditor::left_overlap_keep_first(TcpReassemblerState& trs)
             {
                 unsigned offset = trs.sos.tsd->get_seg_seq() - trs.sos.left->i_seq;
                 memcpy(const_cast<uint8_t*>(trs.sos.tsd->get_pkt()->data),
-                    trs.sos.left->data + offset, trs.sos.tsd->get_seg_len());
+                    trs.sos.left->buf + offset, trs.sos.tsd->get_seg_len());
                 trs.sos.tsd->get_pkt()->packet_flags |= PKT_MODIFIED;
             }
             tcp_norm_stats[PC_TCP_IPS_DATA][trs.sos.tcp_ips_data]++;
@@ -252,7 +252,7 @@ int SegmentOverlapEditor::left_overlap_keep_first(TcpReassemblerState& trs)
                 unsigned length = trs.sos.left->i_seq + trs.sos.left->i_len -
                     trs.sos.tsd->get_seg_seq();
                 memcpy(const_cast<uint8_t*>(trs.sos.tsd->get_pkt()->data),
-                    trs.sos.left->data + offset, length);
+                    trs.sos.left->buf + offset, length);
                 trs.sos.tsd->get_pkt()->packet_flags |= PKT_MODIFIED;
             }
 
@@ -371,7 +371,7 @@ void SegmentOverlapEditor::right_overlap_truncate_new(TcpReassemblerState& trs)
         unsigned length = trs.sos.tsd->get_seg_seq() + trs.sos.tsd->get_seg_len() -
             trs.sos.right->i_seq;
         memcpy(const_cast<uint8_t*>(trs.sos.tsd->get_pkt()->data) + offset,
-            trs.sos.right->data, length);
+            trs.sos.right->buf, length);
         trs.sos.tsd->get_pkt()->packet_flags |= PKT_MODIFIED;
     }
 
@@ -387,7 +387,7 @@ int SegmentOverlapEditor::full_right_overlap_truncate_new(TcpReassemblerState& t
     {
         unsigned offset = trs.sos.right->i_seq - trs.sos.tsd->get_seg_seq();
         memcpy(const_cast<uint8_t*>(trs.sos.tsd->get_pkt()->data) + offset,
-            trs.sos.right->data, trs.sos.right->i_len);
+            trs.sos.right->buf, trs.sos.right->i_len);
         trs.sos.tsd->get_pkt()->packet_flags |= PKT_MODIFIED;
     }
 
@@ -87,6 +87,12 @@ const PegInfo tcp_pegs[] =
     { CountType::SUM, "held_packet_limit_exceeded", "number of times limit of max held packets exceeded" },
     { CountType::SUM, "partial_flushes", "number of partial flushes initiated" },
     { CountType::SUM, "partial_flush_bytes", "partial flush total bytes" },
+    { CountType::SUM, "seg_pool_hits", "segment allocations taken from the thread's pool" },
+    { CountType::SUM, "seg_pool_misses", "segment allocations made from the heap" },
+    { CountType::SUM, "seg_pool_trims", "segment pools freed to make room under the memcap" },
+    { CountType::SUM, "seg_bytes_copied", "segment payload bytes copied into segment nodes" },
+    { CountType::SUM, "seg_bytes_referenced", "segment payload bytes referenced in DAQ buffers" },
+    { CountType::SUM, "seg_refs_reclaimed", "referenced segments copied to release a DAQ buffer" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -198,6 +204,9 @@ static const Parameter s_params[] =
     { "track_only", Parameter::PT_BOOL, nullptr, "false",
       "disable reassembly if true" },
 
+    { "zero_copy", Parameter::PT_BOOL, nullptr, "false",
+      "queue references to DAQ message data instead of copying segments (passive only)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -322,6 +331,13 @@ bool StreamTcpModule::set(const char*, Value& v, SnortConfig*)
         else
             config->flags &= ~STREAM_CONFIG_NO_REASSEMBLY;
     }
+    else if ( v.is("zero_copy") )
+    {
+        if ( v.get_bool() )
+            config->flags |= STREAM_CONFIG_ZERO_COPY;
+        else
+            config->flags &= ~STREAM_CONFIG_ZERO_COPY;
+    }
     else
         return false;
 
@@ -100,6 +100,12 @@ struct TcpStats
     PegCount held_packet_limit_exceeded;
     PegCount partial_flushes;
     PegCount partial_flush_bytes;
+    PegCount seg_pool_hits;
+    PegCount seg_pool_misses;
+    PegCount seg_pool_trims;
+    PegCount seg_bytes_copied;
+    PegCount seg_bytes_referenced;
+    PegCount seg_refs_reclaimed;
 };
 
 extern THREAD_LOCAL struct TcpStats tcpStats;
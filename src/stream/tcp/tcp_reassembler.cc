@@ -28,6 +28,7 @@
 #include "detection/detection_engine.h"
 #include "log/log.h"
 #include "main/analyzer.h"
+#include "main/snort_config.h"
 #include "memory/memory_cap.h"
 #include "packet_io/active.h"
 #include "profiler/profiler.h"
@@ -219,7 +220,8 @@ int TcpReassembler::add_reassembly_segment(
     }
 
     // FIXIT-L don't allocate overlapped part
-    tsn = TcpSegmentNode::init(tsd);
+    tsn = TcpSegmentNode::init(tsd, (trs.sos.session->config->flags & STREAM_CONFIG_ZERO_COPY)
+        and !SnortConfig::adaptor_inline_mode());
 
     tsn->offset = slide;
     tsn->c_len = (uint16_t)newSize;
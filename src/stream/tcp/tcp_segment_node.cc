@@ -25,44 +25,103 @@
 
 #include "tcp_segment_node.h"
 
+#include <daq.h>
+
 #include "main/thread.h"
 #include "memory/memory_cap.h"
+#include "packet_io/sfdaq_instance.h"
 #include "utils/util.h"
 
 #include "segment_overlap_editor.h"
 #include "tcp_module.h"
 
-#define USE_RESERVE
-#ifdef USE_RESERVE
-static THREAD_LOCAL TcpSegmentNode* reserved = nullptr;
-static THREAD_LOCAL unsigned reserve_sz = 0;
+using namespace snort;
 
-static constexpr unsigned num_res = 4096;
-static constexpr unsigned res_min = 1024;
-static constexpr unsigned res_max = 1460;
-#endif
+//-------------------------------------------------------------------------
+// segment nodes are kept on per-thread free lists by payload size class so
+// that steady state reassembly doesn't go to the heap.  nodes are allocated
+// with the full class size so they can be reused for any segment in that
+// class.  larger segments are allocated to fit and are never pooled.
+//
+// pooled nodes stay charged to the memcap until they are freed.  when the
+// memcap needs room, trim() gives back the pools before any flows are
+// pruned.  the pools are bounded and are not refilled while over the
+// preemptive threshold.
+//
+// in zero copy mode (passive only) a node may instead reference the payload
+// in the DAQ message, which is then held until the node is released.  if
+// the DAQ can't spare another message the oldest references are reclaimed
+// by copying their payload into the node (which is always allocated with
+// room for it) and releasing their message.
+//-------------------------------------------------------------------------
+
+struct SegmentPool
+{
+    TcpSegmentNode* head;
+    unsigned count;
+};
+
+static constexpr uint16_t pool_size[] = { 64, 256, 1500, 9000 };
+static constexpr unsigned pool_max[] = { 4096, 4096, 4096, 512 };
+static constexpr unsigned num_pools = sizeof(pool_size) / sizeof(pool_size[0]);
+
+static THREAD_LOCAL SegmentPool pools[num_pools];
+
+// nodes referencing DAQ buffers, oldest first
+static THREAD_LOCAL TcpSegmentNode* ref_head = nullptr;
+static THREAD_LOCAL TcpSegmentNode* ref_tail = nullptr;
+
+static inline unsigned get_pool(uint16_t len)
+{
+    unsigned i = 0;
+
+    while ( i < num_pools and len > pool_size[i] )
+        ++i;
+
+    return i;
+}
 
 void TcpSegmentNode::setup()
 {
-#ifdef USE_RESERVE
-    reserved = nullptr;
-    reserve_sz = 0;
-#endif
+    for ( auto& pool : pools )
+    {
+        pool.head = nullptr;
+        pool.count = 0;
+    }
+    ref_head = ref_tail = nullptr;
 }
 
-void TcpSegmentNode::clear()
+static void free_pool(SegmentPool& pool)
 {
-#ifdef USE_RESERVE
-    while ( reserved )
+    while ( pool.head )
     {
-        TcpSegmentNode* tsn = reserved;
-        reserved = reserved->next;
+        TcpSegmentNode* tsn = pool.head;
+        pool.head = tsn->next;
         memory::MemoryCap::update_deallocations(sizeof(*tsn) + tsn->size);
-        tcpStats.mem_in_use -= tsn->size;
         snort_free(tsn);
     }
-    reserve_sz = 0;
-#endif
+    pool.count = 0;
+}
+
+void TcpSegmentNode::clear()
+{
+    for ( auto& pool : pools )
+        free_pool(pool);
+}
+
+// free the largest nonempty size class; false if nothing was pooled
+bool TcpSegmentNode::trim()
+{
+    for ( unsigned i = num_pools; i > 0; --i )
+    {
+        if ( pools[i - 1].head )
+        {
+            free_pool(pools[i - 1]);
+            tcpStats.seg_pool_trims++;
+            return true;
+        }
+    }
+    return false;
 }
 
 //-------------------------------------------------------------------------
@@ -73,28 +132,39 @@ TcpSegmentNode* TcpSegmentNode::create(
     const struct timeval& tv, const uint8_t* payload, uint16_t len)
 {
     TcpSegmentNode* tsn;
+    unsigned idx = get_pool(len);
 
-#ifdef USE_RESERVE
-    if ( reserved and len > res_min and len <= res_max )
+    if ( idx < num_pools and pools[idx].head )
     {
-        tsn = reserved;
-        reserved = tsn->next;
-        --reserve_sz;
+        tsn = pools[idx].head;
+        pools[idx].head = tsn->next;
+        --pools[idx].count;
+        tcpStats.seg_pool_hits++;
     }
     else
-#endif
     {
-        size_t size = sizeof(*tsn) + len;
-        memory::MemoryCap::update_allocations(size);
-        tsn = (TcpSegmentNode*)snort_alloc(size);
-        tsn->size = len;
-        tcpStats.mem_in_use += len;
+        uint16_t size = (idx < num_pools) ? pool_size[idx] : len;
+        tsn = (TcpSegmentNode*)snort_alloc(sizeof(*tsn) + size);
+        tsn->size = size;
+        memory::MemoryCap::update_allocations(sizeof(*tsn) + size);
+        tcpStats.seg_pool_misses++;
     }
+    tcpStats.mem_in_use += tsn->size;
+
     tsn->tv = tv;
-    tsn->i_len = tsn->c_len = len;
-    memcpy(tsn->data, payload, len);
+    tsn->i_len = tsn->c_len = tsn->b_len = len;
+    tsn->buf = tsn->data;
+    tsn->daq_msg = nullptr;
+    tsn->daq_instance = nullptr;
+
+    if ( payload )
+    {
+        memcpy(tsn->data, payload, len);
+        tcpStats.seg_bytes_copied += len;
+    }
 
     tsn->prev = tsn->next = nullptr;
+    tsn->ref_prev = tsn->ref_next = nullptr;
     tsn->i_seq = tsn->c_seq = 0;
     tsn->offset = 0;
     tsn->ts = 0;
@@ -102,9 +172,21 @@ TcpSegmentNode* TcpSegmentNode::create(
     return tsn;
 }
 
-TcpSegmentNode* TcpSegmentNode::init(TcpSegmentDescriptor& tsd)
+TcpSegmentNode* TcpSegmentNode::init(TcpSegmentDescriptor& tsd, bool zero_copy)
 {
-    return create(tsd.get_pkt()->pkth->ts, tsd.get_pkt()->data, tsd.get_seg_len());
+    Packet* p = tsd.get_pkt();
+
+    if ( !zero_copy )
+        return create(p->pkth->ts, p->data, tsd.get_seg_len());
+
+    TcpSegmentNode* tsn = create(p->pkth->ts, nullptr, tsd.get_seg_len());
+
+    if ( !tsn->reference(p) )
+    {
+        memcpy(tsn->data, p->data, tsn->b_len);
+        tcpStats.seg_bytes_copied += tsn->b_len;
+    }
+    return tsn;
 }
 
 TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tns)
@@ -114,21 +196,92 @@ TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tns)
 
 void TcpSegmentNode::term()
 {
-#ifdef USE_RESERVE
-    if ( size == res_max and reserve_sz < num_res )
+    if ( daq_msg )
+        release();
+
+    tcpStats.mem_in_use -= size;
+    tcpStats.segs_released++;
+
+    unsigned idx = get_pool(size);
+
+    if ( idx < num_pools and pools[idx].count < pool_max[idx] and
+        !memory::MemoryCap::over_threshold() )
     {
-        next = reserved;
-        reserved = this;
-        reserve_sz++;
+        next = pools[idx].head;
+        pools[idx].head = this;
+        pools[idx].count++;
     }
     else
-#endif
     {
         memory::MemoryCap::update_deallocations(sizeof(*this) + size);
-        tcpStats.mem_in_use -= size;
         snort_free(this);
     }
-    tcpStats.segs_released++;
+}
+
+// only wire data can be referenced; rebuilt packets and anything else
+// outside the message buffer (eg decompressed or decrypted data) is copied
+bool TcpSegmentNode::reference(Packet* p)
+{
+    if ( !p->daq_msg or !p->daq_instance or p->is_rebuilt() )
+        return false;
+
+    const uint8_t* base = daq_msg_get_data(p->daq_msg);
+    const uint8_t* end = base + daq_msg_get_data_len(p->daq_msg);
+
+    if ( p->data < base or p->data + b_len > end )
+        return false;
+
+    while ( !p->daq_instance->hold_message(p->daq_msg) )
+    {
+        if ( !ref_head )
+            return false;
+
+        ref_head->reclaim();
+    }
+
+    buf = const_cast<uint8_t*>(p->data);
+    daq_msg = p->daq_msg;
+    daq_instance = p->daq_instance;
+
+    ref_prev = ref_tail;
+    ref_next = nullptr;
+
+    if ( ref_tail )
+        ref_tail->ref_next = this;
+    else
+        ref_head = this;
+
+    ref_tail = this;
+
+    tcpStats.seg_bytes_referenced += b_len;
+    return true;
+}
+
+void TcpSegmentNode::release()
+{
+    if ( ref_prev )
+        ref_prev->ref_next = ref_next;
+    else
+        ref_head = ref_next;
+
+    if ( ref_next )
+        ref_next->ref_prev = ref_prev;
+    else
+        ref_tail = ref_prev;
+
+    DAQ_Msg_h msg = daq_msg;
+    daq_msg = nullptr;
+    daq_instance->release_message(msg);
+}
+
+void TcpSegmentNode::reclaim()
+{
+    memcpy(data, buf, b_len);
+    buf = data;
+    release();
+
+    tcpStats.seg_bytes_copied += b_len;
+    tcpStats.seg_refs_reclaimed++;
 }
 
 bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize,
@@ -140,15 +293,15 @@ bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize,
 
     if ( orig_dsize == c_len )
     {
-        if ( ( ( c_len <= rsize )and !memcmp(data, rdata, c_len) )
-            or ( ( c_len > rsize )and !memcmp(data, rdata, rsize) ) )
+        if ( ( ( c_len <= rsize )and !memcmp(buf, rdata, c_len) )
+            or ( ( c_len > rsize )and !memcmp(buf, rdata, rsize) ) )
         {
             return true;
         }
     }
     //Checking for a possible split of segment in which case
     //we compare complete data of the segment to find a retransmission
-    else if ( (orig_dsize == rsize) and !memcmp(data, rdata, rsize) )
+    else if ( (orig_dsize == rsize) and !memcmp(buf, rdata, rsize) )
     {
         if ( full_retransmit )
             *full_retransmit = true;
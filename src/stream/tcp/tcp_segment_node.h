@@ -33,26 +33,32 @@ class TcpSegmentDescriptor;
 // size/alignment requirements to minimize unused space
 // ... however, use of padding below is critical, adjust if needed
 // and we use the struct hack to avoid 2 allocs per node
+// nodes are pooled per thread by size class; see tcp_segment_node.cc
+// in zero copy mode buf points into the DAQ message instead of data
 //-----------------------------------------------------------------
 
 class TcpSegmentNode
 {
 private:
     static TcpSegmentNode* create(const struct timeval& tv, const uint8_t* segment, uint16_t len);
+    bool reference(snort::Packet*);
+    void release();
+    void reclaim();
 
 public:
-    static TcpSegmentNode* init(TcpSegmentDescriptor&);
+    static TcpSegmentNode* init(TcpSegmentDescriptor&, bool zero_copy = false);
     static TcpSegmentNode* init(TcpSegmentNode&);
 
     void term();
 
     static void setup();
     static void clear();
+    static bool trim();
 
     bool is_retransmit(const uint8_t*, uint16_t size, uint32_t, uint16_t, bool*);
 
     uint8_t* payload()
-    { return data + offset; }
+    { return buf + offset; }
 
     bool is_packet_missing(uint32_t to_seq)
     {
@@ -66,6 +72,13 @@ public:
     TcpSegmentNode* prev;
     TcpSegmentNode* next;
 
+    TcpSegmentNode* ref_prev;   // thread list of nodes referencing DAQ buffers
+    TcpSegmentNode* ref_next;
+    DAQ_Msg_h daq_msg;          // non-null if buf references this message's data
+    snort::SFDAQInstance* daq_instance;
+    uint8_t* buf;               // data or DAQ buffer
+    uint16_t b_len;             // bytes of buf in use
+
     struct timeval tv;
     uint32_t ts;
     uint32_t i_seq;             // initial seq # of the data segment
@@ -73,7 +86,7 @@ public:
     uint16_t i_len;             // initial length of the data segment
     uint16_t c_len;             // length of data remaining for reassembly
     uint16_t offset;
-    uint16_t size;              // actual allocated size (overlaps cause i_len to differ)
+    uint16_t size;              // allocated payload size (size class or i_len if larger)
 
     uint8_t data[1];
 };
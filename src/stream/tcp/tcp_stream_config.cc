@@ -66,6 +66,8 @@ void TcpStreamConfig::show_config(TcpStreamConfig* config)
         LogMessage("    Options:\n");
         if (config->flags & STREAM_CONFIG_NO_ASYNC_REASSEMBLY)
             LogMessage("        Don't queue packets on one-sided sessions: YES\n");
+        if (config->flags & STREAM_CONFIG_ZERO_COPY)
+            LogMessage("        Reference segment data in DAQ buffers: YES\n");
     }
 
     if ( config->hs_timeout < 0 )
@@ -29,6 +29,7 @@
 #define STREAM_CONFIG_SHOW_PACKETS             0x00000001
 #define STREAM_CONFIG_NO_ASYNC_REASSEMBLY      0x00000002
 #define STREAM_CONFIG_NO_REASSEMBLY            0x00000004
+#define STREAM_CONFIG_ZERO_COPY                0x00000008
 
 #define STREAM_DEFAULT_SSN_TIMEOUT  30
 
@@ -0,0 +1,411 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_segment_node_test.cc
+// unit tests and allocation benchmark for the TcpSegmentNode pools
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "stream/tcp/tcp_segment_node.h"
+
+#include <set>
+
+#ifdef BENCHMARK_TEST
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#endif
+
+#include "memory/memory_cap.h"
+#include "packet_io/sfdaq_instance.h"
+#include "stream/tcp/tcp_module.h"
+#include "utils/util.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+THREAD_LOCAL TcpStats tcpStats;
+
+static size_t mem_used = 0;
+static bool over = false;
+
+namespace memory
+{
+void MemoryCap::update_allocations(size_t n) { mem_used += n; }
+void MemoryCap::update_deallocations(size_t n) { mem_used -= n; }
+bool MemoryCap::over_threshold() { return over; }
+}
+
+// the DAQ instance just counts references to at most msgs_max messages
+static std::multiset<DAQ_Msg_h> held;
+static unsigned msgs_max = 0;
+
+namespace snort
+{
+bool SFDAQInstance::hold_message(DAQ_Msg_h msg)
+{
+    if ( !held.count(msg) )
+    {
+        std::set<DAQ_Msg_h> msgs(held.begin(), held.end());
+        if ( msgs.size() >= msgs_max )
+            return false;
+    }
+    held.insert(msg);
+    return true;
+}
+
+void SFDAQInstance::release_message(DAQ_Msg_h msg)
+{ held.erase(held.find(msg)); }
+}
+
+TcpSegmentDescriptor::TcpSegmentDescriptor(snort::Flow* f, snort::Packet* p, TcpEventLogger&) :
+    flow(f), pkt(p) { }
+
+// init(TcpSegmentNode&) copies from another node; use that instead of the
+// segment descriptor which needs a packet
+static uint8_t src_buf[sizeof(TcpSegmentNode) + 65535];
+
+static TcpSegmentNode* new_seg(uint16_t len)
+{
+    TcpSegmentNode* src = (TcpSegmentNode*)src_buf;
+    src->tv = { 1, 2 };
+    src->buf = src->data;
+    src->offset = 0;
+    src->c_len = len;
+
+    return TcpSegmentNode::init(*src);
+}
+
+TEST_GROUP(tcp_segment_node)
+{
+    void setup() override
+    {
+        memset(&tcpStats, 0, sizeof(tcpStats));
+        mem_used = 0;
+        over = false;
+        TcpSegmentNode::setup();
+    }
+
+    void teardown() override
+    {
+        TcpSegmentNode::clear();
+    }
+};
+
+TEST(tcp_segment_node, size_classes)
+{
+    TcpSegmentNode* a = new_seg(1);
+    TcpSegmentNode* b = new_seg(100);
+    TcpSegmentNode* c = new_seg(1460);
+    TcpSegmentNode* d = new_seg(9000);
+    TcpSegmentNode* e = new_seg(9001);
+
+    CHECK(a->size == 64);
+    CHECK(b->size == 256);
+    CHECK(c->size == 1500);
+    CHECK(d->size == 9000);
+    CHECK(e->size == 9001);
+
+    CHECK(c->i_len == 1460 and c->c_len == 1460);
+    CHECK(c->tv.tv_sec == 1 and c->tv.tv_usec == 2);
+    CHECK(tcpStats.seg_pool_misses == 5);
+    CHECK(tcpStats.mem_in_use == 64 + 256 + 1500 + 9000 + 9001);
+
+    a->term();
+    b->term();
+    c->term();
+    d->term();
+    e->term();
+
+    CHECK(tcpStats.segs_released == 5);
+    CHECK(tcpStats.mem_in_use == 0);
+    TcpSegmentNode::clear();
+    CHECK(mem_used == 0);
+}
+
+TEST(tcp_segment_node, reuse)
+{
+    TcpSegmentNode* a = new_seg(1000);
+    a->term();
+
+    // same class is reused, other classes are not
+    TcpSegmentNode* b = new_seg(1460);
+    CHECK(a == b);
+    CHECK(tcpStats.seg_pool_hits == 1);
+
+    TcpSegmentNode* c = new_seg(200);
+    CHECK(tcpStats.seg_pool_misses == 2);
+
+    // oversize nodes are not pooled
+    TcpSegmentNode* d = new_seg(20000);
+    d->term();
+    d = new_seg(20000);
+    CHECK(tcpStats.seg_pool_misses == 4);
+
+    b->term();
+    c->term();
+    d->term();
+    TcpSegmentNode::clear();
+    CHECK(mem_used == 0);
+}
+
+TEST(tcp_segment_node, memcap)
+{
+    const size_t node = sizeof(TcpSegmentNode) + 1500;
+    TcpSegmentNode* a = new_seg(1460);
+    TcpSegmentNode* b = new_seg(1460);
+    CHECK(mem_used == 2 * node);
+
+    // pooled nodes are still counted
+    a->term();
+    CHECK(mem_used == 2 * node);
+    CHECK(tcpStats.mem_in_use == 1500);
+
+    // but not kept when over the threshold
+    over = true;
+    b->term();
+    CHECK(mem_used == node);
+    over = false;
+
+    new_seg(1460)->term();
+    new_seg(1460)->term();
+    CHECK(tcpStats.seg_pool_hits == 2);
+    CHECK(tcpStats.seg_pool_misses == 2);
+    CHECK(mem_used == node);
+}
+
+TEST(tcp_segment_node, trim)
+{
+    TcpSegmentNode* a = new_seg(10);
+    TcpSegmentNode* b = new_seg(1460);
+    TcpSegmentNode* c = new_seg(1460);
+    TcpSegmentNode* d = new_seg(100);
+
+    a->term();
+    b->term();
+    c->term();
+    CHECK(mem_used == 2 * (sizeof(TcpSegmentNode) + 1500) +
+        2 * sizeof(TcpSegmentNode) + 64 + 256);
+
+    // largest class first, one class per call
+    CHECK(TcpSegmentNode::trim());
+    CHECK(mem_used == 2 * sizeof(TcpSegmentNode) + 64 + 256);
+
+    CHECK(TcpSegmentNode::trim());
+    CHECK(mem_used == sizeof(TcpSegmentNode) + 256);
+    CHECK(!TcpSegmentNode::trim());
+    CHECK(tcpStats.seg_pool_trims == 2);
+
+    // trimmed classes come from the heap again
+    new_seg(1460)->term();
+    CHECK(tcpStats.seg_pool_hits == 0);
+
+    d->term();
+    TcpSegmentNode::clear();
+    CHECK(mem_used == 0);
+}
+
+// packets are just the fields init() looks at
+struct ZeroCopyPkt
+{
+    ZeroCopyPkt(DAQ_Msg_h msg, const uint8_t* data, uint16_t len)
+    {
+        memset(pkt_buf, 0, sizeof(pkt_buf));
+        p = (snort::Packet*)pkt_buf;
+        p->pkth = &pkth;
+        p->daq_msg = msg;
+        p->daq_instance = (snort::SFDAQInstance*)pkt_buf;
+        p->data = data;
+        p->dsize = len;
+    }
+
+    TcpSegmentNode* seg()
+    {
+        TcpEventLogger tel;
+        TcpSegmentDescriptor tsd(nullptr, p, tel);
+        return TcpSegmentNode::init(tsd, true);
+    }
+
+    alignas(snort::Packet) uint8_t pkt_buf[sizeof(snort::Packet)];
+    DAQ_PktHdr_t pkth = { };
+    snort::Packet* p;
+};
+
+static uint8_t wire[2][1514];
+
+static DAQ_Msg_t new_msg(uint8_t* data)
+{
+    DAQ_Msg_t msg = { };
+    msg.data = data;
+    msg.data_len = sizeof(wire[0]);
+    return msg;
+}
+
+TEST(tcp_segment_node, zero_copy)
+{
+    msgs_max = 2;
+    DAQ_Msg_t m0 = new_msg(wire[0]);
+    uint8_t other[100] = { };
+
+    // payload in the message is referenced
+    TcpSegmentNode* a = ZeroCopyPkt(&m0, wire[0] + 54, 1460).seg();
+    CHECK(a->payload() == wire[0] + 54);
+    CHECK(a->daq_msg == &m0);
+    CHECK(held.count(&m0) == 1);
+
+    // anything else is copied
+    TcpSegmentNode* b = ZeroCopyPkt(&m0, other, sizeof(other)).seg();
+    CHECK(b->payload() == b->data);
+    CHECK(b->daq_msg == nullptr);
+
+    CHECK(tcpStats.seg_bytes_referenced == 1460);
+    CHECK(tcpStats.seg_bytes_copied == sizeof(other));
+
+    a->term();
+    b->term();
+    CHECK(held.empty());
+    TcpSegmentNode::clear();
+    CHECK(mem_used == 0);
+}
+
+TEST(tcp_segment_node, zero_copy_reclaim)
+{
+    msgs_max = 1;
+    DAQ_Msg_t m0 = new_msg(wire[0]);
+    DAQ_Msg_t m1 = new_msg(wire[1]);
+    memset(wire[0], 'a', sizeof(wire[0]));
+
+    TcpSegmentNode* a = ZeroCopyPkt(&m0, wire[0] + 54, 100).seg();
+    TcpSegmentNode* b = ZeroCopyPkt(&m0, wire[0] + 154, 100).seg();
+    CHECK(held.count(&m0) == 2);
+
+    // another message can't be held until m0 is released
+    TcpSegmentNode* c = ZeroCopyPkt(&m1, wire[1] + 54, 100).seg();
+    CHECK(held.count(&m0) == 0);
+    CHECK(held.count(&m1) == 1);
+    CHECK(tcpStats.seg_refs_reclaimed == 2);
+    CHECK(tcpStats.seg_bytes_copied == 200);
+
+    CHECK(a->payload() == a->data and a->payload()[99] == 'a');
+    CHECK(b->payload() == b->data and b->payload()[0] == 'a');
+    CHECK(c->payload() == wire[1] + 54);
+
+    a->term();
+    b->term();
+    c->term();
+    CHECK(held.empty());
+
+    // with nothing to reclaim it just copies
+    msgs_max = 0;
+    a = ZeroCopyPkt(&m0, wire[0] + 54, 100).seg();
+    CHECK(a->payload() == a->data);
+    a->term();
+}
+
+#ifdef BENCHMARK_TEST
+//--------------------------------------------------------------------------
+// segments/sec for a reassembly like pattern: a window of queued segments
+// per flow with typical payload sizes, released in order as acked.  the
+// baseline is the per segment heap allocation used before pooling.
+//--------------------------------------------------------------------------
+
+static TcpSegmentNode* heap_seg(uint16_t len)
+{
+    size_t size = sizeof(TcpSegmentNode) + len;
+    memory::MemoryCap::update_allocations(size);
+    TcpSegmentNode* tsn = (TcpSegmentNode*)snort_alloc(size);
+    tsn->size = len;
+    tcpStats.mem_in_use += len;
+
+    tsn->i_len = tsn->c_len = len;
+    memcpy(tsn->data, src_buf + sizeof(TcpSegmentNode), len);
+    tsn->prev = tsn->next = nullptr;
+    return tsn;
+}
+
+static void heap_free(TcpSegmentNode* tsn)
+{
+    memory::MemoryCap::update_deallocations(sizeof(*tsn) + tsn->size);
+    tcpStats.mem_in_use -= tsn->size;
+    snort_free(tsn);
+}
+
+static uint16_t seg_len(uint32_t& seed)
+{
+    static const uint16_t lens[] = { 1460, 1460, 1460, 1448, 536, 40, 120, 1200 };
+    seed = seed * 1664525 + 1013904223;
+    return lens[seed >> 29];
+}
+
+template<typename Alloc, typename Free>
+static double seg_rate(unsigned segs, Alloc alloc, Free release)
+{
+    const unsigned window = 256;
+    std::vector<TcpSegmentNode*> q(window, nullptr);
+    uint32_t seed = 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned i = 0; i < segs; ++i )
+    {
+        TcpSegmentNode*& slot = q[i % window];
+
+        if ( slot )
+            release(slot);
+
+        slot = alloc(seg_len(seed));
+    }
+    for ( auto tsn : q )
+        if ( tsn )
+            release(tsn);
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return segs / secs.count();
+}
+
+TEST_GROUP(tcp_segment_node_benchmark)
+{
+    void setup() override
+    { TcpSegmentNode::setup(); }
+
+    void teardown() override
+    { TcpSegmentNode::clear(); }
+};
+
+TEST(tcp_segment_node_benchmark, segments)
+{
+    const unsigned segs = 10000000;
+
+    double before = seg_rate(segs, heap_seg, heap_free);
+
+    double after = seg_rate(segs,
+        [](uint16_t len) { return new_seg(len); },
+        [](TcpSegmentNode* tsn) { tsn->term(); });
+
+    printf("\n%16s %16s %8s\n", "heap segs/s", "pooled segs/s", "speedup");
+    printf("%16.0f %16.0f %8.2f\n", before, after, after / before);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -123,7 +123,7 @@ bool UdpSession::setup(Packet* p)
 
     SESSION_STATS_ADD(udpStats);
 
-    DataBus::publish(FLOW_STATE_EVENT, p);
+    DataBus::publish(FLOW_STATE_EVENT_ID, p);
 
     if ( Stream::expected_flow(flow, p) )
     {
@@ -64,4 +64,13 @@ inline long clock_usecs(long ticks)
 inline long clock_ticks(long usecs)
 { return usecs * clock_scale(); }
 
+inline uint64_t clock_nsecs(uint64_t ticks)
+{
+#ifdef USE_TSC_CLOCK
+    return ticks * 1000 / clock_scale();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(hr_duration(ticks)).count();
+#endif
+}
+
 #endif
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// latency_histogram.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "latency_histogram.h"
+
+#include <cmath>
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+void LatencyHistogram::merge(const LatencyHistogram& rhs)
+{
+    for ( unsigned i = 0; i < num_buckets; ++i )
+        buckets[i] += rhs.buckets[i];
+
+    count += rhs.count;
+
+    if ( rhs.max > max )
+        max = rhs.max;
+}
+
+void LatencyHistogram::reset()
+{
+    for ( unsigned i = 0; i < num_buckets; ++i )
+        buckets[i] = 0;
+
+    count = max = 0;
+}
+
+uint64_t LatencyHistogram::get_quantile(double q) const
+{
+    if ( !count )
+        return 0;
+
+    if ( q <= 0.0 )
+        q = 0.0;
+
+    uint64_t rank = (uint64_t)std::ceil(q * count);
+
+    if ( !rank )
+        rank = 1;
+
+    else if ( rank > count )
+        rank = count;
+
+    uint64_t sum = 0;
+
+    for ( unsigned i = 0; i < num_buckets; ++i )
+    {
+        sum += buckets[i];
+
+        if ( sum >= rank )
+        {
+            uint64_t upper = get_upper(i);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::get_upper(unsigned index)
+{
+    if ( index < sub_buckets )
+        return index;
+
+    if ( index >= num_buckets - 1 )
+        return UINT64_MAX;
+
+    unsigned shift = index / sub_buckets - 1;
+    uint64_t sub = index % sub_buckets + sub_buckets;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+// -----------------------------------------------------------------------------
+// unit tests
+// -----------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "latency histogram index", "[time][latency_histogram]" )
+{
+    SECTION( "linear below sub buckets" )
+    {
+        for ( uint64_t v = 0; v < 32; ++v )
+            CHECK( LatencyHistogram::get_index(v) == v );
+    }
+
+    SECTION( "value within bucket bounds" )
+    {
+        for ( uint64_t v = 1; v < (1ull << 40); v = v * 3 + 1 )
+        {
+            unsigned i = LatencyHistogram::get_index(v);
+            CHECK( v <= LatencyHistogram::get_upper(i) );
+            CHECK( v > LatencyHistogram::get_upper(i - 1) );
+        }
+    }
+
+    SECTION( "clamped" )
+    {
+        CHECK( LatencyHistogram::get_index(1ull << 48) == LatencyHistogram::num_buckets - 1 );
+        CHECK( LatencyHistogram::get_index(UINT64_MAX) == LatencyHistogram::num_buckets - 1 );
+    }
+}
+
+TEST_CASE( "latency histogram quantiles", "[time][latency_histogram]" )
+{
+    LatencyHistogram h;
+
+    CHECK( h.get_quantile(0.5) == 0 );
+
+    for ( uint64_t v = 1; v <= 1000; ++v )
+        h.record(v);
+
+    CHECK( h.get_count() == 1000 );
+    CHECK( h.get_max() == 1000 );
+    CHECK( h.get_quantile(1.0) == 1000 );
+
+    uint64_t p50 = h.get_quantile(0.5);
+    CHECK( p50 >= 500 );
+    CHECK( p50 <= 500 + 500 / LatencyHistogram::sub_buckets );
+
+    uint64_t p99 = h.get_quantile(0.99);
+    CHECK( p99 >= 990 );
+    CHECK( p99 <= 1000 );
+
+    SECTION( "merge" )
+    {
+        LatencyHistogram tail;
+        tail.record(1000000);
+
+        h.merge(tail);
+        CHECK( h.get_count() == 1001 );
+        CHECK( h.get_max() == 1000000 );
+        CHECK( h.get_quantile(1.0) == 1000000 );
+        CHECK( h.get_quantile(0.5) == p50 );
+    }
+
+    SECTION( "reset" )
+    {
+        h.reset();
+        CHECK( h.get_count() == 0 );
+        CHECK( h.get_max() == 0 );
+        CHECK( h.get_quantile(0.99) == 0 );
+    }
+}
+
+#endif
+
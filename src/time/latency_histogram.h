@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// latency_histogram.h
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// fixed size log-linear histogram of clock ticks.  each power of 2 is split
+// into 16 linear sub-buckets so any recorded value is reported within ~6%.
+// record() is a few instructions and never allocates; instances are meant
+// to be owned by one packet thread and read by that thread at output time.
+// values at or above 2^48 ticks land in the last bucket.
+
+#include <cstdint>
+
+#include "main/snort_types.h"
+
+class SO_PUBLIC LatencyHistogram
+{
+public:
+    static constexpr unsigned sub_bits = 4;
+    static constexpr unsigned sub_buckets = 1 << sub_bits;
+    static constexpr unsigned max_bits = 48;
+    static constexpr unsigned num_buckets = (max_bits - sub_bits + 1) * sub_buckets;
+
+    void record(uint64_t ticks)
+    {
+        ++buckets[get_index(ticks)];
+        ++count;
+
+        if ( ticks > max )
+            max = ticks;
+    }
+
+    void merge(const LatencyHistogram&);
+    void reset();
+
+    uint64_t get_count() const
+    { return count; }
+
+    uint64_t get_max() const
+    { return max; }
+
+    // the upper bound of the bucket holding the given quantile (0.0 - 1.0)
+    // in ticks; 0 if nothing was recorded
+    uint64_t get_quantile(double) const;
+
+    static unsigned get_index(uint64_t ticks)
+    {
+        if ( ticks < sub_buckets )
+            return (unsigned)ticks;
+
+        unsigned msb = 63 - __builtin_clzll(ticks);
+
+        if ( msb >= max_bits )
+            return num_buckets - 1;
+
+        unsigned shift = msb - sub_bits;
+        return (shift + 1) * sub_buckets + (unsigned)(ticks >> shift) - sub_buckets;
+    }
+
+    static uint64_t get_upper(unsigned index);
+
+private:
+    uint64_t count = 0;
+    uint64_t max = 0;
+    uint64_t buckets[num_buckets] = { };
+};
+
+#endif
+
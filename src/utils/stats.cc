@@ -197,6 +197,15 @@ const PegInfo pc_names[] =
     { CountType::SUM, "offload_fallback", "fast pattern offload search fallback attempts" },
     { CountType::SUM, "offload_failures", "fast pattern offload search failures" },
     { CountType::SUM, "offload_suspends", "fast pattern search suspends due to offload context chains" },
+    { CountType::SUM, "offload_batches", "rounds of offloaded searches run by the offload threads" },
+    { CountType::SUM, "offload_batched", "offloaded packets searched in a round with other packets" },
+    { CountType::SUM, "offload_steals", "offloaded packets taken from another offload thread's queue" },
+    { CountType::SUM, "offload_bytes", "bytes searched by the offload threads" },
+    { CountType::SUM, "offload_lt_10us", "offloads completed in less than 10 usecs" },
+    { CountType::SUM, "offload_lt_100us", "offloads completed in 10 to 100 usecs" },
+    { CountType::SUM, "offload_lt_1ms", "offloads completed in 100 usecs to 1 msec" },
+    { CountType::SUM, "offload_lt_10ms", "offloads completed in 1 to 10 msecs" },
+    { CountType::SUM, "offload_ge_10ms", "offloads completed in 10 msecs or more" },
     { CountType::SUM, "pcre_match_limit", "total number of times pcre hit the match limit" },
     { CountType::SUM, "pcre_recursion_limit", "total number of times pcre hit the recursion limit" },
     { CountType::SUM, "pcre_error", "total number of times pcre returns error" },
@@ -60,6 +60,15 @@ struct PacketCount
     PegCount offload_fallback;
     PegCount offload_failures;
     PegCount offload_suspends;
+    PegCount offload_batches;
+    PegCount offload_batched;
+    PegCount offload_steals;
+    PegCount offload_bytes;
+    PegCount offload_lt_10us;
+    PegCount offload_lt_100us;
+    PegCount offload_lt_1ms;
+    PegCount offload_lt_10ms;
+    PegCount offload_ge_10ms;
     PegCount pcre_match_limit;
     PegCount pcre_recursion_limit;
     PegCount pcre_error;
@@ -85,6 +94,9 @@ struct AuxCount
     PegCount idle;
     PegCount rx_bytes;
     PegCount skipped;
+    PegCount batches;
+    PegCount batch_usecs;
+    PegCount max_batch_usecs;
 };
 
 extern ProcessCount proc_stats;
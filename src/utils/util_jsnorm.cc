@@ -215,6 +215,13 @@ struct JSNormState
     uint8_t* unicode_map;
     char* overwrite;
     Dbuf dest;
+
+    // where the last possible keyword started so a stream can back up to it
+    const char* save_src;
+    uint8_t save_prev_event;
+    uint16_t save_num_spaces;
+    uint16_t save_alerts;
+    bool incomplete;
 };
 
 struct UnescapeState
@@ -1170,6 +1177,10 @@ static int JSNorm_exec(JSNormState* s, ActionJSNorm a, int c, const char* src, u
         break;
     case ACT_SAVE:
         s->overwrite = cur_ptr;
+        s->save_src = *ptr;
+        s->save_prev_event = s->prev_event;
+        s->save_num_spaces = s->num_spaces;
+        s->save_alerts = js->alerts;
         WriteJSNormChar(s, c, js);
         break;
     case ACT_SPACE:
@@ -1186,6 +1197,9 @@ static int JSNorm_exec(JSNormState* s, ActionJSNorm a, int c, const char* src, u
         }
         UnescapeDecode(src, srclen, ptr, &dest, sizeof(decoded_out), &bcopied, js, s->unicode_map);
         WriteJSNorm(s, dest, bcopied, js);
+        // the call may continue past the end of src
+        if (*ptr >= src + srclen)
+            s->incomplete = true;
         break;
     case ACT_SFCC:
         if ( s->overwrite && (s->overwrite < cur_ptr))
@@ -1194,6 +1208,8 @@ static int JSNorm_exec(JSNormState* s, ActionJSNorm a, int c, const char* src, u
         }
         StringFromCharCodeDecode(src, srclen, ptr, &dest, sizeof(decoded_out), &bcopied, js, s->unicode_map);
         WriteJSNorm(s, dest, bcopied, js);
+        if (*ptr >= src + srclen)
+            s->incomplete = true;
         break;
     case ACT_QUIT:
         iRet = RET_QUIT;
@@ -1237,33 +1253,34 @@ static int JSNorm_scan_fsm(JSNormState* s, int c, const char* src, uint16_t srcl
     return(JSNorm_exec(s, (ActionJSNorm)m->action, c, src, srclen, ptr, js));
 }
 
-int JSNormalizeDecode(const char* src, uint16_t srclen, char* dst, uint16_t destlen, const char** ptr,
-    int* bytes_copied, JSState* js, uint8_t* iis_unicode_map)
+static void JSNormInit(JSNormState* s, char* dst, uint16_t destlen, uint8_t* iis_unicode_map)
 {
-    int iRet = RET_OK;
-    const char* start, * end;
-    JSNormState s;
-
-    if (js == nullptr)
-    {
-        return RET_QUIT;
-    }
-
-    start = src;
-    end = src + srclen;
+    s->fsm = 0;
+    s->overwrite = nullptr;
+    s->dest.data = dst;
+    s->dest.size = destlen;
+    s->dest.len = 0;
+    s->prev_event = 0;
+    s->unicode_map = iis_unicode_map;
+    s->num_spaces = 0;
+    s->save_src = nullptr;
+    s->save_prev_event = 0;
+    s->save_num_spaces = 0;
+    s->save_alerts = 0;
+    s->incomplete = false;
+}
 
-    s.fsm = 0;
-    s.overwrite = nullptr;
-    s.dest.data = dst;
-    s.dest.size = destlen;
-    s.dest.len = 0;
-    s.prev_event = 0;
-    s.unicode_map = iis_unicode_map;
-    s.num_spaces = 0;
+// returns RET_QUIT if the end of the script was found
+static int JSNormRun(JSNormState* s, const char* src, uint16_t srclen, const char** ptr,
+    JSState* js)
+{
+    int iRet = RET_OK;
+    const char* start = src;
+    const char* end = src + srclen;
 
     while (!outBounds(start, end, *ptr))
     {
-        iRet = JSNorm_scan_fsm(&s, **ptr, src, srclen, ptr, js);
+        iRet = JSNorm_scan_fsm(s, **ptr, src, srclen, ptr, js);
         if (iRet != RET_OK)
         {
             break;
@@ -1276,10 +1293,67 @@ int JSNormalizeDecode(const char* src, uint16_t srclen, char* dst, uint16_t dest
         (*ptr)++;
     }
 
+    return iRet;
+}
+
+int JSNormalizeDecode(const char* src, uint16_t srclen, char* dst, uint16_t destlen, const char** ptr,
+    int* bytes_copied, JSState* js, uint8_t* iis_unicode_map)
+{
+    JSNormState s;
+
+    if (js == nullptr)
+    {
+        return RET_QUIT;
+    }
+
+    JSNormInit(&s, dst, destlen, iis_unicode_map);
+    JSNormRun(&s, src, srclen, ptr, js);
+
     *bytes_copied = s.dest.len;
 
     return RET_OK;
 }
+
+bool JSNormalizeStream(const char* src, uint16_t srclen, char* dst, uint16_t destlen,
+    const char** ptr, int* bytes_copied, JSState* js, JSStream* stream, uint16_t max_hold,
+    uint8_t* iis_unicode_map)
+{
+    JSNormState s;
+    const char* end = src + srclen;
+
+    JSNormInit(&s, dst, destlen, iis_unicode_map);
+    s.fsm = stream->fsm;
+    s.prev_event = stream->prev_event;
+    s.num_spaces = stream->num_spaces;
+
+    const bool quit = (JSNormRun(&s, src, srclen, ptr, js) == RET_QUIT);
+
+    if (!quit)
+    {
+        // Part way through a keyword or through the argument list of a call we decode. Back up
+        // to where the keyword started so the caller can try again with more text.
+        const bool in_keyword = (s.fsm > Z0) && (s.fsm < Z3);
+
+        if ((in_keyword || s.incomplete) && s.save_src && (end - s.save_src <= max_hold))
+        {
+            *ptr = s.save_src;
+            s.dest.len = s.overwrite - s.dest.data;
+            s.fsm = 0;
+            s.prev_event = s.save_prev_event;
+            s.num_spaces = s.save_num_spaces;
+            js->alerts = s.save_alerts;
+        }
+        else if (*ptr > end)
+            *ptr = end;
+    }
+
+    stream->fsm = quit ? 0 : s.fsm;
+    stream->prev_event = quit ? 0 : s.prev_event;
+    stream->num_spaces = quit ? 0 : s.num_spaces;
+    *bytes_copied = s.dest.len;
+
+    return quit;
+}
 }
 
 
@@ -42,6 +42,25 @@ struct JSState
 
 SO_PUBLIC int JSNormalizeDecode(
     const char*, uint16_t, char*, uint16_t destlen, const char**, int*, JSState*, uint8_t*);
+
+// Position of the normalizer inside a script that arrives in pieces. Zero initialize before the
+// first piece.
+struct JSStream
+{
+    uint8_t fsm;
+    uint8_t prev_event;
+    uint16_t num_spaces;
+};
+
+// Resumable form of JSNormalizeDecode. Normalizes the script text at *ptr continuing from stream
+// and returns true when the end of the script is found. Otherwise *ptr is normally left at the
+// end of src. If src ends part way through a keyword or through a call whose argument is decoded,
+// and that construct started no more than max_hold octets from the end, *ptr is left where it
+// started and nothing from there on is written. The caller should present those octets again
+// at the front of the next piece. Use max_hold of zero for the final piece.
+SO_PUBLIC bool JSNormalizeStream(
+    const char*, uint16_t, char*, uint16_t destlen, const char**, int*, JSState*, JSStream*,
+    uint16_t max_hold, uint8_t*);
 }
 #endif
 
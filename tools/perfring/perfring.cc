@@ -0,0 +1,403 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2019-2019 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// perfring.cc
+
+//  This program exports records from the perf_monitor ring format files
+//  (perf_monitor.format = 'ring') to CSV.  The file is mapped read only so
+//  it can be read while Snort is writing it.  Records are kept in time
+//  order so a time range is found with a binary search of the timestamp
+//  column and only the selected columns are read.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/network_inspectors/perf_monitor/perf_ring.h"
+
+using namespace std;
+using namespace perf_ring;
+
+static string in_file;
+static string out_file;
+static uint64_t b_stamp = UINT64_MAX, a_stamp = 0;
+static vector<string> wanted;
+static bool list_only = false;
+
+static void help()
+{
+    cout << "perf_monitor Ring File Exporter for Snort 3\n\n"
+         << "Records are output as CSV with a header line, oldest first\n\n"
+         << "Usage: perfring -i file [-a time] [-b time] [-c columns] [-o file] [-l]\n"
+         << "-i: ring file from Snort (required)\n"
+         << "-a: export records after or equal to this timestamp\n"
+         << "-b: export records before or equal to this timestamp\n"
+         << "-c: comma separated columns to export (default all)\n"
+         << "-o: write to this file instead of stdout\n"
+         << "-l: list the columns and ring state instead of exporting\n";
+}
+
+static bool parse_args(int argc, char* argv[])
+{
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "i:a:b:c:o:lh")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'i':
+            in_file = optarg;
+            break;
+
+        case 'a':
+            a_stamp = strtoull(optarg, nullptr, 10);
+            break;
+
+        case 'b':
+            b_stamp = strtoull(optarg, nullptr, 10);
+            break;
+
+        case 'c':
+        {
+            string s = optarg;
+            size_t pos = 0, end;
+
+            while ( (end = s.find(',', pos)) != string::npos )
+            {
+                wanted.emplace_back(s.substr(pos, end - pos));
+                pos = end + 1;
+            }
+            wanted.emplace_back(s.substr(pos));
+            break;
+        }
+        case 'o':
+            out_file = optarg;
+            break;
+
+        case 'l':
+            list_only = true;
+            break;
+
+        default:
+            return false;
+        }
+    }
+    return !in_file.empty();
+}
+
+//--------------------------------------------------------------------------
+// output
+//--------------------------------------------------------------------------
+
+class Output
+{
+public:
+    Output(FILE* f) : file(f)
+    { buf.reserve(size + 32); }
+
+    ~Output()
+    { flush(); }
+
+    void put(const char* s)
+    {
+        buf += s;
+        check();
+    }
+
+    void put(uint64_t v)
+    {
+        char tmp[24];
+        char* p = tmp + sizeof(tmp);
+
+        do
+        {
+            *--p = '0' + v % 10;
+            v /= 10;
+        }
+        while ( v );
+
+        buf.append(p, tmp + sizeof(tmp) - p);
+        check();
+    }
+
+    void put(char c)
+    {
+        buf += c;
+        check();
+    }
+
+    void flush()
+    {
+        fwrite(buf.data(), buf.size(), 1, file);
+        buf.clear();
+    }
+
+private:
+    void check()
+    {
+        if ( buf.size() >= size )
+            flush();
+    }
+
+    static const size_t size = 1 << 16;
+    FILE* file;
+    string buf;
+};
+
+//--------------------------------------------------------------------------
+// ring access
+//--------------------------------------------------------------------------
+
+struct Ring
+{
+    const uint8_t* base;
+    const Header* hdr;
+    const uint64_t* ts;
+
+    uint64_t get_ts(uint64_t n) const
+    { return ts[n % hdr->capacity]; }
+
+    uint64_t get_count() const
+    { return hdr->count.load(std::memory_order_acquire); }
+};
+
+// first record in [lo, hi) with timestamp >= t (or > t if after)
+static uint64_t search(const Ring& r, uint64_t lo, uint64_t hi, uint64_t t, bool after)
+{
+    while ( lo < hi )
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        uint64_t v = r.get_ts(mid);
+
+        if ( v < t or (after and v == t) )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool get_columns(const Ring& r, vector<unsigned>& cols)
+{
+    unsigned n = r.hdr->columns;
+
+    if ( wanted.empty() )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+            cols.emplace_back(i);
+        return true;
+    }
+
+    cols.emplace_back(0);
+
+    for ( const auto& w : wanted )
+    {
+        unsigned i = 1;
+
+        while ( i < n and w != get_name(r.base, i) )
+            ++i;
+
+        if ( i == n )
+        {
+            cerr << "unknown column: " << w << "\n";
+            return false;
+        }
+        cols.emplace_back(i);
+    }
+    return true;
+}
+
+static void list(const Ring& r)
+{
+    uint64_t count = r.get_count();
+    uint64_t cap = r.hdr->capacity;
+    uint64_t first = count > cap ? count - cap + 1 : 0;
+
+    cout << "capacity: " << cap << "\n";
+    cout << "records: " << count << "\n";
+
+    if ( count > first )
+    {
+        cout << "first: " << r.get_ts(first) << "\n";
+        cout << "last: " << r.get_ts(count - 1) << "\n";
+    }
+
+    cout << "columns:\n";
+
+    for ( unsigned i = 0; i < r.hdr->columns; ++i )
+        cout << "    " << get_name(r.base, i) << "\n";
+}
+
+static void export_csv(const Ring& r, const vector<unsigned>& cols, Output& out)
+{
+    out.put('#');
+
+    for ( unsigned i = 0; i < cols.size(); ++i )
+    {
+        if ( i )
+            out.put(',');
+        out.put(get_name(r.base, cols[i]));
+    }
+    out.put('\n');
+
+    uint64_t count = r.get_count();
+    uint64_t cap = r.hdr->capacity;
+
+    // the slot of count - cap may be in the middle of being overwritten
+    uint64_t first = count >= cap ? count - cap + 1 : 0;
+
+    uint64_t lo = search(r, first, count, a_stamp, false);
+    uint64_t hi = search(r, lo, count, b_stamp, true);
+
+    const unsigned block = 4096;
+    vector<uint64_t> rows;
+    unsigned skipped = 0;
+
+    for ( uint64_t n = lo; n < hi; n += block )
+    {
+        uint64_t end = min(hi, n + block);
+        rows.clear();
+
+        // copy a block column by column, then make sure none of it was reused
+        for ( auto c : cols )
+        {
+            const uint64_t* col = get_column(r.base, r.hdr, c);
+
+            for ( uint64_t i = n; i < end; ++i )
+                rows.emplace_back(col[i % cap]);
+        }
+
+        // the copies must be done before count is reloaded
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = r.get_count();
+        uint64_t valid = now >= cap ? now - cap + 1 : 0;
+        uint64_t len = end - n;
+
+        for ( uint64_t i = 0; i < len; ++i )
+        {
+            if ( n + i < valid )
+            {
+                ++skipped;
+                continue;
+            }
+
+            for ( unsigned c = 0; c < cols.size(); ++c )
+            {
+                if ( c )
+                    out.put(',');
+                out.put(rows[c * len + i]);
+            }
+            out.put('\n');
+        }
+    }
+
+    if ( skipped )
+        cerr << "skipped " << skipped << " records overwritten during export\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if ( !parse_args(argc, argv) )
+    {
+        help();
+        return 1;
+    }
+
+    int fd = open(in_file.c_str(), O_RDONLY);
+    struct stat st;
+
+    if ( fd < 0 or fstat(fd, &st) )
+    {
+        cerr << "can't open " << in_file << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    if ( (size_t)st.st_size < page_size )
+    {
+        cerr << in_file << " is not a ring file\n";
+        return 1;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if ( p == MAP_FAILED )
+    {
+        cerr << "can't map " << in_file << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    Ring r;
+    r.base = (const uint8_t*)p;
+    r.hdr = (const Header*)p;
+
+    // bound columns * capacity by the file size before computing the
+    // expected size so it can't wrap around to match
+    if ( !check_magic(r.hdr) or r.hdr->version != version or
+        !r.hdr->columns or !r.hdr->capacity or
+        r.hdr->capacity > (size_t)st.st_size / sizeof(uint64_t) / r.hdr->columns or
+        r.hdr->data_offset != get_data_offset(r.hdr->columns) or
+        (size_t)st.st_size != get_file_size(r.hdr->columns, r.hdr->capacity) )
+    {
+        cerr << in_file << " is not a version " << version << " ring file\n";
+        return 1;
+    }
+    r.ts = get_column(r.base, r.hdr, 0);
+
+    if ( list_only )
+    {
+        list(r);
+        return 0;
+    }
+
+    vector<unsigned> cols;
+
+    if ( !get_columns(r, cols) )
+        return 1;
+
+    FILE* f = out_file.empty() ? stdout : fopen(out_file.c_str(), "w");
+
+    if ( !f )
+    {
+        cerr << "can't open " << out_file << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    {
+        Output out(f);
+        export_csv(r, cols, out);
+    }
+
+    if ( f != stdout )
+        fclose(f);
+
+    munmap(p, st.st_size);
+    return 0;
+}
+